@@ -229,6 +229,39 @@ static inline block_t *block_Duplicate( const block_t *p_block )
     return p_dup;
 }
 
+/**
+ * Shares a block.
+ *
+ * Creates a new block referencing the payload of an existing block, without
+ * copying it. The payload is freed when the last block referencing it is
+ * released.
+ *
+ * The payload of a shared block is read-only. A consumer that modifies the
+ * data in place must call block_MakeWritable() first. Resizing the block with
+ * block_Realloc() is always safe: the data is copied if needed.
+ *
+ * @return the new block on success, NULL on error.
+ */
+VLC_API block_t *block_Share(block_t *block) VLC_USED;
+
+/**
+ * Checks if a block payload can be modified in place.
+ *
+ * @return false if the payload is shared with other blocks, true otherwise.
+ */
+VLC_API bool block_IsWritable(const block_t *block) VLC_USED;
+
+/**
+ * Makes a block writable.
+ *
+ * If the block payload is shared (see block_Share()), the block is replaced
+ * with a private copy. Otherwise, the block is returned unchanged.
+ *
+ * @return the writable block on success, NULL on error.
+ * @note On error, the block is discarded.
+ */
+VLC_API block_t *block_MakeWritable(block_t *block) VLC_USED;
+
 /**
  * Wraps heap in a block.
  *
@@ -637,6 +670,91 @@ static inline void vlc_fifo_Cleanup(void *fifo)
 
 /** @} */
 
+/**
+ * \defgroup spsc_fifo Single-producer single-consumer block FIFO
+ * Lock-free block queue for exactly one writing and one reading thread
+ *
+ * Unlike block_fifo_t, queuing and dequeuing do not take any lock. The
+ * consumer only sleeps, on a condition variable, when the queue is empty, and
+ * the producer only signals it if the consumer is actually sleeping.
+ *
+ * block_SpscPut() must always be called from the same thread (or with
+ * external serialization), and so must block_SpscGet() and
+ * block_SpscTryGet().
+ * @{
+ */
+
+typedef struct block_spsc_t block_spsc_t;
+
+/**
+ * Creates a single-producer single-consumer queue of blocks.
+ *
+ * The created queue must be released with block_SpscRelease().
+ *
+ * @return the FIFO or NULL on memory error
+ */
+VLC_API block_spsc_t *block_SpscNew(void) VLC_USED VLC_MALLOC;
+
+/**
+ * Destroys a FIFO created by block_SpscNew().
+ *
+ * @note Any queued blocks are also destroyed.
+ * @warning Neither the producer nor the consumer may be using the FIFO when
+ * this function is called.
+ */
+VLC_API void block_SpscRelease(block_spsc_t *);
+
+/**
+ * Queues a block list at the end of a FIFO.
+ *
+ * This function never blocks. It may only be called by the producer thread.
+ *
+ * @param fifo queue
+ * @param block head of a block list to queue (may be NULL)
+ */
+VLC_API void block_SpscPut(block_spsc_t *fifo, block_t *block);
+
+/**
+ * Dequeues the first block from the FIFO without waiting.
+ *
+ * This function may only be called by the consumer thread.
+ *
+ * @return a block, or NULL if the FIFO is empty
+ */
+VLC_API block_t *block_SpscTryGet(block_spsc_t *) VLC_USED;
+
+/**
+ * Dequeues the first block from the FIFO. If necessary, waits until there is
+ * one block in the queue. This function is (always) cancellation point.
+ *
+ * This function may only be called by the consumer thread.
+ *
+ * @return a valid block
+ */
+VLC_API block_t *block_SpscGet(block_spsc_t *) VLC_USED;
+
+/**
+ * Counts blocks in a FIFO.
+ *
+ * @note This function can be called from any thread. The value is only a
+ * snapshot, as the producer and the consumer may be changing it concurrently.
+ *
+ * @return the number of blocks in the FIFO (zero if it is empty)
+ */
+VLC_API size_t block_SpscGetCount(const block_spsc_t *) VLC_USED;
+
+/**
+ * Counts bytes in a FIFO.
+ *
+ * This is the counterpart of vlc_fifo_GetBytes(), with the same caveat as
+ * block_SpscGetCount().
+ *
+ * @return the total number of bytes
+ */
+VLC_API size_t block_SpscGetBytes(const block_spsc_t *) VLC_USED;
+
+/** @} */
+
 /** @} */
 
 #endif /* VLC_BLOCK_H */
@@ -65,8 +65,10 @@ VLC_API unsigned vlc_CPU(void);
 
 # ifdef __SSE2__
 #  define vlc_CPU_SSE2() (1)
+#  define VLC_SSE2
 # else
 #  define vlc_CPU_SSE2() ((vlc_CPU() & VLC_CPU_SSE2) != 0)
+#  define VLC_SSE2 __attribute__ ((__target__ ("sse2")))
 # endif
 
 # ifdef __SSE3__
@@ -83,8 +85,10 @@ VLC_API unsigned vlc_CPU(void);
 
 # ifdef __SSE4_1__
 #  define vlc_CPU_SSE4_1() (1)
+#  define VLC_SSE4_1
 # else
 #  define vlc_CPU_SSE4_1() ((vlc_CPU() & VLC_CPU_SSE4_1) != 0)
+#  define VLC_SSE4_1 __attribute__ ((__target__ ("sse4.1")))
 # endif
 
 # ifdef __SSE4_2__
@@ -101,14 +105,18 @@ VLC_API unsigned vlc_CPU(void);
 
 # ifdef __AVX__
 #  define vlc_CPU_AVX() (1)
+#  define VLC_AVX
 # else
 #  define vlc_CPU_AVX() ((vlc_CPU() & VLC_CPU_AVX) != 0)
+#  define VLC_AVX __attribute__ ((__target__ ("avx")))
 # endif
 
 # ifdef __AVX2__
 #  define vlc_CPU_AVX2() (1)
+#  define VLC_AVX2
 # else
 #  define vlc_CPU_AVX2() ((vlc_CPU() & VLC_CPU_AVX2) != 0)
+#  define VLC_AVX2 __attribute__ ((__target__ ("avx2")))
 # endif
 
 # ifdef __3dNOW__
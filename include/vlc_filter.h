@@ -279,6 +279,43 @@ VLC_API int filter_Blend( filter_t *, picture_t *p_dst, int i_dst_x, int i_dst_y
  */
 VLC_API void filter_DeleteBlend( filter_t * );
 
+/**
+ * Slice callback of a slice-parallel video filter.
+ *
+ * It processes the slice \p i_slice out of \p i_slices, usually a horizontal
+ * band of the pictures (see filter_GetSliceLines()). Slices of a same call
+ * run concurrently, so they must not write to the same memory.
+ */
+typedef void (*filter_slice_cb)( filter_t *, void *opaque,
+                                 unsigned i_slice, unsigned i_slices );
+
+/**
+ * Returns the number of horizontal bands a video filter should split
+ * \p i_lines picture lines into, according to the number of filter threads
+ * ("video-filter-threads") and to the size of the bands.
+ */
+VLC_API unsigned filter_GetSliceCount( filter_t *, unsigned i_lines );
+
+/**
+ * Runs \p pf_slice on each of the \p i_slices slices, on the filter threads
+ * shared by the instance and on the calling thread, then waits for all of
+ * them to be completed.
+ */
+VLC_API void filter_RunSlices( filter_t *, unsigned i_slices,
+                               filter_slice_cb pf_slice, void *opaque );
+
+/**
+ * Returns the lines [*pi_start, *pi_end) of a plane of \p i_lines lines
+ * belonging to the band \p i_slice out of \p i_slices.
+ */
+static inline void filter_GetSliceLines( unsigned i_lines, unsigned i_slice,
+                                         unsigned i_slices,
+                                         unsigned *pi_start, unsigned *pi_end )
+{
+    *pi_start = (uint64_t)i_lines * i_slice / i_slices;
+    *pi_end   = (uint64_t)i_lines * (i_slice + 1) / i_slices;
+}
+
 /**
  * Create a picture_t *(*)( filter_t *, picture_t * ) compatible wrapper
  * using a void (*)( filter_t *, picture_t *, picture_t * ) function
@@ -377,7 +377,10 @@ typedef enum input_item_meta_request_option_t
     META_REQUEST_OPTION_SCOPE_LOCAL   = 0x01,
     META_REQUEST_OPTION_SCOPE_NETWORK = 0x02,
     META_REQUEST_OPTION_SCOPE_ANY     = 0x03,
-    META_REQUEST_OPTION_DO_INTERACT   = 0x04
+    META_REQUEST_OPTION_DO_INTERACT   = 0x04,
+    /* the item is waited for (visible, or explicitly requested by the user):
+     * queue it ahead of the requests without this flag */
+    META_REQUEST_OPTION_PRIORITY      = 0x08
 } input_item_meta_request_option_t;
 
 /* status of the on_preparse_ended() callback */
@@ -418,6 +421,7 @@ struct input_stats_t
     int64_t i_read_packets;
     int64_t i_read_bytes;
     float f_input_bitrate;
+    int64_t i_lost_packets;
 
     /* Demux */
     int64_t i_demux_read_packets;
@@ -810,6 +810,9 @@ static int media_parse(libvlc_media_t *media, bool b_async,
             parse_scope |= META_REQUEST_OPTION_SCOPE_NETWORK;
         if (parse_flag & libvlc_media_do_interact)
             parse_scope |= META_REQUEST_OPTION_DO_INTERACT;
+        /* the caller is waiting for the result */
+        if (!b_async)
+            parse_scope |= META_REQUEST_OPTION_PRIORITY;
         ret = libvlc_MetadataRequest(libvlc, item, parse_scope, &input_preparser_callbacks, media, timeout, media);
         if (ret != VLC_SUCCESS)
             return ret;
@@ -42,6 +42,7 @@
 #include <vlc_network.h>
 #include <vlc_block.h>
 #include <vlc_interrupt.h>
+#include <vlc_atomic.h>
 #ifdef HAVE_POLL
 # include <poll.h>
 #endif
@@ -58,6 +59,10 @@ static void Close( vlc_object_t * );
 #define BUFFER_TEXT N_("Receive buffer")
 #define BUFFER_LONGTEXT N_("UDP receive buffer size (bytes)" )
 #define TIMEOUT_TEXT N_("UDP Source timeout (sec)")
+#define BATCH_TEXT N_("Datagrams per receive call")
+#define BATCH_LONGTEXT N_("Maximum number of datagrams read at once from " \
+    "the socket. Reading them in batches saves system calls at high bit " \
+    "rates. 1 reads them one by one.")
 
 vlc_module_begin ()
     set_shortname( N_("UDP" ) )
@@ -68,6 +73,10 @@ vlc_module_begin ()
     add_obsolete_integer( "server-port" ) /* since 2.0.0 */
     add_obsolete_integer( "udp-buffer" ) /* since 3.0.0 */
     add_integer( "udp-timeout", -1, TIMEOUT_TEXT, NULL, true )
+#ifdef HAVE_RECVMMSG
+    add_integer( "udp-batch", 32, BATCH_TEXT, BATCH_LONGTEXT, true )
+        change_integer_range( 1, 1024 )
+#endif
 
     set_capability( "access", 0 )
     add_shortcut( "udp", "udpstream", "udp4", "udp6" )
@@ -75,20 +84,145 @@ vlc_module_begin ()
     set_callbacks( Open, Close )
 vlc_module_end ()
 
+#ifdef SO_RXQ_OVFL
+/* Ancillary data carrying the count of datagrams dropped by the kernel */
+typedef union
+{
+    struct cmsghdr hdr;
+    char buf[CMSG_SPACE(sizeof (uint32_t))];
+} udp_cmsg_t;
+#endif
+
+#ifdef HAVE_RECVMMSG
+typedef struct udp_pool_t udp_pool_t;
+
+typedef struct udp_slot_t
+{
+    block_t self;
+    udp_pool_t *pool;
+    struct udp_slot_t *next; /* in the free list */
+    uint8_t *buffer;
+} udp_slot_t;
+
+/* Preallocated datagram blocks, recycled as soon as they are released */
+struct udp_pool_t
+{
+    vlc_atomic_rc_t rc; /* one for the access, one per block in use */
+    vlc_mutex_t lock;
+    udp_slot_t *free;
+    size_t size;
+    uint8_t *buffers;
+    udp_slot_t slots[];
+};
+#endif
+
 typedef struct
 {
     int fd;
     int timeout;
     size_t mtu;
     block_t *overflow_block;
+
+    uint32_t dropped; /* kernel drop counter, wraps around */
+    uint64_t lost; /* datagrams dropped by the kernel */
+
+#ifdef HAVE_RECVMMSG
+    /* batched receive */
+    unsigned batch;
+    unsigned count; /* datagrams received by the last call */
+    unsigned next; /* next datagram to return */
+    udp_pool_t *pool;
+    block_t **blocks;
+    struct mmsghdr *msgs;
+    struct iovec *iovs; /* datagram and overflow, per message */
+# ifdef SO_RXQ_OVFL
+    udp_cmsg_t *cmsgs;
+# endif
+#endif
 } access_sys_t;
 
 /*****************************************************************************
  * Local prototypes
  *****************************************************************************/
 static block_t *BlockUDP( stream_t *, bool * );
+#ifdef HAVE_RECVMMSG
+static block_t *BlockUDPBatch( stream_t *, bool * );
+static void BatchClean( access_sys_t * );
+#endif
 static int Control( stream_t *, int, va_list );
 
+#ifdef HAVE_RECVMMSG
+static void UdpPoolRelease( udp_pool_t *pool )
+{
+    if( !vlc_atomic_rc_dec( &pool->rc ) )
+        return;
+    vlc_mutex_destroy( &pool->lock );
+    free( pool->buffers );
+    free( pool );
+}
+
+static void UdpSlotRelease( block_t *block )
+{
+    udp_slot_t *slot = container_of( block, udp_slot_t, self );
+    udp_pool_t *pool = slot->pool;
+
+    vlc_mutex_lock( &pool->lock );
+    slot->next = pool->free;
+    pool->free = slot;
+    vlc_mutex_unlock( &pool->lock );
+    UdpPoolRelease( pool );
+}
+
+static const struct vlc_block_callbacks udp_slot_cbs =
+{
+    UdpSlotRelease,
+};
+
+static udp_pool_t *UdpPoolNew( unsigned count, size_t size )
+{
+    udp_pool_t *pool = malloc( sizeof (*pool) + count * sizeof (udp_slot_t) );
+    if( unlikely(pool == NULL) )
+        return NULL;
+
+    pool->buffers = malloc( count * size );
+    if( unlikely(pool->buffers == NULL) )
+    {
+        free( pool );
+        return NULL;
+    }
+
+    vlc_atomic_rc_init( &pool->rc );
+    vlc_mutex_init( &pool->lock );
+    pool->size = size;
+    pool->free = NULL;
+    for( unsigned i = 0; i < count; i++ )
+    {
+        udp_slot_t *slot = &pool->slots[i];
+        slot->pool = pool;
+        slot->buffer = &pool->buffers[i * size];
+        slot->next = pool->free;
+        pool->free = slot;
+    }
+    return pool;
+}
+
+/* Falls back to the heap if every slot is still in use downstream */
+static block_t *UdpPoolGet( udp_pool_t *pool )
+{
+    vlc_mutex_lock( &pool->lock );
+    udp_slot_t *slot = pool->free;
+    if( slot != NULL )
+        pool->free = slot->next;
+    vlc_mutex_unlock( &pool->lock );
+
+    if( slot == NULL )
+        return block_Alloc( pool->size );
+
+    vlc_atomic_rc_inc( &pool->rc );
+    return block_Init( &slot->self, &udp_slot_cbs, slot->buffer, pool->size );
+}
+#endif
+
 /*****************************************************************************
  * Open: open the socket
  *****************************************************************************/
@@ -181,6 +315,45 @@ static int Open( vlc_object_t *p_this )
     if( sys->timeout > 0)
         sys->timeout *= 1000;
 
+    sys->dropped = 0;
+    sys->lost = 0;
+#ifdef SO_RXQ_OVFL
+    setsockopt( sys->fd, SOL_SOCKET, SO_RXQ_OVFL, &(int){ 1 }, sizeof (int) );
+#endif
+
+#ifdef HAVE_RECVMMSG
+    sys->batch = var_InheritInteger( p_access, "udp-batch" );
+    sys->count = sys->next = 0;
+    sys->pool = NULL;
+    sys->blocks = NULL;
+    sys->msgs = NULL;
+    sys->iovs = NULL;
+# ifdef SO_RXQ_OVFL
+    sys->cmsgs = NULL;
+# endif
+    if( sys->batch > 1 )
+    {
+        sys->blocks = calloc( sys->batch, sizeof (*sys->blocks) );
+        sys->msgs = calloc( sys->batch, sizeof (*sys->msgs) );
+        sys->iovs = calloc( 2 * sys->batch, sizeof (*sys->iovs) );
+        sys->pool = UdpPoolNew( 4 * sys->batch, sys->mtu );
+        bool ok = sys->blocks != NULL && sys->msgs != NULL
+               && sys->iovs != NULL && sys->pool != NULL;
+# ifdef SO_RXQ_OVFL
+        sys->cmsgs = calloc( sys->batch, sizeof (*sys->cmsgs) );
+        ok = ok && sys->cmsgs != NULL;
+# endif
+        if( unlikely(!ok) )
+        {
+            BatchClean( sys );
+            net_Close( sys->fd );
+            block_Release( sys->overflow_block );
+            return VLC_ENOMEM;
+        }
+        ACCESS_SET_CALLBACKS( NULL, BlockUDPBatch, Control, NULL );
+    }
+#endif
+
     return VLC_SUCCESS;
 }
 
@@ -193,6 +366,9 @@ static void Close( vlc_object_t *p_this )
     access_sys_t *sys = p_access->p_sys;
     if( sys->overflow_block )
         block_Release( sys->overflow_block );
+#ifdef HAVE_RECVMMSG
+    BatchClean( sys );
+#endif
 
     net_Close( sys->fd );
 }
@@ -219,12 +395,48 @@ static int Control( stream_t *p_access, int i_query, va_list args )
                 VLC_TICK_FROM_MS(var_InheritInteger(p_access, "network-caching"));
             break;
 
+        case STREAM_GET_LOST_PACKETS:
+        {
+            access_sys_t *sys = p_access->p_sys;
+            *va_arg( args, uint64_t * ) = sys->lost;
+            break;
+        }
+
         default:
             return VLC_EGENERIC;
     }
     return VLC_SUCCESS;
 }
 
+/* Accounts for the datagrams dropped by the kernel since the previous ones */
+static void CheckDropped(stream_t *access, struct msghdr *msg, block_t *pkt)
+{
+#ifdef SO_RXQ_OVFL
+    access_sys_t *sys = access->p_sys;
+
+    for (struct cmsghdr *cmsg = CMSG_FIRSTHDR(msg); cmsg != NULL;
+         cmsg = CMSG_NXTHDR(msg, cmsg))
+    {
+        if (cmsg->cmsg_level != SOL_SOCKET || cmsg->cmsg_type != SO_RXQ_OVFL)
+            continue;
+
+        uint32_t dropped;
+        memcpy(&dropped, CMSG_DATA(cmsg), sizeof (dropped));
+        if (dropped != sys->dropped)
+        {
+            uint32_t count = dropped - sys->dropped;
+            msg_Dbg(access, "%"PRIu32" datagram(s) dropped by the kernel, "
+                    "receive buffer overflow", count);
+            sys->lost += count;
+            sys->dropped = dropped;
+            pkt->i_flags |= BLOCK_FLAG_DISCONTINUITY;
+        }
+    }
+#else
+    VLC_UNUSED(access); VLC_UNUSED(msg); VLC_UNUSED(pkt);
+#endif
+}
+
 /*****************************************************************************
  * BlockUDP:
  *****************************************************************************/
@@ -248,9 +460,16 @@ static block_t *BlockUDP(stream_t *access, bool *restrict eof)
         .iov_base = sys->overflow_block->p_buffer,
         .iov_len = sys->overflow_block->i_buffer,
     }};
+#ifdef SO_RXQ_OVFL
+    udp_cmsg_t cmsg;
+#endif
     struct msghdr msg = {
         .msg_iov = iov,
         .msg_iovlen = 2,
+#ifdef SO_RXQ_OVFL
+        .msg_control = &cmsg,
+        .msg_controllen = sizeof (cmsg),
+#endif
     };
 
     struct pollfd ufd[1];
@@ -298,5 +517,161 @@ skip:
     else
         pkt->i_buffer = len;
 
+    CheckDropped(access, &msg, pkt);
     return pkt;
 }
+
+#ifdef HAVE_RECVMMSG
+static void BatchClean(access_sys_t *sys)
+{
+    if (sys->blocks != NULL)
+        for (unsigned i = 0; i < sys->batch; i++)
+            if (sys->blocks[i] != NULL)
+                block_Release(sys->blocks[i]);
+    if (sys->pool != NULL)
+        UdpPoolRelease(sys->pool);
+    free(sys->blocks);
+    free(sys->msgs);
+    free(sys->iovs);
+# ifdef SO_RXQ_OVFL
+    free(sys->cmsgs);
+# endif
+}
+
+static block_t *BatchNext(access_sys_t *sys)
+{
+    while (sys->next < sys->count)
+    {
+        block_t *pkt = sys->blocks[sys->next];
+        sys->blocks[sys->next++] = NULL;
+        if (pkt != NULL) /* NULL if dropped */
+            return pkt;
+    }
+    sys->count = sys->next = 0;
+    return NULL;
+}
+
+/*****************************************************************************
+ * BlockUDPBatch: receives up to udp-batch datagrams per system call, into
+ * blocks from the pool, then returns them one by one
+ *****************************************************************************/
+static block_t *BlockUDPBatch(stream_t *access, bool *restrict eof)
+{
+    access_sys_t *sys = access->p_sys;
+
+    block_t *pkt = BatchNext(sys);
+    if (pkt != NULL)
+        return pkt;
+
+    /* Rearm the slots returned by the previous call */
+    unsigned n;
+    for (n = 0; n < sys->batch; n++)
+    {
+        if (sys->blocks[n] == NULL)
+        {
+            sys->blocks[n] = UdpPoolGet(sys->pool);
+            if (unlikely(sys->blocks[n] == NULL))
+                break;
+        }
+
+        struct iovec *iov = &sys->iovs[2 * n];
+        iov[0].iov_base = sys->blocks[n]->p_buffer;
+        iov[0].iov_len = sys->mtu;
+        /* Shared by all messages: only the last oversized one is intact */
+        iov[1].iov_base = sys->overflow_block->p_buffer;
+        iov[1].iov_len = sys->overflow_block->i_buffer;
+
+        struct msghdr *msg = &sys->msgs[n].msg_hdr;
+        msg->msg_iov = iov;
+        msg->msg_iovlen = 2;
+# ifdef SO_RXQ_OVFL
+        msg->msg_control = &sys->cmsgs[n];
+        msg->msg_controllen = sizeof (sys->cmsgs[n]);
+# endif
+    }
+
+    if (unlikely(n == 0))
+    {   /* OOM - dequeue and discard one packet */
+        char dummy;
+        recv(sys->fd, &dummy, 1, 0);
+        return NULL;
+    }
+
+    struct pollfd ufd[1];
+
+    ufd[0].fd = sys->fd;
+    ufd[0].events = POLLIN;
+
+    switch (vlc_poll_i11e(ufd, 1, sys->timeout))
+    {
+        case 0:
+            msg_Err(access, "receive time-out");
+            *eof = true;
+            /* fall through */
+        case -1:
+            return NULL;
+    }
+
+    int count = recvmmsg(sys->fd, sys->msgs, n, MSG_DONTWAIT, NULL);
+    if (count <= 0)
+        return NULL;
+
+    size_t mtu = sys->mtu;
+    int last_oversized = -1;
+    for (int i = 0; i < count; i++)
+    {
+        if (unlikely(sys->msgs[i].msg_len > mtu))
+            last_oversized = i;
+        else
+            sys->blocks[i]->i_buffer = sys->msgs[i].msg_len;
+        CheckDropped(access, &sys->msgs[i].msg_hdr, sys->blocks[i]);
+    }
+
+    /* Received more than mtu amount: gather the datagram whose overflow is
+     * intact, drop the others, increase mtu and allocate a new overflow block
+     * and a new pool. See Open() */
+    if (unlikely(last_oversized >= 0))
+    {
+        size_t len = sys->msgs[last_oversized].msg_len;
+
+        for (int i = 0; i < last_oversized; i++)
+            if (sys->msgs[i].msg_len > mtu)
+            {
+                msg_Warn(access, "%u bytes packet lost (MTU was %zu)",
+                         sys->msgs[i].msg_len, mtu);
+                block_Release(sys->blocks[i]);
+                sys->blocks[i] = NULL;
+                sys->lost++;
+            }
+
+        block_t *gather_block = sys->overflow_block;
+        pkt = sys->blocks[last_oversized];
+        pkt->i_buffer = mtu;
+        gather_block->i_buffer = len - mtu;
+        pkt->p_next = gather_block;
+        sys->blocks[last_oversized] = block_ChainGather(pkt);
+
+        /* The armed slots are too small now */
+        for (unsigned i = count; i < sys->batch; i++)
+            if (sys->blocks[i] != NULL)
+            {
+                block_Release(sys->blocks[i]);
+                sys->blocks[i] = NULL;
+            }
+
+        udp_pool_t *pool = UdpPoolNew(4 * sys->batch, len);
+        if (likely(pool != NULL))
+        {
+            msg_Warn(access, "%zu bytes packet received (MTU was %zu), "
+                     "adjusting mtu", len, mtu);
+            UdpPoolRelease(sys->pool);
+            sys->pool = pool;
+            sys->mtu = len;
+        }
+        sys->overflow_block = block_Alloc(65507 - sys->mtu);
+    }
+
+    sys->count = count;
+    return BatchNext(sys);
+}
+#endif
@@ -143,7 +143,7 @@ void GrabVBI (demux_t *p_demux, vlc_v4l2_vbi_t *vbi)
                 if (vbi->es[i] == NULL)
                     continue;
 
-                block_t *dup = block_Duplicate(p_block);
+                block_t *dup = block_Share(p_block);
                 if (likely(dup != NULL))
                     es_out_Send(p_demux->out, vbi->es[i], dup);
             }
@@ -969,6 +969,10 @@ static ssize_t writeSegment( sout_access_out_t *p_access )
                 memcpy( output->p_buffer, p_sys->stuffing_bytes, p_sys->stuffing_size );
                 p_sys->stuffing_size = 0;
             }
+            /* The segment is encrypted in place */
+            output = block_MakeWritable( output );
+            if( unlikely(!output) )
+                return VLC_ENOMEM;
             size_t original = output->i_buffer;
             size_t padded = (output->i_buffer + 15 ) & ~15;
             size_t pad = padded - original;
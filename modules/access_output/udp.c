@@ -45,6 +45,11 @@
 #elif defined (HAVE_SYS_SOCKET_H)
 #   include <sys/socket.h>
 #endif
+#ifdef HAVE_SENDMMSG
+#   include <sys/uio.h>
+#   include <netinet/in.h>
+#   include <netinet/udp.h>
+#endif
 
 #include <vlc_network.h>
 
@@ -70,6 +75,12 @@ static void Close( vlc_object_t * );
                           "helps reducing the scheduling load on " \
                           "heavily-loaded systems." )
 
+#define BATCH_TEXT N_("Batch packets")
+#define BATCH_LONGTEXT N_("Send the packets of each group, as defined by " \
+                          "the group option, with a single system call, " \
+                          "and without copying them. This reduces the CPU " \
+                          "load of high bit rate outputs." )
+
 vlc_module_begin ()
     set_description( N_("UDP stream output") )
     set_shortname( "UDP" )
@@ -78,6 +89,10 @@ vlc_module_begin ()
     add_integer( SOUT_CFG_PREFIX "caching", DEFAULT_PTS_DELAY / 1000, CACHING_TEXT, CACHING_LONGTEXT, true )
     add_integer( SOUT_CFG_PREFIX "group", 1, GROUP_TEXT, GROUP_LONGTEXT,
                                  true )
+#ifdef HAVE_SENDMMSG
+    add_bool( SOUT_CFG_PREFIX "batch", false, BATCH_TEXT, BATCH_LONGTEXT,
+              true )
+#endif
 
     set_capability( "sout access", 0 )
     add_shortcut( "udp" )
@@ -91,6 +106,9 @@ vlc_module_end ()
 static const char *const ppsz_sout_options[] = {
     "caching",
     "group",
+#ifdef HAVE_SENDMMSG
+    "batch",
+#endif
     NULL
 };
 
@@ -107,6 +125,24 @@ static int Control( sout_access_out_t *, int, va_list );
 
 static void* ThreadWrite( void * );
 
+#ifdef HAVE_SENDMMSG
+#define DGRAM_MAX_PARTS 16 /* TS packets per datagram, with room to spare */
+#define BATCH_MAX_DGRAMS 64 /* also the UDP GSO segments limit */
+
+/* Datagram referencing the written blocks rather than a copy of them; the
+ * datagram size is in self.i_buffer */
+typedef struct
+{
+    block_t       self;
+    unsigned      i_parts;
+    block_t      *pp_parts[DGRAM_MAX_PARTS];
+    struct iovec  iov[DGRAM_MAX_PARTS];
+} udp_dgram_t;
+
+static ssize_t WriteBatch( sout_access_out_t *, block_t * );
+static void* ThreadWriteBatch( void * );
+#endif
+
 typedef struct
 {
     vlc_tick_t    i_caching;
@@ -114,9 +150,14 @@ typedef struct
     bool          b_mtu_warning;
     size_t        i_mtu;
 
-    block_fifo_t *p_fifo;
+    block_spsc_t *p_fifo;
     block_t      *p_buffer;
 
+#ifdef HAVE_SENDMMSG
+    udp_dgram_t  *p_dgram;
+    bool          b_gso;
+#endif
+
     vlc_thread_t  thread;
 } sout_access_out_sys_t;
 
@@ -206,20 +247,38 @@ static int Open( vlc_object_t *p_this )
     p_sys->i_handle = i_handle;
     p_sys->i_mtu = var_CreateGetInteger( p_this, "mtu" );
     p_sys->b_mtu_warning = false;
-    p_sys->p_fifo = block_FifoNew();
+    p_sys->p_fifo = block_SpscNew();
     p_sys->p_buffer = NULL;
 
-    if( vlc_clone( &p_sys->thread, ThreadWrite, p_access,
+    void *(*pf_thread)( void * ) = ThreadWrite;
+    p_access->pf_write = Write;
+#ifdef HAVE_SENDMMSG
+    p_sys->p_dgram = NULL;
+    p_sys->b_gso = false;
+    if( var_GetBool( p_access, SOUT_CFG_PREFIX "batch" ) )
+    {
+# ifdef UDP_SEGMENT
+        /* Probe for UDP segmentation offload (Linux 4.18) */
+        p_sys->b_gso = setsockopt( i_handle, SOL_UDP, UDP_SEGMENT,
+                                   &(int){ 0 }, sizeof (int) ) == 0;
+# endif
+        msg_Dbg( p_access, "batched output%s",
+                 p_sys->b_gso ? " with segmentation offload" : "" );
+        pf_thread = ThreadWriteBatch;
+        p_access->pf_write = WriteBatch;
+    }
+#endif
+
+    if( vlc_clone( &p_sys->thread, pf_thread, p_access,
                            VLC_THREAD_PRIORITY_HIGHEST ) )
     {
         msg_Err( p_access, "cannot spawn sout access thread" );
-        block_FifoRelease( p_sys->p_fifo );
+        block_SpscRelease( p_sys->p_fifo );
         net_Close (i_handle);
         free (p_sys);
         return VLC_EGENERIC;
     }
 
-    p_access->pf_write = Write;
     p_access->pf_control = Control;
 
     return VLC_SUCCESS;
@@ -235,9 +294,12 @@ static void Close( vlc_object_t * p_this )
 
     vlc_cancel( p_sys->thread );
     vlc_join( p_sys->thread, NULL );
-    block_FifoRelease( p_sys->p_fifo );
+    block_SpscRelease( p_sys->p_fifo );
 
     if( p_sys->p_buffer ) block_Release( p_sys->p_buffer );
+#ifdef HAVE_SENDMMSG
+    if( p_sys->p_dgram ) block_Release( &p_sys->p_dgram->self );
+#endif
 
     net_Close( p_sys->i_handle );
     free( p_sys );
@@ -290,7 +352,7 @@ static ssize_t Write( sout_access_out_t *p_access, block_t *p_buffer )
                          now - p_sys->p_buffer->i_dts
                           - p_sys->i_caching );
             }
-            block_FifoPut( p_sys->p_fifo, p_sys->p_buffer );
+            block_SpscPut( p_sys->p_fifo, p_sys->p_buffer );
             p_sys->p_buffer = NULL;
         }
 
@@ -332,7 +394,7 @@ static ssize_t Write( sout_access_out_t *p_access, block_t *p_buffer )
                              vlc_tick_now() - p_sys->p_buffer->i_dts
                               - p_sys->i_caching );
                 }
-                block_FifoPut( p_sys->p_fifo, p_sys->p_buffer );
+                block_SpscPut( p_sys->p_fifo, p_sys->p_buffer );
                 p_sys->p_buffer = NULL;
             }
         }
@@ -360,7 +422,7 @@ static void* ThreadWrite( void *data )
 
     for (;;)
     {
-        block_t *p_pk = block_FifoGet( p_sys->p_fifo );
+        block_t *p_pk = block_SpscGet( p_sys->p_fifo );
         vlc_tick_t    i_date;
 
         i_date = p_sys->i_caching + p_pk->i_dts;
@@ -419,3 +481,353 @@ static void* ThreadWrite( void *data )
     }
     return NULL;
 }
+
+#ifdef HAVE_SENDMMSG
+static void DgramRelease( block_t *p_block )
+{
+    udp_dgram_t *p_dgram = container_of( p_block, udp_dgram_t, self );
+
+    for( unsigned i = 0; i < p_dgram->i_parts; i++ )
+        block_Release( p_dgram->pp_parts[i] );
+    free( p_dgram );
+}
+
+static const struct vlc_block_callbacks dgram_cbs =
+{
+    DgramRelease,
+};
+
+static void DgramFlush( sout_access_out_t *p_access, vlc_tick_t now )
+{
+    sout_access_out_sys_t *p_sys = p_access->p_sys;
+    block_t *p_dgram = &p_sys->p_dgram->self;
+
+    if( p_dgram->i_dts + p_sys->i_caching < now )
+    {
+        msg_Dbg( p_access, "late packet for udp input (%"PRId64 ")",
+                 now - p_dgram->i_dts - p_sys->i_caching );
+    }
+    block_SpscPut( p_sys->p_fifo, p_dgram );
+    p_sys->p_dgram = NULL;
+}
+
+/*****************************************************************************
+ * WriteBatch: gather the blocks into datagrams, as Write(), but by reference
+ *****************************************************************************/
+static ssize_t WriteBatch( sout_access_out_t *p_access, block_t *p_buffer )
+{
+    sout_access_out_sys_t *p_sys = p_access->p_sys;
+    int i_len = 0;
+
+    while( p_buffer )
+    {
+        block_t *p_next = p_buffer->p_next;
+        vlc_tick_t now = vlc_tick_now();
+
+        p_buffer->p_next = NULL;
+        i_len += p_buffer->i_buffer;
+
+        if( !p_sys->b_mtu_warning && p_buffer->i_buffer > p_sys->i_mtu )
+        {
+            msg_Warn( p_access, "packet size > MTU, you should probably "
+                      "increase the MTU" );
+            p_sys->b_mtu_warning = true;
+        }
+
+        /* Check if there is enough space in the datagram */
+        udp_dgram_t *p_dgram = p_sys->p_dgram;
+        if( p_dgram && ( p_dgram->self.i_buffer + p_buffer->i_buffer
+                                                      > p_sys->i_mtu
+                      || p_dgram->i_parts == DGRAM_MAX_PARTS ) )
+            DgramFlush( p_access, now );
+
+        /* Blocks larger than the MTU are split into as many datagrams: copy
+         * the pieces, each datagram must own all of its parts */
+        block_t *p_part = p_buffer;
+        bool b_split = p_buffer->i_buffer > p_sys->i_mtu;
+
+        while( p_part )
+        {
+            if( b_split )
+            {
+                size_t i_write = __MIN( p_buffer->i_buffer, p_sys->i_mtu );
+
+                p_part = NULL;
+                if( i_write > 0 )
+                {
+                    p_part = block_Alloc( i_write );
+                    if( unlikely(p_part == NULL) )
+                        break;
+                    memcpy( p_part->p_buffer, p_buffer->p_buffer, i_write );
+                    p_part->i_flags = p_buffer->i_flags & BLOCK_FLAG_CLOCK;
+                    p_buffer->p_buffer += i_write;
+                    p_buffer->i_buffer -= i_write;
+                }
+                if( p_part == NULL )
+                    break;
+            }
+
+            if( !p_sys->p_dgram )
+            {
+                p_sys->p_dgram = malloc( sizeof (*p_sys->p_dgram) );
+                if( unlikely(p_sys->p_dgram == NULL) )
+                {
+                    block_Release( p_part );
+                    break;
+                }
+                block_Init( &p_sys->p_dgram->self, &dgram_cbs, NULL, 0 );
+                p_sys->p_dgram->self.i_dts = p_buffer->i_dts;
+                p_sys->p_dgram->i_parts = 0;
+            }
+
+            p_dgram = p_sys->p_dgram;
+            p_dgram->pp_parts[p_dgram->i_parts] = p_part;
+            p_dgram->iov[p_dgram->i_parts].iov_base = p_part->p_buffer;
+            p_dgram->iov[p_dgram->i_parts].iov_len = p_part->i_buffer;
+            p_dgram->i_parts++;
+            p_dgram->self.i_buffer += p_part->i_buffer;
+            if ( p_part->i_flags & BLOCK_FLAG_CLOCK )
+            {
+                if ( p_dgram->self.i_flags & BLOCK_FLAG_CLOCK )
+                    msg_Warn( p_access, "putting two PCRs at once" );
+                p_dgram->self.i_flags |= BLOCK_FLAG_CLOCK;
+            }
+
+            if( p_dgram->self.i_buffer == p_sys->i_mtu || b_split )
+                DgramFlush( p_access, now );
+
+            if( !b_split )
+                p_part = NULL;
+        }
+
+        /* The block is referenced by a datagram (or was released on error)
+         * unless it was split */
+        if( b_split )
+            block_Release( p_buffer );
+        p_buffer = p_next;
+    }
+
+    return i_len;
+}
+
+struct udp_batch
+{
+    unsigned      i_count;
+    udp_dgram_t  *pp_dgrams[BATCH_MAX_DGRAMS];
+    struct mmsghdr msgs[BATCH_MAX_DGRAMS];
+};
+
+static void BatchRelease( void *data )
+{
+    struct udp_batch *p_batch = data;
+
+    for( unsigned i = 0; i < p_batch->i_count; i++ )
+        block_Release( &p_batch->pp_dgrams[i]->self );
+    p_batch->i_count = 0;
+}
+
+#ifdef UDP_SEGMENT
+/* Sends datagrams of the same size, but maybe the last one, in one call and
+ * returns how many, or 0 if segmentation offload is not usable */
+static unsigned SendSegments( sout_access_out_t *p_access,
+                              udp_dgram_t *const *pp_dgrams, unsigned i_count )
+{
+    sout_access_out_sys_t *p_sys = p_access->p_sys;
+    const size_t i_size = pp_dgrams[0]->self.i_buffer;
+    struct iovec iov[BATCH_MAX_DGRAMS * DGRAM_MAX_PARTS];
+    size_t i_total = 0;
+    unsigned i_iov = 0, n;
+
+    for( n = 0; n < i_count; n++ )
+    {
+        const udp_dgram_t *p_dgram = pp_dgrams[n];
+
+        if( n > 0 && ( p_dgram->self.i_buffer > i_size || i_size == 0
+                    || i_total + p_dgram->self.i_buffer > 65507 ) )
+            break;
+        memcpy( &iov[i_iov], p_dgram->iov,
+                p_dgram->i_parts * sizeof (*iov) );
+        i_iov += p_dgram->i_parts;
+        i_total += p_dgram->self.i_buffer;
+        if( p_dgram->self.i_buffer < i_size )
+        {   /* only the last segment may be shorter */
+            n++;
+            break;
+        }
+    }
+
+    union
+    {
+        struct cmsghdr hdr;
+        char buf[CMSG_SPACE(sizeof (uint16_t))];
+    } control;
+    struct msghdr msg = {
+        .msg_iov = iov,
+        .msg_iovlen = i_iov,
+    };
+    if( n > 1 )
+    {
+        msg.msg_control = &control;
+        msg.msg_controllen = sizeof (control);
+
+        struct cmsghdr *cmsg = CMSG_FIRSTHDR( &msg );
+        cmsg->cmsg_level = SOL_UDP;
+        cmsg->cmsg_type = UDP_SEGMENT;
+        cmsg->cmsg_len = CMSG_LEN(sizeof (uint16_t));
+        uint16_t i_segment = i_size;
+        memcpy( CMSG_DATA(cmsg), &i_segment, sizeof (i_segment) );
+    }
+
+    if( sendmsg( p_sys->i_handle, &msg, 0 ) == -1 )
+    {
+        if( errno != EIO && errno != EINVAL )
+        {
+            msg_Warn( p_access, "send error: %s", vlc_strerror_c(errno) );
+            return n; /* the datagrams are lost, as with send() */
+        }
+        /* Unsupported by the output device */
+        msg_Dbg( p_access, "segmentation offload failed: %s",
+                 vlc_strerror_c(errno) );
+        p_sys->b_gso = false;
+        return 0;
+    }
+    return n;
+}
+#endif
+
+static void BatchSend( sout_access_out_t *p_access, struct udp_batch *p_batch )
+{
+    sout_access_out_sys_t *p_sys = p_access->p_sys;
+    unsigned i_sent = 0;
+
+#ifdef UDP_SEGMENT
+    while( p_sys->b_gso && i_sent < p_batch->i_count )
+    {
+        unsigned n = SendSegments( p_access, &p_batch->pp_dgrams[i_sent],
+                                   p_batch->i_count - i_sent );
+        if( n == 0 )
+            break;
+        i_sent += n;
+    }
+#endif
+
+    for( unsigned i = i_sent; i < p_batch->i_count; i++ )
+    {
+        struct msghdr *p_msg = &p_batch->msgs[i].msg_hdr;
+
+        memset( p_msg, 0, sizeof (*p_msg) );
+        p_msg->msg_iov = p_batch->pp_dgrams[i]->iov;
+        p_msg->msg_iovlen = p_batch->pp_dgrams[i]->i_parts;
+    }
+
+    while( i_sent < p_batch->i_count )
+    {
+        int i_ret = sendmmsg( p_sys->i_handle, &p_batch->msgs[i_sent],
+                              p_batch->i_count - i_sent, 0 );
+        if( i_ret == -1 )
+        {   /* skip the failing datagram, as with send() */
+            msg_Warn( p_access, "send error: %s", vlc_strerror_c(errno) );
+            i_ret = 1;
+        }
+        i_sent += i_ret;
+    }
+
+    BatchRelease( p_batch );
+}
+
+/*****************************************************************************
+ * ThreadWriteBatch: as ThreadWrite(), but sends the packets due in each
+ * pacing slot together: the slot starts with the packet waited for, either
+ * the last of a group or carrying a PCR, and ends before the next one.
+ *****************************************************************************/
+static void ThreadWriteBatchLoop( sout_access_out_t *p_access,
+                                  struct udp_batch *p_batch )
+{
+    sout_access_out_sys_t *p_sys = p_access->p_sys;
+    vlc_tick_t i_date_last = -1;
+    const unsigned i_group = var_GetInteger( p_access,
+                                             SOUT_CFG_PREFIX "group" );
+    int i_to_send = i_group;
+    unsigned i_dropped_packets = 0;
+
+    for (;;)
+    {
+        block_t *p_pk = block_SpscTryGet( p_sys->p_fifo );
+        if( p_pk == NULL )
+        {   /* nothing else is due yet */
+            BatchSend( p_access, p_batch );
+            p_pk = block_SpscGet( p_sys->p_fifo );
+        }
+
+        vlc_tick_t i_date = p_sys->i_caching + p_pk->i_dts;
+        if( i_date_last > 0 )
+        {
+            if( i_date - i_date_last > VLC_TICK_FROM_SEC(2) )
+            {
+                if( !i_dropped_packets )
+                    msg_Dbg( p_access, "mmh, hole (%"PRId64" > 2s) -> drop",
+                             i_date - i_date_last );
+
+                block_Release( p_pk );
+
+                i_date_last = i_date;
+                i_dropped_packets++;
+                continue;
+            }
+            else if( i_date - i_date_last < VLC_TICK_FROM_MS(-1) )
+            {
+                if( !i_dropped_packets )
+                    msg_Dbg( p_access, "mmh, packets in the past (%"PRId64")",
+                             i_date_last - i_date );
+            }
+        }
+
+        bool b_wait = false;
+        i_to_send--;
+        if( !i_to_send || (p_pk->i_flags & BLOCK_FLAG_CLOCK) )
+        {
+            if( i_date > vlc_tick_now() )
+            {   /* the current slot is over */
+                BatchSend( p_access, p_batch );
+                b_wait = true;
+            }
+            i_to_send = i_group;
+        }
+
+        /* Queued before waiting, so that the batch cleanup releases it */
+        p_batch->pp_dgrams[p_batch->i_count++] =
+            container_of( p_pk, udp_dgram_t, self );
+        if( b_wait )
+            vlc_tick_wait( i_date );
+        if( p_batch->i_count == BATCH_MAX_DGRAMS )
+            BatchSend( p_access, p_batch );
+
+        if( i_dropped_packets )
+        {
+            msg_Dbg( p_access, "dropped %i packets", i_dropped_packets );
+            i_dropped_packets = 0;
+        }
+
+        i_date_last = i_date;
+
+        i_date = vlc_tick_now() - i_date;
+        if ( i_date > VLC_TICK_FROM_MS(20) )
+        {
+            msg_Dbg( p_access, "packet has been sent too late (%"PRId64 ")",
+                     i_date );
+        }
+    }
+}
+
+/* The loop state is kept out of the cancellation cleanup frame */
+static void* ThreadWriteBatch( void *data )
+{
+    sout_access_out_t *p_access = data;
+    struct udp_batch batch = { .i_count = 0 };
+
+    vlc_cleanup_push( BatchRelease, &batch );
+    ThreadWriteBatchLoop( p_access, &batch );
+    vlc_cleanup_pop();
+    return NULL;
+}
+#endif
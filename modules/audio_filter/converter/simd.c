@@ -0,0 +1,864 @@
+/*****************************************************************************
+ * simd.c : vectorized PCM format conversion and volume
+ *****************************************************************************
+ * Copyright (C) 2024 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+/*
+ * The kernels produce exactly the same samples as the "format" converter and
+ * the "float" and "integer" volume modules; only the most common conversions
+ * are provided, the other ones are left to those modules.
+ */
+
+#ifdef HAVE_CONFIG_H
+# include "config.h"
+#endif
+#include <math.h>
+
+#include <vlc_common.h>
+#include <vlc_plugin.h>
+#include <vlc_cpu.h>
+#include <vlc_aout.h>
+#include <vlc_aout_volume.h>
+#include <vlc_block.h>
+#include <vlc_filter.h>
+
+#if defined(__GNUC__) && (defined(__i386__) || defined(__x86_64__))
+# define AUDIO_SIMD_X86
+# include <immintrin.h>
+#endif
+/* Double precision vectors and rounding conversions need AArch64 */
+#if defined(__aarch64__) && defined(__ARM_NEON)
+# define AUDIO_SIMD_NEON
+# include <arm_neon.h>
+#endif
+
+static int OpenConverter(vlc_object_t *);
+static void CloseConverter(vlc_object_t *);
+static int OpenVolume(vlc_object_t *);
+
+vlc_module_begin()
+    set_description(N_("Vectorized audio filter for PCM format conversion"))
+    set_category(CAT_AUDIO)
+    set_subcategory(SUBCAT_AUDIO_MISC)
+    set_capability("audio converter", 2)
+    set_callbacks(OpenConverter, CloseConverter)
+
+    add_submodule()
+    set_description(N_("Vectorized audio volume"))
+    set_capability("audio volume", 11)
+    set_callbacks(OpenVolume, NULL)
+vlc_module_end()
+
+/*
+ * Scalar samples, as computed by the format converter
+ */
+static inline int16_t Fl32toS16(float f)
+{
+    /* Walken's trick, rounds to nearest even */
+    union { float f; int32_t i; } u;
+    u.f = f + 384.f;
+    if (u.i > 0x43c07fff)
+        return 32767;
+    if (u.i < 0x43bf8000)
+        return -32768;
+    return u.i - 0x43c00000;
+}
+
+static inline int32_t Fl32toS32(float f)
+{
+    float s = f * 2147483648.f;
+    if (s >= 2147483647.f)
+        return 2147483647;
+    if (s <= -2147483648.f)
+        return -2147483648;
+    return lroundf(s);
+}
+
+static inline int16_t S16Gain(int16_t s, int mult)
+{
+    int_fast32_t v = (s * (int_fast32_t)mult) >> 8;
+    return VLC_CLIP(v, INT16_MIN, INT16_MAX);
+}
+
+/* Largest float below one half: adding it then truncating rounds half away
+ * from zero, as lroundf() */
+#define HALF_DOWN 0.49999997f
+
+typedef void (*cvt_kernel_t)(void *, const void *, size_t);
+
+struct simd_kernels
+{
+    cvt_kernel_t s16_fl32;
+    cvt_kernel_t fl32_s16;
+    cvt_kernel_t s32_fl32;
+    cvt_kernel_t fl32_s32;
+    cvt_kernel_t s16_s32;
+    cvt_kernel_t s32_s16;
+    cvt_kernel_t fl32_fl64;
+    cvt_kernel_t fl64_fl32;
+    void (*gain_fl32)(float *, size_t, float);
+    void (*gain_fl64)(double *, size_t, double);
+    void (*gain_s16)(int16_t *, size_t, int);
+};
+
+/* Conversions work in place when the output samples are not larger than the
+ * input samples: each vector is loaded before the output is stored, behind
+ * the next input vector. */
+
+#ifdef AUDIO_SIMD_X86
+/*** SSE2 ***/
+VLC_SSE2
+static void S16toFl32_SSE2(void *dstp, const void *srcp, size_t n)
+{
+    const int16_t *src = srcp;
+    float *dst = dstp;
+    const __m128 scale = _mm_set1_ps(1.f / 32768.f);
+
+    for (; n >= 8; n -= 8, src += 8, dst += 8)
+    {
+        __m128i x = _mm_loadu_si128((const __m128i *)src);
+        __m128i lo = _mm_srai_epi32(_mm_unpacklo_epi16(x, x), 16);
+        __m128i hi = _mm_srai_epi32(_mm_unpackhi_epi16(x, x), 16);
+        _mm_storeu_ps(dst, _mm_mul_ps(_mm_cvtepi32_ps(lo), scale));
+        _mm_storeu_ps(dst + 4, _mm_mul_ps(_mm_cvtepi32_ps(hi), scale));
+    }
+    while (n--)
+        *dst++ = *src++ / 32768.f;
+}
+
+VLC_SSE2
+static void Fl32toS16_SSE2(void *dstp, const void *srcp, size_t n)
+{
+    const float *src = srcp;
+    int16_t *dst = dstp;
+    const __m128 scale = _mm_set1_ps(32768.f);
+    const __m128 max = _mm_set1_ps(32767.f), min = _mm_set1_ps(-32768.f);
+
+    for (; n >= 8; n -= 8, src += 8, dst += 8)
+    {
+        __m128 a = _mm_mul_ps(_mm_loadu_ps(src), scale);
+        __m128 b = _mm_mul_ps(_mm_loadu_ps(src + 4), scale);
+        a = _mm_max_ps(_mm_min_ps(a, max), min);
+        b = _mm_max_ps(_mm_min_ps(b, max), min);
+        _mm_storeu_si128((__m128i *)dst,
+                         _mm_packs_epi32(_mm_cvtps_epi32(a),
+                                         _mm_cvtps_epi32(b)));
+    }
+    while (n--)
+        *dst++ = Fl32toS16(*src++);
+}
+
+VLC_SSE2
+static void S32toFl32_SSE2(void *dstp, const void *srcp, size_t n)
+{
+    const int32_t *src = srcp;
+    float *dst = dstp;
+    const __m128 scale = _mm_set1_ps(1.f / 2147483648.f);
+
+    for (; n >= 4; n -= 4, src += 4, dst += 4)
+    {
+        __m128i x = _mm_loadu_si128((const __m128i *)src);
+        _mm_storeu_ps(dst, _mm_mul_ps(_mm_cvtepi32_ps(x), scale));
+    }
+    while (n--)
+        *dst++ = (float)(*src++) / 2147483648.f;
+}
+
+VLC_SSE2
+static void Fl32toS32_SSE2(void *dstp, const void *srcp, size_t n)
+{
+    const float *src = srcp;
+    int32_t *dst = dstp;
+    const __m128 scale = _mm_set1_ps(2147483648.f);
+    const __m128 half = _mm_set1_ps(HALF_DOWN);
+    const __m128 sign = _mm_set1_ps(-0.f);
+
+    for (; n >= 4; n -= 4, src += 4, dst += 4)
+    {
+        __m128 s = _mm_mul_ps(_mm_loadu_ps(src), scale);
+        __m128 r = _mm_add_ps(s, _mm_or_ps(_mm_and_ps(s, sign), half));
+        /* Positive overflows convert to INT32_MIN, flip them to INT32_MAX */
+        __m128i over = _mm_castps_si128(_mm_cmpge_ps(s, scale));
+        _mm_storeu_si128((__m128i *)dst,
+                         _mm_xor_si128(_mm_cvttps_epi32(r), over));
+    }
+    while (n--)
+        *dst++ = Fl32toS32(*src++);
+}
+
+VLC_SSE2
+static void S16toS32_SSE2(void *dstp, const void *srcp, size_t n)
+{
+    const int16_t *src = srcp;
+    int32_t *dst = dstp;
+    const __m128i zero = _mm_setzero_si128();
+
+    for (; n >= 8; n -= 8, src += 8, dst += 8)
+    {
+        __m128i x = _mm_loadu_si128((const __m128i *)src);
+        _mm_storeu_si128((__m128i *)dst, _mm_unpacklo_epi16(zero, x));
+        _mm_storeu_si128((__m128i *)(dst + 4), _mm_unpackhi_epi16(zero, x));
+    }
+    while (n--)
+        *dst++ = *src++ << 16;
+}
+
+VLC_SSE2
+static void S32toS16_SSE2(void *dstp, const void *srcp, size_t n)
+{
+    const int32_t *src = srcp;
+    int16_t *dst = dstp;
+
+    for (; n >= 8; n -= 8, src += 8, dst += 8)
+    {
+        __m128i a = _mm_loadu_si128((const __m128i *)src);
+        __m128i b = _mm_loadu_si128((const __m128i *)(src + 4));
+        _mm_storeu_si128((__m128i *)dst,
+                         _mm_packs_epi32(_mm_srai_epi32(a, 16),
+                                         _mm_srai_epi32(b, 16)));
+    }
+    while (n--)
+        *dst++ = (*src++) >> 16;
+}
+
+VLC_SSE2
+static void Fl32toFl64_SSE2(void *dstp, const void *srcp, size_t n)
+{
+    const float *src = srcp;
+    double *dst = dstp;
+
+    for (; n >= 4; n -= 4, src += 4, dst += 4)
+    {
+        __m128 x = _mm_loadu_ps(src);
+        _mm_storeu_pd(dst, _mm_cvtps_pd(x));
+        _mm_storeu_pd(dst + 2, _mm_cvtps_pd(_mm_movehl_ps(x, x)));
+    }
+    while (n--)
+        *dst++ = *src++;
+}
+
+VLC_SSE2
+static void Fl64toFl32_SSE2(void *dstp, const void *srcp, size_t n)
+{
+    const double *src = srcp;
+    float *dst = dstp;
+
+    for (; n >= 4; n -= 4, src += 4, dst += 4)
+    {
+        __m128 a = _mm_cvtpd_ps(_mm_loadu_pd(src));
+        __m128 b = _mm_cvtpd_ps(_mm_loadu_pd(src + 2));
+        _mm_storeu_ps(dst, _mm_movelh_ps(a, b));
+    }
+    while (n--)
+        *dst++ = *src++;
+}
+
+VLC_SSE2
+static void GainFl32_SSE2(float *p, size_t n, float gain)
+{
+    const __m128 g = _mm_set1_ps(gain);
+
+    for (; n >= 8; n -= 8, p += 8)
+    {
+        _mm_storeu_ps(p, _mm_mul_ps(_mm_loadu_ps(p), g));
+        _mm_storeu_ps(p + 4, _mm_mul_ps(_mm_loadu_ps(p + 4), g));
+    }
+    while (n--)
+        *(p++) *= gain;
+}
+
+VLC_SSE2
+static void GainFl64_SSE2(double *p, size_t n, double gain)
+{
+    const __m128d g = _mm_set1_pd(gain);
+
+    for (; n >= 4; n -= 4, p += 4)
+    {
+        _mm_storeu_pd(p, _mm_mul_pd(_mm_loadu_pd(p), g));
+        _mm_storeu_pd(p + 2, _mm_mul_pd(_mm_loadu_pd(p + 2), g));
+    }
+    while (n--)
+        *(p++) *= gain;
+}
+
+VLC_SSE2
+static void GainS16_SSE2(int16_t *p, size_t n, int mult)
+{
+    const __m128i m = _mm_set1_epi16(mult);
+
+    for (; n >= 8; n -= 8, p += 8)
+    {
+        __m128i x = _mm_loadu_si128((const __m128i *)p);
+        __m128i lo = _mm_mullo_epi16(x, m), hi = _mm_mulhi_epi16(x, m);
+        __m128i a = _mm_srai_epi32(_mm_unpacklo_epi16(lo, hi), 8);
+        __m128i b = _mm_srai_epi32(_mm_unpackhi_epi16(lo, hi), 8);
+        _mm_storeu_si128((__m128i *)p, _mm_packs_epi32(a, b));
+    }
+    for (; n > 0; n--, p++)
+        *p = S16Gain(*p, mult);
+}
+
+static const struct simd_kernels kernels_sse2 = {
+    S16toFl32_SSE2, Fl32toS16_SSE2, S32toFl32_SSE2, Fl32toS32_SSE2,
+    S16toS32_SSE2, S32toS16_SSE2, Fl32toFl64_SSE2, Fl64toFl32_SSE2,
+    GainFl32_SSE2, GainFl64_SSE2, GainS16_SSE2,
+};
+
+/*** AVX2 ***/
+VLC_AVX2
+static void S16toFl32_AVX2(void *dstp, const void *srcp, size_t n)
+{
+    const int16_t *src = srcp;
+    float *dst = dstp;
+    const __m256 scale = _mm256_set1_ps(1.f / 32768.f);
+
+    for (; n >= 8; n -= 8, src += 8, dst += 8)
+    {
+        __m256i x = _mm256_cvtepi16_epi32(
+                        _mm_loadu_si128((const __m128i *)src));
+        _mm256_storeu_ps(dst, _mm256_mul_ps(_mm256_cvtepi32_ps(x), scale));
+    }
+    while (n--)
+        *dst++ = *src++ / 32768.f;
+}
+
+VLC_AVX2
+static void Fl32toS16_AVX2(void *dstp, const void *srcp, size_t n)
+{
+    const float *src = srcp;
+    int16_t *dst = dstp;
+    const __m256 scale = _mm256_set1_ps(32768.f);
+    const __m256 max = _mm256_set1_ps(32767.f), min = _mm256_set1_ps(-32768.f);
+
+    for (; n >= 16; n -= 16, src += 16, dst += 16)
+    {
+        __m256 a = _mm256_mul_ps(_mm256_loadu_ps(src), scale);
+        __m256 b = _mm256_mul_ps(_mm256_loadu_ps(src + 8), scale);
+        a = _mm256_max_ps(_mm256_min_ps(a, max), min);
+        b = _mm256_max_ps(_mm256_min_ps(b, max), min);
+        /* The packing interleaves the 128-bit lanes */
+        __m256i r = _mm256_packs_epi32(_mm256_cvtps_epi32(a),
+                                       _mm256_cvtps_epi32(b));
+        _mm256_storeu_si256((__m256i *)dst, _mm256_permute4x64_epi64(r, 0xD8));
+    }
+    while (n--)
+        *dst++ = Fl32toS16(*src++);
+}
+
+VLC_AVX2
+static void S32toFl32_AVX2(void *dstp, const void *srcp, size_t n)
+{
+    const int32_t *src = srcp;
+    float *dst = dstp;
+    const __m256 scale = _mm256_set1_ps(1.f / 2147483648.f);
+
+    for (; n >= 8; n -= 8, src += 8, dst += 8)
+    {
+        __m256i x = _mm256_loadu_si256((const __m256i *)src);
+        _mm256_storeu_ps(dst, _mm256_mul_ps(_mm256_cvtepi32_ps(x), scale));
+    }
+    while (n--)
+        *dst++ = (float)(*src++) / 2147483648.f;
+}
+
+VLC_AVX2
+static void Fl32toS32_AVX2(void *dstp, const void *srcp, size_t n)
+{
+    const float *src = srcp;
+    int32_t *dst = dstp;
+    const __m256 scale = _mm256_set1_ps(2147483648.f);
+    const __m256 half = _mm256_set1_ps(HALF_DOWN);
+    const __m256 sign = _mm256_set1_ps(-0.f);
+
+    for (; n >= 8; n -= 8, src += 8, dst += 8)
+    {
+        __m256 s = _mm256_mul_ps(_mm256_loadu_ps(src), scale);
+        __m256 r = _mm256_add_ps(s, _mm256_or_ps(_mm256_and_ps(s, sign), half));
+        __m256i over = _mm256_castps_si256(_mm256_cmp_ps(s, scale, _CMP_GE_OQ));
+        _mm256_storeu_si256((__m256i *)dst,
+                            _mm256_xor_si256(_mm256_cvttps_epi32(r), over));
+    }
+    while (n--)
+        *dst++ = Fl32toS32(*src++);
+}
+
+VLC_AVX2
+static void S16toS32_AVX2(void *dstp, const void *srcp, size_t n)
+{
+    const int16_t *src = srcp;
+    int32_t *dst = dstp;
+
+    for (; n >= 8; n -= 8, src += 8, dst += 8)
+    {
+        __m256i x = _mm256_cvtepi16_epi32(
+                        _mm_loadu_si128((const __m128i *)src));
+        _mm256_storeu_si256((__m256i *)dst, _mm256_slli_epi32(x, 16));
+    }
+    while (n--)
+        *dst++ = *src++ << 16;
+}
+
+VLC_AVX2
+static void S32toS16_AVX2(void *dstp, const void *srcp, size_t n)
+{
+    const int32_t *src = srcp;
+    int16_t *dst = dstp;
+
+    for (; n >= 16; n -= 16, src += 16, dst += 16)
+    {
+        __m256i a = _mm256_loadu_si256((const __m256i *)src);
+        __m256i b = _mm256_loadu_si256((const __m256i *)(src + 8));
+        __m256i r = _mm256_packs_epi32(_mm256_srai_epi32(a, 16),
+                                       _mm256_srai_epi32(b, 16));
+        _mm256_storeu_si256((__m256i *)dst, _mm256_permute4x64_epi64(r, 0xD8));
+    }
+    while (n--)
+        *dst++ = (*src++) >> 16;
+}
+
+VLC_AVX2
+static void Fl32toFl64_AVX2(void *dstp, const void *srcp, size_t n)
+{
+    const float *src = srcp;
+    double *dst = dstp;
+
+    for (; n >= 8; n -= 8, src += 8, dst += 8)
+    {
+        _mm256_storeu_pd(dst, _mm256_cvtps_pd(_mm_loadu_ps(src)));
+        _mm256_storeu_pd(dst + 4, _mm256_cvtps_pd(_mm_loadu_ps(src + 4)));
+    }
+    while (n--)
+        *dst++ = *src++;
+}
+
+VLC_AVX2
+static void Fl64toFl32_AVX2(void *dstp, const void *srcp, size_t n)
+{
+    const double *src = srcp;
+    float *dst = dstp;
+
+    for (; n >= 8; n -= 8, src += 8, dst += 8)
+    {
+        __m128 a = _mm256_cvtpd_ps(_mm256_loadu_pd(src));
+        __m128 b = _mm256_cvtpd_ps(_mm256_loadu_pd(src + 4));
+        _mm256_storeu_ps(dst, _mm256_set_m128(b, a));
+    }
+    while (n--)
+        *dst++ = *src++;
+}
+
+VLC_AVX2
+static void GainFl32_AVX2(float *p, size_t n, float gain)
+{
+    const __m256 g = _mm256_set1_ps(gain);
+
+    for (; n >= 16; n -= 16, p += 16)
+    {
+        _mm256_storeu_ps(p, _mm256_mul_ps(_mm256_loadu_ps(p), g));
+        _mm256_storeu_ps(p + 8, _mm256_mul_ps(_mm256_loadu_ps(p + 8), g));
+    }
+    while (n--)
+        *(p++) *= gain;
+}
+
+VLC_AVX2
+static void GainFl64_AVX2(double *p, size_t n, double gain)
+{
+    const __m256d g = _mm256_set1_pd(gain);
+
+    for (; n >= 8; n -= 8, p += 8)
+    {
+        _mm256_storeu_pd(p, _mm256_mul_pd(_mm256_loadu_pd(p), g));
+        _mm256_storeu_pd(p + 4, _mm256_mul_pd(_mm256_loadu_pd(p + 4), g));
+    }
+    while (n--)
+        *(p++) *= gain;
+}
+
+VLC_AVX2
+static void GainS16_AVX2(int16_t *p, size_t n, int mult)
+{
+    const __m256i m = _mm256_set1_epi16(mult);
+
+    for (; n >= 16; n -= 16, p += 16)
+    {
+        __m256i x = _mm256_loadu_si256((const __m256i *)p);
+        __m256i lo = _mm256_mullo_epi16(x, m), hi = _mm256_mulhi_epi16(x, m);
+        /* Unpacking and packing within the same lanes keep the order */
+        __m256i a = _mm256_srai_epi32(_mm256_unpacklo_epi16(lo, hi), 8);
+        __m256i b = _mm256_srai_epi32(_mm256_unpackhi_epi16(lo, hi), 8);
+        _mm256_storeu_si256((__m256i *)p, _mm256_packs_epi32(a, b));
+    }
+    for (; n > 0; n--, p++)
+        *p = S16Gain(*p, mult);
+}
+
+static const struct simd_kernels kernels_avx2 = {
+    S16toFl32_AVX2, Fl32toS16_AVX2, S32toFl32_AVX2, Fl32toS32_AVX2,
+    S16toS32_AVX2, S32toS16_AVX2, Fl32toFl64_AVX2, Fl64toFl32_AVX2,
+    GainFl32_AVX2, GainFl64_AVX2, GainS16_AVX2,
+};
+#endif
+
+#ifdef AUDIO_SIMD_NEON
+static void S16toFl32_NEON(void *dstp, const void *srcp, size_t n)
+{
+    const int16_t *src = srcp;
+    float *dst = dstp;
+
+    for (; n >= 8; n -= 8, src += 8, dst += 8)
+    {
+        int16x8_t x = vld1q_s16(src);
+        vst1q_f32(dst, vmulq_n_f32(vcvtq_f32_s32(vmovl_s16(vget_low_s16(x))),
+                                   1.f / 32768.f));
+        vst1q_f32(dst + 4, vmulq_n_f32(vcvtq_f32_s32(vmovl_high_s16(x)),
+                                       1.f / 32768.f));
+    }
+    while (n--)
+        *dst++ = *src++ / 32768.f;
+}
+
+static void Fl32toS16_NEON(void *dstp, const void *srcp, size_t n)
+{
+    const float *src = srcp;
+    int16_t *dst = dstp;
+
+    for (; n >= 8; n -= 8, src += 8, dst += 8)
+    {
+        /* Both conversions saturate */
+        int32x4_t a = vcvtnq_s32_f32(vmulq_n_f32(vld1q_f32(src), 32768.f));
+        int32x4_t b = vcvtnq_s32_f32(vmulq_n_f32(vld1q_f32(src + 4), 32768.f));
+        vst1q_s16(dst, vqmovn_high_s32(vqmovn_s32(a), b));
+    }
+    while (n--)
+        *dst++ = Fl32toS16(*src++);
+}
+
+static void S32toFl32_NEON(void *dstp, const void *srcp, size_t n)
+{
+    const int32_t *src = srcp;
+    float *dst = dstp;
+
+    for (; n >= 4; n -= 4, src += 4, dst += 4)
+        vst1q_f32(dst, vmulq_n_f32(vcvtq_f32_s32(vld1q_s32(src)),
+                                   1.f / 2147483648.f));
+    while (n--)
+        *dst++ = (float)(*src++) / 2147483648.f;
+}
+
+static void Fl32toS32_NEON(void *dstp, const void *srcp, size_t n)
+{
+    const float *src = srcp;
+    int32_t *dst = dstp;
+    const uint32x4_t sign = vdupq_n_u32(0x80000000);
+    const float32x4_t half = vdupq_n_f32(HALF_DOWN);
+
+    for (; n >= 4; n -= 4, src += 4, dst += 4)
+    {
+        float32x4_t s = vmulq_n_f32(vld1q_f32(src), 2147483648.f);
+        /* The truncating conversion saturates */
+        float32x4_t r = vaddq_f32(s, vbslq_f32(sign, s, half));
+        vst1q_s32(dst, vcvtq_s32_f32(r));
+    }
+    while (n--)
+        *dst++ = Fl32toS32(*src++);
+}
+
+static void S16toS32_NEON(void *dstp, const void *srcp, size_t n)
+{
+    const int16_t *src = srcp;
+    int32_t *dst = dstp;
+
+    for (; n >= 8; n -= 8, src += 8, dst += 8)
+    {
+        int16x8_t x = vld1q_s16(src);
+        vst1q_s32(dst, vshll_n_s16(vget_low_s16(x), 16));
+        vst1q_s32(dst + 4, vshll_high_n_s16(x, 16));
+    }
+    while (n--)
+        *dst++ = *src++ << 16;
+}
+
+static void S32toS16_NEON(void *dstp, const void *srcp, size_t n)
+{
+    const int32_t *src = srcp;
+    int16_t *dst = dstp;
+
+    for (; n >= 8; n -= 8, src += 8, dst += 8)
+    {
+        int32x4_t a = vld1q_s32(src), b = vld1q_s32(src + 4);
+        vst1q_s16(dst, vshrn_high_n_s32(vshrn_n_s32(a, 16), b, 16));
+    }
+    while (n--)
+        *dst++ = (*src++) >> 16;
+}
+
+static void Fl32toFl64_NEON(void *dstp, const void *srcp, size_t n)
+{
+    const float *src = srcp;
+    double *dst = dstp;
+
+    for (; n >= 4; n -= 4, src += 4, dst += 4)
+    {
+        float32x4_t x = vld1q_f32(src);
+        vst1q_f64(dst, vcvt_f64_f32(vget_low_f32(x)));
+        vst1q_f64(dst + 2, vcvt_high_f64_f32(x));
+    }
+    while (n--)
+        *dst++ = *src++;
+}
+
+static void Fl64toFl32_NEON(void *dstp, const void *srcp, size_t n)
+{
+    const double *src = srcp;
+    float *dst = dstp;
+
+    for (; n >= 4; n -= 4, src += 4, dst += 4)
+    {
+        float64x2_t a = vld1q_f64(src), b = vld1q_f64(src + 2);
+        vst1q_f32(dst, vcvt_high_f32_f64(vcvt_f32_f64(a), b));
+    }
+    while (n--)
+        *dst++ = *src++;
+}
+
+static void GainFl32_NEON(float *p, size_t n, float gain)
+{
+    for (; n >= 8; n -= 8, p += 8)
+    {
+        vst1q_f32(p, vmulq_n_f32(vld1q_f32(p), gain));
+        vst1q_f32(p + 4, vmulq_n_f32(vld1q_f32(p + 4), gain));
+    }
+    while (n--)
+        *(p++) *= gain;
+}
+
+static void GainFl64_NEON(double *p, size_t n, double gain)
+{
+    for (; n >= 4; n -= 4, p += 4)
+    {
+        vst1q_f64(p, vmulq_n_f64(vld1q_f64(p), gain));
+        vst1q_f64(p + 2, vmulq_n_f64(vld1q_f64(p + 2), gain));
+    }
+    while (n--)
+        *(p++) *= gain;
+}
+
+static void GainS16_NEON(int16_t *p, size_t n, int mult)
+{
+    const int16x8_t m = vdupq_n_s16(mult);
+
+    for (; n >= 8; n -= 8, p += 8)
+    {
+        int16x8_t x = vld1q_s16(p);
+        int32x4_t a = vshrq_n_s32(vmull_s16(vget_low_s16(x), vget_low_s16(m)), 8);
+        int32x4_t b = vshrq_n_s32(vmull_high_s16(x, m), 8);
+        vst1q_s16(p, vqmovn_high_s32(vqmovn_s32(a), b));
+    }
+    for (; n > 0; n--, p++)
+        *p = S16Gain(*p, mult);
+}
+
+static const struct simd_kernels kernels_neon = {
+    S16toFl32_NEON, Fl32toS16_NEON, S32toFl32_NEON, Fl32toS32_NEON,
+    S16toS32_NEON, S32toS16_NEON, Fl32toFl64_NEON, Fl64toFl32_NEON,
+    GainFl32_NEON, GainFl64_NEON, GainS16_NEON,
+};
+#endif
+
+static const struct simd_kernels *GetKernels(void)
+{
+#ifdef AUDIO_SIMD_X86
+    if (vlc_CPU_AVX2())
+        return &kernels_avx2;
+    if (vlc_CPU_SSE2())
+        return &kernels_sse2;
+#endif
+#ifdef AUDIO_SIMD_NEON
+    if (vlc_CPU_ARM_NEON())
+        return &kernels_neon;
+#endif
+    return NULL;
+}
+
+/*
+ * Converter
+ */
+static const struct {
+    vlc_fourcc_t src;
+    vlc_fourcc_t dst;
+    size_t       offset;
+} cvt_simd[] = {
+    { VLC_CODEC_S16N, VLC_CODEC_FL32, offsetof(struct simd_kernels, s16_fl32)  },
+    { VLC_CODEC_FL32, VLC_CODEC_S16N, offsetof(struct simd_kernels, fl32_s16)  },
+    { VLC_CODEC_S32N, VLC_CODEC_FL32, offsetof(struct simd_kernels, s32_fl32)  },
+    { VLC_CODEC_FL32, VLC_CODEC_S32N, offsetof(struct simd_kernels, fl32_s32)  },
+    { VLC_CODEC_S16N, VLC_CODEC_S32N, offsetof(struct simd_kernels, s16_s32)   },
+    { VLC_CODEC_S32N, VLC_CODEC_S16N, offsetof(struct simd_kernels, s32_s16)   },
+    { VLC_CODEC_FL32, VLC_CODEC_FL64, offsetof(struct simd_kernels, fl32_fl64) },
+    { VLC_CODEC_FL64, VLC_CODEC_FL32, offsetof(struct simd_kernels, fl64_fl32) },
+};
+
+typedef struct
+{
+    cvt_kernel_t convert;
+    unsigned     src_size;
+    unsigned     dst_size;
+} filter_sys_t;
+
+static block_t *Convert(filter_t *filter, block_t *bsrc)
+{
+    filter_sys_t *sys = filter->p_sys;
+    size_t samples = bsrc->i_buffer / sys->src_size;
+    block_t *bdst = bsrc;
+
+    if (sys->dst_size > sys->src_size)
+    {
+        bdst = block_Alloc(samples * sys->dst_size);
+        if (unlikely(bdst == NULL))
+        {
+            block_Release(bsrc);
+            return NULL;
+        }
+        block_CopyProperties(bdst, bsrc);
+    }
+
+    sys->convert(bdst->p_buffer, bsrc->p_buffer, samples);
+
+    if (bdst != bsrc)
+        block_Release(bsrc);
+    else
+        bdst->i_buffer = samples * sys->dst_size;
+    return bdst;
+}
+
+static void CloseConverter(vlc_object_t *object)
+{
+    filter_t *filter = (filter_t *)object;
+
+    free(filter->p_sys);
+}
+
+static int OpenConverter(vlc_object_t *object)
+{
+    filter_t *filter = (filter_t *)object;
+    const es_format_t *src = &filter->fmt_in;
+    const es_format_t *dst = &filter->fmt_out;
+
+    if (!AOUT_FMTS_SIMILAR(&src->audio, &dst->audio))
+        return VLC_EGENERIC;
+
+    const struct simd_kernels *kernels = GetKernels();
+    if (kernels == NULL)
+        return VLC_EGENERIC;
+
+    for (size_t i = 0; i < ARRAY_SIZE(cvt_simd); i++)
+    {
+        if (cvt_simd[i].src != src->i_codec || cvt_simd[i].dst != dst->i_codec)
+            continue;
+
+        filter_sys_t *sys = malloc(sizeof (*sys));
+        if (unlikely(sys == NULL))
+            return VLC_ENOMEM;
+
+        sys->convert = *(const cvt_kernel_t *)((const char *)kernels
+                                               + cvt_simd[i].offset);
+        sys->src_size = aout_BitsPerSample(src->i_codec) / 8;
+        sys->dst_size = aout_BitsPerSample(dst->i_codec) / 8;
+
+        filter->p_sys = sys;
+        filter->pf_audio_filter = Convert;
+        return VLC_SUCCESS;
+    }
+    return VLC_EGENERIC;
+}
+
+/*
+ * Volume
+ */
+static void AmplifyFl32(audio_volume_t *volume, block_t *block, float amp)
+{
+    const struct simd_kernels *kernels = GetKernels();
+
+    if (amp == 1.f)
+        return; /* nothing to do */
+
+    kernels->gain_fl32((float *)block->p_buffer,
+                       block->i_buffer / sizeof (float), amp);
+    (void) volume;
+}
+
+static void AmplifyFl64(audio_volume_t *volume, block_t *block, float amp)
+{
+    const struct simd_kernels *kernels = GetKernels();
+    double mult = amp;
+
+    if (mult == 1.)
+        return; /* nothing to do */
+
+    kernels->gain_fl64((double *)block->p_buffer,
+                       block->i_buffer / sizeof (double), mult);
+    (void) volume;
+}
+
+static void AmplifyS16(audio_volume_t *volume, block_t *block, float amp)
+{
+    const struct simd_kernels *kernels = GetKernels();
+    int16_t *p = (int16_t *)block->p_buffer;
+    size_t n = block->i_buffer / sizeof (*p);
+
+    long mult = lroundf(amp * 0x1.p8f);
+    if (mult == (1 << 8))
+        return;
+
+    if (likely(mult >= 0 && mult <= INT16_MAX))
+        kernels->gain_s16(p, n, mult);
+    else
+    {   /* Beyond the range of the vectorized multiplication */
+        for (; n > 0; n--, p++)
+        {
+            int_fast64_t s = (*p * (int_fast64_t)mult) >> 8;
+            *p = VLC_CLIP(s, INT16_MIN, INT16_MAX);
+        }
+    }
+    (void) volume;
+}
+
+static int OpenVolume(vlc_object_t *object)
+{
+    audio_volume_t *volume = (audio_volume_t *)object;
+
+    if (GetKernels() == NULL)
+        return VLC_EGENERIC;
+
+    switch (volume->format)
+    {
+        case VLC_CODEC_FL32:
+            volume->amplify = AmplifyFl32;
+            break;
+        case VLC_CODEC_FL64:
+            volume->amplify = AmplifyFl64;
+            break;
+        case VLC_CODEC_S16N:
+            volume->amplify = AmplifyS16;
+            break;
+        default:
+            return VLC_EGENERIC;
+    }
+    return VLC_SUCCESS;
+}
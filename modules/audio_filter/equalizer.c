@@ -29,18 +29,20 @@
 #endif
 
 #include <math.h>
+#include <string.h>
 
 #include <vlc_common.h>
 #include <vlc_plugin.h>
 #include <vlc_charset.h>
+#include <vlc_cpu.h>
 
 #include <vlc_aout.h>
 #include <vlc_filter.h>
 
 #include "equalizer_presets.h"
+#include "frames_simd.h"
 
 /* TODO:
- *  - optimize a bit (you can hardly do slower ;)
  *  - add tables for more bands (15 and 32 would be cool), maybe with auto coeffs
  *    computation (not too hard once the Q is found).
  *  - support for external preset
@@ -100,37 +102,58 @@ vlc_module_end ()
 /*****************************************************************************
  * Local prototypes
  *****************************************************************************/
+/* Channels are filtered in parallel, one per vector lane: the state has room
+ * for the widest vectors */
+#define EQZ_CHANNELS ((AOUT_CHAN_MAX + 7) & ~7)
+
 typedef struct
+{
+    float x[2][EQZ_CHANNELS];
+    float y[EQZ_BANDS_MAX][2][EQZ_CHANNELS];
+} eqz_state_t;
+
+typedef struct filter_sys_t filter_sys_t;
+
+struct filter_sys_t
 {
     /* Filter static config */
-    int i_band;
-    float *f_alpha;
-    float *f_beta;
-    float *f_gamma;
+    float f_alpha[EQZ_BANDS_MAX];
+    float f_beta[EQZ_BANDS_MAX];
+    float f_gamma[EQZ_BANDS_MAX];
 
-    /* Filter dyn config */
-    float *f_amp;   /* Per band amp */
+    /* Filter dyn config, as set by the callbacks */
+    float f_db[EQZ_BANDS_MAX];  /* Per band gain in dB */
     float f_gamp;   /* Global preamp */
     bool b_2eqz;
+    bool b_dirty;
 
-    /* Filter state */
-    float x[32][2];
-    float y[32][128][2];
+    /* Filter dyn config, as used by the filter, derived from the above */
+    float f_amp[EQZ_BANDS_MAX];  /* Per band amp */
+    float f_out;    /* Output gain, the preamp applies to each pass */
 
-    /* Second filter state */
-    float x2[32][2];
-    float y2[32][128][2];
+    /* Filter state of each pass */
+    eqz_state_t state[2];
 
+    void (*pf_filter)( filter_sys_t *, float *, unsigned, unsigned );
     vlc_mutex_t lock;
-} filter_sys_t;
+};
 
 static block_t *DoWork( filter_t *, block_t * );
 
 #define EQZ_IN_FACTOR (0.25f)
 static int  EqzInit( filter_t *, int );
-static void EqzFilter( filter_t *, float *, float *, int, int );
+static void EqzUpdate( filter_sys_t * );
 static void EqzClean( filter_t * );
 
+static void EqzFilterC( filter_sys_t *, float *, unsigned, unsigned );
+#ifdef FRAMES_X86
+static void EqzFilterSSE2( filter_sys_t *, float *, unsigned, unsigned );
+static void EqzFilterAVX( filter_sys_t *, float *, unsigned, unsigned );
+#endif
+#ifdef FRAMES_NEON
+static void EqzFilterNEON( filter_sys_t *, float *, unsigned, unsigned );
+#endif
+
 static int PresetCallback ( vlc_object_t *, char const *, vlc_value_t,
                             vlc_value_t, void * );
 static int PreampCallback ( vlc_object_t *, char const *, vlc_value_t,
@@ -167,6 +190,20 @@ static int Open( vlc_object_t *p_this )
     p_filter->fmt_out.audio = p_filter->fmt_in.audio;
     p_filter->pf_audio_filter = DoWork;
 
+    p_sys->pf_filter = EqzFilterC;
+#ifdef FRAMES_X86
+    /* Wider vectors would mostly hold padding for stereo */
+    if( vlc_CPU_AVX()
+     && aout_FormatNbChannels( &p_filter->fmt_in.audio ) > 4 )
+        p_sys->pf_filter = EqzFilterAVX;
+    else if( vlc_CPU_SSE2() )
+        p_sys->pf_filter = EqzFilterSSE2;
+#endif
+#ifdef FRAMES_NEON
+    if( vlc_CPU_ARM_NEON() )
+        p_sys->pf_filter = EqzFilterNEON;
+#endif
+
     return VLC_SUCCESS;
 }
 
@@ -190,9 +227,15 @@ static void Close( vlc_object_t *p_this )
  *****************************************************************************/
 static block_t * DoWork( filter_t * p_filter, block_t * p_in_buf )
 {
-    EqzFilter( p_filter, (float*)p_in_buf->p_buffer,
-               (float*)p_in_buf->p_buffer, p_in_buf->i_nb_samples,
-               aout_FormatNbChannels( &p_filter->fmt_in.audio ) );
+    filter_sys_t *p_sys = p_filter->p_sys;
+
+    vlc_mutex_lock( &p_sys->lock );
+    if( p_sys->b_dirty )
+        EqzUpdate( p_sys );
+    p_sys->pf_filter( p_sys, (float*)p_in_buf->p_buffer,
+                      p_in_buf->i_nb_samples,
+                      aout_FormatNbChannels( &p_filter->fmt_in.audio ) );
+    vlc_mutex_unlock( &p_sys->lock );
     return p_in_buf;
 }
 
@@ -280,23 +323,15 @@ static int EqzInit( filter_t *p_filter, int i_rate )
 {
     filter_sys_t *p_sys = p_filter->p_sys;
     eqz_config_t cfg;
-    int i, ch;
+    int i;
     vlc_value_t val1, val2, val3;
     vlc_object_t *p_aout = p_filter->obj.parent;
-    int i_ret = VLC_ENOMEM;
 
     bool b_vlcFreqs = var_InheritBool( p_aout, "equalizer-vlcfreqs" );
     EqzCoeffs( i_rate, 1.0f, b_vlcFreqs, &cfg );
 
     /* Create the static filter config */
-    p_sys->i_band = cfg.i_band;
-    p_sys->f_alpha = vlc_alloc( p_sys->i_band, sizeof(float) );
-    p_sys->f_beta  = vlc_alloc( p_sys->i_band, sizeof(float) );
-    p_sys->f_gamma = vlc_alloc( p_sys->i_band, sizeof(float) );
-    if( !p_sys->f_alpha || !p_sys->f_beta || !p_sys->f_gamma )
-        goto error;
-
-    for( i = 0; i < p_sys->i_band; i++ )
+    for( i = 0; i < EQZ_BANDS_MAX; i++ )
     {
         p_sys->f_alpha[i] = cfg.band[i].f_alpha;
         p_sys->f_beta[i]  = cfg.band[i].f_beta;
@@ -306,31 +341,11 @@ static int EqzInit( filter_t *p_filter, int i_rate )
     /* Filter dyn config */
     p_sys->b_2eqz = false;
     p_sys->f_gamp = 1.0f;
-    p_sys->f_amp  = vlc_alloc( p_sys->i_band, sizeof(float) );
-    if( !p_sys->f_amp )
-        goto error;
-
-    for( i = 0; i < p_sys->i_band; i++ )
-    {
-        p_sys->f_amp[i] = 0.0f;
-    }
+    for( i = 0; i < EQZ_BANDS_MAX; i++ )
+        p_sys->f_db[i] = 0.0f;
 
     /* Filter state */
-    for( ch = 0; ch < 32; ch++ )
-    {
-        p_sys->x[ch][0]  =
-        p_sys->x[ch][1]  =
-        p_sys->x2[ch][0] =
-        p_sys->x2[ch][1] = 0.0f;
-
-        for( i = 0; i < p_sys->i_band; i++ )
-        {
-            p_sys->y[ch][i][0]  =
-            p_sys->y[ch][i][1]  =
-            p_sys->y2[ch][i][0] =
-            p_sys->y2[ch][i][1] = 0.0f;
-        }
-    }
+    memset( p_sys->state, 0, sizeof( p_sys->state ) );
 
     var_Create( p_aout, "equalizer-bands", VLC_VAR_STRING | VLC_VAR_DOINHERIT );
     var_Create( p_aout, "equalizer-preset", VLC_VAR_STRING | VLC_VAR_DOINHERIT );
@@ -356,12 +371,12 @@ static int EqzInit( filter_t *p_filter, int i_rate )
     {
         msg_Err(p_filter, "No preset selected");
         free( val2.psz_string );
-        free( p_sys->f_amp );
-        i_ret = VLC_EGENERIC;
-        goto error;
+        return VLC_EGENERIC;
     }
     free( val2.psz_string );
 
+    EqzUpdate( p_sys );
+
     /* Add our own callbacks */
     var_AddCallback( p_aout, "equalizer-preset", PresetCallback, p_sys );
     var_AddCallback( p_aout, "equalizer-bands", BandsCallback, p_sys );
@@ -369,84 +384,367 @@ static int EqzInit( filter_t *p_filter, int i_rate )
     var_AddCallback( p_aout, "equalizer-2pass", TwoPassCallback, p_sys );
 
     msg_Dbg( p_filter, "equalizer loaded for %d Hz with %d bands %d pass",
-                        i_rate, p_sys->i_band, p_sys->b_2eqz ? 2 : 1 );
-    for( i = 0; i < p_sys->i_band; i++ )
+                        i_rate, EQZ_BANDS_MAX, p_sys->b_2eqz ? 2 : 1 );
+    for( i = 0; i < EQZ_BANDS_MAX; i++ )
     {
         msg_Dbg( p_filter, "   %.2f Hz -> factor:%f alpha:%f beta:%f gamma:%f",
                  cfg.band[i].f_frequency, p_sys->f_amp[i],
                  p_sys->f_alpha[i], p_sys->f_beta[i], p_sys->f_gamma[i]);
     }
     return VLC_SUCCESS;
+}
+
+/* Derives the filter parameters from the settings, once they are all set and
+ * before they are used, rather than on each callback: a preset sets every
+ * band and the preamp. Called with the lock held. */
+static void EqzUpdate( filter_sys_t *p_sys )
+{
+    for( int i = 0; i < EQZ_BANDS_MAX; i++ )
+        p_sys->f_amp[i] = EqzConvertdB( p_sys->f_db[i] );
 
-error:
-    free( p_sys->f_alpha );
-    free( p_sys->f_beta );
-    free( p_sys->f_gamma );
-    return i_ret;
+    p_sys->f_out = p_sys->b_2eqz ? p_sys->f_gamp * p_sys->f_gamp
+                                 : p_sys->f_gamp;
+    p_sys->b_dirty = false;
 }
 
-static void EqzFilter( filter_t *p_filter, float *out, float *in,
-                       int i_samples, int i_channels )
+/*
+ * Each band is a 2nd order IIR on the input, and the output is the input plus
+ * the sum of the bands weighted by their gains; in two pass mode, that output
+ * goes through the same filters again. The filters of every channel have the
+ * same coefficients, so the kernels run one channel per vector lane. The band
+ * filters of a group of channels remain in registers over the whole buffer.
+ */
+static void EqzFilterC( filter_sys_t *p_sys, float *buf,
+                        unsigned i_samples, unsigned i_channels )
 {
-    filter_sys_t *p_sys = p_filter->p_sys;
-    int i, ch, j;
+    const unsigned i_pass = p_sys->b_2eqz ? 2 : 1;
+    float alpha[EQZ_BANDS_MAX], beta[EQZ_BANDS_MAX], gamma[EQZ_BANDS_MAX];
+    float amp[EQZ_BANDS_MAX];
 
-    vlc_mutex_lock( &p_sys->lock );
-    for( i = 0; i < i_samples; i++ )
+    for( unsigned j = 0; j < EQZ_BANDS_MAX; j++ )
     {
-        for( ch = 0; ch < i_channels; ch++ )
+        alpha[j] = p_sys->f_alpha[j];
+        beta[j]  = p_sys->f_beta[j];
+        gamma[j] = p_sys->f_gamma[j];
+        amp[j]   = p_sys->f_amp[j];
+    }
+
+    for( unsigned ch = 0; ch < i_channels; ch++ )
+    {
+        float x[2][2], y[2][EQZ_BANDS_MAX][2];
+
+        for( unsigned p = 0; p < i_pass; p++ )
         {
-            const float x = in[ch];
-            float o = 0.0f;
+            const eqz_state_t *s = &p_sys->state[p];
 
-            for( j = 0; j < p_sys->i_band; j++ )
+            for( unsigned d = 0; d < 2; d++ )
             {
-                float y = p_sys->f_alpha[j] * ( x - p_sys->x[ch][1] ) +
-                          p_sys->f_gamma[j] * p_sys->y[ch][j][0] -
-                          p_sys->f_beta[j]  * p_sys->y[ch][j][1];
+                x[p][d] = s->x[d][ch];
+                for( unsigned j = 0; j < EQZ_BANDS_MAX; j++ )
+                    y[p][j][d] = s->y[j][d][ch];
+            }
+        }
 
-                p_sys->y[ch][j][1] = p_sys->y[ch][j][0];
-                p_sys->y[ch][j][0] = y;
+        for( unsigned i = 0; i < i_samples; i++ )
+        {
+            float *frame = &buf[i * i_channels + ch];
+            float in = *frame, o = 0.0f;
 
-                o += y * p_sys->f_amp[j];
+            for( unsigned p = 0; p < i_pass; p++ )
+            {
+                /* The second pass filters the output of the first one */
+                if( p > 0 )
+                    in = EQZ_IN_FACTOR * in + o;
+                o = 0.0f;
+                for( unsigned j = 0; j < EQZ_BANDS_MAX; j++ )
+                {
+                    float v = alpha[j] * ( in - x[p][1] ) +
+                              gamma[j] * y[p][j][0] -
+                              beta[j]  * y[p][j][1];
+
+                    y[p][j][1] = y[p][j][0];
+                    y[p][j][0] = v;
+
+                    o += v * amp[j];
+                }
+                x[p][1] = x[p][0];
+                x[p][0] = in;
             }
-            p_sys->x[ch][1] = p_sys->x[ch][0];
-            p_sys->x[ch][0] = x;
 
-            /* Second filter */
-            if( p_sys->b_2eqz )
+            /* We add source PCM + filtered PCM */
+            *frame = p_sys->f_out * ( EQZ_IN_FACTOR * in + o );
+        }
+
+        for( unsigned p = 0; p < i_pass; p++ )
+        {
+            eqz_state_t *s = &p_sys->state[p];
+
+            for( unsigned d = 0; d < 2; d++ )
             {
-                const float x2 = EQZ_IN_FACTOR * x + o;
-                o = 0.0f;
-                for( j = 0; j < p_sys->i_band; j++ )
+                s->x[d][ch] = x[p][d];
+                for( unsigned j = 0; j < EQZ_BANDS_MAX; j++ )
+                    s->y[j][d][ch] = y[p][j][d];
+            }
+        }
+    }
+}
+
+#ifdef FRAMES_X86
+VLC_SSE2
+static void EqzFilterSSE2( filter_sys_t *p_sys, float *buf,
+                           unsigned i_samples, unsigned i_channels )
+{
+    const unsigned i_pass = p_sys->b_2eqz ? 2 : 1;
+    const __m128 in_factor = _mm_set1_ps( EQZ_IN_FACTOR );
+    const __m128 out = _mm_set1_ps( p_sys->f_out );
+    __m128 alpha[EQZ_BANDS_MAX], beta[EQZ_BANDS_MAX], gamma[EQZ_BANDS_MAX];
+    __m128 amp[EQZ_BANDS_MAX];
+
+    for( unsigned j = 0; j < EQZ_BANDS_MAX; j++ )
+    {
+        alpha[j] = _mm_set1_ps( p_sys->f_alpha[j] );
+        beta[j]  = _mm_set1_ps( p_sys->f_beta[j] );
+        gamma[j] = _mm_set1_ps( p_sys->f_gamma[j] );
+        amp[j]   = _mm_set1_ps( p_sys->f_amp[j] );
+    }
+
+    for( unsigned ch = 0; ch < i_channels; ch += 4 )
+    {
+        const unsigned n = __MIN( i_channels - ch, 4 );
+        __m128 x[2][2], y[2][EQZ_BANDS_MAX][2];
+
+        for( unsigned p = 0; p < i_pass; p++ )
+        {
+            const eqz_state_t *s = &p_sys->state[p];
+
+            for( unsigned d = 0; d < 2; d++ )
+            {
+                x[p][d] = _mm_loadu_ps( &s->x[d][ch] );
+                for( unsigned j = 0; j < EQZ_BANDS_MAX; j++ )
+                    y[p][j][d] = _mm_loadu_ps( &s->y[j][d][ch] );
+            }
+        }
+
+        for( unsigned i = 0; i < i_samples; i++ )
+        {
+            float *frame = &buf[i * i_channels + ch];
+            __m128 in = likely( n == 4 ) ? _mm_loadu_ps( frame )
+                                         : LoadPartialSSE2( frame, n );
+            __m128 o = _mm_setzero_ps();
+
+            for( unsigned p = 0; p < i_pass; p++ )
+            {
+                if( p > 0 )
+                    in = _mm_add_ps( _mm_mul_ps( in_factor, in ), o );
+                o = _mm_setzero_ps();
+                for( unsigned j = 0; j < EQZ_BANDS_MAX; j++ )
                 {
-                    float y = p_sys->f_alpha[j] * ( x2 - p_sys->x2[ch][1] ) +
-                              p_sys->f_gamma[j] * p_sys->y2[ch][j][0] -
-                              p_sys->f_beta[j]  * p_sys->y2[ch][j][1];
+                    __m128 v = _mm_sub_ps(
+                        _mm_add_ps( _mm_mul_ps( alpha[j],
+                                                _mm_sub_ps( in, x[p][1] ) ),
+                                    _mm_mul_ps( gamma[j], y[p][j][0] ) ),
+                        _mm_mul_ps( beta[j], y[p][j][1] ) );
 
-                    p_sys->y2[ch][j][1] = p_sys->y2[ch][j][0];
-                    p_sys->y2[ch][j][0] = y;
+                    y[p][j][1] = y[p][j][0];
+                    y[p][j][0] = v;
 
-                    o += y * p_sys->f_amp[j];
+                    o = _mm_add_ps( o, _mm_mul_ps( v, amp[j] ) );
                 }
-                p_sys->x2[ch][1] = p_sys->x2[ch][0];
-                p_sys->x2[ch][0] = x2;
+                x[p][1] = x[p][0];
+                x[p][0] = in;
+            }
 
-                /* We add source PCM + filtered PCM */
-                out[ch] = p_sys->f_gamp * p_sys->f_gamp *( EQZ_IN_FACTOR * x2 + o );
+            in = _mm_mul_ps( out, _mm_add_ps( _mm_mul_ps( in_factor, in ), o ) );
+            if( likely( n == 4 ) )
+                _mm_storeu_ps( frame, in );
+            else
+                StorePartialSSE2( frame, in, n );
+        }
+
+        for( unsigned p = 0; p < i_pass; p++ )
+        {
+            eqz_state_t *s = &p_sys->state[p];
+
+            for( unsigned d = 0; d < 2; d++ )
+            {
+                _mm_storeu_ps( &s->x[d][ch], x[p][d] );
+                for( unsigned j = 0; j < EQZ_BANDS_MAX; j++ )
+                    _mm_storeu_ps( &s->y[j][d][ch], y[p][j][d] );
             }
+        }
+    }
+}
+
+VLC_AVX
+static void EqzFilterAVX( filter_sys_t *p_sys, float *buf,
+                          unsigned i_samples, unsigned i_channels )
+{
+    const unsigned i_pass = p_sys->b_2eqz ? 2 : 1;
+    const __m256 in_factor = _mm256_set1_ps( EQZ_IN_FACTOR );
+    const __m256 out = _mm256_set1_ps( p_sys->f_out );
+    __m256 alpha[EQZ_BANDS_MAX], beta[EQZ_BANDS_MAX], gamma[EQZ_BANDS_MAX];
+    __m256 amp[EQZ_BANDS_MAX];
+
+    for( unsigned j = 0; j < EQZ_BANDS_MAX; j++ )
+    {
+        alpha[j] = _mm256_set1_ps( p_sys->f_alpha[j] );
+        beta[j]  = _mm256_set1_ps( p_sys->f_beta[j] );
+        gamma[j] = _mm256_set1_ps( p_sys->f_gamma[j] );
+        amp[j]   = _mm256_set1_ps( p_sys->f_amp[j] );
+    }
+
+    for( unsigned ch = 0; ch < i_channels; ch += 8 )
+    {
+        const unsigned n = __MIN( i_channels - ch, 8 );
+        __m256 x[2][2], y[2][EQZ_BANDS_MAX][2];
+
+        for( unsigned p = 0; p < i_pass; p++ )
+        {
+            const eqz_state_t *s = &p_sys->state[p];
+
+            for( unsigned d = 0; d < 2; d++ )
+            {
+                x[p][d] = _mm256_loadu_ps( &s->x[d][ch] );
+                for( unsigned j = 0; j < EQZ_BANDS_MAX; j++ )
+                    y[p][j][d] = _mm256_loadu_ps( &s->y[j][d][ch] );
+            }
+        }
+
+        for( unsigned i = 0; i < i_samples; i++ )
+        {
+            float *frame = &buf[i * i_channels + ch];
+            __m256 in = likely( n == 8 ) ? _mm256_loadu_ps( frame )
+                                         : LoadPartialAVX( frame, n );
+            __m256 o = _mm256_setzero_ps();
+
+            for( unsigned p = 0; p < i_pass; p++ )
+            {
+                if( p > 0 )
+                    in = _mm256_add_ps( _mm256_mul_ps( in_factor, in ), o );
+                o = _mm256_setzero_ps();
+                for( unsigned j = 0; j < EQZ_BANDS_MAX; j++ )
+                {
+                    __m256 v = _mm256_sub_ps(
+                        _mm256_add_ps( _mm256_mul_ps( alpha[j],
+                                                      _mm256_sub_ps( in, x[p][1] ) ),
+                                       _mm256_mul_ps( gamma[j], y[p][j][0] ) ),
+                        _mm256_mul_ps( beta[j], y[p][j][1] ) );
+
+                    y[p][j][1] = y[p][j][0];
+                    y[p][j][0] = v;
+
+                    o = _mm256_add_ps( o, _mm256_mul_ps( v, amp[j] ) );
+                }
+                x[p][1] = x[p][0];
+                x[p][0] = in;
+            }
+
+            in = _mm256_mul_ps( out,
+                                _mm256_add_ps( _mm256_mul_ps( in_factor, in ), o ) );
+            if( likely( n == 8 ) )
+                _mm256_storeu_ps( frame, in );
             else
+                StorePartialAVX( frame, in, n );
+        }
+
+        for( unsigned p = 0; p < i_pass; p++ )
+        {
+            eqz_state_t *s = &p_sys->state[p];
+
+            for( unsigned d = 0; d < 2; d++ )
             {
-                /* We add source PCM + filtered PCM */
-                out[ch] = p_sys->f_gamp *( EQZ_IN_FACTOR * x + o );
+                _mm256_storeu_ps( &s->x[d][ch], x[p][d] );
+                for( unsigned j = 0; j < EQZ_BANDS_MAX; j++ )
+                    _mm256_storeu_ps( &s->y[j][d][ch], y[p][j][d] );
             }
         }
+    }
+}
+#endif
 
-        in  += i_channels;
-        out += i_channels;
+#ifdef FRAMES_NEON
+static void EqzFilterNEON( filter_sys_t *p_sys, float *buf,
+                           unsigned i_samples, unsigned i_channels )
+{
+    const unsigned i_pass = p_sys->b_2eqz ? 2 : 1;
+    const float32x4_t in_factor = vdupq_n_f32( EQZ_IN_FACTOR );
+    const float32x4_t out = vdupq_n_f32( p_sys->f_out );
+    float32x4_t alpha[EQZ_BANDS_MAX], beta[EQZ_BANDS_MAX], gamma[EQZ_BANDS_MAX];
+    float32x4_t amp[EQZ_BANDS_MAX];
+
+    for( unsigned j = 0; j < EQZ_BANDS_MAX; j++ )
+    {
+        alpha[j] = vdupq_n_f32( p_sys->f_alpha[j] );
+        beta[j]  = vdupq_n_f32( p_sys->f_beta[j] );
+        gamma[j] = vdupq_n_f32( p_sys->f_gamma[j] );
+        amp[j]   = vdupq_n_f32( p_sys->f_amp[j] );
+    }
+
+    for( unsigned ch = 0; ch < i_channels; ch += 4 )
+    {
+        const unsigned n = __MIN( i_channels - ch, 4 );
+        float32x4_t x[2][2], y[2][EQZ_BANDS_MAX][2];
+
+        for( unsigned p = 0; p < i_pass; p++ )
+        {
+            const eqz_state_t *s = &p_sys->state[p];
+
+            for( unsigned d = 0; d < 2; d++ )
+            {
+                x[p][d] = vld1q_f32( &s->x[d][ch] );
+                for( unsigned j = 0; j < EQZ_BANDS_MAX; j++ )
+                    y[p][j][d] = vld1q_f32( &s->y[j][d][ch] );
+            }
+        }
+
+        for( unsigned i = 0; i < i_samples; i++ )
+        {
+            float *frame = &buf[i * i_channels + ch];
+            float32x4_t in = likely( n == 4 ) ? vld1q_f32( frame )
+                                              : LoadPartialNEON( frame, n );
+            float32x4_t o = vdupq_n_f32( 0.f );
+
+            for( unsigned p = 0; p < i_pass; p++ )
+            {
+                if( p > 0 )
+                    in = vmlaq_f32( o, in_factor, in );
+                o = vdupq_n_f32( 0.f );
+                for( unsigned j = 0; j < EQZ_BANDS_MAX; j++ )
+                {
+                    float32x4_t v = vmulq_f32( alpha[j], vsubq_f32( in, x[p][1] ) );
+                    v = vmlaq_f32( v, gamma[j], y[p][j][0] );
+                    v = vmlsq_f32( v, beta[j], y[p][j][1] );
+
+                    y[p][j][1] = y[p][j][0];
+                    y[p][j][0] = v;
+
+                    o = vmlaq_f32( o, v, amp[j] );
+                }
+                x[p][1] = x[p][0];
+                x[p][0] = in;
+            }
+
+            in = vmulq_f32( out, vmlaq_f32( o, in_factor, in ) );
+            if( likely( n == 4 ) )
+                vst1q_f32( frame, in );
+            else
+                StorePartialNEON( frame, in, n );
+        }
+
+        for( unsigned p = 0; p < i_pass; p++ )
+        {
+            eqz_state_t *s = &p_sys->state[p];
+
+            for( unsigned d = 0; d < 2; d++ )
+            {
+                vst1q_f32( &s->x[d][ch], x[p][d] );
+                for( unsigned j = 0; j < EQZ_BANDS_MAX; j++ )
+                    vst1q_f32( &s->y[j][d][ch], y[p][j][d] );
+            }
+        }
     }
-    vlc_mutex_unlock( &p_sys->lock );
 }
+#endif
 
 static void EqzClean( filter_t *p_filter )
 {
@@ -457,12 +755,6 @@ static void EqzClean( filter_t *p_filter )
     var_DelCallback( p_aout, "equalizer-preset", PresetCallback, p_sys );
     var_DelCallback( p_aout, "equalizer-preamp", PreampCallback, p_sys );
     var_DelCallback( p_aout, "equalizer-2pass", TwoPassCallback, p_sys );
-
-    free( p_sys->f_alpha );
-    free( p_sys->f_beta );
-    free( p_sys->f_gamma );
-
-    free( p_sys->f_amp );
 }
 
 
@@ -529,6 +821,7 @@ static int PreampCallback( vlc_object_t *p_this, char const *psz_cmd,
 
     vlc_mutex_lock( &p_sys->lock );
     p_sys->f_gamp = preamp;
+    p_sys->b_dirty = true;
     vlc_mutex_unlock( &p_sys->lock );
     return VLC_SUCCESS;
 }
@@ -543,7 +836,7 @@ static int BandsCallback( vlc_object_t *p_this, char const *psz_cmd,
 
     /* Same thing for bands */
     vlc_mutex_lock( &p_sys->lock );
-    while( i < p_sys->i_band )
+    while( i < EQZ_BANDS_MAX )
     {
         char *next;
         /* Read dB -20/20 */
@@ -551,14 +844,15 @@ static int BandsCallback( vlc_object_t *p_this, char const *psz_cmd,
         if( next == p || isnan( f ) )
             break; /* no conversion */
 
-        p_sys->f_amp[i++] = EqzConvertdB( f );
+        p_sys->f_db[i++] = f;
 
         if( *next == '\0' )
             break; /* end of line */
         p = &next[1];
     }
-    while( i < p_sys->i_band )
-        p_sys->f_amp[i++] = EqzConvertdB( 0.f );
+    while( i < EQZ_BANDS_MAX )
+        p_sys->f_db[i++] = 0.f;
+    p_sys->b_dirty = true;
     vlc_mutex_unlock( &p_sys->lock );
     return VLC_SUCCESS;
 }
@@ -570,6 +864,7 @@ static int TwoPassCallback( vlc_object_t *p_this, char const *psz_cmd,
 
     vlc_mutex_lock( &p_sys->lock );
     p_sys->b_2eqz = newval.b_bool;
+    p_sys->b_dirty = true;
     vlc_mutex_unlock( &p_sys->lock );
     return VLC_SUCCESS;
 }
@@ -0,0 +1,127 @@
+/*****************************************************************************
+ * frames_simd.h: partial frame loads and stores for the SIMD audio filters
+ *****************************************************************************
+ * Copyright (C) 2024 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+#ifndef VLC_AUDIO_FILTER_FRAMES_SIMD_H_
+#define VLC_AUDIO_FILTER_FRAMES_SIMD_H_
+
+/*
+ * The filters which run one channel per vector lane load and store the
+ * channels of a frame by groups of a vector width. These helpers handle the
+ * last group of a frame, of n channels, without touching the next frame.
+ */
+
+#include <string.h>
+#include <vlc_cpu.h>
+
+#if defined(__GNUC__) && (defined(__i386__) || defined(__x86_64__))
+# define FRAMES_X86
+# include <immintrin.h>
+
+/* Loads and stores the n < 4 last channels of a frame */
+VLC_SSE2
+static inline __m128 LoadPartialSSE2( const float *p, unsigned n )
+{
+    if( n == 1 )
+        return _mm_load_ss( p );
+
+    __m128 v = _mm_loadl_pi( _mm_setzero_ps(), (const __m64 *)p );
+    if( n == 3 )
+        v = _mm_movelh_ps( v, _mm_load_ss( p + 2 ) );
+    return v;
+}
+
+VLC_SSE2
+static inline void StorePartialSSE2( float *p, __m128 v, unsigned n )
+{
+    if( n == 1 )
+    {
+        _mm_store_ss( p, v );
+        return;
+    }
+
+    _mm_storel_pi( (__m64 *)p, v );
+    if( n == 3 )
+        _mm_store_ss( p + 2, _mm_movehl_ps( v, v ) );
+}
+
+/* Loads and stores the n < 8 last channels of a frame: masked stores would
+ * stall the load of the next frame */
+VLC_AVX
+static inline __m256 LoadPartialAVX( const float *p, unsigned n )
+{
+    __m128 lo, hi = _mm_setzero_ps();
+
+    if( n < 4 )
+        lo = LoadPartialSSE2( p, n );
+    else
+    {
+        lo = _mm_loadu_ps( p );
+        if( n > 4 )
+            hi = LoadPartialSSE2( p + 4, n - 4 );
+    }
+    return _mm256_insertf128_ps( _mm256_castps128_ps256( lo ), hi, 1 );
+}
+
+VLC_AVX
+static inline void StorePartialAVX( float *p, __m256 v, unsigned n )
+{
+    __m128 lo = _mm256_castps256_ps128( v );
+
+    if( n < 4 )
+        StorePartialSSE2( p, lo, n );
+    else
+    {
+        _mm_storeu_ps( p, lo );
+        if( n > 4 )
+            StorePartialSSE2( p + 4, _mm256_extractf128_ps( v, 1 ), n - 4 );
+    }
+}
+#endif
+
+#if defined(__ARM_NEON)
+# define FRAMES_NEON
+# include <arm_neon.h>
+
+/* Loads and stores the n < 4 last channels of a frame */
+static inline float32x4_t LoadPartialNEON( const float *p, unsigned n )
+{
+    if( n == 2 )
+        return vcombine_f32( vld1_f32( p ), vdup_n_f32( 0.f ) );
+
+    float tmp[4] = { 0.f, 0.f, 0.f, 0.f };
+    memcpy( tmp, p, n * sizeof (float) );
+    return vld1q_f32( tmp );
+}
+
+static inline void StorePartialNEON( float *p, float32x4_t v, unsigned n )
+{
+    if( n == 2 )
+    {
+        vst1_f32( p, vget_low_f32( v ) );
+        return;
+    }
+
+    float tmp[4];
+    vst1q_f32( tmp, v );
+    memcpy( p, tmp, n * sizeof (float) );
+}
+#endif
+
+#endif
@@ -30,12 +30,17 @@
 #endif
 
 #include <math.h>
+#include <string.h>
 
 #include <vlc_common.h>
 #include <vlc_plugin.h>
+#include <vlc_cpu.h>
 #include <vlc_aout.h>
 #include <vlc_filter.h>
 
+#include "frames_simd.h"
+
+
 /*****************************************************************************
  * Module descriptor
  *****************************************************************************/
@@ -43,8 +48,6 @@ static int  Open ( vlc_object_t * );
 static void Close( vlc_object_t * );
 static void CalcPeakEQCoeffs( float, float, float, float, float * );
 static void CalcShelfEQCoeffs( float, float, float, int, float, float * );
-static void ProcessEQ( const float *, float *, float *, unsigned, unsigned,
-                       const float *, unsigned );
 static block_t *DoWork( filter_t *, block_t * );
 
 vlc_module_begin ()
@@ -82,7 +85,14 @@ vlc_module_end ()
 /*****************************************************************************
  * Local prototypes
  *****************************************************************************/
-typedef struct
+#define EQ_COUNT 5
+/* Channels are filtered in parallel, one per vector lane: the state has room
+ * for the widest vectors */
+#define EQ_CHANNELS ((AOUT_CHAN_MAX + 7) & ~7)
+
+typedef struct filter_sys_t filter_sys_t;
+
+struct filter_sys_t
 {
     /* Filter static config */
     float   f_lowf, f_lowgain;
@@ -91,11 +101,21 @@ typedef struct
     float   f_f3, f_Q3, f_gain3;
     float   f_highf, f_highgain;
     /* Filter computed coeffs */
-    float   coeffs[5*5];
-    /* State */
-    float  *p_state;
-} filter_sys_t;
+    float   coeffs[EQ_COUNT*5];
+    /* State: x[n-1], x[n-2], y[n-1], y[n-2] of each filter */
+    float   state[EQ_COUNT][4][EQ_CHANNELS];
 
+    void  (*pf_process)( filter_sys_t *, float *, unsigned, unsigned );
+};
+
+static void ProcessEQ( filter_sys_t *, float *, unsigned, unsigned );
+#ifdef FRAMES_X86
+static void ProcessEQ_SSE2( filter_sys_t *, float *, unsigned, unsigned );
+static void ProcessEQ_AVX( filter_sys_t *, float *, unsigned, unsigned );
+#endif
+#ifdef FRAMES_NEON
+static void ProcessEQ_NEON( filter_sys_t *, float *, unsigned, unsigned );
+#endif
 
 
 
@@ -107,6 +127,9 @@ static int Open( vlc_object_t *p_this )
     filter_t     *p_filter = (filter_t *)p_this;
     unsigned     i_samplerate;
 
+    if( p_filter->fmt_in.audio.i_channels > AOUT_CHAN_MAX )
+        return VLC_EGENERIC;
+
     /* Allocate structure */
     filter_sys_t *p_sys = p_filter->p_sys = malloc( sizeof( *p_sys ) );
     if( !p_sys )
@@ -145,8 +168,20 @@ static int Open( vlc_object_t *p_this )
                       i_samplerate, p_sys->coeffs+3*5);
     CalcShelfEQCoeffs(p_sys->f_highf, 1, p_sys->f_highgain, 0,
                       i_samplerate, p_sys->coeffs+4*5);
-    p_sys->p_state = (float*)calloc( p_filter->fmt_in.audio.i_channels*5*4,
-                                     sizeof(float) );
+    memset( p_sys->state, 0, sizeof( p_sys->state ) );
+
+    p_sys->pf_process = ProcessEQ;
+#ifdef FRAMES_X86
+    /* Wider vectors would mostly hold padding for stereo */
+    if( vlc_CPU_AVX() && p_filter->fmt_in.audio.i_channels > 4 )
+        p_sys->pf_process = ProcessEQ_AVX;
+    else if( vlc_CPU_SSE2() )
+        p_sys->pf_process = ProcessEQ_SSE2;
+#endif
+#ifdef FRAMES_NEON
+    if( vlc_CPU_ARM_NEON() )
+        p_sys->pf_process = ProcessEQ_NEON;
+#endif
 
     return VLC_SUCCESS;
 }
@@ -155,7 +190,6 @@ static void Close( vlc_object_t *p_this )
 {
     filter_t *p_filter = (filter_t *)p_this;
     filter_sys_t *p_sys = p_filter->p_sys;
-    free( p_sys->p_state );
     free( p_sys );
 }
 
@@ -167,10 +201,9 @@ static void Close( vlc_object_t *p_this )
 static block_t *DoWork( filter_t * p_filter, block_t * p_in_buf )
 {
     filter_sys_t *p_sys = p_filter->p_sys;
-    ProcessEQ( (float*)p_in_buf->p_buffer, (float*)p_in_buf->p_buffer,
-               p_sys->p_state,
-               p_filter->fmt_in.audio.i_channels, p_in_buf->i_nb_samples,
-               p_sys->coeffs, 5 );
+    p_sys->pf_process( p_sys, (float*)p_in_buf->p_buffer,
+                       p_filter->fmt_in.audio.i_channels,
+                       p_in_buf->i_nb_samples );
     return p_in_buf;
 }
 
@@ -276,48 +309,202 @@ static void CalcShelfEQCoeffs( float f0, float slope, float gainDB, int high,
 }
 
 /*
-  src is assumed to be interleaved
-  dest is assumed to be interleaved
-  size of state is 4*channels*eqCount
+  buf is interleaved, and filtered in place
   samples is not premultiplied by channels
-  size of coeffs is 5*eqCount
+  The filters are cascaded; the filters of every channel have the same
+  coefficients, so the vector versions run one channel per lane, and keep the
+  state of a group of channels in registers over the whole buffer.
 */
-void ProcessEQ( const float *src, float *dest, float *state,
-                unsigned channels, unsigned samples, const float *coeffs,
-                unsigned eqCount )
+static void ProcessEQ( filter_sys_t *p_sys, float *buf,
+                       unsigned channels, unsigned samples )
 {
-    unsigned i, chn, eq;
-    float   b0, b1, b2, a1, a2;
-    float   x, y = 0;
-    const float *src1 = src;
-    float *dest1 = dest;
-
-    for (i = 0; i < samples; i++)
+    for (unsigned chn = 0; chn < channels; chn++)
     {
-        float *state1 = state;
-        for (chn = 0; chn < channels; chn++)
+        float state[EQ_COUNT][4];
+
+        for (unsigned eq = 0; eq < EQ_COUNT; eq++)
+            for (unsigned k = 0; k < 4; k++)
+                state[eq][k] = p_sys->state[eq][k][chn];
+
+        for (unsigned i = 0; i < samples; i++)
         {
-            const float *coeffs1 = coeffs;
-            x = *src1++;
+            const float *coeffs = p_sys->coeffs;
+            float x = buf[i * channels + chn];
+
             /* Direct form 1 IIRs */
-            for (eq = 0; eq < eqCount; eq++)
+            for (unsigned eq = 0; eq < EQ_COUNT; eq++)
             {
-                b0 = coeffs1[0];
-                b1 = coeffs1[1];
-                b2 = coeffs1[2];
-                a1 = coeffs1[3];
-                a2 = coeffs1[4];
-                coeffs1 += 5;
-                y = x*b0 + state1[0]*b1 + state1[1]*b2 - state1[2]*a1 - state1[3]*a2;
-                state1[1] = state1[0];
-                state1[0] = x;
-                state1[3] = state1[2];
-                state1[2] = y;
+                float y = x*coeffs[0] + state[eq][0]*coeffs[1]
+                        + state[eq][1]*coeffs[2] - state[eq][2]*coeffs[3]
+                        - state[eq][3]*coeffs[4];
+                state[eq][1] = state[eq][0];
+                state[eq][0] = x;
+                state[eq][3] = state[eq][2];
+                state[eq][2] = y;
                 x = y;
-                state1 += 4;
+                coeffs += 5;
             }
-            *dest1++ = y;
+            buf[i * channels + chn] = x;
         }
+
+        for (unsigned eq = 0; eq < EQ_COUNT; eq++)
+            for (unsigned k = 0; k < 4; k++)
+                p_sys->state[eq][k][chn] = state[eq][k];
     }
 }
 
+#ifdef FRAMES_X86
+VLC_SSE2
+static void ProcessEQ_SSE2( filter_sys_t *p_sys, float *buf,
+                            unsigned channels, unsigned samples )
+{
+    __m128 coeffs[EQ_COUNT][5];
+
+    for (unsigned eq = 0; eq < EQ_COUNT; eq++)
+        for (unsigned k = 0; k < 5; k++)
+            coeffs[eq][k] = _mm_set1_ps(p_sys->coeffs[eq * 5 + k]);
+
+    for (unsigned chn = 0; chn < channels; chn += 4)
+    {
+        const unsigned n = __MIN(channels - chn, 4);
+        __m128 state[EQ_COUNT][4];
+
+        for (unsigned eq = 0; eq < EQ_COUNT; eq++)
+            for (unsigned k = 0; k < 4; k++)
+                state[eq][k] = _mm_loadu_ps(&p_sys->state[eq][k][chn]);
+
+        for (unsigned i = 0; i < samples; i++)
+        {
+            float *frame = &buf[i * channels + chn];
+            __m128 x = likely(n == 4) ? _mm_loadu_ps(frame)
+                                      : LoadPartialSSE2(frame, n);
+
+            for (unsigned eq = 0; eq < EQ_COUNT; eq++)
+            {
+                __m128 y = _mm_add_ps(_mm_mul_ps(x, coeffs[eq][0]),
+                                      _mm_mul_ps(state[eq][0], coeffs[eq][1]));
+                y = _mm_add_ps(y, _mm_mul_ps(state[eq][1], coeffs[eq][2]));
+                y = _mm_sub_ps(y, _mm_mul_ps(state[eq][2], coeffs[eq][3]));
+                y = _mm_sub_ps(y, _mm_mul_ps(state[eq][3], coeffs[eq][4]));
+                state[eq][1] = state[eq][0];
+                state[eq][0] = x;
+                state[eq][3] = state[eq][2];
+                state[eq][2] = y;
+                x = y;
+            }
+
+            if (likely(n == 4))
+                _mm_storeu_ps(frame, x);
+            else
+                StorePartialSSE2(frame, x, n);
+        }
+
+        for (unsigned eq = 0; eq < EQ_COUNT; eq++)
+            for (unsigned k = 0; k < 4; k++)
+                _mm_storeu_ps(&p_sys->state[eq][k][chn], state[eq][k]);
+    }
+}
+
+VLC_AVX
+static void ProcessEQ_AVX( filter_sys_t *p_sys, float *buf,
+                           unsigned channels, unsigned samples )
+{
+    __m256 coeffs[EQ_COUNT][5];
+
+    for (unsigned eq = 0; eq < EQ_COUNT; eq++)
+        for (unsigned k = 0; k < 5; k++)
+            coeffs[eq][k] = _mm256_set1_ps(p_sys->coeffs[eq * 5 + k]);
+
+    for (unsigned chn = 0; chn < channels; chn += 8)
+    {
+        const unsigned n = __MIN(channels - chn, 8);
+        __m256 state[EQ_COUNT][4];
+
+        for (unsigned eq = 0; eq < EQ_COUNT; eq++)
+            for (unsigned k = 0; k < 4; k++)
+                state[eq][k] = _mm256_loadu_ps(&p_sys->state[eq][k][chn]);
+
+        for (unsigned i = 0; i < samples; i++)
+        {
+            float *frame = &buf[i * channels + chn];
+            __m256 x = likely(n == 8) ? _mm256_loadu_ps(frame)
+                                      : LoadPartialAVX(frame, n);
+
+            for (unsigned eq = 0; eq < EQ_COUNT; eq++)
+            {
+                __m256 y = _mm256_add_ps(_mm256_mul_ps(x, coeffs[eq][0]),
+                                         _mm256_mul_ps(state[eq][0], coeffs[eq][1]));
+                y = _mm256_add_ps(y, _mm256_mul_ps(state[eq][1], coeffs[eq][2]));
+                y = _mm256_sub_ps(y, _mm256_mul_ps(state[eq][2], coeffs[eq][3]));
+                y = _mm256_sub_ps(y, _mm256_mul_ps(state[eq][3], coeffs[eq][4]));
+                state[eq][1] = state[eq][0];
+                state[eq][0] = x;
+                state[eq][3] = state[eq][2];
+                state[eq][2] = y;
+                x = y;
+            }
+
+            if (likely(n == 8))
+                _mm256_storeu_ps(frame, x);
+            else
+                StorePartialAVX(frame, x, n);
+        }
+
+        for (unsigned eq = 0; eq < EQ_COUNT; eq++)
+            for (unsigned k = 0; k < 4; k++)
+                _mm256_storeu_ps(&p_sys->state[eq][k][chn], state[eq][k]);
+    }
+}
+#endif
+
+#ifdef FRAMES_NEON
+static void ProcessEQ_NEON( filter_sys_t *p_sys, float *buf,
+                            unsigned channels, unsigned samples )
+{
+    float32x4_t coeffs[EQ_COUNT][5];
+
+    for (unsigned eq = 0; eq < EQ_COUNT; eq++)
+        for (unsigned k = 0; k < 5; k++)
+            coeffs[eq][k] = vdupq_n_f32(p_sys->coeffs[eq * 5 + k]);
+
+    for (unsigned chn = 0; chn < channels; chn += 4)
+    {
+        const unsigned n = __MIN(channels - chn, 4);
+        float32x4_t state[EQ_COUNT][4];
+
+        for (unsigned eq = 0; eq < EQ_COUNT; eq++)
+            for (unsigned k = 0; k < 4; k++)
+                state[eq][k] = vld1q_f32(&p_sys->state[eq][k][chn]);
+
+        for (unsigned i = 0; i < samples; i++)
+        {
+            float *frame = &buf[i * channels + chn];
+            float32x4_t x = likely(n == 4) ? vld1q_f32(frame)
+                                           : LoadPartialNEON(frame, n);
+
+            for (unsigned eq = 0; eq < EQ_COUNT; eq++)
+            {
+                float32x4_t y = vmulq_f32(x, coeffs[eq][0]);
+                y = vmlaq_f32(y, state[eq][0], coeffs[eq][1]);
+                y = vmlaq_f32(y, state[eq][1], coeffs[eq][2]);
+                y = vmlsq_f32(y, state[eq][2], coeffs[eq][3]);
+                y = vmlsq_f32(y, state[eq][3], coeffs[eq][4]);
+                state[eq][1] = state[eq][0];
+                state[eq][0] = x;
+                state[eq][3] = state[eq][2];
+                state[eq][2] = y;
+                x = y;
+            }
+
+            if (likely(n == 4))
+                vst1q_f32(frame, x);
+            else
+                StorePartialNEON(frame, x, n);
+        }
+
+        for (unsigned eq = 0; eq < EQ_COUNT; eq++)
+            for (unsigned k = 0; k < 4; k++)
+                vst1q_f32(&p_sys->state[eq][k][chn], state[eq][k]);
+    }
+}
+#endif
@@ -31,12 +31,23 @@
 #include <vlc_plugin.h>
 #include <vlc_aout.h>
 #include <vlc_atomic.h>
+#include <vlc_cpu.h>
 #include <vlc_filter.h>
 #include <vlc_modules.h>
 
+#include <math.h>
 #include <string.h> /* for memset */
 #include <limits.h> /* form INT_MIN */
 
+#if defined(__GNUC__) && (defined(__i386__) || defined(__x86_64__))
+# define SCALETEMPO_X86
+# include <immintrin.h>
+#endif
+#if defined(__ARM_NEON)
+# define SCALETEMPO_NEON
+# include <arm_neon.h>
+#endif
+
 /*****************************************************************************
  * Module descriptor
  *****************************************************************************/
@@ -55,6 +66,18 @@ static block_t *DoPitchWork( filter_t *, block_t * );
 # define MODULES_SHORTNAME N_("Scaletempo")
 #endif
 
+enum
+{
+    CORRELATION_AUTO,
+    CORRELATION_DIRECT,
+    CORRELATION_FFT,
+};
+
+static const int pi_correlation_values[] = {
+    CORRELATION_AUTO, CORRELATION_DIRECT, CORRELATION_FFT };
+static const char *const ppsz_correlation_descriptions[] = {
+    N_("Automatic"), N_("Direct"), N_("FFT") };
+
 vlc_module_begin ()
     set_description( MODULE_DESC )
     set_shortname( MODULES_SHORTNAME )
@@ -68,6 +91,11 @@ vlc_module_begin ()
         N_("Overlap Length"), N_("Percentage of stride to overlap"), true )
     add_integer_with_range( "scaletempo-search", 14, 0, 200,
         N_("Search Length"), N_("Length in milliseconds to search for best overlap position"), true )
+    add_integer( "scaletempo-correlation", CORRELATION_AUTO,
+        N_("Correlation method"),
+        N_("Method used to search for the best overlap position. The FFT is "
+           "faster for long overlaps and searches."), true )
+        change_integer_list( pi_correlation_values, ppsz_correlation_descriptions )
 #ifdef PITCH_SHIFTER
     add_float_with_range( "pitch-shift", 0, -12, 12,
         N_("Pitch Shift"), N_("Pitch shift in semitones."), false )
@@ -102,6 +130,7 @@ typedef struct
     unsigned  ms_stride;
     double    percent_overlap;
     unsigned  ms_search;
+    int       correlation;
     /* audio format */
     unsigned  samples_per_frame;  /* AKA number of channels */
     unsigned  bytes_per_sample;
@@ -129,6 +158,14 @@ typedef struct
     void     *buf_pre_corr;
     void     *table_window;
     unsigned(*best_overlap_offset)( filter_t *p_filter );
+    float   (*dot_product)( const float *, const float *, unsigned );
+    /* FFT cross correlation */
+    void    (*butterflies)( float *, float *, float *, float *,
+                            const float *, const float *, unsigned );
+    unsigned  fft_size;
+    unsigned *fft_reverse;
+    float    *fft_twiddle;
+    float    *fft_buf;
 #ifdef PITCH_SHIFTER
     /* pitch */
     filter_t * resampler;
@@ -136,16 +173,179 @@ typedef struct
 #endif
 } filter_sys_t;
 
+/*****************************************************************************
+ * dot_product: correlation of the pre-correlation buffer at one offset
+ * butterflies: one group of radix-2 butterflies of the FFT, n is a multiple
+ *              of 4
+ *****************************************************************************/
+static float dot_product_c( const float *a, const float *b, unsigned n )
+{
+    float corr = 0;
+    for( unsigned i = 0; i < n; i++ )
+        corr += a[i] * b[i];
+    return corr;
+}
+
+static void butterflies_c( float *restrict ar, float *restrict ai,
+                           float *restrict br, float *restrict bi,
+                           const float *wr, const float *wi, unsigned n )
+{
+    for( unsigned j = 0; j < n; j++ )
+    {
+        float tr = br[j] * wr[j] - bi[j] * wi[j];
+        float ti = br[j] * wi[j] + bi[j] * wr[j];
+        br[j] = ar[j] - tr;
+        bi[j] = ai[j] - ti;
+        ar[j] += tr;
+        ai[j] += ti;
+    }
+}
+
+#ifdef SCALETEMPO_X86
+VLC_SSE2
+static float dot_product_sse2( const float *a, const float *b, unsigned n )
+{
+    __m128 sum0 = _mm_setzero_ps(), sum1 = _mm_setzero_ps();
+    unsigned i = 0;
+
+    for( ; i + 8 <= n; i += 8 )
+    {
+        sum0 = _mm_add_ps( sum0, _mm_mul_ps( _mm_loadu_ps( a + i ),
+                                             _mm_loadu_ps( b + i ) ) );
+        sum1 = _mm_add_ps( sum1, _mm_mul_ps( _mm_loadu_ps( a + i + 4 ),
+                                             _mm_loadu_ps( b + i + 4 ) ) );
+    }
+    sum0 = _mm_add_ps( sum0, sum1 );
+    sum0 = _mm_add_ps( sum0, _mm_movehl_ps( sum0, sum0 ) );
+    sum0 = _mm_add_ss( sum0, _mm_shuffle_ps( sum0, sum0, 1 ) );
+
+    float corr = _mm_cvtss_f32( sum0 );
+    for( ; i < n; i++ )
+        corr += a[i] * b[i];
+    return corr;
+}
+
+VLC_SSE2
+static void butterflies_sse2( float *restrict ar, float *restrict ai,
+                              float *restrict br, float *restrict bi,
+                              const float *wr, const float *wi, unsigned n )
+{
+    for( unsigned j = 0; j < n; j += 4 )
+    {
+        __m128 xr = _mm_loadu_ps( br + j ), xi = _mm_loadu_ps( bi + j );
+        __m128 yr = _mm_loadu_ps( wr + j ), yi = _mm_loadu_ps( wi + j );
+        __m128 tr = _mm_sub_ps( _mm_mul_ps( xr, yr ), _mm_mul_ps( xi, yi ) );
+        __m128 ti = _mm_add_ps( _mm_mul_ps( xr, yi ), _mm_mul_ps( xi, yr ) );
+        __m128 zr = _mm_loadu_ps( ar + j ), zi = _mm_loadu_ps( ai + j );
+
+        _mm_storeu_ps( br + j, _mm_sub_ps( zr, tr ) );
+        _mm_storeu_ps( bi + j, _mm_sub_ps( zi, ti ) );
+        _mm_storeu_ps( ar + j, _mm_add_ps( zr, tr ) );
+        _mm_storeu_ps( ai + j, _mm_add_ps( zi, ti ) );
+    }
+}
+
+VLC_AVX2
+static float dot_product_avx2( const float *a, const float *b, unsigned n )
+{
+    __m256 sum0 = _mm256_setzero_ps(), sum1 = _mm256_setzero_ps();
+    unsigned i = 0;
+
+    for( ; i + 16 <= n; i += 16 )
+    {
+        sum0 = _mm256_add_ps( sum0, _mm256_mul_ps( _mm256_loadu_ps( a + i ),
+                                                   _mm256_loadu_ps( b + i ) ) );
+        sum1 = _mm256_add_ps( sum1, _mm256_mul_ps( _mm256_loadu_ps( a + i + 8 ),
+                                                   _mm256_loadu_ps( b + i + 8 ) ) );
+    }
+    sum0 = _mm256_add_ps( sum0, sum1 );
+
+    __m128 sum = _mm_add_ps( _mm256_castps256_ps128( sum0 ),
+                             _mm256_extractf128_ps( sum0, 1 ) );
+    sum = _mm_add_ps( sum, _mm_movehl_ps( sum, sum ) );
+    sum = _mm_add_ss( sum, _mm_shuffle_ps( sum, sum, 1 ) );
+
+    float corr = _mm_cvtss_f32( sum );
+    for( ; i < n; i++ )
+        corr += a[i] * b[i];
+    return corr;
+}
+
+VLC_AVX2
+static void butterflies_avx2( float *restrict ar, float *restrict ai,
+                              float *restrict br, float *restrict bi,
+                              const float *wr, const float *wi, unsigned n )
+{
+    if( n < 8 )
+    {
+        butterflies_sse2( ar, ai, br, bi, wr, wi, n );
+        return;
+    }
+    for( unsigned j = 0; j < n; j += 8 )
+    {
+        __m256 xr = _mm256_loadu_ps( br + j ), xi = _mm256_loadu_ps( bi + j );
+        __m256 yr = _mm256_loadu_ps( wr + j ), yi = _mm256_loadu_ps( wi + j );
+        __m256 tr = _mm256_sub_ps( _mm256_mul_ps( xr, yr ), _mm256_mul_ps( xi, yi ) );
+        __m256 ti = _mm256_add_ps( _mm256_mul_ps( xr, yi ), _mm256_mul_ps( xi, yr ) );
+        __m256 zr = _mm256_loadu_ps( ar + j ), zi = _mm256_loadu_ps( ai + j );
+
+        _mm256_storeu_ps( br + j, _mm256_sub_ps( zr, tr ) );
+        _mm256_storeu_ps( bi + j, _mm256_sub_ps( zi, ti ) );
+        _mm256_storeu_ps( ar + j, _mm256_add_ps( zr, tr ) );
+        _mm256_storeu_ps( ai + j, _mm256_add_ps( zi, ti ) );
+    }
+}
+#endif
+
+#ifdef SCALETEMPO_NEON
+static float dot_product_neon( const float *a, const float *b, unsigned n )
+{
+    float32x4_t sum0 = vdupq_n_f32( 0.f ), sum1 = vdupq_n_f32( 0.f );
+    unsigned i = 0;
+
+    for( ; i + 8 <= n; i += 8 )
+    {
+        sum0 = vmlaq_f32( sum0, vld1q_f32( a + i ), vld1q_f32( b + i ) );
+        sum1 = vmlaq_f32( sum1, vld1q_f32( a + i + 4 ), vld1q_f32( b + i + 4 ) );
+    }
+    sum0 = vaddq_f32( sum0, sum1 );
+
+    float32x2_t sum = vadd_f32( vget_low_f32( sum0 ), vget_high_f32( sum0 ) );
+    sum = vpadd_f32( sum, sum );
+
+    float corr = vget_lane_f32( sum, 0 );
+    for( ; i < n; i++ )
+        corr += a[i] * b[i];
+    return corr;
+}
+
+static void butterflies_neon( float *restrict ar, float *restrict ai,
+                              float *restrict br, float *restrict bi,
+                              const float *wr, const float *wi, unsigned n )
+{
+    for( unsigned j = 0; j < n; j += 4 )
+    {
+        float32x4_t xr = vld1q_f32( br + j ), xi = vld1q_f32( bi + j );
+        float32x4_t yr = vld1q_f32( wr + j ), yi = vld1q_f32( wi + j );
+        float32x4_t tr = vmlsq_f32( vmulq_f32( xr, yr ), xi, yi );
+        float32x4_t ti = vmlaq_f32( vmulq_f32( xr, yi ), xi, yr );
+        float32x4_t zr = vld1q_f32( ar + j ), zi = vld1q_f32( ai + j );
+
+        vst1q_f32( br + j, vsubq_f32( zr, tr ) );
+        vst1q_f32( bi + j, vsubq_f32( zi, ti ) );
+        vst1q_f32( ar + j, vaddq_f32( zr, tr ) );
+        vst1q_f32( ai + j, vaddq_f32( zi, ti ) );
+    }
+}
+#endif
+
 /*****************************************************************************
  * best_overlap_offset: calculate best offset for overlap
  *****************************************************************************/
-static unsigned best_overlap_offset_float( filter_t *p_filter )
+static void pre_correlate_float( filter_sys_t *p )
 {
-    filter_sys_t *p = p_filter->p_sys;
-    float *pw, *po, *ppc, *search_start;
-    float best_corr = INT_MIN;
-    unsigned best_off = 0;
-    unsigned i, off;
+    float *pw, *po, *ppc;
+    unsigned i;
 
     pw  = p->table_window;
     po  = p->buf_overlap;
@@ -154,15 +354,22 @@ static unsigned best_overlap_offset_float( filter_t *p_filter )
     for( i = p->samples_per_frame; i < p->samples_overlap; i++ ) {
       *ppc++ = *pw++ * *po++;
     }
+}
+
+static unsigned best_overlap_offset_float( filter_t *p_filter )
+{
+    filter_sys_t *p = p_filter->p_sys;
+    const unsigned samples_corr = p->samples_overlap - p->samples_per_frame;
+    float *search_start;
+    float best_corr = INT_MIN;
+    unsigned best_off = 0;
+    unsigned off;
+
+    pre_correlate_float( p );
 
     search_start = (float *)p->buf_queue + p->samples_per_frame;
     for( off = 0; off < p->frames_search; off++ ) {
-      float corr = 0;
-      float *ps = search_start;
-      ppc = p->buf_pre_corr;
-      for( i = p->samples_per_frame; i < p->samples_overlap; i++ ) {
-        corr += *ppc++ * *ps++;
-      }
+      float corr = p->dot_product( p->buf_pre_corr, search_start, samples_corr );
       if( corr > best_corr ) {
         best_corr = corr;
         best_off  = off;
@@ -173,6 +380,137 @@ static unsigned best_overlap_offset_float( filter_t *p_filter )
     return best_off * p->bytes_per_frame;
 }
 
+/*
+ * The FFT path computes all the correlations at once, as the real part of
+ * IFFT( X * conj( Y ) ), X being the transform of the search window and Y the
+ * one of the pre-correlation buffer. Both real signals are transformed
+ * together as the real and imaginary parts of a single complex one, and the
+ * inverse transform is the forward one of the conjugate. The transform size
+ * covers the whole window, so that the circular correlation never wraps.
+ * The correlations are computed at every sample and the ones falling on
+ * frame boundaries are kept: the channels are correlated together.
+ */
+/* Measured cost of a butterfly relative to a multiply-add of the direct
+ * search, both vectorized; the FFT is less cache friendly */
+#define FFT_COST 20.
+
+static void fft_float( const filter_sys_t *p, float *re, float *im )
+{
+    const unsigned size = p->fft_size;
+    const float *twiddle = p->fft_twiddle;
+
+    /* Radix-2 decimation in time, the input is in bit-reversed order. The
+     * first two stages have trivial twiddle factors and are merged. */
+    for( unsigned k = 0; k < size; k += 4 )
+    {
+        float *r = re + k, *i = im + k;
+        float ar = r[0] + r[1], ai = i[0] + i[1];
+        float br = r[0] - r[1], bi = i[0] - i[1];
+        float cr = r[2] + r[3], ci = i[2] + i[3];
+        float dr = r[2] - r[3], di = i[2] - i[3];
+
+        r[0] = ar + cr; i[0] = ai + ci;
+        r[2] = ar - cr; i[2] = ai - ci;
+        r[1] = br + di; i[1] = bi - dr;
+        r[3] = br - di; i[3] = bi + dr;
+    }
+
+    /* The twiddle factors of each stage are contiguous */
+    for( unsigned half = 4; half < size; half <<= 1 )
+    {
+        const float *wr = twiddle + half - 1;
+        const float *wi = wr + size - 1;
+
+        for( unsigned k = 0; k < size; k += 2 * half )
+            p->butterflies( re + k, im + k, re + k + half, im + k + half,
+                            wr, wi, half );
+    }
+}
+
+static unsigned best_overlap_offset_fft_float( filter_t *p_filter )
+{
+    filter_sys_t *p = p_filter->p_sys;
+    const unsigned size = p->fft_size;
+    const unsigned samples_corr = p->samples_overlap - p->samples_per_frame;
+    const unsigned samples_search = ( p->frames_search - 1 ) * p->samples_per_frame
+                                  + samples_corr;
+    const float *search_start = (float *)p->buf_queue + p->samples_per_frame;
+    const float *ppc = p->buf_pre_corr;
+    const unsigned *rev = p->fft_reverse;
+    float *zr = p->fft_buf, *zi = zr + size;
+    float *cr = zi + size, *ci = cr + size;
+
+    pre_correlate_float( p );
+
+    for( unsigned i = 0; i < size; i++ )
+    {
+        zr[rev[i]] = i < samples_search ? search_start[i] : 0.f;
+        zi[rev[i]] = i < samples_corr ? ppc[i] : 0.f;
+    }
+    fft_float( p, zr, zi );
+
+    /* Separate X and Y, and store the conjugate of X * conj( Y ) bit-reversed.
+     * The constant scale factors are left out, they do not move the peak. */
+    for( unsigned k = 0; k < size; k++ )
+    {
+        unsigned m = ( size - k ) & ( size - 1 );
+        float xr = zr[k] + zr[m], xi = zi[k] - zi[m];
+        float yr = zi[k] + zi[m], yi = zr[m] - zr[k];
+
+        cr[rev[k]] = xr * yr + xi * yi;
+        ci[rev[k]] = xr * yi - xi * yr;
+    }
+    fft_float( p, cr, ci );
+
+    float best_corr = -INFINITY;
+    unsigned best_off = 0;
+    for( unsigned off = 0; off < p->frames_search; off++ ) {
+      float corr = cr[off * p->samples_per_frame];
+      if( corr > best_corr ) {
+        best_corr = corr;
+        best_off  = off;
+      }
+    }
+
+    return best_off * p->bytes_per_frame;
+}
+
+static int init_fft( filter_t *p_filter, unsigned samples_search )
+{
+    filter_sys_t *p = p_filter->p_sys;
+    unsigned size = 4, bits = 2;
+
+    while( size < samples_search ) {
+        size <<= 1;
+        bits++;
+    }
+
+    p->fft_size    = size;
+    p->fft_reverse = vlc_alloc( size, sizeof (*p->fft_reverse) );
+    p->fft_twiddle = vlc_alloc( 2 * size, sizeof (float) );
+    p->fft_buf     = vlc_alloc( 4 * size, sizeof (float) );
+    if( !p->fft_reverse || !p->fft_twiddle || !p->fft_buf )
+        return VLC_ENOMEM;
+
+    for( unsigned i = 0; i < size; i++ )
+    {
+        unsigned r = 0;
+        for( unsigned b = 0; b < bits; b++ )
+            r |= ( ( i >> b ) & 1 ) << ( bits - 1 - b );
+        p->fft_reverse[i] = r;
+    }
+
+    /* exp( -i pi j / half ) for each stage */
+    float *wr = p->fft_twiddle, *wi = wr + size - 1;
+    for( unsigned half = 1; half < size; half <<= 1 )
+        for( unsigned j = 0; j < half; j++ )
+        {
+            *wr++ =  cos( M_PI * j / half );
+            *wi++ = -sin( M_PI * j / half );
+        }
+    return VLC_SUCCESS;
+}
+
 /*****************************************************************************
  * output_overlap: blend end of previous stride with beginning of current stride
  *****************************************************************************/
@@ -361,6 +699,25 @@ static int reinit_buffers( filter_t *p_filter )
                 *pw++ = v;
         }
         p->best_overlap_offset = best_overlap_offset_float;
+
+        unsigned samples_corr   = p->samples_overlap - p->samples_per_frame;
+        unsigned samples_search = ( p->frames_search - 1 ) * p->samples_per_frame
+                                + samples_corr;
+        bool use_fft = p->correlation == CORRELATION_FFT;
+        if( p->correlation == CORRELATION_AUTO )
+        {
+            /* Rough costs of both methods */
+            double direct = (double)p->frames_search * samples_corr;
+            double fft = ldexp( 1., ceil( log2( samples_search ) ) );
+            fft *= FFT_COST * log2( fft );
+            use_fft = fft < direct;
+        }
+        if( use_fft )
+        {
+            if( init_fft( p_filter, samples_search ) )
+                return VLC_ENOMEM;
+            p->best_overlap_offset = best_overlap_offset_fft_float;
+        }
     }
 
     unsigned new_size = ( p->frames_search + frames_stride + frames_overlap ) * p->bytes_per_frame;
@@ -390,7 +747,7 @@ static int reinit_buffers( filter_t *p_filter )
     p->frames_stride_scaled = p->bytes_stride_scaled / p->bytes_per_frame;
 
     msg_Dbg( VLC_OBJECT(p_filter),
-             "%.3f scale, %.3f stride_in, %i stride_out, %i standing, %i overlap, %i search, %i queue, %s mode",
+             "%.3f scale, %.3f stride_in, %i stride_out, %i standing, %i overlap, %i search, %i queue, %s mode, %s correlation",
              p->scale,
              p->frames_stride_scaled,
              (int)( p->bytes_stride / p->bytes_per_frame ),
@@ -398,7 +755,8 @@ static int reinit_buffers( filter_t *p_filter )
              (int)( p->bytes_overlap / p->bytes_per_frame ),
              p->frames_search,
              (int)( p->bytes_queue_max / p->bytes_per_frame ),
-             "fl32");
+             "fl32",
+             p->best_overlap_offset == best_overlap_offset_fft_float ? "fft" : "direct");
 
     return VLC_SUCCESS;
 }
@@ -430,6 +788,7 @@ static int Open( vlc_object_t *p_this )
     p_sys->ms_stride       = var_InheritInteger( p_this, "scaletempo-stride" );
     p_sys->percent_overlap = var_InheritFloat( p_this, "scaletempo-overlap" );
     p_sys->ms_search       = var_InheritInteger( p_this, "scaletempo-search" );
+    p_sys->correlation     = var_InheritInteger( p_this, "scaletempo-correlation" );
 
     msg_Dbg( p_this, "params: %i stride, %.3f overlap, %i search",
              p_sys->ms_stride, p_sys->percent_overlap, p_sys->ms_search );
@@ -439,11 +798,36 @@ static int Open( vlc_object_t *p_this )
     p_sys->table_blend    = NULL;
     p_sys->buf_pre_corr   = NULL;
     p_sys->table_window   = NULL;
+    p_sys->fft_reverse    = NULL;
+    p_sys->fft_twiddle    = NULL;
+    p_sys->fft_buf        = NULL;
     p_sys->bytes_overlap  = 0;
     p_sys->bytes_queued   = 0;
     p_sys->bytes_to_slide = 0;
     p_sys->frames_stride_error = 0;
 
+    p_sys->dot_product = dot_product_c;
+    p_sys->butterflies = butterflies_c;
+#ifdef SCALETEMPO_X86
+    if( vlc_CPU_AVX2() )
+    {
+        p_sys->dot_product = dot_product_avx2;
+        p_sys->butterflies = butterflies_avx2;
+    }
+    else if( vlc_CPU_SSE2() )
+    {
+        p_sys->dot_product = dot_product_sse2;
+        p_sys->butterflies = butterflies_sse2;
+    }
+#endif
+#ifdef SCALETEMPO_NEON
+    if( vlc_CPU_ARM_NEON() )
+    {
+        p_sys->dot_product = dot_product_neon;
+        p_sys->butterflies = butterflies_neon;
+    }
+#endif
+
     if( reinit_buffers( p_filter ) != VLC_SUCCESS )
     {
         Close( p_this );
@@ -536,6 +920,9 @@ static void Close( vlc_object_t *p_this )
     free( p_sys->table_blend );
     free( p_sys->buf_pre_corr );
     free( p_sys->table_window );
+    free( p_sys->fft_reverse );
+    free( p_sys->fft_twiddle );
+    free( p_sys->fft_buf );
     free( p_sys );
 }
 
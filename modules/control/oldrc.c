@@ -1722,6 +1722,8 @@ static int updateStatistics( intf_thread_t *p_intf, input_item_t *p_item )
             (float)(p_item->p_stats->i_read_bytes)/1024 );
     msg_rc(_("| input bitrate    :   %6.0f kb/s"),
             (float)(p_item->p_stats->f_input_bitrate)*8000 );
+    msg_rc(_("| input lost       :    %5"PRIi64),
+            p_item->p_stats->i_lost_packets );
     msg_rc(_("| demux bytes read : %8.0f KiB"),
             (float)(p_item->p_stats->i_demux_read_bytes)/1024 );
     msg_rc(_("| demux bitrate    :   %6.0f kb/s"),
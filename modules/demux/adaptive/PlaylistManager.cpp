@@ -117,7 +117,8 @@ bool PlaylistManager::setupPeriod()
         BaseAdaptationSet *set = *it;
         if(set && streamFactory)
         {
-            SegmentTracker *tracker = new (std::nothrow) SegmentTracker(logic, set);
+            SegmentTracker *tracker = new (std::nothrow) SegmentTracker(logic, set,
+                                        var_InheritInteger(p_demux, "adaptive-prefetch"));
             if(!tracker)
                 continue;
 
@@ -156,7 +157,8 @@ bool PlaylistManager::start()
 {
     if(!conManager &&
        !(conManager =
-         new (std::nothrow) HTTPConnectionManager(VLC_OBJECT(p_demux->s), authStorage))
+         new (std::nothrow) HTTPConnectionManager(VLC_OBJECT(p_demux->s), authStorage,
+                                                  var_InheritInteger(p_demux, "adaptive-prefetch")))
       )
         return false;
 
@@ -76,8 +76,10 @@ SegmentTrackerEvent::SegmentTrackerEvent(const ID &id, vlc_tick_t duration)
     u.segment.id = &id;
 }
 
-SegmentTracker::SegmentTracker(AbstractAdaptationLogic *logic_, BaseAdaptationSet *adaptSet)
+SegmentTracker::SegmentTracker(AbstractAdaptationLogic *logic_, BaseAdaptationSet *adaptSet,
+                               unsigned prefetchCount_)
 {
+    prefetchCount = prefetchCount_;
     first = true;
     curNumber = next = 0;
     initializing = true;
@@ -127,6 +129,7 @@ bool SegmentTracker::segmentsListReady() const
 
 void SegmentTracker::reset()
 {
+    dropPrefetched();
     notify(SegmentTrackerEvent(curRepresentation, NULL));
     curRepresentation = NULL;
     init_sent = false;
@@ -165,6 +168,7 @@ SegmentChunk * SegmentTracker::getNextChunk(bool switch_allowed,
 
     if(rep != curRepresentation)
     {
+        dropPrefetched();
         notify(SegmentTrackerEvent(curRepresentation, rep));
         prevRep = curRepresentation;
         curRepresentation = rep;
@@ -246,7 +250,9 @@ SegmentChunk * SegmentTracker::getNextChunk(bool switch_allowed,
         initializing = false;
     }
 
-    SegmentChunk *chunk = segment->toChunk(next, rep, connManager);
+    SegmentChunk *chunk = getPrefetchedChunk(next, rep);
+    if(!chunk)
+        chunk = segment->toChunk(next, rep, connManager);
 
     /* Notify new segment length for stats / logic */
     if(chunk)
@@ -273,11 +279,61 @@ SegmentChunk * SegmentTracker::getNextChunk(bool switch_allowed,
     {
         curNumber = next;
         next++;
+        prefetch(rep, connManager);
     }
 
     return chunk;
 }
 
+SegmentChunk * SegmentTracker::getPrefetchedChunk(uint64_t number, BaseRepresentation *rep)
+{
+    if(prefetched.empty())
+        return NULL;
+
+    const Prefetched &front = prefetched.front();
+    if(front.number != number || front.rep != rep)
+    {
+        /* out of sequence (gap, update, or prefetch failure) */
+        dropPrefetched();
+        return NULL;
+    }
+
+    SegmentChunk *chunk = front.chunk;
+    prefetched.pop_front();
+    return chunk;
+}
+
+void SegmentTracker::prefetch(BaseRepresentation *rep, AbstractConnectionManager *connManager)
+{
+    /* Keep the next segments downloading in parallel,
+     * the chunks are handed over in order by getNextChunk() */
+    uint64_t number = prefetched.empty() ? next : prefetched.back().number + 1;
+    while(prefetched.size() < prefetchCount)
+    {
+        bool b_gap;
+        ISegment *segment = rep->getNextSegment(BaseRepresentation::INFOTYPE_MEDIA,
+                                                number, &number, &b_gap);
+        if(!segment)
+            break;
+
+        SegmentChunk *chunk = segment->toChunk(number, rep, connManager, true);
+        if(!chunk)
+            break;
+
+        Prefetched p = { number, rep, chunk };
+        prefetched.push_back(p);
+        number++;
+    }
+}
+
+void SegmentTracker::dropPrefetched()
+{
+    std::list<Prefetched>::const_iterator it;
+    for(it = prefetched.begin(); it != prefetched.end(); ++it)
+        delete (*it).chunk;
+    prefetched.clear();
+}
+
 bool SegmentTracker::setPositionByTime(vlc_tick_t time, bool restarted, bool tryonly)
 {
     uint64_t segnumber;
@@ -297,6 +353,7 @@ bool SegmentTracker::setPositionByTime(vlc_tick_t time, bool restarted, bool try
 
 void SegmentTracker::setPositionByNumber(uint64_t segnumber, bool restarted)
 {
+    dropPrefetched();
     if(restarted)
     {
         initializing = true;
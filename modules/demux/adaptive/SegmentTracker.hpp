@@ -112,7 +112,7 @@ namespace adaptive
     class SegmentTracker
     {
         public:
-            SegmentTracker(AbstractAdaptationLogic *, BaseAdaptationSet *);
+            SegmentTracker(AbstractAdaptationLogic *, BaseAdaptationSet *, unsigned = 0);
             ~SegmentTracker();
 
             StreamFormat getCurrentFormat() const;
@@ -131,6 +131,9 @@ namespace adaptive
         private:
             void setAdaptationLogic(AbstractAdaptationLogic *);
             void notify(const SegmentTrackerEvent &) const;
+            SegmentChunk * getPrefetchedChunk(uint64_t, BaseRepresentation *);
+            void prefetch(BaseRepresentation *, AbstractConnectionManager *);
+            void dropPrefetched();
             bool first;
             bool initializing;
             bool index_sent;
@@ -142,6 +145,14 @@ namespace adaptive
             BaseAdaptationSet *adaptationSet;
             BaseRepresentation *curRepresentation;
             std::list<SegmentTrackerListenerInterface *> listeners;
+            struct Prefetched
+            {
+                uint64_t number;
+                BaseRepresentation *rep;
+                SegmentChunk *chunk;
+            };
+            std::list<Prefetched> prefetched; /* next media segments, in order */
+            unsigned prefetchCount;
     };
 }
 
@@ -76,6 +76,10 @@ static void Close   (vlc_object_t *);
 #define ADAPT_ACCESS_TEXT N_("Use regular HTTP modules")
 #define ADAPT_ACCESS_LONGTEXT N_("Connect using HTTP access instead of custom HTTP code")
 
+#define ADAPT_PREFETCH_TEXT N_("Segments to prefetch")
+#define ADAPT_PREFETCH_LONGTEXT N_("Number of upcoming segments of each stream " \
+                                   "to download in parallel with the current one")
+
 static const AbstractAdaptationLogic::LogicType pi_logics[] = {
                                 AbstractAdaptationLogic::Default,
                                 AbstractAdaptationLogic::Predictive,
@@ -122,6 +126,8 @@ vlc_module_begin ()
                      ADAPT_HEIGHT_TEXT, ADAPT_HEIGHT_TEXT, false )
         add_integer( "adaptive-bw",     250, ADAPT_BW_TEXT,     ADAPT_BW_LONGTEXT,     false )
         add_bool   ( "adaptive-use-access", false, ADAPT_ACCESS_TEXT, ADAPT_ACCESS_LONGTEXT, true );
+        add_integer( "adaptive-prefetch", 0, ADAPT_PREFETCH_TEXT, ADAPT_PREFETCH_LONGTEXT, true )
+            change_integer_range( 0, 8 )
         set_callbacks( Open, Close )
 vlc_module_end ()
 
@@ -303,6 +303,8 @@ HTTPChunkBufferedSource::HTTPChunkBufferedSource(const std::string& url, Abstrac
     done = false;
     eof = false;
     held = false;
+    prefetch = false;
+    requested = false;
     downloadstart = 0;
 }
 
@@ -316,6 +318,10 @@ HTTPChunkBufferedSource::~HTTPChunkBufferedSource()
     if(held) /* wait release if not in queue but currently downloaded */
         vlc_cond_wait(&avail, &lock);
 
+    if(downloadstart) /* interrupted transfer */
+        connManager->endTransfer(downloadstart);
+    downloadstart = 0;
+
     if(p_head)
     {
         block_ChainRelease(p_head);
@@ -388,7 +394,7 @@ void HTTPChunkBufferedSource::bufferize(size_t readsize)
         vlc_mutex_locker locker( &lock );
         done = true;
         rate.size = buffered + consumed;
-        rate.time = vlc_tick_now() - downloadstart;
+        rate.time = connManager->endTransfer(downloadstart);
         downloadstart = 0;
     }
     else
@@ -401,7 +407,7 @@ void HTTPChunkBufferedSource::bufferize(size_t readsize)
         {
             done = true;
             rate.size = buffered + consumed;
-            rate.time = vlc_tick_now() - downloadstart;
+            rate.time = connManager->endTransfer(downloadstart);
             downloadstart = 0;
         }
     }
@@ -418,8 +424,13 @@ bool HTTPChunkBufferedSource::prepare()
 {
     if(!prepared)
     {
-        downloadstart = vlc_tick_now();
-        return HTTPChunkSource::prepare();
+        downloadstart = connManager->beginTransfer();
+        if(!HTTPChunkSource::prepare())
+        {
+            connManager->endTransfer(downloadstart);
+            downloadstart = 0;
+            return false;
+        }
     }
     return true;
 }
@@ -430,10 +441,22 @@ bool HTTPChunkBufferedSource::hasMoreData() const
     return !eof;
 }
 
+void HTTPChunkBufferedSource::request()
+{
+    /* first read: if prefetched, it now has to come before the others */
+    if(!requested)
+    {
+        requested = true;
+        connManager->promote(this);
+    }
+}
+
 block_t * HTTPChunkBufferedSource::readBlock()
 {
     block_t *p_block = NULL;
 
+    request();
+
     vlc_mutex_locker locker(&lock);
 
     while(!p_head && !done)
@@ -466,6 +489,8 @@ block_t * HTTPChunkBufferedSource::readBlock()
 
 block_t * HTTPChunkBufferedSource::read(size_t readsize)
 {
+    request();
+
     vlc_mutex_locker locker(&lock);
 
     while(readsize > buffered && !done)
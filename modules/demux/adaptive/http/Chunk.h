@@ -133,6 +133,7 @@ namespace adaptive
                 virtual bool       prepare(); /* reimpl */
                 void               bufferize(size_t);
                 bool               isDone() const;
+                void               request();
 
             private:
                 block_t            *p_head; /* read cache buffer */
@@ -140,9 +141,11 @@ namespace adaptive
                 size_t              buffered; /* read cache size */
                 bool                done;
                 bool                eof;
-                vlc_tick_t          downloadstart;
+                vlc_tick_t          downloadstart; /* link time, see beginTransfer() */
                 vlc_cond_t          avail;
                 bool                held;
+                bool                prefetch; /* Downloader lock */
+                bool                requested; /* reader only */
         };
 
         class HTTPChunk : public AbstractChunk
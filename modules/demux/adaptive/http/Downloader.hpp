@@ -24,6 +24,7 @@
 
 #include <vlc_common.h>
 #include <list>
+#include <vector>
 
 namespace adaptive
 {
@@ -34,22 +35,27 @@ namespace adaptive
         class Downloader
         {
             public:
-                Downloader();
+                Downloader(unsigned = 1);
                 ~Downloader();
                 bool start();
-                void schedule(HTTPChunkBufferedSource *);
+                void schedule(HTTPChunkBufferedSource *, bool = false);
+                void promote(HTTPChunkBufferedSource *);
                 void cancel(HTTPChunkBufferedSource *);
 
             private:
                 static void * downloaderThread(void *);
                 void Run();
                 void DownloadSource(HTTPChunkBufferedSource *);
-                vlc_thread_t thread_handle;
+                HTTPChunkBufferedSource * getNextSource() const;
+                bool isBusy(const HTTPChunkBufferedSource *) const;
+                std::vector<vlc_thread_t> threads;
+                unsigned     threads_count;
                 vlc_mutex_t  lock;
                 vlc_cond_t   waitcond;
-                bool         thread_handle_valid;
+                vlc_cond_t   updatedcond;
                 bool         killed;
                 std::list<HTTPChunkBufferedSource *> chunks;
+                std::list<HTTPChunkBufferedSource *> busy; /* being read by a thread */
         };
 
     }
@@ -33,6 +33,8 @@
 #include <vlc_url.h>
 #include <vlc_http.h>
 
+#include <cassert>
+
 using namespace adaptive::http;
 
 AbstractConnectionManager::AbstractConnectionManager(vlc_object_t *p_object_)
@@ -40,17 +42,58 @@ AbstractConnectionManager::AbstractConnectionManager(vlc_object_t *p_object_)
 {
     p_object = p_object_;
     rateObserver = NULL;
+    vlc_mutex_init(&ratelock);
+    transfers = 0;
+    linktime = VLC_TICK_0;
+    linkdate = VLC_TICK_INVALID;
 }
 
 AbstractConnectionManager::~AbstractConnectionManager()
 {
-
+    vlc_mutex_destroy(&ratelock);
 }
 
 void AbstractConnectionManager::updateDownloadRate(const adaptive::ID &sourceid, size_t size, vlc_tick_t time)
 {
+    /* serialized, as the observers are fed from all downloading threads */
+    vlc_mutex_lock(&ratelock);
     if(rateObserver)
         rateObserver->updateDownloadRate(sourceid, size, time);
+    vlc_mutex_unlock(&ratelock);
+}
+
+/*
+ * Concurrent transfers are sharing the link: the time reported for each one
+ * is its share of the link, the wall time divided by the number of transfers
+ * running at the same time. The sum of the shares is the time the link was
+ * busy, and the observers still see the link throughput.
+ */
+void AbstractConnectionManager::updateLinkTime(vlc_tick_t now)
+{
+    if(transfers)
+        linktime += (now - linkdate) / transfers;
+    linkdate = now;
+}
+
+vlc_tick_t AbstractConnectionManager::beginTransfer()
+{
+    vlc_mutex_lock(&ratelock);
+    updateLinkTime(vlc_tick_now());
+    transfers++;
+    const vlc_tick_t start = linktime;
+    vlc_mutex_unlock(&ratelock);
+    return start;
+}
+
+vlc_tick_t AbstractConnectionManager::endTransfer(vlc_tick_t start)
+{
+    vlc_mutex_lock(&ratelock);
+    assert(transfers > 0);
+    updateLinkTime(vlc_tick_now());
+    transfers--;
+    const vlc_tick_t time = linktime - start;
+    vlc_mutex_unlock(&ratelock);
+    return time;
 }
 
 void AbstractConnectionManager::setDownloadRateObserver(IDownloadRateObserver *obs)
@@ -58,20 +101,23 @@ void AbstractConnectionManager::setDownloadRateObserver(IDownloadRateObserver *o
     rateObserver = obs;
 }
 
-HTTPConnectionManager::HTTPConnectionManager    (vlc_object_t *p_object_, AbstractConnectionFactory *factory_)
+HTTPConnectionManager::HTTPConnectionManager    (vlc_object_t *p_object_, AbstractConnectionFactory *factory_,
+                                                 unsigned prefetch)
     : AbstractConnectionManager( p_object_ )
 {
     vlc_mutex_init(&lock);
-    downloader = new (std::nothrow) Downloader();
+    /* one more connection per prefetched segment */
+    downloader = new (std::nothrow) Downloader(1 + prefetch);
     downloader->start();
     factory = factory_;
 }
 
-HTTPConnectionManager::HTTPConnectionManager    (vlc_object_t *p_object_, AuthStorage *storage)
+HTTPConnectionManager::HTTPConnectionManager    (vlc_object_t *p_object_, AuthStorage *storage,
+                                                 unsigned prefetch)
     : AbstractConnectionManager( p_object_ )
 {
     vlc_mutex_init(&lock);
-    downloader = new (std::nothrow) Downloader();
+    downloader = new (std::nothrow) Downloader(1 + prefetch);
     downloader->start();
     factory = new ConnectionFactory(storage);
 }
@@ -141,11 +187,18 @@ AbstractConnection * HTTPConnectionManager::getConnection(ConnectionParams &para
     return conn;
 }
 
-void HTTPConnectionManager::start(AbstractChunkSource *source)
+void HTTPConnectionManager::start(AbstractChunkSource *source, bool prefetch)
+{
+    HTTPChunkBufferedSource *src = dynamic_cast<HTTPChunkBufferedSource *>(source);
+    if(src)
+        downloader->schedule(src, prefetch);
+}
+
+void HTTPConnectionManager::promote(AbstractChunkSource *source)
 {
     HTTPChunkBufferedSource *src = dynamic_cast<HTTPChunkBufferedSource *>(source);
     if(src)
-        downloader->schedule(src);
+        downloader->promote(src);
 }
 
 void HTTPConnectionManager::cancel(AbstractChunkSource *source)
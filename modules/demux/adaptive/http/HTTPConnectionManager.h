@@ -50,30 +50,43 @@ namespace adaptive
                 ~AbstractConnectionManager();
                 virtual void    closeAllConnections () = 0;
                 virtual AbstractConnection * getConnection(ConnectionParams &) = 0;
-                virtual void start(AbstractChunkSource *) = 0;
+                virtual void start(AbstractChunkSource *, bool = false) = 0;
+                virtual void promote(AbstractChunkSource *) = 0;
                 virtual void cancel(AbstractChunkSource *) = 0;
 
                 virtual void updateDownloadRate(const ID &, size_t, vlc_tick_t); /* impl */
                 void setDownloadRateObserver(IDownloadRateObserver *);
 
+                /* Link time accounting for concurrent transfers */
+                vlc_tick_t beginTransfer();
+                vlc_tick_t endTransfer(vlc_tick_t);
+
             protected:
                 vlc_object_t                                       *p_object;
 
             private:
+                void updateLinkTime(vlc_tick_t);
                 IDownloadRateObserver                              *rateObserver;
+                vlc_mutex_t                                         ratelock;
+                unsigned                                            transfers;
+                vlc_tick_t                                          linktime;
+                vlc_tick_t                                          linkdate;
         };
 
         class HTTPConnectionManager : public AbstractConnectionManager
         {
             public:
-                HTTPConnectionManager           (vlc_object_t *p_object, AbstractConnectionFactory *);
-                HTTPConnectionManager           (vlc_object_t *p_object, AuthStorage *);
+                HTTPConnectionManager           (vlc_object_t *p_object, AbstractConnectionFactory *,
+                                                 unsigned = 0);
+                HTTPConnectionManager           (vlc_object_t *p_object, AuthStorage *,
+                                                 unsigned = 0);
                 virtual ~HTTPConnectionManager  ();
 
                 virtual void    closeAllConnections () /* impl */;
                 virtual AbstractConnection * getConnection(ConnectionParams &) /* impl */;
 
-                virtual void start(AbstractChunkSource *) /* impl */;
+                virtual void start(AbstractChunkSource *, bool = false) /* impl */;
+                virtual void promote(AbstractChunkSource *) /* impl */;
                 virtual void cancel(AbstractChunkSource *) /* impl */;
 
             private:
@@ -67,7 +67,8 @@ void ISegment::onChunkDownload(block_t **, SegmentChunk *, BaseRepresentation *)
 
 }
 
-SegmentChunk* ISegment::toChunk(size_t index, BaseRepresentation *rep, AbstractConnectionManager *connManager)
+SegmentChunk* ISegment::toChunk(size_t index, BaseRepresentation *rep, AbstractConnectionManager *connManager,
+                                bool prefetch)
 {
     const std::string url = getUrlSegment().toString(index, rep);
     HTTPChunkBufferedSource *source = new (std::nothrow) HTTPChunkBufferedSource(url, connManager,
@@ -80,7 +81,7 @@ SegmentChunk* ISegment::toChunk(size_t index, BaseRepresentation *rep, AbstractC
         SegmentChunk *chunk = new (std::nothrow) SegmentChunk(this, source, rep);
         if( chunk )
         {
-            connManager->start(source);
+            connManager->start(source, prefetch);
             return chunk;
         }
         else
@@ -44,6 +44,7 @@
 
 #include "libavi.h"
 #include "../rawdv.h"
+#include "../index_cache.h"
 #include "bitmapinfoheader.h"
 
 /*****************************************************************************
@@ -2568,6 +2569,94 @@ static void AVI_IndexLoad( demux_t *p_demux )
     }
 }
 
+/* Index cache payload: the number of tracks, then for each track the number
+ * of entries followed by (flags << 32 | id, pos, length) for each entry */
+static int AVI_IndexCacheLoad( demux_t *p_demux, demux_index_cache_t *p_cache )
+{
+    demux_sys_t *p_sys = p_demux->p_sys;
+    block_t *p_block = demux_IndexCacheLoad( p_cache );
+    uint64_t i_track, i_entries, i_value;
+
+    if( !p_block )
+        return VLC_EGENERIC;
+
+    if( !demux_IndexCacheGet( p_block, &i_track ) || i_track != p_sys->i_track )
+        goto error;
+
+    for( unsigned i = 0; i < p_sys->i_track; i++ )
+    {
+        avi_track_t *tk = p_sys->track[i];
+
+        if( !demux_IndexCacheGet( p_block, &i_entries ) ||
+            i_entries > p_block->i_buffer / 24 )
+            goto error;
+
+        for( uint64_t j = 0; j < i_entries; j++ )
+        {
+            avi_entry_t index;
+
+            if( !demux_IndexCacheGet( p_block, &i_value ) )
+                goto error;
+            index.i_id    = i_value & UINT32_MAX;
+            index.i_flags = i_value >> 32;
+            if( !demux_IndexCacheGet( p_block, &index.i_pos ) ||
+                !demux_IndexCacheGet( p_block, &i_value ) )
+                goto error;
+            index.i_length = i_value;
+            index.i_lengthtotal = i_value;
+            avi_index_Append( &tk->idx, &p_sys->i_movi_lastchunk_pos, &index );
+            if( !tk->idx.p_entry )
+                goto error;
+        }
+    }
+    block_Release( p_block );
+
+    for( unsigned i = 0; i < p_sys->i_track; i++ )
+        msg_Dbg( p_demux, "stream[%u] loaded %u index entries from cache",
+                 i, p_sys->track[i]->idx.i_size );
+    return VLC_SUCCESS;
+
+error:
+    block_Release( p_block );
+    for( unsigned i = 0; i < p_sys->i_track; i++ )
+    {
+        avi_index_Clean( &p_sys->track[i]->idx );
+        avi_index_Init( &p_sys->track[i]->idx );
+    }
+    return VLC_EGENERIC;
+}
+
+static void AVI_IndexCacheStore( demux_t *p_demux, demux_index_cache_t *p_cache )
+{
+    demux_sys_t *p_sys = p_demux->p_sys;
+    struct vlc_memstream ms;
+
+    if( vlc_memstream_open( &ms ) )
+        return;
+
+    demux_IndexCachePut( &ms, p_sys->i_track );
+    for( unsigned i = 0; i < p_sys->i_track; i++ )
+    {
+        const avi_index_t *p_index = &p_sys->track[i]->idx;
+
+        demux_IndexCachePut( &ms, p_index->i_size );
+        for( unsigned j = 0; j < p_index->i_size; j++ )
+        {
+            const avi_entry_t *p_entry = &p_index->p_entry[j];
+
+            demux_IndexCachePut( &ms, ((uint64_t)p_entry->i_flags << 32) |
+                                      p_entry->i_id );
+            demux_IndexCachePut( &ms, p_entry->i_pos );
+            demux_IndexCachePut( &ms, p_entry->i_length );
+        }
+    }
+
+    if( vlc_memstream_close( &ms ) )
+        return;
+    demux_IndexCacheStore( p_cache, ms.ptr, ms.length );
+    free( ms.ptr );
+}
+
 static void AVI_IndexCreate( demux_t *p_demux )
 {
     demux_sys_t *p_sys = p_demux->p_sys;
@@ -2580,6 +2669,8 @@ static void AVI_IndexCreate( demux_t *p_demux )
 
     vlc_tick_t i_dialog_update;
     vlc_dialog_id *p_dialog_id = NULL;
+    demux_index_cache_t *p_cache;
+    bool b_cancelled = false;
 
     p_riff = AVI_ChunkFind( &p_sys->ck_root, AVIFOURCC_RIFF, 0, true );
     p_movi = AVI_ChunkFind( p_riff, AVIFOURCC_movi, 0, true );
@@ -2593,6 +2684,14 @@ static void AVI_IndexCreate( demux_t *p_demux )
     for( i_stream = 0; i_stream < p_sys->i_track; i_stream++ )
         avi_index_Init( &p_sys->track[i_stream]->idx );
 
+    /* The scan below reads the whole file, reuse a previous one if any */
+    p_cache = demux_IndexCacheNew( VLC_OBJECT(p_demux), p_demux->s, "avi-index" );
+    if( p_cache && AVI_IndexCacheLoad( p_demux, p_cache ) == VLC_SUCCESS )
+    {
+        demux_IndexCacheDelete( p_cache );
+        return;
+    }
+
     i_movi_end = __MIN( (uint32_t)(p_movi->i_chunk_pos + p_movi->i_chunk_size),
                         stream_Size( p_demux->s ) );
 
@@ -2618,7 +2717,10 @@ static void AVI_IndexCreate( demux_t *p_demux )
         if( p_dialog_id != NULL && vlc_tick_now() - i_dialog_update > VLC_TICK_FROM_MS(100) )
         {
             if( vlc_dialog_is_cancelled( p_demux, p_dialog_id ) )
+            {
+                b_cancelled = true;
                 break;
+            }
 
             double f_current = vlc_stream_Tell( p_demux->s );
             double f_size    = stream_Size( p_demux->s );
@@ -2697,6 +2799,13 @@ print_stat:
         msg_Dbg( p_demux, "stream[%d] creating %d index entries",
                 i_stream, p_sys->track[i_stream]->idx.i_size );
     }
+
+    if( p_cache )
+    {
+        if( !b_cancelled )
+            AVI_IndexCacheStore( p_demux, p_cache );
+        demux_IndexCacheDelete( p_cache );
+    }
 }
 
 /* */
@@ -0,0 +1,351 @@
+/*****************************************************************************
+ * index_cache.c: persistent seek index cache for demuxers
+ *****************************************************************************
+ * Copyright (C) 2024 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+#ifdef HAVE_CONFIG_H
+# include "config.h"
+#endif
+
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <sys/stat.h>
+
+#include <vlc_common.h>
+#include <vlc_stream.h>
+#include <vlc_fs.h>
+#include <vlc_md5.h>
+#include <vlc_rand.h>
+#include <vlc_configuration.h>
+
+#include "index_cache.h"
+
+/* Bytes hashed at each end of the stream to identify its content */
+#define INDEX_CACHE_PROBE    (64 * 1024)
+/* Larger payloads are assumed to be corrupted */
+#define INDEX_CACHE_MAX_SIZE (256 << 20)
+/* Indexes stored longer ago are removed, so that they get rescanned */
+#define INDEX_CACHE_MAX_AGE  (90 * 24 * 3600)
+
+static const char index_cache_magic[8] = { 'V','L','C','I','D','X','0','1' };
+#define INDEX_CACHE_HEADER_SIZE (8 + 8 + 8)
+
+struct demux_index_cache_t
+{
+    vlc_object_t *p_obj;
+    char         *psz_path;
+    uint64_t      i_stream_size;
+};
+
+static void IndexCacheCreateDir( const char *psz_dir )
+{
+    char newdir[strlen( psz_dir ) + 1];
+    strcpy( newdir, psz_dir );
+    char *psz = newdir;
+
+    while( *psz )
+    {
+        while( *psz && *psz != DIR_SEP_CHAR ) psz++;
+        if( !*psz ) break;
+        *psz = 0;
+        if( *newdir )
+            vlc_mkdir( newdir, 0700 );
+        *psz = DIR_SEP_CHAR;
+        psz++;
+    }
+    vlc_mkdir( psz_dir, 0700 );
+}
+
+static int IndexCacheHashRange( stream_t *s, struct md5_s *md5,
+                                uint64_t i_pos, size_t i_size )
+{
+    uint8_t buf[4096];
+
+    if( vlc_stream_Seek( s, i_pos ) )
+        return VLC_EGENERIC;
+
+    while( i_size > 0 )
+    {
+        ssize_t i_read = vlc_stream_Read( s, buf, __MIN( i_size, sizeof(buf) ) );
+        if( i_read <= 0 )
+            return VLC_EGENERIC;
+        AddMD5( md5, buf, i_read );
+        i_size -= i_read;
+    }
+    return VLC_SUCCESS;
+}
+
+static char *IndexCacheGetKey( stream_t *s, const char *psz_format,
+                               uint64_t i_size )
+{
+    struct md5_s md5;
+    uint8_t size[8];
+
+    InitMD5( &md5 );
+    AddMD5( &md5, psz_format, strlen( psz_format ) + 1 );
+    SetQWLE( size, i_size );
+    AddMD5( &md5, size, sizeof(size) );
+
+    const uint64_t i_head = __MIN( i_size, INDEX_CACHE_PROBE );
+    const uint64_t i_tail = __MIN( i_size - i_head, INDEX_CACHE_PROBE );
+    if( IndexCacheHashRange( s, &md5, 0, i_head ) ||
+        IndexCacheHashRange( s, &md5, i_size - i_tail, i_tail ) )
+        return NULL;
+
+    EndMD5( &md5 );
+    return psz_md5_hash( &md5 );
+}
+
+demux_index_cache_t *demux_IndexCacheNew( vlc_object_t *p_obj, stream_t *s,
+                                          const char *psz_format )
+{
+    bool b_fastseek = false;
+    uint64_t i_size;
+
+    if( !var_InheritBool( p_obj, "demux-index-cache" ) )
+        return NULL;
+
+    /* Hashing the tail of a remote stream would cost more than the scan */
+    if( vlc_stream_Control( s, STREAM_CAN_FASTSEEK, &b_fastseek ) ||
+        !b_fastseek || vlc_stream_GetSize( s, &i_size ) || i_size == 0 )
+        return NULL;
+
+    demux_index_cache_t *p_cache = malloc( sizeof(*p_cache) );
+    if( unlikely(!p_cache) )
+        return NULL;
+
+    const uint64_t i_pos = vlc_stream_Tell( s );
+    char *psz_key = IndexCacheGetKey( s, psz_format, i_size );
+    if( vlc_stream_Seek( s, i_pos ) )
+    {
+        free( psz_key );
+        free( p_cache );
+        return NULL;
+    }
+
+    char *psz_cachedir = config_GetUserDir( VLC_CACHE_DIR );
+    if( !psz_key || !psz_cachedir ||
+        asprintf( &p_cache->psz_path, "%s" DIR_SEP "index" DIR_SEP "%s",
+                  psz_cachedir, psz_key ) == -1 )
+        p_cache->psz_path = NULL;
+    free( psz_cachedir );
+    free( psz_key );
+
+    if( !p_cache->psz_path )
+    {
+        free( p_cache );
+        return NULL;
+    }
+
+    p_cache->p_obj = p_obj;
+    p_cache->i_stream_size = i_size;
+    return p_cache;
+}
+
+void demux_IndexCacheDelete( demux_index_cache_t *p_cache )
+{
+    free( p_cache->psz_path );
+    free( p_cache );
+}
+
+block_t *demux_IndexCacheLoad( demux_index_cache_t *p_cache )
+{
+    uint8_t header[INDEX_CACHE_HEADER_SIZE];
+    block_t *p_block = NULL;
+
+    FILE *file = vlc_fopen( p_cache->psz_path, "rb" );
+    if( !file )
+        return NULL;
+
+    if( fread( header, sizeof(header), 1, file ) != 1 ||
+        memcmp( header, index_cache_magic, sizeof(index_cache_magic) ) ||
+        GetQWLE( &header[8] ) != p_cache->i_stream_size )
+        goto error;
+
+    const uint64_t i_payload = GetQWLE( &header[16] );
+    if( i_payload > INDEX_CACHE_MAX_SIZE ||
+        !(p_block = block_Alloc( i_payload )) )
+        goto error;
+
+    if( i_payload > 0 &&
+        fread( p_block->p_buffer, i_payload, 1, file ) != 1 )
+        goto error;
+
+    fclose( file );
+    msg_Dbg( p_cache->p_obj, "loaded %"PRIu64" bytes of index from %s",
+             i_payload, p_cache->psz_path );
+    return p_block;
+
+error:
+    msg_Warn( p_cache->p_obj, "ignoring invalid index cache %s",
+              p_cache->psz_path );
+    if( p_block )
+        block_Release( p_block );
+    fclose( file );
+    return NULL;
+}
+
+struct index_cache_entry
+{
+    char    *psz_path;
+    time_t   i_mtime;
+    uint64_t i_size;
+};
+
+static int IndexCacheEntryCmp( const void *a, const void *b )
+{
+    const struct index_cache_entry *ea = a, *eb = b;
+
+    return (ea->i_mtime > eb->i_mtime) - (ea->i_mtime < eb->i_mtime);
+}
+
+/* Removes the expired indexes, then the oldest ones until the directory
+ * fits in the configured size. The index just stored is kept. */
+static void IndexCachePrune( demux_index_cache_t *p_cache, const char *psz_dir )
+{
+    const uint64_t i_max = (uint64_t) __MAX( var_InheritInteger( p_cache->p_obj,
+                                             "demux-index-cache-size" ), 0 ) << 20;
+    const time_t i_expiry = time( NULL ) - INDEX_CACHE_MAX_AGE;
+    struct index_cache_entry *p_entries = NULL;
+    size_t i_entries = 0;
+    uint64_t i_total = 0;
+
+    DIR *dir = vlc_opendir( psz_dir );
+    if( !dir )
+        return;
+
+    const char *psz_file;
+    while( (psz_file = vlc_readdir( dir )) != NULL )
+    {
+        struct stat st;
+        char *psz_path;
+
+        if( psz_file[0] == '.' ||
+            asprintf( &psz_path, "%s" DIR_SEP "%s", psz_dir, psz_file ) == -1 )
+            continue;
+
+        if( vlc_stat( psz_path, &st ) || !S_ISREG( st.st_mode ) )
+        {
+            free( psz_path );
+            continue;
+        }
+
+        /* Also removes the leftovers of interrupted stores */
+        if( st.st_mtime < i_expiry )
+        {
+            vlc_unlink( psz_path );
+            free( psz_path );
+            continue;
+        }
+
+        i_total += st.st_size;
+
+        /* Files being written by another instance are left alone */
+        struct index_cache_entry *p_realloc;
+        if( strchr( psz_file, '.' ) || !strcmp( psz_path, p_cache->psz_path ) ||
+            !(p_realloc = realloc( p_entries, (i_entries + 1) * sizeof(*p_entries) )) )
+        {
+            free( psz_path );
+            continue;
+        }
+        p_entries = p_realloc;
+        p_entries[i_entries].psz_path = psz_path;
+        p_entries[i_entries].i_mtime = st.st_mtime;
+        p_entries[i_entries].i_size = st.st_size;
+        i_entries++;
+    }
+    closedir( dir );
+
+    if( i_total > i_max && i_entries > 0 )
+        qsort( p_entries, i_entries, sizeof(*p_entries), IndexCacheEntryCmp );
+
+    for( size_t i = 0; i < i_entries; i++ )
+    {
+        if( i_total > i_max && !vlc_unlink( p_entries[i].psz_path ) )
+        {
+            msg_Dbg( p_cache->p_obj, "removed index cache %s",
+                     p_entries[i].psz_path );
+            i_total -= p_entries[i].i_size;
+        }
+        free( p_entries[i].psz_path );
+    }
+    free( p_entries );
+}
+
+int demux_IndexCacheStore( demux_index_cache_t *p_cache,
+                           const void *p_data, size_t i_data )
+{
+    uint8_t header[INDEX_CACHE_HEADER_SIZE];
+    char *psz_tmp;
+
+    if( i_data > INDEX_CACHE_MAX_SIZE )
+        return VLC_EGENERIC;
+
+    char *psz_dir = strdup( p_cache->psz_path );
+    if( unlikely(!psz_dir) )
+        return VLC_ENOMEM;
+    *strrchr( psz_dir, DIR_SEP_CHAR ) = '\0';
+    IndexCacheCreateDir( psz_dir );
+
+    /* Write aside then rename, so that concurrent readers (or another
+     * instance storing the same index) never see a truncated file */
+    if( asprintf( &psz_tmp, "%s.%08lx", p_cache->psz_path,
+                  (unsigned long) vlc_mrand48() ) == -1 )
+    {
+        free( psz_dir );
+        return VLC_ENOMEM;
+    }
+
+    FILE *file = vlc_fopen( psz_tmp, "wb" );
+    if( !file )
+    {
+        msg_Warn( p_cache->p_obj, "cannot create index cache %s: %s",
+                  psz_tmp, vlc_strerror_c(errno) );
+        free( psz_tmp );
+        free( psz_dir );
+        return VLC_EGENERIC;
+    }
+
+    memcpy( header, index_cache_magic, sizeof(index_cache_magic) );
+    SetQWLE( &header[8], p_cache->i_stream_size );
+    SetQWLE( &header[16], i_data );
+
+    bool b_error = fwrite( header, sizeof(header), 1, file ) != 1 ||
+                   ( i_data > 0 && fwrite( p_data, i_data, 1, file ) != 1 );
+    b_error |= fclose( file ) != 0;
+
+    if( b_error || vlc_rename( psz_tmp, p_cache->psz_path ) )
+    {
+        msg_Warn( p_cache->p_obj, "cannot write index cache %s",
+                  p_cache->psz_path );
+        vlc_unlink( psz_tmp );
+        free( psz_tmp );
+        free( psz_dir );
+        return VLC_EGENERIC;
+    }
+    free( psz_tmp );
+
+    msg_Dbg( p_cache->p_obj, "stored %zu bytes of index to %s", i_data,
+             p_cache->psz_path );
+
+    IndexCachePrune( p_cache, psz_dir );
+    free( psz_dir );
+    return VLC_SUCCESS;
+}
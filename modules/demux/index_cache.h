@@ -0,0 +1,85 @@
+/*****************************************************************************
+ * index_cache.h: persistent seek index cache for demuxers
+ *****************************************************************************
+ * Copyright (C) 2024 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+#ifndef VLC_DEMUX_INDEX_CACHE_H
+#define VLC_DEMUX_INDEX_CACHE_H
+
+#include <vlc_block.h>
+#include <vlc_memstream.h>
+
+# ifdef __cplusplus
+extern "C" {
+# endif
+
+/*
+ * Demuxers that have to scan a stream to be able to seek into it store the
+ * result of the scan in the user cache directory, and reload it the next
+ * time the same content is opened. The content is identified by its size
+ * and a hash of its first and last bytes, so that renamed or copied files
+ * still hit the cache, and modified files miss it.
+ *
+ * The payload is opaque to the cache: each demuxer serializes its own index
+ * with the helpers below (little endian, 64 bits values).
+ */
+typedef struct demux_index_cache_t demux_index_cache_t;
+
+/**
+ * Identifies the content of a stream.
+ *
+ * \param psz_format demuxer specific name, also used to version the payload
+ * \return NULL if the cache is disabled ("demux-index-cache"), or if the
+ * stream is not fast seekable or has no known size. The stream position is
+ * left unchanged.
+ */
+demux_index_cache_t *demux_IndexCacheNew( vlc_object_t *, stream_t *,
+                                          const char *psz_format );
+void demux_IndexCacheDelete( demux_index_cache_t * );
+
+/**
+ * Loads the payload stored for this content, if any.
+ */
+block_t *demux_IndexCacheLoad( demux_index_cache_t * );
+
+/**
+ * Replaces the payload stored for this content.
+ */
+int demux_IndexCacheStore( demux_index_cache_t *, const void *, size_t );
+
+static inline void demux_IndexCachePut( struct vlc_memstream *ms, uint64_t i_value )
+{
+    uint8_t buf[8];
+    SetQWLE( buf, i_value );
+    vlc_memstream_write( ms, buf, sizeof(buf) );
+}
+
+static inline bool demux_IndexCacheGet( block_t *p_block, uint64_t *pi_value )
+{
+    if( p_block->i_buffer < 8 )
+        return false;
+    *pi_value = GetQWLE( p_block->p_buffer );
+    p_block->p_buffer += 8;
+    p_block->i_buffer -= 8;
+    return true;
+}
+
+# ifdef __cplusplus
+}
+# endif
+
+#endif
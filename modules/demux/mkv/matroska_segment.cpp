@@ -27,6 +27,7 @@
 #include "util.hpp"
 #include "Ebml_parser.hpp"
 #include "Ebml_dispatcher.hpp"
+#include "stream_io_callback.hpp"
 
 #include <new>
 #include <iterator>
@@ -62,11 +63,19 @@ matroska_segment_c::matroska_segment_c( demux_sys_t & demuxer, EbmlStream & estr
     ,ep( EbmlParser(&estream, p_seg, &demuxer.demuxer ))
     ,b_preloaded(false)
     ,b_ref_external_segments(false)
+    ,p_index_cache(NULL)
+    ,i_index_cache_size(0)
 {
 }
 
 matroska_segment_c::~matroska_segment_c()
 {
+    if( p_index_cache )
+    {
+        StoreIndexCache();
+        demux_IndexCacheDelete( p_index_cache );
+    }
+
     free( psz_writing_application );
     free( psz_muxing_application );
     free( psz_segment_filename );
@@ -685,12 +694,69 @@ bool matroska_segment_c::Preload( )
 
     b_preloaded = true;
 
+    /* Without Cues, the clusters are discovered by scanning the file */
+    if( !b_cues && cluster )
+        LoadIndexCache();
+
     if( cluster )
         EnsureDuration();
 
     return true;
 }
 
+void matroska_segment_c::LoadIndexCache()
+{
+    vlc_stream_io_callback *io_callback = dynamic_cast<vlc_stream_io_callback *>( &es.I_O() );
+    if( io_callback == NULL )
+        return;
+
+    /* a file may contain several segments */
+    char psz_format[32];
+    snprintf( psz_format, sizeof(psz_format), "mkv-seeker-%" PRIu64,
+              static_cast<uint64_t>( segment->GetElementPosition() ) );
+
+    p_index_cache = demux_IndexCacheNew( VLC_OBJECT( &sys.demuxer ),
+                                         io_callback->GetStream(), psz_format );
+    if( p_index_cache == NULL )
+        return;
+
+    block_t *p_block = demux_IndexCacheLoad( p_index_cache );
+    if( p_block == NULL )
+        return;
+
+    const size_t i_size = p_block->i_buffer;
+    uint64_t i_cached_duration;
+    if( demux_IndexCacheGet( p_block, &i_cached_duration ) && _seeker.load( p_block ) )
+    {
+        /* spares the walk over all the clusters in EnsureDuration */
+        if( i_duration <= 0 )
+            i_duration = static_cast<vlc_tick_t>( i_cached_duration );
+        i_index_cache_size = i_size;
+    }
+    else
+        msg_Warn( &sys.demuxer, "invalid seek index in cache" );
+    block_Release( p_block );
+}
+
+void matroska_segment_c::StoreIndexCache()
+{
+    struct vlc_memstream ms;
+
+    if( vlc_memstream_open( &ms ) )
+        return;
+
+    demux_IndexCachePut( &ms, i_duration );
+    _seeker.save( &ms );
+
+    if( vlc_memstream_close( &ms ) )
+        return;
+
+    /* the index only grows, store it if something was added since the load */
+    if( ms.length != i_index_cache_size )
+        demux_IndexCacheStore( p_index_cache, ms.ptr, ms.length );
+    free( ms.ptr );
+}
+
 /* Here we try to load elements that were found in Seek Heads, but not yet parsed */
 bool matroska_segment_c::LoadSeekHeadItem( const EbmlCallbacks & ClassInfos, int64_t i_element_position )
 {
@@ -35,6 +35,7 @@
 #include <memory>
 
 #include "Ebml_parser.hpp"
+#include "../index_cache.h"
 
 namespace mkv {
 
@@ -138,6 +139,10 @@ public:
     bool                           b_preloaded;
     bool                           b_ref_external_segments;
 
+    /* seek index, kept across opens when there are no Cues */
+    demux_index_cache_t            *p_index_cache;
+    size_t                         i_index_cache_size;
+
     bool Preload();
     bool PreloadFamily( const matroska_segment_c & segment );
     bool PreloadClusters( uint64 i_cluster_position );
@@ -172,6 +177,8 @@ private:
     bool TrackInit( mkv_track_t * p_tk );
     void ComputeTrackPriority();
     void EnsureDuration();
+    void LoadIndexCache();
+    void StoreIndexCache();
 
     SegmentSeeker _seeker;
 
@@ -27,6 +27,7 @@
 #include "Ebml_dispatcher.hpp"
 #include "util.hpp"
 #include "stream_io_callback.hpp"
+#include "../index_cache.h"
 
 #include <sstream>
 #include <limits>
@@ -519,4 +520,140 @@ SegmentSeeker::mkv_jump_to( matroska_segment_c& ms, fptr_t fpos )
         ms.es.I_O().setFilePointer( fpos );
 }
 
+/* The state is stored in the index cache as the searched ranges, the
+ * seekpoints of each track, the cluster positions, then the clusters */
+void
+SegmentSeeker::save( vlc_memstream * ms ) const
+{
+    demux_IndexCachePut( ms, _ranges_searched.size() );
+    for( ranges_t::const_iterator it = _ranges_searched.begin(); it != _ranges_searched.end(); ++it )
+    {
+        demux_IndexCachePut( ms, it->start );
+        demux_IndexCachePut( ms, it->end );
+    }
+
+    demux_IndexCachePut( ms, _tracks_seekpoints.size() );
+    for( tracks_seekpoints_t::const_iterator it = _tracks_seekpoints.begin(); it != _tracks_seekpoints.end(); ++it )
+    {
+        demux_IndexCachePut( ms, it->first );
+        demux_IndexCachePut( ms, it->second.size() );
+        for( seekpoints_t::const_iterator sp = it->second.begin(); sp != it->second.end(); ++sp )
+        {
+            demux_IndexCachePut( ms, sp->fpos );
+            demux_IndexCachePut( ms, sp->pts );
+            demux_IndexCachePut( ms, sp->trust_level );
+        }
+    }
+
+    demux_IndexCachePut( ms, _cluster_positions.size() );
+    for( cluster_positions_t::const_iterator it = _cluster_positions.begin(); it != _cluster_positions.end(); ++it )
+        demux_IndexCachePut( ms, *it );
+
+    demux_IndexCachePut( ms, _clusters.size() );
+    for( cluster_map_t::const_iterator it = _clusters.begin(); it != _clusters.end(); ++it )
+    {
+        demux_IndexCachePut( ms, it->second.fpos );
+        demux_IndexCachePut( ms, it->second.pts );
+        demux_IndexCachePut( ms, it->second.duration );
+        demux_IndexCachePut( ms, it->second.size );
+    }
+}
+
+bool
+SegmentSeeker::load( block_t * p_block )
+{
+    struct reader {
+        block_t * p_block;
+
+        bool count( uint64_t & i_count, size_t i_item_size )
+        {
+            return demux_IndexCacheGet( p_block, &i_count ) &&
+                   i_count <= p_block->i_buffer / i_item_size;
+        }
+        uint64_t get()
+        {
+            uint64_t i_value = 0;
+            demux_IndexCacheGet( p_block, &i_value );
+            return i_value;
+        }
+    } r = { p_block };
+
+    /* Parse everything before touching the current state */
+    ranges_t            ranges;
+    tracks_seekpoints_t tracks_seekpoints;
+    cluster_positions_t cluster_positions;
+    cluster_map_t       clusters;
+    uint64_t            i_count;
+
+    if( !r.count( i_count, 16 ) )
+        return false;
+    for( ; i_count; --i_count )
+    {
+        fptr_t start = r.get();
+        fptr_t end   = r.get();
+        ranges.push_back( Range( start, end ) );
+    }
+
+    uint64_t i_tracks;
+    if( !r.count( i_tracks, 16 ) )
+        return false;
+    for( ; i_tracks; --i_tracks )
+    {
+        track_id_t track_id = r.get();
+        seekpoints_t& seekpoints = tracks_seekpoints[ track_id ];
+
+        if( !r.count( i_count, 24 ) )
+            return false;
+        for( ; i_count; --i_count )
+        {
+            fptr_t     fpos  = r.get();
+            vlc_tick_t pts   = r.get();
+            int64_t    trust = r.get();
+
+            if( trust != Seekpoint::TRUSTED && trust != Seekpoint::QUESTIONABLE &&
+                trust != Seekpoint::DISABLED )
+                return false;
+            seekpoints.push_back( Seekpoint( fpos, pts, Seekpoint::TrustLevel( trust ) ) );
+        }
+    }
+
+    if( !r.count( i_count, 8 ) )
+        return false;
+    for( ; i_count; --i_count )
+        cluster_positions.push_back( r.get() );
+
+    if( !r.count( i_count, 32 ) )
+        return false;
+    for( ; i_count; --i_count )
+    {
+        Cluster cinfo;
+        cinfo.fpos     = r.get();
+        cinfo.pts      = r.get();
+        cinfo.duration = r.get();
+        cinfo.size     = r.get();
+        clusters.insert( cluster_map_t::value_type( cinfo.pts, cinfo ) );
+    }
+
+    /* Merge with what the preparsing already found */
+    for( ranges_t::const_iterator it = ranges.begin(); it != ranges.end(); ++it )
+        mark_range_as_searched( *it );
+
+    for( tracks_seekpoints_t::const_iterator it = tracks_seekpoints.begin(); it != tracks_seekpoints.end(); ++it )
+    {
+        for( seekpoints_t::const_iterator sp = it->second.begin(); sp != it->second.end(); ++sp )
+            add_seekpoint( it->first, *sp );
+    }
+
+    cluster_positions_t const known_positions = _cluster_positions;
+    for( cluster_positions_t::const_iterator it = cluster_positions.begin(); it != cluster_positions.end(); ++it )
+    {
+        if( !std::binary_search( known_positions.begin(), known_positions.end(), *it ) )
+            add_cluster_position( *it );
+    }
+
+    _clusters.insert( clusters.begin(), clusters.end() );
+
+    return true;
+}
+
 } // namespace
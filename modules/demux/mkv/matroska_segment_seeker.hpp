@@ -30,6 +30,8 @@
 #include <map>
 #include <limits>
 
+struct vlc_memstream;
+
 namespace mkv {
 
 class matroska_segment_c;
@@ -119,6 +121,9 @@ class SegmentSeeker
         void mark_range_as_searched( Range );
         ranges_t get_search_areas( fptr_t start, fptr_t end ) const;
 
+        void save( vlc_memstream * ) const;
+        bool load( block_t * );
+
     public:
         ranges_t            _ranges_searched;
         tracks_seekpoints_t _tracks_seekpoints;
@@ -52,6 +52,12 @@ static void Close( vlc_object_t * );
 #define MP4_M4A_TEXT     N_("M4A audio only")
 #define MP4_M4A_LONGTEXT N_("Ignore non audio tracks from iTunes audio files")
 
+#define MP4_LAZY_TEXT     N_("Lazy sample tables")
+#define MP4_LAZY_LONGTEXT N_( \
+    "Decode the sample tables on demand around the playback position " \
+    "instead of expanding them when opening. This saves memory and time " \
+    "on very long files.")
+
 #define HEIF_DURATION_TEXT N_("Duration in seconds")
 #define HEIF_DURATION_LONGTEXT N_( \
     "Duration in seconds before simulating an end of file. " \
@@ -67,6 +73,7 @@ vlc_module_begin ()
 
     add_category_hint("Hacks", NULL)
     add_bool( CFG_PREFIX"m4a-audioonly", false, MP4_M4A_TEXT, MP4_M4A_LONGTEXT, true )
+    add_bool( CFG_PREFIX"lazy-index", false, MP4_LAZY_TEXT, MP4_LAZY_LONGTEXT, true )
 
     add_submodule()
         set_category( CAT_INPUT )
@@ -108,6 +115,7 @@ typedef struct
     bool         b_seekable;
     bool         b_fastseekable;
     bool         b_error;        /* unrecoverable */
+    bool         b_lazy_index;   /* sample tables decoded on demand */
 
     bool            b_index_probed;     /* mFra sync points index */
     bool            b_fragments_probed; /* moof segments index created */
@@ -146,6 +154,7 @@ typedef struct
 
 #define DEMUX_INCREMENT VLC_TICK_FROM_MS(250) /* How far the pcr will go, each round */
 #define DEMUX_TRACK_MAX_PRELOAD VLC_TICK_FROM_SEC(15) /* maximum preloading, to deal with interleaving */
+#define MP4_CHUNK_WINDOW 1024 /* chunks decoded at once with the lazy index */
 
 #define INVALID_PRELOAD  UINT_MAX
 
@@ -167,6 +176,7 @@ const char *psz_meta_roots[] = { "/moov/udta/meta/ilst",
 static void MP4_TrackSetup( demux_t *, mp4_track_t *, MP4_Box_t  *, bool, bool );
 static void MP4_TrackInit( mp4_track_t * );
 static void MP4_TrackClean( es_out_t *, mp4_track_t * );
+static mp4_chunk_t * MP4_TrackChunk( mp4_track_t *, uint32_t );
 
 static void MP4_Block_Send( demux_t *, mp4_track_t *, block_t * );
 
@@ -330,7 +340,7 @@ static es_out_id_t * MP4_AddTrackES( es_out_t *out, mp4_track_t *p_track )
 static inline vlc_tick_t MP4_TrackGetDTS( demux_t *p_demux, mp4_track_t *p_track )
 {
     demux_sys_t *p_sys = p_demux->p_sys;
-    const mp4_chunk_t *p_chunk = &p_track->chunk[p_track->i_chunk];
+    const mp4_chunk_t *p_chunk = MP4_TrackChunk( p_track, p_track->i_chunk );
 
     unsigned int i_index = 0;
     unsigned int i_sample = p_track->i_sample - p_chunk->i_sample_first;
@@ -380,7 +390,7 @@ static inline bool MP4_TrackGetPTSDelta( demux_t *p_demux, mp4_track_t *p_track,
                                          vlc_tick_t *pi_delta )
 {
     VLC_UNUSED( p_demux );
-    mp4_chunk_t *ck = &p_track->chunk[p_track->i_chunk];
+    const mp4_chunk_t *ck = MP4_TrackChunk( p_track, p_track->i_chunk );
 
     unsigned int i_index = 0;
     unsigned int i_sample = p_track->i_sample - ck->i_sample_first;
@@ -407,7 +417,7 @@ static inline vlc_tick_t MP4_GetSamplesDuration( demux_t *p_demux, mp4_track_t *
 {
     VLC_UNUSED( p_demux );
 
-    const mp4_chunk_t *p_chunk = &p_track->chunk[p_track->i_chunk];
+    const mp4_chunk_t *p_chunk = MP4_TrackChunk( p_track, p_track->i_chunk );
     stime_t i_duration = 0;
 
     /* Forward to right index, and set remaining count in that index */
@@ -559,7 +569,7 @@ static block_t * MP4_EIA608_Convert( block_t * p_block )
 static uint32_t MP4_TrackGetRunSeq( mp4_track_t *p_track )
 {
     if( p_track->i_chunk_count > 0 )
-        return p_track->chunk[p_track->i_chunk].i_virtual_run_number;
+        return MP4_TrackChunk( p_track, p_track->i_chunk )->i_virtual_run_number;
     return 0;
 }
 
@@ -781,6 +791,7 @@ static int Open( vlc_object_t * p_this )
     p_demux->pf_control = Control;
 
     p_sys->context.i_lastseqnumber = UINT32_MAX;
+    p_sys->b_lazy_index = var_InheritBool( p_demux, CFG_PREFIX"lazy-index" );
 
     p_demux->p_sys = p_sys;
 
@@ -1094,7 +1105,8 @@ static int Open( vlc_object_t * p_this )
         goto error;
     }
 
-    if( p_sys->i_tracks > 1 && !p_sys->b_fastseekable )
+    /* The lazy index does not decode all the chunks */
+    if( p_sys->i_tracks > 1 && !p_sys->b_fastseekable && !p_sys->b_lazy_index )
     {
         vlc_tick_t i_max_continuity;
         bool b_flat;
@@ -2356,8 +2368,8 @@ static void LoadChapterApple( demux_t  *p_demux, mp4_track_t *tk )
                 TAB_APPEND( p_sys->p_title->i_seekpoint, p_sys->p_title->seekpoint, s );
             }
         }
-        if( tk->i_sample+1 >= tk->chunk[tk->i_chunk].i_sample_first +
-                              tk->chunk[tk->i_chunk].i_sample_count )
+        const mp4_chunk_t *ck = MP4_TrackChunk( tk, tk->i_chunk );
+        if( tk->i_sample+1 >= ck->i_sample_first + ck->i_sample_count )
             tk->i_chunk++;
     }
 }
@@ -2561,13 +2573,13 @@ static int xTTS_CountEntries( demux_t *p_demux, uint32_t *pi_entry /* out */,
     return VLC_SUCCESS;
 }
 
-static int TrackCreateSamplesIndex( demux_t *p_demux,
-                                    mp4_track_t *p_demux_track )
+/* Sets the sample sizes from the stsz table, used as is */
+static int TrackSetupSampleSizes( demux_t *p_demux,
+                                  mp4_track_t *p_demux_track,
+                                  uint32_t i_last_chunk_samples )
 {
     MP4_Box_t *p_box;
     MP4_Box_data_stsz_t *stsz;
-    /* TODO use also stss and stsh table for seeking */
-    /* FIXME use edit table */
 
     /* Find stsz
      *  Gives the sample size for each samples. There is also a stz2 table
@@ -2590,38 +2602,34 @@ static int TrackCreateSamplesIndex( demux_t *p_demux,
         p_demux_track->i_sample_count = __MIN(p_demux_track->i_sample_count, stsz->i_sample_count);
     }
 
-    if( stsz->i_sample_size )
-    {
-        /* 1: all sample have the same size, so no need to construct a table */
-        p_demux_track->i_sample_size = stsz->i_sample_size;
-        p_demux_track->p_sample_size = NULL;
-    }
-    else
-    {
-        /* 2: each sample can have a different size */
-        p_demux_track->i_sample_size = 0;
-        p_demux_track->p_sample_size =
-            calloc( p_demux_track->i_sample_count, sizeof( uint32_t ) );
-        if( p_demux_track->p_sample_size == NULL )
-            return VLC_ENOMEM;
-
-        for( uint32_t i_sample = 0; i_sample < p_demux_track->i_sample_count; i_sample++ )
-        {
-            p_demux_track->p_sample_size[i_sample] =
-                    stsz->i_entry_size[i_sample];
-        }
-    }
+    /* 1: all sample have the same size, so no need for a table
+     * 2: each sample can have a different size, given by the stsz box */
+    p_demux_track->i_sample_size = stsz->i_sample_size;
+    p_demux_track->p_sample_size = stsz->i_sample_size ? NULL : stsz->i_entry_size;
 
     if ( p_demux_track->i_chunk_count && p_demux_track->i_sample_size == 0 )
     {
-        const mp4_chunk_t *lastchunk = &p_demux_track->chunk[p_demux_track->i_chunk_count - 1];
-        if( (uint64_t)lastchunk->i_sample_count + p_demux_track->i_chunk_count - 1 > stsz->i_sample_count )
+        if( (uint64_t)i_last_chunk_samples + p_demux_track->i_chunk_count - 1 > stsz->i_sample_count )
         {
             msg_Err( p_demux, "invalid samples table: stsz table is too small" );
             return VLC_EGENERIC;
         }
     }
 
+    return VLC_SUCCESS;
+}
+
+static int TrackCreateSamplesIndex( demux_t *p_demux,
+                                    mp4_track_t *p_demux_track )
+{
+    MP4_Box_t *p_box;
+    /* TODO use also stss and stsh table for seeking */
+    /* FIXME use edit table */
+
+    if( TrackSetupSampleSizes( p_demux, p_demux_track, p_demux_track->i_chunk_count ?
+            p_demux_track->chunk[p_demux_track->i_chunk_count - 1].i_sample_count : 0 ) )
+        return VLC_EGENERIC;
+
     /* Use stts table to create a sample number -> dts table.
      * XXX: if we don't want to waste too much memory, we can't expand
      *  the box! so each chunk will contain an "extract" of this table
@@ -2846,13 +2854,392 @@ static int TrackCreateSamplesIndex( demux_t *p_demux,
 }
 
 
+/* Lazy index: the chunks are decoded by windows of MP4_CHUNK_WINDOW, from
+ * the tables state saved for each window when opening */
+typedef struct
+{
+    const MP4_Box_data_co64_t *co64;
+    const MP4_Box_data_stsc_t *stsc;
+    const MP4_Box_data_stts_t *stts;
+    const MP4_Box_data_ctts_t *ctts; /* optional */
+    int64_t i_cts_shift;
+} mp4_sample_tables_t;
+
+static int TrackGetSampleTables( const mp4_track_t *p_track,
+                                 mp4_sample_tables_t *t )
+{
+    const MP4_Box_t *p_co64, *p_stsc, *p_stts, *p_ctts, *p_cslg;
+
+    if( ( !(p_co64 = MP4_BoxGet( p_track->p_stbl, "stco" ) ) &&
+          !(p_co64 = MP4_BoxGet( p_track->p_stbl, "co64" ) ) ) ||
+        !(p_stsc = MP4_BoxGet( p_track->p_stbl, "stsc" ) ) ||
+        !(p_stts = MP4_BoxGet( p_track->p_stbl, "stts" ) ) ||
+        !BOXDATA(p_co64) || !BOXDATA(p_stsc) || !BOXDATA(p_stts) )
+        return VLC_EGENERIC;
+
+    t->co64 = BOXDATA(p_co64);
+    t->stsc = BOXDATA(p_stsc);
+    t->stts = BOXDATA(p_stts);
+    p_ctts = MP4_BoxGet( p_track->p_stbl, "ctts" );
+    t->ctts = p_ctts ? BOXDATA(p_ctts) : NULL;
+    p_cslg = MP4_BoxGet( p_track->p_stbl, "cslg" );
+    t->i_cts_shift = ( p_cslg && BOXDATA(p_cslg) ) ? BOXDATA(p_cslg)->ct_to_dts_shift : 0;
+    return VLC_SUCCESS;
+}
+
+static uint64_t xTTS_TotalSamples( const uint32_t *pi_sample_count,
+                                   uint32_t i_entry_count )
+{
+    uint64_t i_total = 0;
+    for( uint32_t i = 0; i < i_entry_count; i++ )
+        i_total += pi_sample_count[i];
+    return i_total;
+}
+
+/* Returns the length of the next run of at most i_samples samples sharing
+ * the same stts/ctts entry, or 0 at the end of the table */
+static uint32_t xTTS_NextRun( const uint32_t *pi_sample_count, uint32_t i_entry_count,
+                              uint32_t *pi_index, uint32_t *pi_used,
+                              uint32_t i_samples, uint32_t *pi_entry )
+{
+    while( *pi_index < i_entry_count && *pi_used >= pi_sample_count[*pi_index] )
+    {
+        (*pi_index)++;
+        *pi_used = 0;
+    }
+    if( *pi_index >= i_entry_count )
+        return 0;
+
+    const uint32_t i_run = __MIN( pi_sample_count[*pi_index] - *pi_used, i_samples );
+    *pi_entry = *pi_index;
+    *pi_used += i_run;
+    return i_run;
+}
+
+/* Decodes a chunk from the tables state, and moves the state past it.
+ * The dts/pts runs are only counted unless the chunk tables are set. */
+static void TrackDecodeChunk( const mp4_sample_tables_t *t, mp4_chunk_index_t *pos,
+                              uint32_t i_chunk, mp4_chunk_t *ck )
+{
+    const MP4_Box_data_stsc_t *stsc = t->stsc;
+    uint32_t i_run, i_entry, i_left;
+
+    while( pos->i_stsc_index + 1 < stsc->i_entry_count &&
+           stsc->i_first_chunk[pos->i_stsc_index + 1] - 1 <= i_chunk )
+        pos->i_stsc_index++;
+
+    ck->i_offset = t->co64->i_chunk_offset[i_chunk];
+    if( stsc->i_entry_count && stsc->i_first_chunk[pos->i_stsc_index] - 1 <= i_chunk )
+    {
+        ck->i_sample_description_index = stsc->i_sample_description_index[pos->i_stsc_index];
+        ck->i_sample_count = stsc->i_samples_per_chunk[pos->i_stsc_index];
+    }
+    else
+    {
+        ck->i_sample_description_index = 0;
+        ck->i_sample_count = 0;
+    }
+    ck->i_sample_first = pos->i_sample_first;
+    ck->i_sample = 0;
+    ck->i_virtual_run_number = 0;
+    ck->i_first_dts = pos->i_first_dts;
+
+    ck->i_entries_dts = 0;
+    i_left = ck->i_sample_count;
+    while( i_left > 0 &&
+           (i_run = xTTS_NextRun( t->stts->pi_sample_count, t->stts->i_entry_count,
+                                  &pos->i_stts_index, &pos->i_stts_used,
+                                  i_left, &i_entry )) )
+    {
+        const uint32_t i_delta = t->stts->pi_sample_delta[i_entry];
+        if( ck->p_sample_count_dts )
+        {
+            ck->p_sample_count_dts[ck->i_entries_dts] = i_run;
+            ck->p_sample_delta_dts[ck->i_entries_dts] = i_delta;
+        }
+        ck->i_entries_dts++;
+        pos->i_first_dts += (uint64_t) i_run * i_delta;
+        i_left -= i_run;
+    }
+    ck->i_duration = pos->i_first_dts - ck->i_first_dts;
+
+    ck->i_entries_pts = 0;
+    i_left = t->ctts ? ck->i_sample_count : 0;
+    while( i_left > 0 &&
+           (i_run = xTTS_NextRun( t->ctts->pi_sample_count, t->ctts->i_entry_count,
+                                  &pos->i_ctts_index, &pos->i_ctts_used,
+                                  i_left, &i_entry )) )
+    {
+        if( ck->p_sample_count_pts )
+        {
+            ck->p_sample_count_pts[ck->i_entries_pts] = i_run;
+            ck->p_sample_offset_pts[ck->i_entries_pts] =
+                t->ctts->pi_sample_offset[i_entry] + t->i_cts_shift;
+        }
+        ck->i_entries_pts++;
+        i_left -= i_run;
+    }
+
+    pos->i_sample_first += ck->i_sample_count;
+}
+
+static bool TrackChunkWindowReserve( mp4_chunk_window_t *w,
+                                     uint32_t i_dts, uint32_t i_pts )
+{
+    if( i_dts > w->i_dts_max )
+    {
+        i_dts = __MAX( i_dts, MP4_CHUNK_WINDOW );
+        uint32_t *p_count = vlc_reallocarray( w->p_sample_count_dts, i_dts, sizeof(uint32_t) );
+        if( !p_count )
+            return false;
+        w->p_sample_count_dts = p_count;
+        uint32_t *p_delta = vlc_reallocarray( w->p_sample_delta_dts, i_dts, sizeof(uint32_t) );
+        if( !p_delta )
+            return false;
+        w->p_sample_delta_dts = p_delta;
+        w->i_dts_max = i_dts;
+    }
+
+    if( i_pts > w->i_pts_max )
+    {
+        i_pts = __MAX( i_pts, MP4_CHUNK_WINDOW );
+        uint32_t *p_count = vlc_reallocarray( w->p_sample_count_pts, i_pts, sizeof(uint32_t) );
+        if( !p_count )
+            return false;
+        w->p_sample_count_pts = p_count;
+        int32_t *p_offset = vlc_reallocarray( w->p_sample_offset_pts, i_pts, sizeof(int32_t) );
+        if( !p_offset )
+            return false;
+        w->p_sample_offset_pts = p_offset;
+        w->i_pts_max = i_pts;
+    }
+
+    return true;
+}
+
+/* Walks the chunks up to the start of the window, saving the tables state
+ * at each window on the way: the index only covers the part of the track
+ * the demuxer has reached or seeked into */
+static void TrackLazyIndexExtend( mp4_track_t *p_track, uint32_t i_window )
+{
+    mp4_sample_tables_t t;
+
+    /* The tables were checked when creating the index */
+    if( TrackGetSampleTables( p_track, &t ) )
+        vlc_assert_unreachable();
+
+    while( p_track->i_chunk_index <= i_window )
+    {
+        const uint32_t i_first = (p_track->i_chunk_index - 1) * MP4_CHUNK_WINDOW;
+        const uint32_t i_last = __MIN( i_first + MP4_CHUNK_WINDOW, p_track->i_chunk_count );
+        mp4_chunk_index_t pos = p_track->p_chunk_index[p_track->i_chunk_index - 1];
+        mp4_chunk_t ck = { 0 };
+
+        for( uint32_t i_chunk = i_first; i_chunk < i_last; i_chunk++ )
+            TrackDecodeChunk( &t, &pos, i_chunk, &ck );
+        p_track->p_chunk_index[p_track->i_chunk_index++] = pos;
+    }
+}
+
+/* Decodes the window of chunks containing i_chunk */
+static void TrackLoadChunkWindow( mp4_track_t *p_track, uint32_t i_chunk )
+{
+    mp4_chunk_window_t *w = &p_track->chunk_window;
+    const uint32_t i_window = i_chunk / MP4_CHUNK_WINDOW;
+    mp4_sample_tables_t t;
+    mp4_chunk_index_t pos;
+    uint32_t i_dts = 0, i_pts = 0;
+
+    /* The tables were checked when creating the index */
+    if( TrackGetSampleTables( p_track, &t ) )
+        vlc_assert_unreachable();
+
+    TrackLazyIndexExtend( p_track, i_window );
+
+    w->i_first = i_window * MP4_CHUNK_WINDOW;
+    w->i_count = __MIN( MP4_CHUNK_WINDOW, p_track->i_chunk_count - w->i_first );
+
+    /* Count the dts/pts runs first, as they share the window storage */
+    pos = p_track->p_chunk_index[i_window];
+    for( uint32_t i = 0; i < w->i_count; i++ )
+    {
+        mp4_chunk_t *ck = &p_track->chunk[i];
+        ck->p_sample_count_dts = ck->p_sample_delta_dts = NULL;
+        ck->p_sample_count_pts = NULL;
+        ck->p_sample_offset_pts = NULL;
+        TrackDecodeChunk( &t, &pos, w->i_first + i, ck );
+        i_dts += ck->i_entries_dts;
+        i_pts += ck->i_entries_pts;
+    }
+    /* Reading on goes to the next window: index it for free */
+    if( p_track->i_chunk_index == i_window + 1 )
+        p_track->p_chunk_index[p_track->i_chunk_index++] = pos;
+
+    /* Without storage, the chunks are left without timing details, and
+     * the track can't be played any further */
+    const bool b_store = TrackChunkWindowReserve( w, i_dts, i_pts );
+    if( !b_store )
+    {
+        p_track->b_ok       = false;
+        p_track->b_selected = false;
+    }
+
+    pos = p_track->p_chunk_index[i_window];
+    i_dts = i_pts = 0;
+    for( uint32_t i = 0; i < w->i_count; i++ )
+    {
+        mp4_chunk_t *ck = &p_track->chunk[i];
+        if( b_store )
+        {
+            if( w->i_dts_max )
+            {
+                ck->p_sample_count_dts = &w->p_sample_count_dts[i_dts];
+                ck->p_sample_delta_dts = &w->p_sample_delta_dts[i_dts];
+            }
+            if( t.ctts && w->i_pts_max )
+            {
+                ck->p_sample_count_pts = &w->p_sample_count_pts[i_pts];
+                ck->p_sample_offset_pts = &w->p_sample_offset_pts[i_pts];
+            }
+        }
+        TrackDecodeChunk( &t, &pos, w->i_first + i, ck );
+        if( !b_store )
+            ck->i_entries_dts = ck->i_entries_pts = 0;
+        i_dts += ck->i_entries_dts;
+        i_pts += ck->i_entries_pts;
+    }
+
+    /* Restore the read position in the current chunk */
+    if( p_track->i_chunk - w->i_first < w->i_count )
+    {
+        mp4_chunk_t *ck = &p_track->chunk[p_track->i_chunk - w->i_first];
+        if( p_track->i_sample - ck->i_sample_first < ck->i_sample_count )
+            ck->i_sample = p_track->i_sample - ck->i_sample_first;
+    }
+}
+
+/* Returns the chunk, which remains valid until the next call for the track */
+static mp4_chunk_t * MP4_TrackChunk( mp4_track_t *p_track, uint32_t i_chunk )
+{
+    if( p_track->p_chunk_index == NULL )
+        return &p_track->chunk[i_chunk];
+
+    mp4_chunk_window_t *w = &p_track->chunk_window;
+    if( i_chunk - w->i_first >= w->i_count )
+        TrackLoadChunkWindow( p_track, i_chunk );
+    return &p_track->chunk[i_chunk - w->i_first];
+}
+
+/* Creates the sparse index of the lazy mode, in place of the chunks and
+ * samples indexes. Only the chunks count and the samples count, which the
+ * sample to chunk table gives per run of chunks, are computed at open: the
+ * chunks themselves are walked when the demuxer reaches or seeks to them. */
+static int TrackCreateLazyIndex( demux_t *p_demux, mp4_track_t *p_demux_track )
+{
+    mp4_sample_tables_t t;
+
+    if( TrackGetSampleTables( p_demux_track, &t ) )
+        return VLC_EGENERIC;
+
+    p_demux_track->i_chunk_count = t.co64->i_entry_count;
+
+    /* A run lasts until the first chunk of the next entry */
+    uint64_t i_sample_count = 0;
+    uint32_t i_last_chunk_samples = 0;
+    for( uint32_t i = 0; i < t.stsc->i_entry_count; i++ )
+    {
+        if( t.stsc->i_first_chunk[i] == 0 ||
+            ( i > 0 && t.stsc->i_first_chunk[i] < t.stsc->i_first_chunk[i - 1] ) )
+        {
+            msg_Warn( p_demux, "corrupted chunk table" );
+            return VLC_EGENERIC;
+        }
+
+        const uint32_t i_first = t.stsc->i_first_chunk[i] - 1;
+        uint32_t i_end = p_demux_track->i_chunk_count;
+        if( i + 1 < t.stsc->i_entry_count )
+            i_end = __MIN( t.stsc->i_first_chunk[i + 1] - 1, i_end );
+        if( i_first >= i_end )
+            continue;
+
+        i_sample_count += (uint64_t) (i_end - i_first) * t.stsc->i_samples_per_chunk[i];
+        if( i_end == p_demux_track->i_chunk_count )
+            i_last_chunk_samples = t.stsc->i_samples_per_chunk[i];
+    }
+
+    if( unlikely(i_sample_count > UINT32_MAX) )
+    {
+        msg_Err( p_demux, "Overflow in chunks total samples count" );
+        return VLC_EGENERIC;
+    }
+    p_demux_track->i_sample_count = i_sample_count;
+
+    /* Like xTTS_CountEntries, the timing tables must cover all the samples:
+     * the chunks are decoded later on without checking them again */
+    if( xTTS_TotalSamples( t.stts->pi_sample_count, t.stts->i_entry_count ) < i_sample_count ||
+        ( t.ctts && xTTS_TotalSamples( t.ctts->pi_sample_count,
+                                       t.ctts->i_entry_count ) < i_sample_count ) )
+    {
+        msg_Err( p_demux, "invalid index counting total samples" );
+        return VLC_EGENERIC;
+    }
+
+    if( !p_demux_track->i_chunk_count )
+    {
+        msg_Warn( p_demux, "no chunk defined" );
+        return TrackSetupSampleSizes( p_demux, p_demux_track, 0 );
+    }
+
+    /* One state per window, and the state at the end of the track */
+    const uint32_t i_windows = (p_demux_track->i_chunk_count - 1) / MP4_CHUNK_WINDOW + 1;
+    p_demux_track->p_chunk_index = vlc_alloc( i_windows + 1, sizeof(mp4_chunk_index_t) );
+    p_demux_track->chunk = vlc_alloc( __MIN( p_demux_track->i_chunk_count, MP4_CHUNK_WINDOW ),
+                                      sizeof(mp4_chunk_t) );
+    if( !p_demux_track->p_chunk_index || !p_demux_track->chunk )
+        return VLC_ENOMEM;
+
+    memset( &p_demux_track->p_chunk_index[0], 0, sizeof(mp4_chunk_index_t) );
+    p_demux_track->i_chunk_index = 1;
+
+    msg_Dbg( p_demux, "track[Id 0x%x] %"PRIu32" chunks, %"PRIu32" samples, "
+             "indexed on demand", p_demux_track->i_track_ID,
+             p_demux_track->i_chunk_count, p_demux_track->i_sample_count );
+
+    return TrackSetupSampleSizes( p_demux, p_demux_track, i_last_chunk_samples );
+}
+
+/* Returns the first chunk of the lazy index window where the time is,
+ * indexing the track up to it */
+static uint32_t TrackLazyIndexFindChunk( mp4_track_t *p_track, uint64_t i_dts )
+{
+    const uint32_t i_windows = (p_track->i_chunk_count - 1) / MP4_CHUNK_WINDOW + 1;
+
+    while( p_track->i_chunk_index < i_windows &&
+           p_track->p_chunk_index[p_track->i_chunk_index - 1].i_first_dts <= i_dts )
+        TrackLazyIndexExtend( p_track, p_track->i_chunk_index );
+
+    const mp4_chunk_index_t *p_index = p_track->p_chunk_index;
+    size_t i_low = 0;
+    size_t i_high = __MIN( p_track->i_chunk_index, i_windows );
+
+    while( i_high - i_low > 1 )
+    {
+        const size_t i_mid = (i_low + i_high) / 2;
+        if( p_index[i_mid].i_first_dts <= i_dts )
+            i_low = i_mid;
+        else
+            i_high = i_mid;
+    }
+    return i_low * MP4_CHUNK_WINDOW;
+}
+
 /**
  * It computes the sample rate for a video track using the given sample
  * description index
  */
 static void TrackGetESSampleRate( demux_t *p_demux,
                                   unsigned *pi_num, unsigned *pi_den,
-                                  const mp4_track_t *p_track,
+                                  mp4_track_t *p_track,
                                   unsigned i_sd_index,
                                   unsigned i_chunk )
 {
@@ -2876,24 +3263,33 @@ static void TrackGetESSampleRate( demux_t *p_demux,
     if( p_track->i_chunk_count == 0 )
         return;
 
+    /* The lazy index estimates the rate from the window of the chunk, rather
+     * than walking the whole track */
+    uint32_t i_first = 0, i_end = p_track->i_chunk_count;
+    if( p_track->p_chunk_index )
+    {
+        i_first = i_chunk - i_chunk % MP4_CHUNK_WINDOW;
+        i_end = __MIN( i_first + MP4_CHUNK_WINDOW, i_end );
+    }
+
     /* */
-    const mp4_chunk_t *p_chunk = &p_track->chunk[i_chunk];
-    while( p_chunk > &p_track->chunk[0] &&
-           p_chunk[-1].i_sample_description_index == i_sd_index )
+    while( i_chunk > i_first &&
+           MP4_TrackChunk( p_track, i_chunk - 1 )->i_sample_description_index == i_sd_index )
     {
-        p_chunk--;
+        i_chunk--;
     }
 
     uint64_t i_sample = 0;
     uint64_t i_total_duration = 0;
     do
     {
+        const mp4_chunk_t *p_chunk = MP4_TrackChunk( p_track, i_chunk );
         i_sample += p_chunk->i_sample_count;
         i_total_duration += p_chunk->i_duration;
-        p_chunk++;
+        i_chunk++;
     }
-    while( p_chunk < &p_track->chunk[p_track->i_chunk_count] &&
-           p_chunk->i_sample_description_index == i_sd_index );
+    while( i_chunk < i_end &&
+           MP4_TrackChunk( p_track, i_chunk )->i_sample_description_index == i_sd_index );
 
     if( i_sample > 0 && i_total_duration )
         vlc_ureduce( pi_num, pi_den,
@@ -2916,7 +3312,7 @@ static int TrackCreateES( demux_t *p_demux, mp4_track_t *p_track,
         i_sample_description_index = 1; /* XXX */
     else
         i_sample_description_index =
-                p_track->chunk[i_chunk].i_sample_description_index;
+                MP4_TrackChunk( p_track, i_chunk )->i_sample_description_index;
 
     if( pp_es )
         *pp_es = NULL;
@@ -3135,9 +3531,12 @@ static int TrackTimeToSampleChunk( demux_t *p_demux, mp4_track_t *p_track,
         i_start = MP4_rescale_qtime( start, p_track->i_timescale );
     }
 
-    /* we start from sample 0/chunk 0, hope it won't take too much time */
+    /* we start from sample 0/chunk 0, hope it won't take too much time,
+     * or from the lazy index window of the time */
+    i_chunk = p_track->p_chunk_index ? TrackLazyIndexFindChunk( p_track, i_start ) : 0;
+
     /* *** find good chunk *** */
-    for( i_chunk = 0; ; i_chunk++ )
+    for( ; ; i_chunk++ )
     {
         if( i_chunk + 1 >= p_track->i_chunk_count )
         {
@@ -3147,37 +3546,42 @@ static int TrackTimeToSampleChunk( demux_t *p_demux, mp4_track_t *p_track,
             break;
         }
 
-        if( (uint64_t)i_start >= p_track->chunk[i_chunk].i_first_dts &&
-            (uint64_t)i_start <  p_track->chunk[i_chunk + 1].i_first_dts )
+        const uint64_t i_first_dts = MP4_TrackChunk( p_track, i_chunk )->i_first_dts;
+        const uint64_t i_next_dts = MP4_TrackChunk( p_track, i_chunk + 1 )->i_first_dts;
+        if( (uint64_t)i_start >= i_first_dts && (uint64_t)i_start < i_next_dts )
         {
             break;
         }
     }
 
     /* *** find sample in the chunk *** */
-    i_sample = p_track->chunk[i_chunk].i_sample_first;
-    i_dts    = p_track->chunk[i_chunk].i_first_dts;
-    for( i_index = 0; i_sample < p_track->chunk[i_chunk].i_sample_count; )
+    const mp4_chunk_t *ck = MP4_TrackChunk( p_track, i_chunk );
+    if( !p_track->b_ok )
+        return VLC_EGENERIC; /* the lazy index window could not be loaded */
+    i_sample = ck->i_sample_first;
+    i_dts    = ck->i_first_dts;
+    for( i_index = 0; i_sample < ck->i_sample_count &&
+                      (uint32_t) i_index < ck->i_entries_dts; )
     {
         if( i_dts +
-            p_track->chunk[i_chunk].p_sample_count_dts[i_index] *
-            p_track->chunk[i_chunk].p_sample_delta_dts[i_index] < (uint64_t)i_start )
+            ck->p_sample_count_dts[i_index] *
+            ck->p_sample_delta_dts[i_index] < (uint64_t)i_start )
         {
             i_dts    +=
-                p_track->chunk[i_chunk].p_sample_count_dts[i_index] *
-                p_track->chunk[i_chunk].p_sample_delta_dts[i_index];
+                ck->p_sample_count_dts[i_index] *
+                ck->p_sample_delta_dts[i_index];
 
-            i_sample += p_track->chunk[i_chunk].p_sample_count_dts[i_index];
+            i_sample += ck->p_sample_count_dts[i_index];
             i_index++;
         }
         else
         {
-            if( p_track->chunk[i_chunk].p_sample_delta_dts[i_index] <= 0 )
+            if( ck->p_sample_delta_dts[i_index] <= 0 )
             {
                 break;
             }
             i_sample += ( i_start - i_dts ) /
-                p_track->chunk[i_chunk].p_sample_delta_dts[i_index];
+                ck->p_sample_delta_dts[i_index];
             break;
         }
     }
@@ -3200,15 +3604,18 @@ static int TrackTimeToSampleChunk( demux_t *p_demux, mp4_track_t *p_track,
         if( i_sync_sample <= i_sample )
         {
             while( i_chunk > 0 &&
-                   i_sync_sample < p_track->chunk[i_chunk].i_sample_first )
+                   i_sync_sample < MP4_TrackChunk( p_track, i_chunk )->i_sample_first )
                 i_chunk--;
         }
         else
         {
-            while( i_chunk < p_track->i_chunk_count - 1 &&
-                   i_sync_sample >= p_track->chunk[i_chunk].i_sample_first +
-                                    p_track->chunk[i_chunk].i_sample_count )
+            while( i_chunk < p_track->i_chunk_count - 1 )
+            {
+                ck = MP4_TrackChunk( p_track, i_chunk );
+                if( i_sync_sample < ck->i_sample_first + ck->i_sample_count )
+                    break;
                 i_chunk++;
+            }
         }
         i_sample = i_sync_sample;
     }
@@ -3225,9 +3632,10 @@ static int TrackGotoChunkSample( demux_t *p_demux, mp4_track_t *p_track,
     bool b_reselect = false;
 
     /* now see if actual es is ok */
+    const uint32_t i_sd_index = p_track->i_chunk < p_track->i_chunk_count
+        ? MP4_TrackChunk( p_track, p_track->i_chunk )->i_sample_description_index : 0;
     if( p_track->i_chunk >= p_track->i_chunk_count ||
-        p_track->chunk[p_track->i_chunk].i_sample_description_index !=
-            p_track->chunk[i_chunk].i_sample_description_index )
+        i_sd_index != MP4_TrackChunk( p_track, i_chunk )->i_sample_description_index )
     {
         msg_Warn( p_demux, "recreate ES for track[Id 0x%x]",
                   p_track->i_track_ID );
@@ -3257,7 +3665,8 @@ static int TrackGotoChunkSample( demux_t *p_demux, mp4_track_t *p_track,
     }
 
     p_track->i_chunk    = i_chunk;
-    p_track->chunk[i_chunk].i_sample = i_sample - p_track->chunk[i_chunk].i_sample_first;
+    mp4_chunk_t *ck = MP4_TrackChunk( p_track, i_chunk );
+    ck->i_sample = i_sample - ck->i_sample_first;
     p_track->i_sample   = i_sample;
 
     return p_track->b_selected ? VLC_SUCCESS : VLC_EGENERIC;
@@ -3514,8 +3923,16 @@ static void MP4_TrackSetup( demux_t *p_demux, mp4_track_t *p_track,
     }
 
     /* Create chunk index table and sample index table */
-    if( TrackCreateChunksIndex( p_demux,p_track  ) ||
-        TrackCreateSamplesIndex( p_demux, p_track ) )
+    if( p_sys->b_lazy_index )
+    {
+        if( TrackCreateLazyIndex( p_demux, p_track ) )
+        {
+            msg_Err( p_demux, "cannot create lazy index" );
+            return;
+        }
+    }
+    else if( TrackCreateChunksIndex( p_demux,p_track  ) ||
+             TrackCreateSamplesIndex( p_demux, p_track ) )
     {
         msg_Err( p_demux, "cannot create chunks index" );
         return; /* cannot create chunks index */
@@ -3633,16 +4050,22 @@ static void MP4_TrackClean( es_out_t *out, mp4_track_t *p_track )
     if( p_track->p_es )
         es_out_Del( out, p_track->p_es );
 
-    if( p_track->chunk )
+    if( p_track->p_chunk_index )
+    {
+        /* the window chunks only point to the window tables */
+        free( p_track->chunk_window.p_sample_count_dts );
+        free( p_track->chunk_window.p_sample_delta_dts );
+        free( p_track->chunk_window.p_sample_count_pts );
+        free( p_track->chunk_window.p_sample_offset_pts );
+        free( p_track->p_chunk_index );
+    }
+    else if( p_track->chunk )
     {
         for( unsigned int i_chunk = 0; i_chunk < p_track->i_chunk_count; i_chunk++ )
             DestroyChunk( &p_track->chunk[i_chunk] );
     }
     free( p_track->chunk );
 
-    if( !p_track->i_sample_size )
-        free( p_track->p_sample_size );
-
     if ( p_track->asfinfo.p_frame )
         block_ChainRelease( p_track->asfinfo.p_frame );
 
@@ -3767,7 +4190,7 @@ static uint32_t MP4_TrackGetReadSize( mp4_track_t *p_track, uint32_t *pi_nb_samp
     else
     {
         const MP4_Box_data_sample_soun_t *p_soun = p_track->p_sample->data.p_sample_soun;
-        const mp4_chunk_t *p_chunk = &p_track->chunk[p_track->i_chunk];
+        const mp4_chunk_t *p_chunk = MP4_TrackChunk( p_track, p_track->i_chunk );
         uint32_t i_max_samples = p_chunk->i_sample_count - p_chunk->i_sample;
 
         /* Group audio packets so we don't call demux for single sample unit */
@@ -3911,8 +4334,9 @@ static uint64_t MP4_TrackGetPos( mp4_track_t *p_track )
 {
     unsigned int i_sample;
     uint64_t i_pos;
+    const mp4_chunk_t *p_chunk = MP4_TrackChunk( p_track, p_track->i_chunk );
 
-    i_pos = p_track->chunk[p_track->i_chunk].i_offset;
+    i_pos = p_chunk->i_offset;
 
     if( p_track->i_sample_size )
     {
@@ -3927,11 +4351,11 @@ static uint64_t MP4_TrackGetPos( mp4_track_t *p_track )
             {
             case VLC_CODEC_GSM: /* # Samples > data size */
                 i_pos += ( p_track->i_sample -
-                           p_track->chunk[p_track->i_chunk].i_sample_first ) / 160 * 33;
+                           p_chunk->i_sample_first ) / 160 * 33;
                 return i_pos;
             case VLC_CODEC_ADPCM_IMA_QT: /* # Samples > data size */
                 i_pos += ( p_track->i_sample -
-                           p_track->chunk[p_track->i_chunk].i_sample_first ) / 64 * 34;
+                           p_chunk->i_sample_first ) / 64 * 34;
                 return i_pos;
             default:
                 break;
@@ -3943,19 +4367,19 @@ static uint64_t MP4_TrackGetPos( mp4_track_t *p_track )
             p_soun->i_sample_per_packet * p_soun->i_bytes_per_frame == 0 )
         {
             i_pos += ( p_track->i_sample -
-                       p_track->chunk[p_track->i_chunk].i_sample_first ) *
+                       p_chunk->i_sample_first ) *
                      MP4_GetFixedSampleSize( p_track, p_soun );
         }
         else
         {
             /* we read chunk by chunk unless a blockalign is requested */
-            i_pos += ( p_track->i_sample - p_track->chunk[p_track->i_chunk].i_sample_first ) /
+            i_pos += ( p_track->i_sample - p_chunk->i_sample_first ) /
                         p_soun->i_sample_per_packet * p_soun->i_bytes_per_frame;
         }
     }
     else
     {
-        for( i_sample = p_track->chunk[p_track->i_chunk].i_sample_first;
+        for( i_sample = p_chunk->i_sample_first;
              i_sample < p_track->i_sample; i_sample++ )
         {
             i_pos += p_track->p_sample_size[i_sample];
@@ -3979,9 +4403,8 @@ static int MP4_TrackNextSample( demux_t *p_demux, mp4_track_t *p_track, uint32_t
         return VLC_EGENERIC;
 
     /* Have we changed chunk ? */
-    if( p_track->i_sample >=
-            p_track->chunk[p_track->i_chunk].i_sample_first +
-            p_track->chunk[p_track->i_chunk].i_sample_count )
+    const mp4_chunk_t *ck = MP4_TrackChunk( p_track, p_track->i_chunk );
+    if( p_track->i_sample >= ck->i_sample_first + ck->i_sample_count )
     {
         if( TrackGotoChunkSample( p_demux, p_track, p_track->i_chunk + 1,
                                   p_track->i_sample ) )
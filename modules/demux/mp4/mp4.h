@@ -61,6 +61,33 @@ typedef struct
 
 } mp4_chunk_t;
 
+/* Sample tables decoding state at the first chunk of a window of chunks */
+typedef struct
+{
+    uint32_t     i_sample_first;
+    uint64_t     i_first_dts;
+    uint32_t     i_stsc_index;  /* stsc entry in use */
+    uint32_t     i_stts_index;
+    uint32_t     i_stts_used;   /* samples of the stts entry already passed */
+    uint32_t     i_ctts_index;
+    uint32_t     i_ctts_used;
+} mp4_chunk_index_t;
+
+/* Decoded window of chunks, all sharing the same tables storage */
+typedef struct
+{
+    uint32_t     i_first;       /* first chunk of the window */
+    uint32_t     i_count;       /* number of decoded chunks */
+
+    uint32_t     i_dts_max;
+    uint32_t     *p_sample_count_dts;
+    uint32_t     *p_sample_delta_dts;
+
+    uint32_t     i_pts_max;
+    uint32_t     *p_sample_count_pts;
+    int32_t      *p_sample_offset_pts;
+} mp4_chunk_window_t;
+
 typedef struct
 {
     uint64_t i_offset;
@@ -117,6 +144,12 @@ typedef struct
 
     mp4_chunk_t    *chunk; /* always defined  for each chunk */
 
+    /* lazy index: chunk only holds the decoded window of chunks, which is
+       rebuilt on demand from the sparse index (one entry per window) */
+    mp4_chunk_index_t  *p_chunk_index;
+    uint32_t            i_chunk_index; /* windows indexed so far */
+    mp4_chunk_window_t  chunk_window;
+
     /* sample size, p_sample_size defined only if i_sample_size == 0
         else i_sample_size is size for all sample */
     uint32_t         i_sample_size;
@@ -34,6 +34,7 @@
 
 #include "pes.h"
 #include "ps.h"
+#include "../index_cache.h"
 
 /* TODO:
  *  - re-add pre-scanning.
@@ -334,34 +335,122 @@ static int Probe( demux_t *p_demux, bool b_end )
     return VLC_DEMUXER_SUCCESS;
 }
 
-static bool FindLength( demux_t *p_demux )
+/* Index cache payload: the first SCR, then the first and last pts of each
+ * track, as found by probing the beginning and the end of the stream */
+static bool FindLengthCacheLoad( demux_t *p_demux, demux_index_cache_t *p_cache )
 {
     demux_sys_t *p_sys = p_demux->p_sys;
+    block_t *p_block = demux_IndexCacheLoad( p_cache );
+    vlc_tick_t pi_pts[2 * PS_TK_COUNT];
+    uint64_t i_value;
+
+    if( !p_block )
+        return false;
+
+    if( p_block->i_buffer != (1 + 2 * PS_TK_COUNT) * 8 ||
+        !demux_IndexCacheGet( p_block, &i_value ) )
+    {
+        block_Release( p_block );
+        return false;
+    }
+    const vlc_tick_t i_first_scr = i_value;
+    for( int i = 0; i < 2 * PS_TK_COUNT; i++ )
+    {
+        if( !demux_IndexCacheGet( p_block, &i_value ) )
+        {
+            block_Release( p_block );
+            return false;
+        }
+        pi_pts[i] = i_value;
+    }
+    block_Release( p_block );
+
+    if( p_sys->i_first_scr == VLC_TICK_INVALID )
+        p_sys->i_first_scr = i_first_scr;
+    for( int i = 0; i < PS_TK_COUNT; i++ )
+    {
+        ps_track_t *tk = &p_sys->tk[i];
+        if( tk->i_first_pts == VLC_TICK_INVALID )
+            tk->i_first_pts = pi_pts[2 * i];
+        tk->i_last_pts = pi_pts[2 * i + 1];
+    }
+    msg_Dbg( p_demux, "stream boundaries loaded from cache" );
+    return true;
+}
+
+static void FindLengthCacheStore( demux_t *p_demux, demux_index_cache_t *p_cache )
+{
+    demux_sys_t *p_sys = p_demux->p_sys;
+    struct vlc_memstream ms;
+
+    if( vlc_memstream_open( &ms ) )
+        return;
+
+    demux_IndexCachePut( &ms, p_sys->i_first_scr );
+    for( int i = 0; i < PS_TK_COUNT; i++ )
+    {
+        demux_IndexCachePut( &ms, p_sys->tk[i].i_first_pts );
+        demux_IndexCachePut( &ms, p_sys->tk[i].i_last_pts );
+    }
+
+    if( vlc_memstream_close( &ms ) )
+        return;
+    demux_IndexCacheStore( p_cache, ms.ptr, ms.length );
+    free( ms.ptr );
+}
+
+/* Probes the timestamps at the beginning and at the end of the stream */
+static bool FindLengthProbe( demux_t *p_demux )
+{
     int64_t i_current_pos = -1, i_size = 0, i_end = 0;
 
+    /* Check beginning */
+    int i = 0;
+    i_current_pos = vlc_stream_Tell( p_demux->s );
+    while( i < 40 && Probe( p_demux, false ) > 0 ) i++;
+
+    /* Check end */
+    i_size = stream_Size( p_demux->s );
+    i_end = VLC_CLIP( i_size, 0, 200000 );
+    if( vlc_stream_Seek( p_demux->s, i_size - i_end ) == VLC_SUCCESS )
+    {
+        i = 0;
+        while( i < 400 && Probe( p_demux, true ) > 0 ) i++;
+        if( i_current_pos >= 0 &&
+            vlc_stream_Seek( p_demux->s, i_current_pos ) != VLC_SUCCESS )
+                return false;
+    }
+    else return false;
+
+    return true;
+}
+
+static bool FindLength( demux_t *p_demux )
+{
+    demux_sys_t *p_sys = p_demux->p_sys;
+
     if( !var_CreateGetBool( p_demux, "ps-trust-timestamps" ) )
         return true;
 
     if( p_sys->i_length == VLC_TICK_INVALID ) /* First time */
     {
         p_sys->i_length = VLC_TICK_0;
-        /* Check beginning */
-        int i = 0;
-        i_current_pos = vlc_stream_Tell( p_demux->s );
-        while( i < 40 && Probe( p_demux, false ) > 0 ) i++;
-
-        /* Check end */
-        i_size = stream_Size( p_demux->s );
-        i_end = VLC_CLIP( i_size, 0, 200000 );
-        if( vlc_stream_Seek( p_demux->s, i_size - i_end ) == VLC_SUCCESS )
+
+        /* The end of the stream is probed, reuse a previous probe if any */
+        demux_index_cache_t *p_cache =
+            demux_IndexCacheNew( VLC_OBJECT(p_demux), p_demux->s, "ps-length" );
+        bool b_ok = true;
+
+        if( !p_cache || !FindLengthCacheLoad( p_demux, p_cache ) )
         {
-            i = 0;
-            while( i < 400 && Probe( p_demux, true ) > 0 ) i++;
-            if( i_current_pos >= 0 &&
-                vlc_stream_Seek( p_demux->s, i_current_pos ) != VLC_SUCCESS )
-                    return false;
+            b_ok = FindLengthProbe( p_demux );
+            if( b_ok && p_cache )
+                FindLengthCacheStore( p_demux, p_cache );
         }
-        else return false;
+        if( p_cache )
+            demux_IndexCacheDelete( p_cache );
+        if( !b_ok )
+            return false;
     }
 
     /* Find the longest track */
@@ -53,6 +53,7 @@
 
 #include "../../codec/scte18.h"
 #include "../opus.h"
+#include "../index_cache.h"
 #include "../../mux/mpeg/csa.h"
 
 #ifdef HAVE_ARIBB24
@@ -118,6 +119,12 @@ static void Close ( vlc_object_t * );
 #define TS_SKIP_GHOST_PROGRAM_TEXT "Only create ES on program sending data"
 #define TS_OFFSETFIX_TEXT   "Try to fix too early PCR (or late DTS)"
 
+#define BATCH_TEXT N_("Packets per read")
+#define BATCH_LONGTEXT N_( \
+    "Number of TS packets read from the input at once and shared within a " \
+    "single buffer. Higher values reduce the per packet overhead on high " \
+    "bitrate streams. No more than the input has available is read." )
+
 #define PCR_TEXT N_("Trust in-stream PCR")
 #define PCR_LONGTEXT N_("Use the stream PCR as a reference.")
 
@@ -159,6 +166,7 @@ vlc_module_begin ()
     add_bool( "ts-pmtfix-waitdata", true, TS_SKIP_GHOST_PROGRAM_TEXT, NULL, true )
     add_bool( "ts-patfix", true, TS_PATFIX_TEXT, NULL, true )
     add_bool( "ts-pcr-offsetfix", true, TS_OFFSETFIX_TEXT, NULL, true )
+    add_integer_with_range( "ts-read-batch", 1, 1, 256, BATCH_TEXT, BATCH_LONGTEXT, true )
 
     add_obsolete_bool( "ts-silent" );
 
@@ -192,6 +200,8 @@ static bool GatherSectionsData( demux_t *p_demux, ts_pid_t *, block_t *, size_t
 static void ProgramSetPCR( demux_t *p_demux, ts_pmt_t *p_prg, stime_t i_pcr );
 
 static block_t* ReadTSPacket( demux_t *p_demux );
+static block_t* ReadTSPacketBatched( demux_t *p_demux );
+static uint64_t GetStreamPosition( demux_sys_t *p_sys );
 static int SeekToTime( demux_t *p_demux, const ts_pmt_t *, stime_t time );
 static void ReadyQueuesPostSeek( demux_t *p_demux );
 static void PCRHandle( demux_t *p_demux, ts_pid_t *, stime_t );
@@ -400,6 +410,7 @@ static int Open( vlc_object_t *p_this )
     p_sys->i_packet_size = i_packet_size;
     p_sys->i_packet_header_size = i_packet_header_size;
     p_sys->i_ts_read = 50;
+    ts_batch_Init( &p_sys->batch, var_InheritInteger( p_demux, "ts-read-batch" ) );
     p_sys->csa = NULL;
     p_sys->b_start_record = false;
 
@@ -496,6 +507,8 @@ static int Open( vlc_object_t *p_this )
 
     p_sys->b_canseek = false;
     p_sys->b_canfastseek = false;
+    p_sys->p_index_cache = NULL;
+    p_sys->b_index_cache_checked = false;
     p_sys->b_ignore_time_for_positions = var_InheritBool( p_demux, "ts-seek-percent" );
     p_sys->b_cc_check = var_InheritBool( p_demux, "ts-cc-check" );
 
@@ -558,6 +571,8 @@ static void Close( vlc_object_t *p_this )
 
     PIDRelease( p_demux, GetPID(p_sys, 0) );
 
+    ts_batch_Flush( &p_sys->batch );
+
     vlc_mutex_lock( &p_sys->csa_lock );
     if( p_sys->csa )
     {
@@ -588,6 +603,9 @@ static void Close( vlc_object_t *p_this )
     /* Clear up attachments */
     vlc_dictionary_clear( &p_sys->attachments, FreeDictAttachment, NULL );
 
+    if( p_sys->p_index_cache )
+        demux_IndexCacheDelete( p_sys->p_index_cache );
+
     free( p_sys );
 }
 
@@ -635,7 +653,7 @@ static int Demux( demux_t *p_demux )
         bool         b_frame = false;
         int          i_header = 0;
         block_t     *p_pkt;
-        if( !(p_pkt = ReadTSPacket( p_demux )) )
+        if( !(p_pkt = ReadTSPacketBatched( p_demux )) )
         {
             return VLC_DEMUXER_EOF;
         }
@@ -950,7 +968,7 @@ static int Control( demux_t *p_demux, int i_query, va_list args )
 
         if( (i64 = stream_Size( p_sys->stream) ) > 0 )
         {
-            uint64_t offset = vlc_stream_Tell( p_sys->stream );
+            uint64_t offset = GetStreamPosition( p_sys );
             *pf = (double)offset / (double)i64;
             return VLC_SUCCESS;
         }
@@ -996,11 +1014,14 @@ static int Control( demux_t *p_demux, int i_query, va_list args )
         }
 
         i64 = stream_Size( p_sys->stream );
-        if( i64 > 0 &&
-            vlc_stream_Seek( p_sys->stream, (int64_t)(i64 * f) ) == VLC_SUCCESS )
+        if( i64 > 0 )
         {
-            ReadyQueuesPostSeek( p_demux );
-            return VLC_SUCCESS;
+            ts_batch_Flush( &p_sys->batch );
+            if( vlc_stream_Seek( p_sys->stream, (int64_t)(i64 * f) ) == VLC_SUCCESS )
+            {
+                ReadyQueuesPostSeek( p_demux );
+                return VLC_SUCCESS;
+            }
         }
         break;
 
@@ -1129,9 +1150,11 @@ static int Control( demux_t *p_demux, int i_query, va_list args )
     }
 
     case DEMUX_SET_TITLE:
+        ts_batch_Flush( &p_sys->batch );
         return vlc_stream_vaControl( p_sys->stream, STREAM_SET_TITLE, args );
 
     case DEMUX_SET_SEEKPOINT:
+        ts_batch_Flush( &p_sys->batch );
         return vlc_stream_vaControl( p_sys->stream, STREAM_SET_SEEKPOINT,
                                      args );
 
@@ -1423,7 +1446,7 @@ static void SendDataChain( demux_t *p_demux, ts_es_t *p_es, block_t *p_chain )
                 {
                     if( p_extra_es->id )
                     {
-                        block_t *p_dup = block_Duplicate( p_block );
+                        block_t *p_dup = block_Share( p_block );
                         if( p_dup )
                             es_out_Send( p_demux->out, p_extra_es->id, p_dup );
                     }
@@ -1434,7 +1457,7 @@ static void SendDataChain( demux_t *p_demux, ts_es_t *p_es, block_t *p_chain )
                 {
                     if( p_es_send->id )
                     {
-                        block_t *p_dup = block_Duplicate( p_block );
+                        block_t *p_dup = block_Share( p_block );
                         if( p_dup )
                             es_out_Send( p_demux->out, p_es_send->id, p_dup );
                     }
@@ -1799,6 +1822,41 @@ static block_t* ReadTSPacket( demux_t *p_demux )
     return p_pkt;
 }
 
+static block_t* ReadTSPacketBatched( demux_t *p_demux )
+{
+    demux_sys_t *p_sys = p_demux->p_sys;
+
+    if( !ts_batch_Enabled( &p_sys->batch ) )
+        return ReadTSPacket( p_demux );
+
+    block_t *p_pkt = ts_batch_Get( &p_sys->batch );
+    if( p_pkt )
+        return p_pkt;
+
+    size_t i_skipped;
+    int i_ret = ts_batch_Fill( &p_sys->batch, p_sys->stream,
+                               p_sys->i_packet_size,
+                               p_sys->i_packet_header_size, &i_skipped );
+    if( i_skipped > 0 )
+    {
+        msg_Warn( p_demux, "lost synchro" );
+        msg_Dbg( p_demux, "skipping %zu bytes of garbage", i_skipped );
+    }
+    if( i_ret != VLC_SUCCESS )
+    {
+        msg_Dbg( p_demux, "EOF at %"PRIu64, vlc_stream_Tell( p_sys->stream ) );
+        return NULL;
+    }
+    return ts_batch_Get( &p_sys->batch );
+}
+
+/* Position of the next packet to be demuxed,
+ * not counting the packets already read ahead in batch */
+static uint64_t GetStreamPosition( demux_sys_t *p_sys )
+{
+    return vlc_stream_Tell( p_sys->stream ) - ts_batch_Pending( &p_sys->batch );
+}
+
 static stime_t GetPCR( const block_t *p_pkt )
 {
     const uint8_t *p = p_pkt->p_buffer;
@@ -1906,13 +1964,17 @@ static int SeekToTime( demux_t *p_demux, const ts_pmt_t *p_pmt, stime_t i_scaled
 
     /* Deal with common but worst binary search case */
     if( p_pmt->pcr.i_first == i_scaledtime && p_sys->b_canseek )
+    {
+        ts_batch_Flush( &p_sys->batch );
         return vlc_stream_Seek( p_sys->stream, 0 );
+    }
 
     const int64_t i_stream_size = stream_Size( p_sys->stream );
     if( !p_sys->b_canfastseek || i_stream_size < p_sys->i_packet_size )
         return VLC_EGENERIC;
 
-    const uint64_t i_initial_pos = vlc_stream_Tell( p_sys->stream );
+    const uint64_t i_initial_pos = GetStreamPosition( p_sys );
+    ts_batch_Flush( &p_sys->batch );
 
     /* Find the time position by using binary search algorithm. */
     uint64_t i_head_pos = 0;
@@ -2108,9 +2170,11 @@ static int ProbeChunk( demux_t *p_demux, int i_program, bool b_end, stime_t *pi_
 int ProbeStart( demux_t *p_demux, int i_program )
 {
     demux_sys_t *p_sys = p_demux->p_sys;
-    const uint64_t i_initial_pos = vlc_stream_Tell( p_sys->stream );
+    const uint64_t i_initial_pos = GetStreamPosition( p_sys );
     int64_t i_stream_size = stream_Size( p_sys->stream );
 
+    ts_batch_Flush( &p_sys->batch );
+
     int i_probe_count = 0;
     int64_t i_pos;
     stime_t i_pcr = -1;
@@ -2140,9 +2204,11 @@ int ProbeStart( demux_t *p_demux, int i_program )
 int ProbeEnd( demux_t *p_demux, int i_program )
 {
     demux_sys_t *p_sys = p_demux->p_sys;
-    const uint64_t i_initial_pos = vlc_stream_Tell( p_sys->stream );
+    const uint64_t i_initial_pos = GetStreamPosition( p_sys );
     int64_t i_stream_size = stream_Size( p_sys->stream );
 
+    ts_batch_Flush( &p_sys->batch );
+
     int i_probe_count = PROBE_CHUNK_COUNT;
     int64_t i_pos;
     stime_t i_pcr = -1;
@@ -2169,6 +2235,74 @@ int ProbeEnd( demux_t *p_demux, int i_program )
     return (b_found) ? VLC_SUCCESS : VLC_EGENERIC;
 }
 
+/* The index cache holds, for each probed program, its number, first pcr,
+ * first dts, last dts and last dts position */
+#define PROBE_CACHE_ENTRY_SIZE (5 * 8)
+
+void ProbeBoundaries( demux_t *p_demux, ts_pmt_t *p_pmt )
+{
+    demux_sys_t *p_sys = p_demux->p_sys;
+    block_t *p_block = NULL;
+
+    if( !p_sys->b_index_cache_checked )
+    {
+        p_sys->b_index_cache_checked = true;
+        p_sys->p_index_cache = demux_IndexCacheNew( VLC_OBJECT(p_demux),
+                                                    p_sys->stream, "ts-probe" );
+    }
+
+    if( p_sys->p_index_cache )
+        p_block = demux_IndexCacheLoad( p_sys->p_index_cache );
+
+    if( p_block )
+    {
+        for( size_t i = 0; i + PROBE_CACHE_ENTRY_SIZE <= p_block->i_buffer;
+             i += PROBE_CACHE_ENTRY_SIZE )
+        {
+            const uint8_t *p = &p_block->p_buffer[i];
+            if( GetQWLE( p ) != (uint64_t) p_pmt->i_number )
+                continue;
+
+            p_pmt->pcr.i_first     = (stime_t) GetQWLE( &p[8] );
+            p_pmt->pcr.i_first_dts = (stime_t) GetQWLE( &p[16] );
+            p_pmt->i_last_dts      = (stime_t) GetQWLE( &p[24] );
+            p_pmt->i_last_dts_byte = GetQWLE( &p[32] );
+            block_Release( p_block );
+            msg_Dbg( p_demux, "program %d boundaries loaded from cache",
+                     p_pmt->i_number );
+            return;
+        }
+    }
+
+    ProbeStart( p_demux, p_pmt->i_number );
+    ProbeEnd( p_demux, p_pmt->i_number );
+
+    if( p_sys->p_index_cache )
+    {
+        struct vlc_memstream ms;
+
+        if( vlc_memstream_open( &ms ) == 0 )
+        {
+            if( p_block )
+                vlc_memstream_write( &ms, p_block->p_buffer, p_block->i_buffer -
+                                     p_block->i_buffer % PROBE_CACHE_ENTRY_SIZE );
+            demux_IndexCachePut( &ms, p_pmt->i_number );
+            demux_IndexCachePut( &ms, p_pmt->pcr.i_first );
+            demux_IndexCachePut( &ms, p_pmt->pcr.i_first_dts );
+            demux_IndexCachePut( &ms, p_pmt->i_last_dts );
+            demux_IndexCachePut( &ms, p_pmt->i_last_dts_byte );
+            if( vlc_memstream_close( &ms ) == 0 )
+            {
+                demux_IndexCacheStore( p_sys->p_index_cache, ms.ptr, ms.length );
+                free( ms.ptr );
+            }
+        }
+    }
+
+    if( p_block )
+        block_Release( p_block );
+}
+
 static void ProgramSetPCR( demux_t *p_demux, ts_pmt_t *p_pmt, stime_t i_pcr )
 {
     demux_sys_t *p_sys = p_demux->p_sys;
@@ -2214,14 +2348,14 @@ static void ProgramSetPCR( demux_t *p_demux, ts_pmt_t *p_pmt, stime_t i_pcr )
         es_out_Control( p_demux->out, ES_OUT_SET_GROUP_PCR, p_pmt->i_number, FROM_SCALE(i_pcr) );
         /* growing files/named fifo handling */
         if( p_sys->b_access_control == false &&
-            vlc_stream_Tell( p_sys->stream ) > p_pmt->i_last_dts_byte )
+            GetStreamPosition( p_sys ) > p_pmt->i_last_dts_byte )
         {
             if( p_pmt->i_last_dts_byte == 0 ) /* first run */
                 p_pmt->i_last_dts_byte = stream_Size( p_sys->stream );
             else
             {
                 p_pmt->i_last_dts = i_pcr;
-                p_pmt->i_last_dts_byte = vlc_stream_Tell( p_sys->stream );
+                p_pmt->i_last_dts_byte = GetStreamPosition( p_sys );
             }
         }
     }
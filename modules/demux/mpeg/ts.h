@@ -25,6 +25,8 @@
 #endif
 typedef struct csa_t csa_t;
 
+#include "ts_batch.h"
+
 #define TS_USER_PMT_NUMBER (0)
 
 #define TS_PSI_PAT_PID 0x00
@@ -70,6 +72,9 @@ struct demux_sys_t
     /* how many TS packet we read at once */
     unsigned    i_ts_read;
 
+    /* read ahead packets, when reading in batches */
+    ts_batch_t  batch;
+
     bool        b_cc_check;
     bool        b_ignore_time_for_positions;
 
@@ -140,6 +145,10 @@ struct demux_sys_t
 
     /* */
     bool        b_start_record;
+
+    /* boundaries of the programs, kept across opens */
+    struct demux_index_cache_t *p_index_cache;
+    bool        b_index_cache_checked;
 };
 
 void TsChangeStandard( demux_sys_t *, ts_standards_e );
@@ -150,6 +159,7 @@ void UpdatePESFilters( demux_t *p_demux, bool b_all );
 
 int ProbeStart( demux_t *p_demux, int i_program );
 int ProbeEnd( demux_t *p_demux, int i_program );
+void ProbeBoundaries( demux_t *p_demux, ts_pmt_t *p_pmt );
 
 void AddAndCreateES( demux_t *p_demux, ts_pid_t *pid, bool b_create_delayed );
 int FindPCRCandidate( ts_pmt_t *p_pmt );
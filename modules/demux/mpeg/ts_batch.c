@@ -0,0 +1,229 @@
+/*****************************************************************************
+ * ts_batch.c : MPEG TS batched packets reader
+ *****************************************************************************
+ * Copyright (C) 2019 - VideoLAN Authors
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *****************************************************************************/
+#ifdef HAVE_CONFIG_H
+# include "config.h"
+#endif
+
+#include <vlc_common.h>
+#include <vlc_block.h>
+#include <vlc_stream.h>
+#include <vlc_atomic.h>
+
+#include "ts_batch.h"
+
+#include <assert.h>
+
+typedef struct
+{
+    block_t self;
+    ts_batch_chunk_t *p_chunk;
+    unsigned i_offset;
+} ts_batch_slice_t;
+
+struct ts_batch_chunk_t
+{
+    vlc_atomic_rc_t rc;
+    block_t *p_data;
+    unsigned i_count;
+    unsigned i_packet_size;
+    unsigned i_header_size;
+    ts_batch_slice_t slices[];
+};
+
+static void ts_batch_chunk_Release( ts_batch_chunk_t *p_chunk )
+{
+    if( !vlc_atomic_rc_dec( &p_chunk->rc ) )
+        return;
+    block_Release( p_chunk->p_data );
+    free( p_chunk );
+}
+
+static void ts_batch_slice_Release( block_t *p_block )
+{
+    ts_batch_slice_t *p_slice = container_of( p_block, ts_batch_slice_t, self );
+    ts_batch_chunk_Release( p_slice->p_chunk );
+}
+
+static const struct vlc_block_callbacks ts_batch_slice_cbs =
+{
+    ts_batch_slice_Release,
+};
+
+void ts_batch_Init( ts_batch_t *p_batch, unsigned i_max )
+{
+    p_batch->p_chunk = NULL;
+    p_batch->i_next = 0;
+    p_batch->i_max = i_max;
+    p_batch->i_carry = 0;
+}
+
+static void ts_batch_Drop( ts_batch_t *p_batch )
+{
+    if( p_batch->p_chunk )
+        ts_batch_chunk_Release( p_batch->p_chunk );
+    p_batch->p_chunk = NULL;
+    p_batch->i_next = 0;
+}
+
+void ts_batch_Flush( ts_batch_t *p_batch )
+{
+    ts_batch_Drop( p_batch );
+    p_batch->i_carry = 0;
+}
+
+size_t ts_batch_Pending( const ts_batch_t *p_batch )
+{
+    const ts_batch_chunk_t *p_chunk = p_batch->p_chunk;
+    if( !p_chunk || p_batch->i_next >= p_chunk->i_count )
+        return p_batch->i_carry;
+    /* the carried over bytes are the tail of the chunk */
+    return p_chunk->p_data->i_buffer - p_chunk->slices[p_batch->i_next].i_offset;
+}
+
+block_t * ts_batch_Get( ts_batch_t *p_batch )
+{
+    ts_batch_chunk_t *p_chunk = p_batch->p_chunk;
+    if( !p_chunk )
+        return NULL;
+
+    if( p_batch->i_next >= p_chunk->i_count )
+    {
+        ts_batch_Drop( p_batch );
+        return NULL;
+    }
+
+    ts_batch_slice_t *p_slice = &p_chunk->slices[p_batch->i_next++];
+    uint8_t *p_pkt = &p_chunk->p_data->p_buffer[p_slice->i_offset];
+
+    block_Init( &p_slice->self, &ts_batch_slice_cbs,
+                p_pkt, p_chunk->i_packet_size );
+    /* Skip header (BluRay streams), see ReadTSPacket */
+    p_slice->self.p_buffer += p_chunk->i_header_size;
+    p_slice->self.i_buffer -= p_chunk->i_header_size;
+    p_slice->p_chunk = p_chunk;
+    vlc_atomic_rc_inc( &p_chunk->rc );
+
+    return &p_slice->self;
+}
+
+/* Finds the packets of the buffer, resyncing on two consecutive sync bytes
+ * like ReadTSPacket does. This is a plain scalar scan: the cost it saves is
+ * the per packet stream read, not the sync byte check. Returns the number of
+ * bytes parsed, the remainder has to wait for more data. */
+static size_t FindPackets( ts_batch_chunk_t *p_chunk, const uint8_t *p_buf,
+                           size_t i_buf, size_t *pi_skipped )
+{
+    const unsigned i_packet_size = p_chunk->i_packet_size;
+    const uint8_t *p_sync = &p_buf[p_chunk->i_header_size];
+    size_t i_offset = 0;
+
+    while( i_offset + i_packet_size <= i_buf )
+    {
+        if( likely(p_sync[i_offset] == 0x47) )
+        {
+            p_chunk->slices[p_chunk->i_count++].i_offset = i_offset;
+            i_offset += i_packet_size;
+            continue;
+        }
+
+        size_t i_skip = i_offset + 1;
+        for( ;; i_skip++ )
+        {
+            if( i_skip + p_chunk->i_header_size + i_packet_size >= i_buf )
+            {
+                /* Can't tell yet */
+                *pi_skipped += i_skip - i_offset;
+                return i_skip;
+            }
+            if( p_sync[i_skip] == 0x47 && p_sync[i_skip + i_packet_size] == 0x47 )
+                break;
+        }
+        *pi_skipped += i_skip - i_offset;
+        i_offset = i_skip;
+    }
+    return i_offset;
+}
+
+int ts_batch_Fill( ts_batch_t *p_batch, stream_t *s,
+                   unsigned i_packet_size, unsigned i_header_size,
+                   size_t *pi_skipped )
+{
+    assert( i_packet_size > i_header_size );
+    assert( i_packet_size * 2 <= sizeof(p_batch->carry) );
+    ts_batch_Drop( p_batch );
+    *pi_skipped = 0;
+
+    /* Room for the carried over bytes and at least one more packet */
+    const size_t i_size = __MAX( p_batch->i_max, 3 ) * i_packet_size;
+    const unsigned i_slices = i_size / i_packet_size;
+
+    ts_batch_chunk_t *p_chunk = malloc( sizeof(*p_chunk) +
+                                        i_slices * sizeof(ts_batch_slice_t) );
+    if( unlikely(!p_chunk) )
+        return VLC_ENOMEM;
+    p_chunk->p_data = block_Alloc( i_size );
+    if( unlikely(!p_chunk->p_data) )
+    {
+        free( p_chunk );
+        return VLC_ENOMEM;
+    }
+    vlc_atomic_rc_init( &p_chunk->rc );
+    p_chunk->i_count = 0;
+    p_chunk->i_packet_size = i_packet_size;
+    p_chunk->i_header_size = i_header_size;
+
+    uint8_t *p_buf = p_chunk->p_data->p_buffer;
+    size_t i_buf = p_batch->i_carry;
+    memcpy( p_buf, p_batch->carry, i_buf );
+    p_batch->i_carry = 0;
+
+    /* Only take what the input has at hand, rather than waiting for a
+     * complete batch which could take long on low bitrate live streams */
+    while( p_chunk->i_count == 0 )
+    {
+        ssize_t i_read = vlc_stream_ReadPartial( s, &p_buf[i_buf],
+                                                 i_size - i_buf );
+        if( i_read <= 0 )
+        {
+            /* EOF or read error, like ReadTSPacket: no packet was gathered
+             * yet (or the loop would have ended), drop the partial one */
+            block_Release( p_chunk->p_data );
+            free( p_chunk );
+            return VLC_EGENERIC;
+        }
+        i_buf += i_read;
+
+        size_t i_parsed = FindPackets( p_chunk, p_buf, i_buf, pi_skipped );
+        if( p_chunk->i_count == 0 )
+        {
+            /* Garbage only, keep the part that may hold a packet */
+            memmove( p_buf, &p_buf[i_parsed], i_buf - i_parsed );
+            i_buf -= i_parsed;
+            continue;
+        }
+
+        p_batch->i_carry = i_buf - i_parsed;
+        memcpy( p_batch->carry, &p_buf[i_parsed], p_batch->i_carry );
+    }
+
+    p_chunk->p_data->i_buffer = i_buf;
+    p_batch->p_chunk = p_chunk;
+    p_batch->i_next = 0;
+    return VLC_SUCCESS;
+}
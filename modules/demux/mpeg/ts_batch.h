@@ -0,0 +1,61 @@
+/*****************************************************************************
+ * ts_batch.h : MPEG TS batched packets reader
+ *****************************************************************************
+ * Copyright (C) 2019 - VideoLAN Authors
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *****************************************************************************/
+#ifndef VLC_TS_BATCH_H
+#define VLC_TS_BATCH_H
+
+/* Reads many TS packets with a single stream call into one shared buffer,
+ * then hands them out as lightweight blocks pointing into that buffer.
+ * The buffer is released once the last packet slice has been released, so
+ * it is kept small: a packet held downstream pins all of it. */
+
+typedef struct ts_batch_chunk_t ts_batch_chunk_t;
+
+typedef struct
+{
+    ts_batch_chunk_t *p_chunk; /* current chunk, NULL if none */
+    unsigned i_next;           /* next slice to hand out */
+    unsigned i_max;            /* packets per read, <= 1 disables batching */
+    unsigned i_carry;          /* bytes read after the last packet */
+    uint8_t  carry[512];
+} ts_batch_t;
+
+void ts_batch_Init( ts_batch_t *, unsigned i_max );
+
+/* Drops the data that has been read but not handed out yet */
+void ts_batch_Flush( ts_batch_t * );
+
+static inline bool ts_batch_Enabled( const ts_batch_t *p_batch )
+{
+    return p_batch->i_max > 1;
+}
+
+/* Number of bytes read ahead from the stream and not handed out yet */
+size_t ts_batch_Pending( const ts_batch_t * );
+
+/* Returns the next packet of the current chunk, or NULL if exhausted */
+block_t * ts_batch_Get( ts_batch_t * );
+
+/* Reads a new chunk of packets from the stream, up to what is available,
+ * resyncing if needed. Returns VLC_SUCCESS if at least one packet was read,
+ * and the number of bytes of garbage skipped to find them. */
+int ts_batch_Fill( ts_batch_t *, stream_t *,
+                   unsigned i_packet_size, unsigned i_header_size,
+                   size_t *pi_skipped );
+
+#endif
@@ -2146,8 +2146,7 @@ static void PMTCallBack( void *data, dvbpsi_pmt_t *p_dvbpsipmt )
     if( p_sys->b_canfastseek && p_pmt->i_last_dts == TS_TICK_UNKNOWN )
     {
         p_pmt->i_last_dts = 0;
-        ProbeStart( p_demux, p_pmt->i_number );
-        ProbeEnd( p_demux, p_pmt->i_number );
+        ProbeBoundaries( p_demux, p_pmt );
     }
 
     dvbpsi_pmt_delete( p_dvbpsipmt );
@@ -119,6 +119,7 @@ private:
     QTreeWidgetItem *read_media_stat;
     QTreeWidgetItem *input_bitrate_stat;
     QTreeWidgetItem *input_bitrate_graph;
+    QTreeWidgetItem *lost_packets_stat;
     QTreeWidgetItem *demuxed_stat;
     QTreeWidgetItem *stream_bitrate_stat;
     QTreeWidgetItem *corrupted_stat;
@@ -678,9 +678,11 @@ void InputManager::requestArtUpdate( input_item_t *p_item, bool b_forced )
             if ( status & ( ITEM_ART_NOTFOUND|ITEM_ART_FETCHED ) )
                 return;
         }
+        /* the item is displayed: fetch its art ahead of the others */
         libvlc_ArtRequest( p_intf->obj.libvlc, p_item,
                            (b_forced) ? META_REQUEST_OPTION_SCOPE_ANY
-                                      : META_REQUEST_OPTION_NONE,
+                                        | META_REQUEST_OPTION_PRIORITY
+                                      : META_REQUEST_OPTION_PRIORITY,
                            NULL, NULL );
         /* No input will signal the cover art to update,
              * let's do it ourself */
@@ -49,7 +49,15 @@ static inline block_t *AV1_Pack_Sample(block_t *p_block)
             case AV1_OBU_TILE_LIST:
             {
                 size_t i_offset = p_obu - p_block->p_buffer;
-                if(i_offset < p_block->i_buffer - i_offset - i_obu)
+                const bool b_head = i_offset < p_block->i_buffer - i_offset - i_obu;
+                if(!b_head || i_offset > 0) /* not just skipping a leading OBU */
+                {
+                    p_block = block_MakeWritable(p_block);
+                    if(!p_block)
+                        return NULL;
+                    p_obu = &p_block->p_buffer[i_offset];
+                }
+                if(b_head)
                 {
                     memmove(&p_block->p_buffer[i_obu], p_block->p_buffer, i_offset);
                     p_block->p_buffer += i_obu;
@@ -77,6 +85,9 @@ static inline block_t *AV1_Pack_Sample(block_t *p_block)
         (void) AV1_OBUSize(p_obu, p_block->i_buffer - i_offset, &i_len);
         if(i_len)
         {
+            p_block = block_MakeWritable(p_block);
+            if(!p_block)
+                return NULL;
             memmove(&p_block->p_buffer[i_offset + i_header],
                     &p_block->p_buffer[i_offset + i_header + i_len],
                     p_block->i_buffer - i_offset - i_header - i_len);
@@ -323,6 +323,24 @@ static inline void BufferChainClean( sout_buffer_chain_t *c )
     BufferChainInit( c );
 }
 
+/* TS packets muxed back to back in a single buffer, then sent by groups;
+ * their dates and flags are kept aside until then */
+typedef struct
+{
+    vlc_tick_t  i_dts;
+    vlc_tick_t  i_length;
+    uint32_t    i_flags;
+} ts_packet_info_t;
+
+typedef struct
+{
+    block_t          *p_block; /* i_max packets of 188 bytes */
+    ts_packet_info_t *p_info;
+    int               i_count;
+    int               i_max;
+} ts_burst_t;
+
+
 typedef struct
 {
     sout_buffer_chain_t chain_pes;
@@ -381,6 +399,10 @@ typedef struct
 
     vlc_tick_t      i_pcr;  /* last PCR emited */
 
+    ts_burst_t      burst;
+    unsigned        i_burst_packets; /* packets per output block */
+    unsigned        i_burst_fill; /* packets sent in the last group */
+
     csa_t           *csa;
     int             i_csa_pkt_size;
     bool            b_crypt_audio;
@@ -473,15 +495,17 @@ static int Mux      ( sout_mux_t * );
 
 static block_t *FixPES( sout_mux_t *p_mux, block_fifo_t *p_fifo );
 static block_t *Add_ADTS( block_t *, const es_format_t * );
-static void TSSchedule  ( sout_mux_t *p_mux, sout_buffer_chain_t *p_chain_ts,
+static void TSSchedule  ( sout_mux_t *p_mux, int i_first, int i_count,
                           vlc_tick_t i_pcr_length, vlc_tick_t i_pcr_dts );
-static void TSDate      ( sout_mux_t *p_mux, sout_buffer_chain_t *p_chain_ts,
+static void TSDate      ( sout_mux_t *p_mux, int i_first, int i_count,
                           vlc_tick_t i_pcr_length, vlc_tick_t i_pcr_dts );
+static void TSSend      ( sout_mux_t *p_mux );
 static void GetPAT( sout_mux_t *p_mux, sout_buffer_chain_t *c );
 static void GetPMT( sout_mux_t *p_mux, sout_buffer_chain_t *c );
 
-static block_t *TSNew( sout_mux_t *p_mux, sout_input_sys_t *p_stream, bool b_pcr );
-static void TSSetPCR( block_t *p_ts, vlc_tick_t i_dts );
+static ts_packet_info_t *TSNew( sout_mux_t *p_mux, sout_input_sys_t *p_stream,
+                                bool b_pcr );
+static void TSSetPCR( uint8_t *p_ts, vlc_tick_t i_dts );
 
 static csa_t *csaSetup( vlc_object_t *p_this )
 {
@@ -740,6 +764,11 @@ static int Open( vlc_object_t *p_this )
 
     p_sys->b_use_key_frames = var_GetBool( p_mux, SOUT_CFG_PREFIX "use-key-frames" );
 
+    /* Output blocks must fit in the datagrams of the access output, which
+     * would otherwise split TS packets */
+    int64_t i_mtu = var_InheritInteger( p_mux->p_access, "mtu" );
+    p_sys->i_burst_packets = __MAX( i_mtu / 188, 1 );
+
     p_mux->p_sys        = p_sys;
 
     p_sys->csa = csaSetup(p_this);
@@ -778,6 +807,7 @@ static void Close( vlc_object_t * p_this )
         free( p_sys->sdt.desc[i].psz_provider );
     }
 
+    free( p_sys->burst.p_info );
     free( p_sys );
 }
 
@@ -1042,16 +1072,69 @@ static void DelStream( sout_mux_t *p_mux, sout_input_t *p_input )
     p_sys->i_pmt_version_number %= 32;
 }
 
-static void SetHeader( sout_buffer_chain_t *c,
-                        int depth )
+/* Makes room for i_more packets in the burst, which is lost on error */
+static int BurstReserve( ts_burst_t *p_burst, int i_more )
 {
-    block_t *p_ts = BufferChainPeek( c );
-    while( depth > 0 )
+    if( p_burst->i_count + i_more <= p_burst->i_max )
+        return VLC_SUCCESS;
+
+    int i_max = __MAX( p_burst->i_count + i_more, 2 * p_burst->i_max );
+    ts_packet_info_t *p_info = realloc( p_burst->p_info,
+                                        i_max * sizeof (*p_info) );
+    block_t *p_block = NULL;
+
+    if( likely(p_info != NULL) )
+    {
+        p_burst->p_info = p_info;
+        p_block = p_burst->p_block != NULL
+                ? block_Realloc( p_burst->p_block, 0, i_max * 188 )
+                : block_Alloc( i_max * 188 );
+    }
+    else if( p_burst->p_block != NULL )
+        block_Release( p_burst->p_block );
+
+    p_burst->p_block = p_block;
+    if( unlikely(p_block == NULL) )
     {
-        p_ts = p_ts->p_next;
-        depth--;
+        p_burst->i_count = p_burst->i_max = 0;
+        return VLC_ENOMEM;
     }
-    p_ts->i_flags |= BLOCK_FLAG_HEADER;
+    p_burst->i_max = i_max;
+    return VLC_SUCCESS;
+}
+
+/* Moves TS packets from a chain, the PSI tables, to the burst */
+static void BurstAppendChain( ts_burst_t *p_burst, sout_buffer_chain_t *c )
+{
+    if( BurstReserve( p_burst, c->i_depth ) != VLC_SUCCESS )
+    {
+        BufferChainClean( c );
+        return;
+    }
+
+    block_t *p_ts;
+    while( ( p_ts = BufferChainGet( c ) ) )
+    {
+        ts_packet_info_t *p_info = &p_burst->p_info[p_burst->i_count];
+
+        memcpy( &p_burst->p_block->p_buffer[188 * p_burst->i_count],
+                p_ts->p_buffer, 188 );
+        p_info->i_dts = p_ts->i_dts;
+        p_info->i_length = 0;
+        p_info->i_flags = p_ts->i_flags;
+        p_burst->i_count++;
+        block_Release( p_ts );
+    }
+}
+
+/* Whether the next TS packet of the stream starts a key frame */
+static bool TSStartsKeyFrame( const sout_input_sys_t *p_stream )
+{
+    const block_t *p_pes = p_stream->state.chain_pes.p_first;
+
+    return p_stream->state.i_pes_used <= 0 &&
+           !(p_pes->i_flags & BLOCK_FLAG_NO_KEYFRAME) &&
+           (p_pes->i_flags & BLOCK_FLAG_TYPE_I);
 }
 
 static block_t *Pack_Opus(block_t *p_data)
@@ -1160,6 +1243,10 @@ static block_t *Encap_J2K( block_t *p_data, const es_format_t *p_fmt )
     }
     else
     {
+        /* The new header overwrites the boxes in place */
+        p_data = block_MakeWritable( p_data );
+        if( unlikely(!p_data) )
+            return NULL;
         p_data->p_buffer += (i_offset - 38);
         p_data->i_buffer -= (i_offset - 38);
     }
@@ -1490,7 +1577,8 @@ static bool MuxStreams(sout_mux_t *p_mux )
     /* add overhead for PCR (not really exact) */
     i_packet_count += (8 * i_pcr_length / p_sys->i_pcr_delay + 175) / 176;
 
-    /* 3: mux PES into TS */
+    /* 3: mux PES into TS, in a single buffer */
+    ts_burst_t *p_burst = &p_sys->burst;
     BufferChainInit( &chain_ts );
     /* append PAT/PMT  -> FIXME with big pcr delay it won't have enough pat/pmt */
     bool pat_was_previous = true; //This is to prevent unnecessary double PAT/PMT insertions
@@ -1499,6 +1587,12 @@ static bool MuxStreams(sout_mux_t *p_mux )
     int i_packet_pos = 0;
     i_packet_count += chain_ts.i_depth;
     /* msg_Dbg( p_mux, "estimated pck=%d", i_packet_count ); */
+    if( BurstReserve( p_burst, i_packet_count ) != VLC_SUCCESS )
+    {
+        BufferChainClean( &chain_ts );
+        return true;
+    }
+    BurstAppendChain( p_burst, &chain_ts );
 
     const vlc_tick_t i_pcr_dts = p_pcr_stream->state.i_pes_dts;
     for (;;)
@@ -1541,42 +1635,43 @@ static bool MuxStreams(sout_mux_t *p_mux )
             p_sys->i_pcr = i_pcr_dts + packet_length;
         }
 
-        /* Build the TS packet */
-        block_t *p_ts = TSNew( p_mux, p_stream, b_pcr );
-        if( p_sys->csa != NULL &&
-             (p_input->p_fmt->i_cat != AUDIO_ES || p_sys->b_crypt_audio) &&
-             (p_input->p_fmt->i_cat != VIDEO_ES || p_sys->b_crypt_video) )
-        {
-            p_ts->i_flags |= BLOCK_FLAG_SCRAMBLED;
-        }
-        i_packet_pos++;
-
         /* Write PAT/PMT before every keyframe if use-key-frames is enabled,
          * this helps to do segmenting with livehttp-output so it can cut segment
          * and start new one with pat,pmt,keyframe*/
         if( ( p_sys->b_use_key_frames ) &&
             ( p_input->p_fmt->i_cat == VIDEO_ES ) &&
-            ( p_ts->i_flags & BLOCK_FLAG_TYPE_I ) )
+            TSStartsKeyFrame( p_stream ) )
         {
+            int startcount = 0; //We just inserted pat/pmt,so just flag it instead of adding new one
             if( likely( !pat_was_previous ) )
             {
-                int startcount = chain_ts.i_depth;
+                startcount = p_burst->i_count;
                 GetPAT( p_mux, &chain_ts );
                 GetPMT( p_mux, &chain_ts );
-                SetHeader( &chain_ts, startcount );
-                i_packet_count += (chain_ts.i_depth - startcount );
-            } else {
-                SetHeader( &chain_ts, 0); //We just inserted pat/pmt,so just flag it instead of adding new one
+                i_packet_count += chain_ts.i_depth;
+                BurstAppendChain( p_burst, &chain_ts );
             }
+            if( startcount < p_burst->i_count )
+                p_burst->p_info[startcount].i_flags |= BLOCK_FLAG_HEADER;
         }
         pat_was_previous = false;
 
-        /* */
-        BufferChainAppend( &chain_ts, p_ts );
+        /* Build the TS packet */
+        if( BurstReserve( p_burst, 1 ) != VLC_SUCCESS )
+            break;
+        ts_packet_info_t *p_ts = TSNew( p_mux, p_stream, b_pcr );
+        if( p_sys->csa != NULL &&
+             (p_input->p_fmt->i_cat != AUDIO_ES || p_sys->b_crypt_audio) &&
+             (p_input->p_fmt->i_cat != VIDEO_ES || p_sys->b_crypt_video) )
+        {
+            p_ts->i_flags |= BLOCK_FLAG_SCRAMBLED;
+        }
+        i_packet_pos++;
     }
 
     /* 4: date and send */
-    TSSchedule( p_mux, &chain_ts, i_pcr_length, i_pcr_dts );
+    TSSchedule( p_mux, 0, p_burst->i_count, i_pcr_length, i_pcr_dts );
+    TSSend( p_mux );
     return false;
 }
 
@@ -1711,67 +1806,55 @@ static block_t *Add_ADTS( block_t *p_data, const es_format_t *p_fmt )
     return p_new_block;
 }
 
-static void TSSchedule( sout_mux_t *p_mux, sout_buffer_chain_t *p_chain_ts,
+static void TSSchedule( sout_mux_t *p_mux, int i_first, int i_count,
                         vlc_tick_t i_pcr_length, vlc_tick_t i_pcr_dts )
 {
     sout_mux_sys_t  *p_sys = p_mux->p_sys;
-    sout_buffer_chain_t new_chain;
-    int i_packet_count = p_chain_ts->i_depth;
-
-    BufferChainInit( &new_chain );
+    const ts_packet_info_t *p_info = &p_sys->burst.p_info[i_first];
 
     if ( unlikely(i_pcr_length <= 0) )
     {
-        i_pcr_length = i_packet_count;
+        i_pcr_length = i_count;
     }
 
-    for (int i = 0; i < i_packet_count; i++ )
+    for (int i = 0; i < i_count; i++ )
     {
-        block_t *p_ts = BufferChainGet( p_chain_ts );
-        vlc_tick_t i_new_dts = i_pcr_dts + i_pcr_length * i / i_packet_count;
-
-        BufferChainAppend( &new_chain, p_ts );
+        vlc_tick_t i_new_dts = i_pcr_dts + i_pcr_length * i / i_count;
 
-        if (!p_ts->i_dts || p_ts->i_dts + p_sys->i_dts_delay * 2/3 >= i_new_dts)
+        if (!p_info[i].i_dts ||
+            p_info[i].i_dts + p_sys->i_dts_delay * 2/3 >= i_new_dts)
             continue;
 
-        vlc_tick_t i_max_diff = i_new_dts - p_ts->i_dts;
-        vlc_tick_t i_cut_dts = p_ts->i_dts;
+        vlc_tick_t i_max_diff = i_new_dts - p_info[i].i_dts;
+        vlc_tick_t i_cut_dts = p_info[i].i_dts;
 
-        p_ts = BufferChainPeek( p_chain_ts );
-        i++;
-        i_new_dts = i_pcr_dts + i_pcr_length * i / i_packet_count;
-        while ( p_ts != NULL && i_new_dts - p_ts->i_dts >= i_max_diff )
+        for ( i++; i < i_count; i++ )
         {
-            p_ts = BufferChainGet( p_chain_ts );
-            i_max_diff = i_new_dts - p_ts->i_dts;
-            i_cut_dts = p_ts->i_dts;
-            BufferChainAppend( &new_chain, p_ts );
-
-            p_ts = BufferChainPeek( p_chain_ts );
-            i++;
-            i_new_dts = i_pcr_dts + i_pcr_length * i / i_packet_count;
+            i_new_dts = i_pcr_dts + i_pcr_length * i / i_count;
+            if ( i_new_dts - p_info[i].i_dts < i_max_diff )
+                break;
+            i_max_diff = i_new_dts - p_info[i].i_dts;
+            i_cut_dts = p_info[i].i_dts;
         }
         msg_Dbg( p_mux, "adjusting rate at %"PRId64"/%"PRId64" (%d/%d)",
-                 i_cut_dts - i_pcr_dts, i_pcr_length, new_chain.i_depth,
-                 p_chain_ts->i_depth );
-        if ( new_chain.i_depth )
-            TSDate( p_mux, &new_chain, i_cut_dts - i_pcr_dts, i_pcr_dts );
-        if ( p_chain_ts->i_depth )
-            TSSchedule( p_mux, p_chain_ts, i_pcr_dts + i_pcr_length - i_cut_dts,
-                        i_cut_dts );
+                 i_cut_dts - i_pcr_dts, i_pcr_length, i, i_count - i );
+        TSDate( p_mux, i_first, i, i_cut_dts - i_pcr_dts, i_pcr_dts );
+        if ( i < i_count )
+            TSSchedule( p_mux, i_first + i, i_count - i,
+                        i_pcr_dts + i_pcr_length - i_cut_dts, i_cut_dts );
         return;
     }
 
-    if ( new_chain.i_depth )
-        TSDate( p_mux, &new_chain, i_pcr_length, i_pcr_dts );
+    if ( i_count )
+        TSDate( p_mux, i_first, i_count, i_pcr_length, i_pcr_dts );
 }
 
-static void TSDate( sout_mux_t *p_mux, sout_buffer_chain_t *p_chain_ts,
+static void TSDate( sout_mux_t *p_mux, int i_first, int i_packet_count,
                     vlc_tick_t i_pcr_length, vlc_tick_t i_pcr_dts )
 {
     sout_mux_sys_t  *p_sys = p_mux->p_sys;
-    int i_packet_count = p_chain_ts->i_depth;
+    ts_packet_info_t *p_info = &p_sys->burst.p_info[i_first];
+    uint8_t *p_packets = &p_sys->burst.p_block->p_buffer[188 * i_first];
 
     if ( likely(i_pcr_length / 1000 > 0) )
     {
@@ -1795,7 +1878,7 @@ static void TSDate( sout_mux_t *p_mux, sout_buffer_chain_t *p_chain_ts,
     /* msg_Dbg( p_mux, "real pck=%d", i_packet_count ); */
     for (int i = 0; i < i_packet_count; i++ )
     {
-        block_t *p_ts = BufferChainGet( p_chain_ts );
+        ts_packet_info_t *p_ts = &p_info[i];
         vlc_tick_t i_new_dts = i_pcr_dts + i_pcr_length * i / i_packet_count;
 
         p_ts->i_dts    = i_new_dts;
@@ -1804,26 +1887,84 @@ static void TSDate( sout_mux_t *p_mux, sout_buffer_chain_t *p_chain_ts,
         if( p_ts->i_flags & BLOCK_FLAG_CLOCK )
         {
             /* msg_Dbg( p_mux, "pcr=%lld ms", p_ts->i_dts / 1000 ); */
-            TSSetPCR( p_ts, p_ts->i_dts - p_sys->first_dts );
+            TSSetPCR( &p_packets[188 * i], p_ts->i_dts - p_sys->first_dts );
         }
         if( p_ts->i_flags & BLOCK_FLAG_SCRAMBLED )
         {
             vlc_mutex_lock( &p_sys->csa_lock );
-            csa_Encrypt( p_sys->csa, p_ts->p_buffer, p_sys->i_csa_pkt_size );
+            csa_Encrypt( p_sys->csa, &p_packets[188 * i], p_sys->i_csa_pkt_size );
             vlc_mutex_unlock( &p_sys->csa_lock );
         }
 
         /* latency */
         p_ts->i_dts += p_sys->i_shaping_delay * 3 / 2;
+    }
+}
+
+/* Sends the dated packets of the burst by groups of up to i_burst_packets,
+ * which share its buffer. The groups are aligned on the previous ones, so that
+ * they fill datagrams just like single packets would. A group also starts at
+ * each PAT/PMT flagged as header, for the segmenters; the alignment is kept,
+ * so that the groups on both sides still fill one datagram together. */
+static void TSSend( sout_mux_t *p_mux )
+{
+    sout_mux_sys_t *p_sys = p_mux->p_sys;
+    ts_burst_t *p_burst = &p_sys->burst;
+    const ts_packet_info_t *p_info = p_burst->p_info;
+    const int i_count = p_burst->i_count;
+    uint8_t *p_packets = p_burst->i_count ? p_burst->p_block->p_buffer : NULL;
+    unsigned i_fill = p_sys->i_burst_fill;
+
+    for( int i_first = 0, i_last; i_first < i_count; i_first = i_last )
+    {
+        block_t *p_ts;
+        uint32_t i_flags = p_info[i_first].i_flags;
+        vlc_tick_t i_length = p_info[i_first].i_length;
+
+        if( i_fill >= p_sys->i_burst_packets )
+            i_fill = 0;
+
+        for( i_last = i_first + 1; i_last < i_count &&
+             i_fill + (i_last - i_first) < p_sys->i_burst_packets &&
+             !(p_info[i_last].i_flags & BLOCK_FLAG_HEADER); i_last++ )
+        {
+            i_flags |= p_info[i_last].i_flags;
+            i_length += p_info[i_last].i_length;
+        }
+        i_fill += i_last - i_first;
+
+        /* The last group takes over the burst itself */
+        if( i_last < i_count )
+        {
+            p_ts = block_Share( p_burst->p_block );
+            if( unlikely(p_ts == NULL) )
+                continue;
+        }
+        else
+            p_ts = p_burst->p_block;
+
+        p_ts->p_buffer = &p_packets[188 * i_first];
+        p_ts->i_buffer = 188 * (i_last - i_first);
+        p_ts->i_flags  = i_flags;
+        p_ts->i_dts    = p_info[i_first].i_dts;
+        p_ts->i_length = i_length;
 
         sout_AccessOutWrite( p_mux->p_access, p_ts );
     }
+
+    if( i_count == 0 && p_burst->p_block != NULL )
+        block_Release( p_burst->p_block );
+    p_sys->i_burst_fill = i_fill;
+    p_burst->p_block = NULL;
+    p_burst->i_count = p_burst->i_max = 0;
 }
 
-static block_t *TSNew( sout_mux_t *p_mux, sout_input_sys_t *p_stream,
-                       bool b_pcr )
+/* Appends the next TS packet of the stream to the burst, which must have room
+ * for it */
+static ts_packet_info_t *TSNew( sout_mux_t *p_mux, sout_input_sys_t *p_stream,
+                                bool b_pcr )
 {
-    VLC_UNUSED(p_mux);
+    ts_burst_t *p_burst = &((sout_mux_sys_t *)p_mux->p_sys)->burst;
     block_t *p_pes = p_stream->state.chain_pes.p_first;
 
     bool b_new_pes = false;
@@ -1843,20 +1984,19 @@ static block_t *TSNew( sout_mux_t *p_mux, sout_input_sys_t *p_stream,
         b_adaptation_field = true;
     }
 
-    block_t *p_ts = block_Alloc( 188 );
-
-    if (b_new_pes && !(p_pes->i_flags & BLOCK_FLAG_NO_KEYFRAME) && p_pes->i_flags & BLOCK_FLAG_TYPE_I)
-    {
-        p_ts->i_flags |= BLOCK_FLAG_TYPE_I;
-    }
+    ts_packet_info_t *p_ts = &p_burst->p_info[p_burst->i_count];
+    uint8_t *p_buffer = &p_burst->p_block->p_buffer[188 * p_burst->i_count];
 
+    p_burst->i_count++;
+    p_ts->i_flags = TSStartsKeyFrame( p_stream ) ? BLOCK_FLAG_TYPE_I : 0;
     p_ts->i_dts = p_pes->i_dts;
+    p_ts->i_length = 0;
 
-    p_ts->p_buffer[0] = 0x47;
-    p_ts->p_buffer[1] = ( b_new_pes ? 0x40 : 0x00 ) |
+    p_buffer[0] = 0x47;
+    p_buffer[1] = ( b_new_pes ? 0x40 : 0x00 ) |
         ( ( p_stream->ts.i_pid >> 8 )&0x1f );
-    p_ts->p_buffer[2] = p_stream->ts.i_pid & 0xff;
-    p_ts->p_buffer[3] = ( b_adaptation_field ? 0x30 : 0x10 ) |
+    p_buffer[2] = p_stream->ts.i_pid & 0xff;
+    p_buffer[3] = ( b_adaptation_field ? 0x30 : 0x10 ) |
         p_stream->ts.i_continuity_counter;
 
     p_stream->ts.i_continuity_counter = (p_stream->ts.i_continuity_counter+1)%16;
@@ -1869,28 +2009,28 @@ static block_t *TSNew( sout_mux_t *p_mux, sout_input_sys_t *p_stream,
         {
             p_ts->i_flags |= BLOCK_FLAG_CLOCK;
 
-            p_ts->p_buffer[4] = 7 + i_stuffing;
-            p_ts->p_buffer[5] = 1 << 4; /* PCR_flag */
+            p_buffer[4] = 7 + i_stuffing;
+            p_buffer[5] = 1 << 4; /* PCR_flag */
             if( p_stream->ts.b_discontinuity )
             {
-                p_ts->p_buffer[5] |= 0x80; /* flag TS dicontinuity */
+                p_buffer[5] |= 0x80; /* flag TS dicontinuity */
                 p_stream->ts.b_discontinuity = false;
             }
-            memset(&p_ts->p_buffer[12], 0xff, i_stuffing);
+            memset(&p_buffer[12], 0xff, i_stuffing);
         }
         else
         {
-            p_ts->p_buffer[4] = --i_stuffing;
+            p_buffer[4] = --i_stuffing;
             if( i_stuffing-- )
             {
-                p_ts->p_buffer[5] = 0;
-                memset(&p_ts->p_buffer[6], 0xff, i_stuffing);
+                p_buffer[5] = 0;
+                memset(&p_buffer[6], 0xff, i_stuffing);
             }
         }
     }
 
     /* copy payload */
-    memcpy( &p_ts->p_buffer[188 - i_payload],
+    memcpy( &p_buffer[188 - i_payload],
             &p_pes->p_buffer[p_stream->state.i_pes_used], i_payload );
 
     p_stream->state.i_pes_used += i_payload;
@@ -1923,17 +2063,17 @@ static block_t *TSNew( sout_mux_t *p_mux, sout_input_sys_t *p_stream,
     return p_ts;
 }
 
-static void TSSetPCR( block_t *p_ts, vlc_tick_t i_dts )
+static void TSSetPCR( uint8_t *p_ts, vlc_tick_t i_dts )
 {
     int64_t i_pcr = TO_SCALE_NZ(i_dts);
 
-    p_ts->p_buffer[6]  = ( i_pcr >> 25 )&0xff;
-    p_ts->p_buffer[7]  = ( i_pcr >> 17 )&0xff;
-    p_ts->p_buffer[8]  = ( i_pcr >> 9  )&0xff;
-    p_ts->p_buffer[9]  = ( i_pcr >> 1  )&0xff;
-    p_ts->p_buffer[10] = ( i_pcr << 7  )&0x80;
-    p_ts->p_buffer[10] |= 0x7e;
-    p_ts->p_buffer[11] = 0; /* we don't set PCR extension */
+    p_ts[6]  = ( i_pcr >> 25 )&0xff;
+    p_ts[7]  = ( i_pcr >> 17 )&0xff;
+    p_ts[8]  = ( i_pcr >> 9  )&0xff;
+    p_ts[9]  = ( i_pcr >> 1  )&0xff;
+    p_ts[10] = ( i_pcr << 7  )&0x80;
+    p_ts[10] |= 0x7e;
+    p_ts[11] = 0; /* we don't set PCR extension */
 }
 
 void GetPAT( sout_mux_t *p_mux, sout_buffer_chain_t *c )
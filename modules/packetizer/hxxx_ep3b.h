@@ -19,6 +19,7 @@
  * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
  *****************************************************************************/
 #include <vlc_bits.h>
+#include "startcode_helper.h"
 
 static inline uint8_t *hxxx_ep3b_to_rbsp( uint8_t *p, uint8_t *end, unsigned *pi_prev, size_t i_count )
 {
@@ -42,6 +43,56 @@ static inline uint8_t *hxxx_ep3b_to_rbsp( uint8_t *p, uint8_t *end, unsigned *pi
     return p;
 }
 
+/* Discards the emulation prevention three bytes from p to end, writing the
+ * result to p_dst unless NULL, and returns the unescaped size.
+ * It produces the same bytes as iterating hxxx_ep3b_to_rbsp() from p. */
+static inline size_t hxxx_ep3b_unescape( uint8_t *p_dst, const uint8_t *p, const uint8_t *end )
+{
+    unsigned i_prev = 0;
+    size_t i_dst = 0;
+
+    if( p >= end )
+        return 0;
+
+    /* The first byte is never part of an escape sequence */
+    if( p_dst )
+        p_dst[i_dst] = *p;
+    i_dst++;
+    p++;
+
+    while( p < end )
+    {
+        if( !(i_prev & 0x03) )
+        {
+            /* No escape can happen before the next 00 00 03 sequence, copy
+             * up to its zeros at once. A 03 as last byte is never escaped. */
+            const uint8_t *z = p;
+            while( end - (z = startcode_FindPrefix( z, end )) > 3 && z[2] != 0x03 )
+                z++;
+            const uint8_t *z_end = (end - z > 3) ? z + 2 : end;
+            if( p_dst )
+                memcpy( &p_dst[i_dst], p, z_end - p );
+            i_dst += z_end - p;
+            p = z_end;
+            if( p == end )
+                break;
+            i_prev = 0x03;
+        }
+
+        i_prev = (i_prev << 1) | (!*p);
+        if( *p == 0x03 && ( p + 1 ) != end && (i_prev & 0x06) == 0x06 )
+        {
+            ++p;
+            i_prev = ((i_prev >> 1) << 1) | (!*p);
+        }
+        if( p_dst )
+            p_dst[i_dst] = *p;
+        i_dst++;
+        p++;
+    }
+    return i_dst;
+}
+
 #if 0
 /* Discards emulation prevention three bytes */
 static inline uint8_t * hxxx_ep3b_to_rbsp(const uint8_t *p_src, size_t i_src, size_t *pi_ret)
@@ -84,16 +135,7 @@ static void hxxx_bsfw_ep3b_ctx_init( struct hxxx_bsfw_ep3b_ctx_s *ctx )
 static size_t hxxx_ep3b_total_size( const uint8_t *p, const uint8_t *p_end )
 {
     /* compute final size */
-    unsigned i_prev = 0;
-    size_t i = 0;
-    while( p < p_end )
-    {
-        uint8_t *n = hxxx_ep3b_to_rbsp( (uint8_t *)p, (uint8_t *)p_end, &i_prev, 1 );
-        if( n > p )
-            ++i;
-        p = n;
-    }
-    return i;
+    return hxxx_ep3b_unescape( NULL, p, p_end );
 }
 
 static size_t hxxx_bsfw_byte_forward_ep3b( bs_t *s, size_t i_count )
@@ -101,7 +143,7 @@ static size_t hxxx_bsfw_byte_forward_ep3b( bs_t *s, size_t i_count )
     struct hxxx_bsfw_ep3b_ctx_s *ctx = (struct hxxx_bsfw_ep3b_ctx_s *) s->p_priv;
     if( s->p == NULL )
     {
-        ctx->i_bytesize = hxxx_ep3b_total_size( s->p_start, s->p_end );
+        /* the size is only computed if requested, see remain */
         s->p = s->p_start;
         ctx->i_bytepos = 1;
         return 1;
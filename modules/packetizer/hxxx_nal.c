@@ -27,6 +27,8 @@ static bool block_WillRealloc( block_t *p_block, ssize_t i_prebody, size_t i_bod
 {
     if( i_prebody <= 0 && i_body <= (size_t)(-i_prebody) )
         return false;
+    else if( !block_IsWritable( p_block ) )
+        return false;
     else
         return ( i_prebody + i_body <= p_block->i_size );
 }
@@ -120,7 +122,8 @@ block_t *hxxx_AnnexB_to_xVC( block_t *p_block, uint8_t i_nal_length_size )
     uint8_t *p_dest = NULL;
     const size_t i_dest = p_block->i_buffer + p_list[i_nalcount - 1].move;
 
-    if( p_list[i_nalcount - 1].move != 0 || i_nal_length_size != 4 )  /* We'll need to grow or shrink */
+    if( p_list[i_nalcount - 1].move != 0 || i_nal_length_size != 4 ||  /* We'll need to grow or shrink */
+        !block_IsWritable( p_block ) )
     {
         /* If we grow in size, try using realloc to avoid memcpy */
         if( p_list[i_nalcount - 1].move > 0 && block_WillRealloc( p_block, 0, i_dest ) )
@@ -141,6 +144,7 @@ block_t *hxxx_AnnexB_to_xVC( block_t *p_block, uint8_t i_nal_length_size )
                 goto error;
 
             p_release = p_block; /* Will be released after use */
+            block_CopyProperties( p_newblock, p_release );
             p_source = p_release->p_buffer;
             p_sourceend = &p_release->p_buffer[p_release->i_buffer];
 
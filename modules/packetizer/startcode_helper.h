@@ -22,9 +22,17 @@
 
 #include <vlc_cpu.h>
 
-#if !defined(CAN_COMPILE_SSE2) && defined(HAVE_SSE2_INTRINSICS)
+#ifdef HAVE_SSE2_INTRINSICS
    #include <emmintrin.h>
 #endif
+#if defined(HAVE_SSE2_INTRINSICS) && (defined(__clang__) || VLC_GCC_VERSION(4, 9))
+   #define STARTCODE_AVX2
+   #include <immintrin.h>
+#endif
+#if defined(__ARM_NEON) || defined(__ARM_NEON__)
+   #define STARTCODE_NEON
+   #include <arm_neon.h>
+#endif
 
 /* Looks up efficiently for an AnnexB startcode 0x00 0x00 0x01
  * by using a 4 times faster trick than single byte lookup. */
@@ -140,16 +148,181 @@ static inline const uint8_t * startcode_FindAnnexB_Bits( const uint8_t *p, const
 }
 #undef TRY_MATCH
 
-#if defined(CAN_COMPILE_SSE2) || defined(HAVE_SSE2_INTRINSICS)
+#ifdef STARTCODE_AVX2
+/* Matches the whole startcode on 32 positions at once, using unaligned
+ * loads of the 3 shifted vectors */
+__attribute__ ((__target__ ("avx2")))
+static inline const uint8_t * startcode_FindAnnexB_AVX2( const uint8_t *p, const uint8_t *end )
+{
+    const __m256i zeros = _mm256_setzero_si256();
+    const __m256i ones = _mm256_set1_epi8( 0x01 );
+
+    for( ; end - p >= 32 + 2; p += 32 )
+    {
+        const __m256i v0 = _mm256_loadu_si256( (const __m256i *)&p[0] );
+        const __m256i v1 = _mm256_loadu_si256( (const __m256i *)&p[1] );
+        const __m256i v2 = _mm256_loadu_si256( (const __m256i *)&p[2] );
+        const __m256i res = _mm256_and_si256(
+                            _mm256_and_si256( _mm256_cmpeq_epi8( v0, zeros ),
+                                              _mm256_cmpeq_epi8( v1, zeros ) ),
+                            _mm256_cmpeq_epi8( v2, ones ) );
+        const uint32_t match = _mm256_movemask_epi8( res );
+        if( match )
+            return p + vlc_ctz( match );
+    }
+
+    for( end -= 3; p <= end; p++ )
+    {
+        if( p[0] == 0 && p[1] == 0 && p[2] == 1 )
+            return p;
+    }
+
+    return NULL;
+}
+#endif
+
+#ifdef STARTCODE_NEON
+static inline const uint8_t * startcode_FindAnnexB_NEON( const uint8_t *p, const uint8_t *end )
+{
+    const uint8x16_t zeros = vdupq_n_u8( 0x00 );
+    const uint8x16_t ones = vdupq_n_u8( 0x01 );
+
+    for( ; end - p >= 16 + 2; p += 16 )
+    {
+        const uint8x16_t res = vandq_u8(
+                               vandq_u8( vceqq_u8( vld1q_u8( &p[0] ), zeros ),
+                                         vceqq_u8( vld1q_u8( &p[1] ), zeros ) ),
+                               vceqq_u8( vld1q_u8( &p[2] ), ones ) );
+        const uint64x2_t res64 = vreinterpretq_u64_u8( res );
+        if( vgetq_lane_u64( res64, 0 ) | vgetq_lane_u64( res64, 1 ) )
+            break; /* the match is within the next 16 positions */
+    }
+
+    for( end -= 3; p <= end; p++ )
+    {
+        if( p[0] == 0 && p[1] == 0 && p[2] == 1 )
+            return p;
+    }
+
+    return NULL;
+}
+#endif
+
 static inline const uint8_t * startcode_FindAnnexB( const uint8_t *p, const uint8_t *end )
 {
+#ifdef STARTCODE_AVX2
+    if (vlc_CPU_AVX2())
+        return startcode_FindAnnexB_AVX2(p, end);
+#endif
+#if defined(CAN_COMPILE_SSE2) || defined(HAVE_SSE2_INTRINSICS)
     if (vlc_CPU_SSE2())
         return startcode_FindAnnexB_SSE2(p, end);
-    else
-        return startcode_FindAnnexB_Bits(p, end);
+#endif
+#ifdef STARTCODE_NEON
+    if (vlc_CPU_ARM_NEON())
+        return startcode_FindAnnexB_NEON(p, end);
+#endif
+    return startcode_FindAnnexB_Bits(p, end);
 }
-#else
-    #define startcode_FindAnnexB startcode_FindAnnexB_Bits
+
+/* Looks up the next pair of zero bytes, which prefixes both the startcodes
+ * and the emulation prevention sequences. Returns end if none. */
+static inline const uint8_t * startcode_FindPrefix_Bits( const uint8_t *p, const uint8_t *end )
+{
+    for( ; end - p >= 4 + 1; p += 4 )
+    {
+        uint32_t x;
+        memcpy( &x, p, 4 );
+        if( !((x - 0x01010101) & (~x) & 0x80808080) )
+            continue;
+
+        /* There is a zero byte within the next 4 positions: check them,
+         * then resume the word loop if that zero byte is not a prefix */
+        for( int i = 0; i < 4; i++ )
+            if( p[i] == 0 && p[i + 1] == 0 )
+                return p + i;
+    }
+
+    for( ; end - p >= 2; p++ )
+    {
+        if( p[0] == 0 && p[1] == 0 )
+            return p;
+    }
+    return end;
+}
+
+#ifdef STARTCODE_AVX2
+__attribute__ ((__target__ ("avx2")))
+static inline const uint8_t * startcode_FindPrefix_AVX2( const uint8_t *p, const uint8_t *end )
+{
+    const __m256i zeros = _mm256_setzero_si256();
+
+    for( ; end - p >= 32 + 1; p += 32 )
+    {
+        const __m256i v0 = _mm256_loadu_si256( (const __m256i *)&p[0] );
+        const __m256i v1 = _mm256_loadu_si256( (const __m256i *)&p[1] );
+        const uint32_t match = _mm256_movemask_epi8(
+                               _mm256_and_si256( _mm256_cmpeq_epi8( v0, zeros ),
+                                                 _mm256_cmpeq_epi8( v1, zeros ) ) );
+        if( match )
+            return p + vlc_ctz( match );
+    }
+    return startcode_FindPrefix_Bits( p, end );
+}
+#endif
+
+#ifdef HAVE_SSE2_INTRINSICS
+__attribute__ ((__target__ ("sse2")))
+static inline const uint8_t * startcode_FindPrefix_SSE2( const uint8_t *p, const uint8_t *end )
+{
+    const __m128i zeros = _mm_setzero_si128();
+
+    for( ; end - p >= 16 + 1; p += 16 )
+    {
+        const __m128i v0 = _mm_loadu_si128( (const __m128i *)&p[0] );
+        const __m128i v1 = _mm_loadu_si128( (const __m128i *)&p[1] );
+        const uint32_t match = _mm_movemask_epi8(
+                               _mm_and_si128( _mm_cmpeq_epi8( v0, zeros ),
+                                              _mm_cmpeq_epi8( v1, zeros ) ) );
+        if( match )
+            return p + vlc_ctz( match );
+    }
+    return startcode_FindPrefix_Bits( p, end );
+}
+#endif
+
+#ifdef STARTCODE_NEON
+static inline const uint8_t * startcode_FindPrefix_NEON( const uint8_t *p, const uint8_t *end )
+{
+    const uint8x16_t zeros = vdupq_n_u8( 0x00 );
+
+    for( ; end - p >= 16 + 1; p += 16 )
+    {
+        const uint8x16_t res = vandq_u8( vceqq_u8( vld1q_u8( &p[0] ), zeros ),
+                                         vceqq_u8( vld1q_u8( &p[1] ), zeros ) );
+        const uint64x2_t res64 = vreinterpretq_u64_u8( res );
+        if( vgetq_lane_u64( res64, 0 ) | vgetq_lane_u64( res64, 1 ) )
+            break;
+    }
+    return startcode_FindPrefix_Bits( p, end );
+}
+#endif
+
+static inline const uint8_t * startcode_FindPrefix( const uint8_t *p, const uint8_t *end )
+{
+#ifdef STARTCODE_AVX2
+    if (vlc_CPU_AVX2())
+        return startcode_FindPrefix_AVX2(p, end);
 #endif
+#ifdef HAVE_SSE2_INTRINSICS
+    if (vlc_CPU_SSE2())
+        return startcode_FindPrefix_SSE2(p, end);
+#endif
+#ifdef STARTCODE_NEON
+    if (vlc_CPU_ARM_NEON())
+        return startcode_FindPrefix_NEON(p, end);
+#endif
+    return startcode_FindPrefix_Bits(p, end);
+}
 
 #endif
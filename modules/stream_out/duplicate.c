@@ -28,6 +28,9 @@
 # include "config.h"
 #endif
 
+#include <assert.h>
+#include <stdlib.h>
+
 #include <vlc_common.h>
 #include <vlc_plugin.h>
 #include <vlc_sout.h>
@@ -56,6 +59,68 @@ static void *Add( sout_stream_t *, const es_format_t * );
 static void  Del( sout_stream_t *, void * );
 static int   Send( sout_stream_t *, void *, block_t * );
 
+/*
+ * Threaded branches
+ *
+ * With the "threads" option, or if a branch has its own "queue" or "overflow"
+ * option, the branch runs in its own thread: Add, Del and Send are queued as
+ * commands and executed in order by the worker, so that a slow branch does not
+ * delay the others. Add waits for its command to be executed, so that an ES
+ * rejected by the branch is reported as such. When the queue is full, new
+ * blocks are handled according to the overflow policy of the branch.
+ */
+enum
+{
+    DUP_OVERFLOW_BLOCK,         /* wait for room, i.e. stall all branches */
+    DUP_OVERFLOW_DROP_OLDEST,   /* drop the oldest queued block */
+    DUP_OVERFLOW_DROP_TO_KEYFRAME, /* drop new blocks up to the next keyframe */
+};
+
+static const char *const ppsz_overflow[] = {
+    "block", "drop-oldest", "drop-to-keyframe",
+};
+
+#define DUP_QUEUE_DEFAULT 500 /* blocks */
+
+typedef struct dup_cmd_t
+{
+    struct dup_cmd_t *p_next;
+    enum { DUP_CMD_ADD, DUP_CMD_DEL, DUP_CMD_SEND } i_type;
+    struct dup_worker_id_t *id;
+    block_t          *p_block;
+} dup_cmd_t;
+
+/* ES of a threaded branch */
+typedef struct dup_worker_id_t
+{
+    void        *id;        /* ES in the branch, only used by the worker */
+    es_format_t  fmt;
+    bool         b_discontinuity; /* only used by the owner */
+    bool         b_wait_keyframe; /* only used by the owner */
+    dup_cmd_t    add, del;  /* preallocated, so that Del cannot fail */
+} dup_worker_id_t;
+
+typedef struct
+{
+    sout_stream_t   *p_stream;
+    sout_stream_t   *p_out;     /* first stream of the branch */
+    int              i_overflow; /* -1 for the default */
+    unsigned         i_max;      /* 0 for the default */
+
+    vlc_thread_t     thread;
+    vlc_mutex_t      lock;
+    vlc_cond_t       wait;       /* worker: commands available or quit */
+    vlc_cond_t       wait_space; /* owner: room in the queue */
+    dup_cmd_t       *p_first;
+    dup_cmd_t      **pp_last;
+    unsigned         i_blocks;   /* queued blocks */
+    bool             b_busy;
+    bool             b_quit;
+    uint64_t         i_dropped;
+
+    vlc_mutex_t      chain_lock; /* held while the branch is called */
+} dup_worker_t;
+
 typedef struct
 {
     int             i_nb_streams;
@@ -66,16 +131,289 @@ typedef struct
 
     int             i_nb_select;
     char            **ppsz_select;
+
+    int             i_nb_workers;
+    dup_worker_t    **pp_workers; /* NULL for branches run by the caller */
 } sout_stream_sys_t;
 
 typedef struct
 {
     int                 i_nb_ids;
-    void                **pp_ids;
+    void                **pp_ids; /* dup_worker_id_t for threaded branches */
 } sout_stream_id_sys_t;
 
 static bool ESSelected( const es_format_t *fmt, char *psz_select );
 
+/*****************************************************************************
+ * Threaded branches
+ *****************************************************************************/
+static void WorkerExecute( dup_worker_t *w, dup_cmd_t *cmd )
+{
+    dup_worker_id_t *id = cmd->id;
+
+    vlc_mutex_lock( &w->chain_lock );
+    switch( cmd->i_type )
+    {
+        case DUP_CMD_ADD:
+            /* The owner does not wait: the blocks of a rejected ES are
+             * dropped below */
+            id->id = sout_StreamIdAdd( w->p_out, &id->fmt );
+            if( id->id == NULL )
+                msg_Err( w->p_stream, "cannot add the ES (%4.4s) to a branch",
+                         (const char *)&id->fmt.i_codec );
+            break;
+
+        case DUP_CMD_DEL:
+            if( id->id != NULL )
+                sout_StreamIdDel( w->p_out, id->id );
+            es_format_Clean( &id->fmt );
+            free( id );
+            break;
+
+        case DUP_CMD_SEND:
+            if( id->id != NULL )
+                sout_StreamIdSend( w->p_out, id->id, cmd->p_block );
+            else
+                block_Release( cmd->p_block );
+            break;
+    }
+    vlc_mutex_unlock( &w->chain_lock );
+}
+
+static void *WorkerRun( void *data )
+{
+    dup_worker_t *w = data;
+
+    vlc_mutex_lock( &w->lock );
+    for( ;; )
+    {
+        while( w->p_first == NULL && !w->b_quit )
+            vlc_cond_wait( &w->wait, &w->lock );
+
+        /* The queue is drained before quitting */
+        dup_cmd_t *cmd = w->p_first;
+        if( cmd == NULL )
+            break;
+
+        w->p_first = cmd->p_next;
+        if( w->p_first == NULL )
+            w->pp_last = &w->p_first;
+        if( cmd->i_type == DUP_CMD_SEND )
+        {
+            w->i_blocks--;
+            vlc_cond_signal( &w->wait_space );
+        }
+        w->b_busy = true;
+        vlc_mutex_unlock( &w->lock );
+
+        /* Only blocks have their own command; DEL frees the ES */
+        const int i_type = cmd->i_type;
+        WorkerExecute( w, cmd );
+        if( i_type == DUP_CMD_SEND )
+            free( cmd );
+
+        vlc_mutex_lock( &w->lock );
+        w->b_busy = false;
+    }
+    vlc_mutex_unlock( &w->lock );
+
+    return NULL;
+}
+
+static dup_worker_t *WorkerNew( sout_stream_t *p_stream, sout_stream_t *p_out )
+{
+    dup_worker_t *w = malloc( sizeof( *w ) );
+    if( unlikely(w == NULL) )
+        return NULL;
+
+    w->p_stream = p_stream;
+    w->p_out = p_out;
+    w->i_overflow = -1;
+    w->i_max = 0;
+    return w;
+}
+
+static int WorkerStart( dup_worker_t *w )
+{
+    vlc_mutex_init( &w->lock );
+    vlc_cond_init( &w->wait );
+    vlc_cond_init( &w->wait_space );
+    w->p_first = NULL;
+    w->pp_last = &w->p_first;
+    w->i_blocks = 0;
+    w->b_busy = false;
+    w->b_quit = false;
+    w->i_dropped = 0;
+    vlc_mutex_init( &w->chain_lock );
+
+    if( vlc_clone( &w->thread, WorkerRun, w, VLC_THREAD_PRIORITY_OUTPUT ) )
+    {
+        vlc_mutex_destroy( &w->chain_lock );
+        vlc_cond_destroy( &w->wait_space );
+        vlc_cond_destroy( &w->wait );
+        vlc_mutex_destroy( &w->lock );
+        return VLC_EGENERIC;
+    }
+    return VLC_SUCCESS;
+}
+
+static void WorkerDelete( dup_worker_t *w )
+{
+    vlc_mutex_lock( &w->lock );
+    w->b_quit = true;
+    vlc_cond_signal( &w->wait );
+    vlc_mutex_unlock( &w->lock );
+
+    vlc_join( w->thread, NULL );
+    assert( w->p_first == NULL );
+
+    if( w->i_dropped > 0 )
+        msg_Warn( w->p_stream, "a branch dropped %"PRIu64" blocks",
+                  w->i_dropped );
+
+    vlc_mutex_destroy( &w->chain_lock );
+    vlc_cond_destroy( &w->wait_space );
+    vlc_cond_destroy( &w->wait );
+    vlc_mutex_destroy( &w->lock );
+    free( w );
+}
+
+static void WorkerQueue( dup_worker_t *w, dup_cmd_t *cmd )
+{
+    vlc_mutex_assert( &w->lock );
+
+    cmd->p_next = NULL;
+    *w->pp_last = cmd;
+    w->pp_last = &cmd->p_next;
+    if( cmd->i_type == DUP_CMD_SEND )
+        w->i_blocks++;
+    vlc_cond_signal( &w->wait );
+}
+
+static dup_worker_id_t *WorkerAdd( dup_worker_t *w, const es_format_t *p_fmt )
+{
+    dup_worker_id_t *id = malloc( sizeof( *id ) );
+    if( unlikely(id == NULL) )
+        return NULL;
+
+    if( es_format_Copy( &id->fmt, p_fmt ) != VLC_SUCCESS )
+    {
+        free( id );
+        return NULL;
+    }
+    id->id = NULL;
+    id->b_discontinuity = false;
+    id->b_wait_keyframe = false;
+    id->add.i_type = DUP_CMD_ADD;
+    id->add.id = id;
+    id->del.i_type = DUP_CMD_DEL;
+    id->del.id = id;
+
+    vlc_mutex_lock( &w->lock );
+    WorkerQueue( w, &id->add );
+    vlc_mutex_unlock( &w->lock );
+    return id;
+}
+
+static void WorkerDel( dup_worker_t *w, dup_worker_id_t *id )
+{
+    vlc_mutex_lock( &w->lock );
+    WorkerQueue( w, &id->del );
+    vlc_mutex_unlock( &w->lock );
+}
+
+static void WorkerDropped( dup_worker_t *w )
+{
+    vlc_mutex_assert( &w->lock );
+
+    if( w->i_dropped++ == 0 )
+        msg_Warn( w->p_stream, "a branch is too slow, dropping blocks" );
+}
+
+/* Drops the oldest queued block, and flags the next one of the same ES */
+static void WorkerDropOldest( dup_worker_t *w )
+{
+    dup_cmd_t **pp = &w->p_first;
+
+    while( (*pp)->i_type != DUP_CMD_SEND )
+        pp = &(*pp)->p_next;
+
+    dup_cmd_t *cmd = *pp;
+    *pp = cmd->p_next;
+    if( *pp == NULL )
+        w->pp_last = pp;
+    w->i_blocks--;
+
+    dup_cmd_t *next = cmd->p_next;
+    while( next != NULL && (next->id != cmd->id
+                         || next->i_type != DUP_CMD_SEND) )
+        next = next->p_next;
+    if( next != NULL )
+        next->p_block->i_flags |= BLOCK_FLAG_DISCONTINUITY;
+    else
+        cmd->id->b_discontinuity = true;
+
+    block_Release( cmd->p_block );
+    free( cmd );
+    WorkerDropped( w );
+}
+
+static void WorkerSend( dup_worker_t *w, dup_worker_id_t *id,
+                        block_t *p_block )
+{
+    const bool b_keyframe = id->fmt.i_cat != VIDEO_ES
+                         || (p_block->i_flags & BLOCK_FLAG_TYPE_I);
+
+    vlc_mutex_lock( &w->lock );
+    if( id->b_wait_keyframe && !b_keyframe )
+        goto drop;
+
+    if( w->i_blocks >= w->i_max )
+    {
+        switch( w->i_overflow )
+        {
+            case DUP_OVERFLOW_BLOCK:
+                while( w->i_blocks >= w->i_max )
+                    vlc_cond_wait( &w->wait_space, &w->lock );
+                break;
+            case DUP_OVERFLOW_DROP_OLDEST:
+                WorkerDropOldest( w );
+                break;
+            case DUP_OVERFLOW_DROP_TO_KEYFRAME:
+                id->b_wait_keyframe = true;
+                goto drop;
+        }
+    }
+
+    dup_cmd_t *cmd = malloc( sizeof( *cmd ) );
+    if( unlikely(cmd == NULL) )
+        goto drop;
+    cmd->i_type = DUP_CMD_SEND;
+    cmd->id = id;
+    cmd->p_block = p_block;
+
+    if( id->b_discontinuity || id->b_wait_keyframe )
+        p_block->i_flags |= BLOCK_FLAG_DISCONTINUITY;
+    id->b_discontinuity = false;
+    id->b_wait_keyframe = false;
+    WorkerQueue( w, cmd );
+    vlc_mutex_unlock( &w->lock );
+    return;
+
+drop:
+    WorkerDropped( w );
+    vlc_mutex_unlock( &w->lock );
+    block_Release( p_block );
+}
+
+static bool WorkerIsEmpty( dup_worker_t *w )
+{
+    vlc_mutex_lock( &w->lock );
+    bool b_empty = w->p_first == NULL && !w->b_busy;
+    vlc_mutex_unlock( &w->lock );
+    return b_empty;
+}
+
 /*****************************************************************************
  * Control
  *****************************************************************************/
@@ -92,12 +430,60 @@ static int Control( sout_stream_t *p_stream, int i_query, va_list args )
             void *spu_hl = va_arg(args, void *);
             for( int i = 0; i < id->i_nb_ids; i++ )
             {
-                if( id->pp_ids[i] )
+                dup_worker_t *w = p_sys->pp_workers[i];
+
+                if( !id->pp_ids[i] )
+                    continue;
+                if( w == NULL )
+                {
                     sout_StreamControl( p_sys->pp_streams[i], i_query,
                                         id->pp_ids[i], spu_hl );
+                    continue;
+                }
+
+                dup_worker_id_t *wid = id->pp_ids[i];
+                vlc_mutex_lock( &w->chain_lock );
+                if( wid->id )
+                    sout_StreamControl( p_sys->pp_streams[i], i_query,
+                                        wid->id, spu_hl );
+                vlc_mutex_unlock( &w->chain_lock );
             }
             return VLC_SUCCESS;
         }
+
+        case SOUT_STREAM_EMPTY:
+        {
+            bool *pb_empty = va_arg(args, bool *);
+            bool b_known = false;
+
+            /* Empty if every branch which knows is empty, queue included */
+            *pb_empty = true;
+            for( int i = 0; i < p_sys->i_nb_streams && *pb_empty; i++ )
+            {
+                dup_worker_t *w = p_sys->pp_workers[i];
+                bool b_empty;
+
+                if( w != NULL )
+                {
+                    b_known = true;
+                    if( !WorkerIsEmpty( w ) )
+                    {
+                        *pb_empty = false;
+                        continue;
+                    }
+                    vlc_mutex_lock( &w->chain_lock );
+                }
+                if( sout_StreamControl( p_sys->pp_streams[i], i_query,
+                                        &b_empty ) == VLC_SUCCESS )
+                {
+                    b_known = true;
+                    *pb_empty = b_empty;
+                }
+                if( w != NULL )
+                    vlc_mutex_unlock( &w->chain_lock );
+            }
+            return b_known ? VLC_SUCCESS : VLC_EGENERIC;
+        }
     }
 
     return VLC_EGENERIC;
@@ -111,6 +497,9 @@ static int Open( vlc_object_t *p_this )
     sout_stream_t     *p_stream = (sout_stream_t*)p_this;
     sout_stream_sys_t *p_sys;
     config_chain_t        *p_cfg;
+    bool               b_threads = false;
+    int                i_overflow = DUP_OVERFLOW_DROP_OLDEST;
+    unsigned           i_queue = DUP_QUEUE_DEFAULT;
 
     msg_Dbg( p_stream, "creating 'duplicate'" );
 
@@ -121,6 +510,7 @@ static int Open( vlc_object_t *p_this )
     TAB_INIT( p_sys->i_nb_streams, p_sys->pp_streams );
     TAB_INIT( p_sys->i_nb_last_streams, p_sys->pp_last_streams );
     TAB_INIT( p_sys->i_nb_select, p_sys->ppsz_select );
+    TAB_INIT( p_sys->i_nb_workers, p_sys->pp_workers );
 
     for( p_cfg = p_stream->p_cfg; p_cfg != NULL; p_cfg = p_cfg->p_next )
     {
@@ -138,6 +528,8 @@ static int Open( vlc_object_t *p_this )
                 TAB_APPEND( p_sys->i_nb_last_streams, p_sys->pp_last_streams,
                     p_last );
                 TAB_APPEND( p_sys->i_nb_select,  p_sys->ppsz_select, NULL );
+                TAB_APPEND( p_sys->i_nb_workers, p_sys->pp_workers,
+                            WorkerNew( p_stream, s ) );
             }
         }
         else if( !strncmp( p_cfg->psz_name, "select", strlen( "select" ) ) )
@@ -159,6 +551,48 @@ static int Open( vlc_object_t *p_this )
                 }
             }
         }
+        else if( !strcmp( p_cfg->psz_name, "threads" ) )
+        {
+            b_threads = p_cfg->psz_value == NULL
+                     || strtol( p_cfg->psz_value, NULL, 0 ) != 0;
+        }
+        else if( !strcmp( p_cfg->psz_name, "overflow" ) ||
+                 !strcmp( p_cfg->psz_name, "queue" ) )
+        {
+            /* Before the first destination: default for all the branches,
+             * otherwise: only for the last one (which is then threaded) */
+            dup_worker_t *w = NULL;
+            if( p_sys->i_nb_workers > 0 )
+            {
+                w = p_sys->pp_workers[p_sys->i_nb_workers - 1];
+                if( w == NULL )
+                    continue;
+            }
+
+            const char *psz = p_cfg->psz_value ? p_cfg->psz_value : "";
+            if( p_cfg->psz_name[0] == 'q' )
+            {
+                unsigned i_max = strtoul( psz, NULL, 0 );
+                if( i_max == 0 )
+                    msg_Err( p_stream, " * ignore queue size `%s'", psz );
+                else if( w != NULL )
+                    w->i_max = i_max;
+                else
+                    i_queue = i_max;
+                continue;
+            }
+
+            size_t i;
+            for( i = 0; i < ARRAY_SIZE(ppsz_overflow); i++ )
+                if( !strcmp( psz, ppsz_overflow[i] ) )
+                    break;
+            if( i == ARRAY_SIZE(ppsz_overflow) )
+                msg_Err( p_stream, " * ignore overflow policy `%s'", psz );
+            else if( w != NULL )
+                w->i_overflow = i;
+            else
+                i_overflow = i;
+        }
         else
         {
             msg_Err( p_stream, " * ignore unknown option `%s'", p_cfg->psz_name );
@@ -168,11 +602,40 @@ static int Open( vlc_object_t *p_this )
     if( p_sys->i_nb_streams == 0 )
     {
         msg_Err( p_stream, "no destination given" );
+        free( p_sys->pp_workers );
         free( p_sys );
 
         return VLC_EGENERIC;
     }
 
+    /* The branches end up in the rest of the chain, which is not reentrant */
+    const bool b_can_thread = p_stream->p_next == NULL;
+
+    for( int i = 0; i < p_sys->i_nb_workers; i++ )
+    {
+        dup_worker_t *w = p_sys->pp_workers[i];
+        if( w == NULL )
+            continue;
+
+        const bool b_threaded = b_threads || w->i_overflow >= 0 || w->i_max > 0;
+        if( w->i_overflow < 0 )
+            w->i_overflow = i_overflow;
+        if( w->i_max == 0 )
+            w->i_max = i_queue;
+
+        if( b_threaded && !b_can_thread )
+            msg_Warn( p_stream, " * output %d cannot run in its own thread "
+                      "as it is followed by another stream", i );
+        else if( b_threaded && WorkerStart( w ) == VLC_SUCCESS )
+        {
+            msg_Dbg( p_stream, " * output %d threaded, queue %u blocks, "
+                     "overflow %s", i, w->i_max, ppsz_overflow[w->i_overflow] );
+            continue;
+        }
+        free( w );
+        p_sys->pp_workers[i] = NULL;
+    }
+
     p_stream->pf_add    = Add;
     p_stream->pf_del    = Del;
     p_stream->pf_send   = Send;
@@ -194,12 +657,15 @@ static void Close( vlc_object_t * p_this )
     msg_Dbg( p_stream, "closing a duplication" );
     for( int i = 0; i < p_sys->i_nb_streams; i++ )
     {
+        if( p_sys->pp_workers[i] )
+            WorkerDelete( p_sys->pp_workers[i] );
         sout_StreamChainDelete(p_sys->pp_streams[i], p_sys->pp_last_streams[i]);
         free( p_sys->ppsz_select[i] );
     }
     free( p_sys->pp_streams );
     free( p_sys->pp_last_streams );
     free( p_sys->ppsz_select );
+    free( p_sys->pp_workers );
 
     free( p_sys );
 }
@@ -229,8 +695,13 @@ static void *Add( sout_stream_t *p_stream, const es_format_t *p_fmt )
         if( ESSelected( p_fmt, p_sys->ppsz_select[i_stream] ) )
         {
             sout_stream_t *out = p_sys->pp_streams[i_stream];
+            dup_worker_t *w = p_sys->pp_workers[i_stream];
 
-            id_new = (void*)sout_StreamIdAdd( out, p_fmt );
+            /* A threaded branch adds the ES from its thread */
+            if( w != NULL )
+                id_new = WorkerAdd( w, p_fmt );
+            else
+                id_new = (void*)sout_StreamIdAdd( out, p_fmt );
             if( id_new )
             {
                 msg_Dbg( p_stream, "    - added for output %d", i_stream );
@@ -274,7 +745,12 @@ static void Del( sout_stream_t *p_stream, void *_id )
         if( id->pp_ids[i_stream] )
         {
             sout_stream_t *out = p_sys->pp_streams[i_stream];
-            sout_StreamIdDel( out, id->pp_ids[i_stream] );
+            dup_worker_t *w = p_sys->pp_workers[i_stream];
+
+            if( w != NULL )
+                WorkerDel( w, id->pp_ids[i_stream] );
+            else
+                sout_StreamIdDel( out, id->pp_ids[i_stream] );
         }
     }
 
@@ -285,11 +761,21 @@ static void Del( sout_stream_t *p_stream, void *_id )
 /*****************************************************************************
  * Send:
  *****************************************************************************/
+static void SendBranch( sout_stream_sys_t *p_sys, int i_stream, void *id,
+                        block_t *p_buffer )
+{
+    dup_worker_t *w = p_sys->pp_workers[i_stream];
+
+    if( w != NULL )
+        WorkerSend( w, id, p_buffer );
+    else
+        sout_StreamIdSend( p_sys->pp_streams[i_stream], id, p_buffer );
+}
+
 static int Send( sout_stream_t *p_stream, void *_id, block_t *p_buffer )
 {
     sout_stream_sys_t *p_sys = p_stream->p_sys;
     sout_stream_id_sys_t *id = (sout_stream_id_sys_t *)_id;
-    sout_stream_t     *p_dup_stream;
     int               i_stream;
 
     /* Loop through the linked list of buffers */
@@ -301,21 +787,18 @@ static int Send( sout_stream_t *p_stream, void *_id, block_t *p_buffer )
 
         for( i_stream = 0; i_stream < p_sys->i_nb_streams - 1; i_stream++ )
         {
-            p_dup_stream = p_sys->pp_streams[i_stream];
-
             if( id->pp_ids[i_stream] )
             {
-                block_t *p_dup = block_Duplicate( p_buffer );
+                block_t *p_dup = block_Share( p_buffer );
 
                 if( p_dup )
-                    sout_StreamIdSend( p_dup_stream, id->pp_ids[i_stream], p_dup );
+                    SendBranch( p_sys, i_stream, id->pp_ids[i_stream], p_dup );
             }
         }
 
         if( i_stream < p_sys->i_nb_streams && id->pp_ids[i_stream] )
         {
-            p_dup_stream = p_sys->pp_streams[i_stream];
-            sout_StreamIdSend( p_dup_stream, id->pp_ids[i_stream], p_buffer );
+            SendBranch( p_sys, i_stream, id->pp_ids[i_stream], p_buffer );
         }
         else
         {
@@ -919,6 +919,15 @@ out:
  * RTP mux
  *****************************************************************************/
 
+/** Maximum RTP packet size, header included */
+static int GetMTU( sout_stream_t *p_stream )
+{
+    int i_mtu = var_InheritInteger( p_stream, "mtu" );
+    if( i_mtu <= 12 + 16 )
+        i_mtu = 576 - 20 - 8; /* pessimistic */
+    return i_mtu;
+}
+
 /**
  * Shrink the MTU down to a fixed packetization time (for audio).
  */
@@ -961,9 +970,7 @@ static void *Add( sout_stream_t *p_stream, const es_format_t *p_fmt )
         return NULL;
     id->p_stream   = p_stream;
 
-    id->i_mtu = var_InheritInteger( p_stream, "mtu" );
-    if( id->i_mtu <= 12 + 16 )
-        id->i_mtu = 576 - 20 - 8; /* pessimistic */
+    id->i_mtu = GetMTU( p_stream );
     msg_Dbg( p_stream, "maximum RTP packet size: %d bytes", id->i_mtu );
 
 #ifdef HAVE_SRTP
@@ -1802,6 +1809,11 @@ static sout_access_out_t *GrabberCreate( sout_stream_t *p_stream )
     p_grab->p_sys       = p_stream;
     p_grab->pf_seek     = NULL;
     p_grab->pf_write    = AccessOutGrabberWrite;
+
+    /* The mux sizes its output blocks from the RTP payload size: the TS
+     * packets must not be split over RTP packets (RFC 2250) */
+    var_Create( p_grab, "mtu", VLC_VAR_INTEGER );
+    var_SetInteger( p_grab, "mtu", GetMTU( p_stream ) - 12 );
     return p_grab;
 }
 
@@ -252,6 +252,10 @@ int AbstractDecodedStream::Send(block_t *p_block)
 
      if(!p_owner->b_error)
     {
+        /* The decoder may modify its input in place */
+        if(p_block && !(p_block = block_MakeWritable(p_block)))
+            return VLC_ENOMEM;
+
         int ret = p_decoder->pf_decode(p_decoder, p_block);
         switch(ret)
         {
@@ -134,7 +134,7 @@ int transcode_spu_init( sout_stream_t *p_stream, const es_format_t *p_fmt,
 
         /* open output stream */
         id->downstream_id =
-                id->pf_transcode_downstream_add( p_stream,
+                id->pf_transcode_downstream_add( p_stream, id,
                                                  &id->p_decoder->fmt_in,
                                                  transcode_encoder_format_out( id->encoder ) );
         if( !id->downstream_id )
@@ -181,6 +181,10 @@ int transcode_spu_process( sout_stream_t *p_stream,
     *out = NULL;
     bool b_error = false;
 
+    /* The decoder may modify its input in place */
+    if( in != NULL && (in = block_MakeWritable( in )) == NULL )
+        return VLC_ENOMEM;
+
     int ret = id->p_decoder->pf_decode( id->p_decoder, in );
     if( ret != VLCDEC_SUCCESS )
         return VLC_EGENERIC;
@@ -126,6 +126,10 @@
 #define HP_LONGTEXT N_( \
     "Runs the optional encoder thread at the OUTPUT priority instead of " \
     "VIDEO." )
+#define ES_THREADS_TEXT N_("Per-ES threads")
+#define ES_THREADS_LONGTEXT N_( \
+    "Decode, filter and encode each transcoded audio and video stream " \
+    "in its own thread." )
 #define POOL_TEXT N_("Picture pool size")
 #define POOL_LONGTEXT N_( "Defines how many pictures we allow to be in pool "\
     "between decoder/encoder threads when threads > 0" )
@@ -215,6 +219,8 @@ vlc_module_begin ()
         change_integer_range( 1, 1000 )
     add_bool( SOUT_CFG_PREFIX "high-priority", false, HP_TEXT, HP_LONGTEXT,
               true )
+    add_bool( SOUT_CFG_PREFIX "es-threads", false, ES_THREADS_TEXT,
+              ES_THREADS_LONGTEXT, true )
 
 vlc_module_end ()
 
@@ -224,7 +230,7 @@ static const char *const ppsz_sout_options[] = {
     "deinterlace-module", "threads", "aenc", "acodec", "ab", "alang",
     "afilter", "samplerate", "channels", "senc", "scodec", "soverlay",
     "sfilter", "high-priority", "maxwidth", "maxheight", "pool-size",
-    NULL
+    "es-threads", NULL
 };
 
 /*****************************************************************************
@@ -360,9 +366,18 @@ static void SetSPUEncoderConfig( sout_stream_t *p_stream, transcode_encoder_conf
  *****************************************************************************/
 static int Control( sout_stream_t *p_stream, int i_query, va_list args )
 {
+    sout_stream_sys_t *p_sys = p_stream->p_sys;
+
     switch( i_query )
     {
         case SOUT_STREAM_EMPTY:
+            /* The output of the ES threads is only handed over from here */
+            for( int i = 0; i < p_sys->i_workers; i++ )
+                if( !transcode_worker_Flush( p_sys->pp_workers[i]->worker ) )
+                {
+                    *va_arg( args, bool * ) = false;
+                    return VLC_SUCCESS;
+                }
             if( p_stream->p_next )
                 return sout_StreamControlVa( p_stream->p_next, i_query, args );
             break;
@@ -370,9 +385,11 @@ static int Control( sout_stream_t *p_stream, int i_query, va_list args )
         {
             sout_stream_id_sys_t *id = (sout_stream_id_sys_t *) va_arg(args, void *);
             void *spu_hl = va_arg(args, void *);
-            if( p_stream->p_next && id->downstream_id )
+            void *downstream_id = id->worker ?
+                transcode_worker_Downstream( id->worker ) : id->downstream_id;
+            if( p_stream->p_next && downstream_id )
                 return sout_StreamControl( p_stream->p_next, i_query,
-                                           id->downstream_id, spu_hl );
+                                           downstream_id, spu_hl );
             break;
         }
     }
@@ -460,6 +477,8 @@ static int Open( vlc_object_t *p_this )
         msg_Dbg( p_stream, "codec spu=%4.4s", (char *)&p_sys->senc_cfg.i_codec );
 
     p_sys->b_soverlay = var_GetBool( p_stream, SOUT_CFG_PREFIX "soverlay" );
+    p_sys->b_es_threads = var_GetBool( p_stream, SOUT_CFG_PREFIX "es-threads" );
+    TAB_INIT( p_sys->i_workers, p_sys->pp_workers );
     /* Set default size for TEXT spu non overlay conversion / updater */
     p_sys->senc_cfg.spu.i_width = (p_sys->venc_cfg.video.i_width) ? p_sys->venc_cfg.video.i_width : 1280;
     p_sys->senc_cfg.spu.i_height = (p_sys->venc_cfg.video.i_height) ? p_sys->venc_cfg.video.i_height : 720;
@@ -489,6 +508,8 @@ static void Close( vlc_object_t * p_this )
 
     transcode_encoder_config_clean( &p_sys->senc_cfg );
 
+    assert( p_sys->i_workers == 0 );
+    TAB_CLEAN( p_sys->i_workers, p_sys->pp_workers );
     free( p_sys );
 }
 
@@ -533,11 +554,15 @@ static vlc_tick_t GetMasterDrift( void *cbdata )
 {
     sout_stream_t *p_stream = cbdata;
     sout_stream_sys_t *p_sys = p_stream->p_sys;
+    vlc_tick_t i_drift = 0;
     if( p_sys->id_master_sync )
     {
-        return p_sys->id_master_sync->i_drift;
+        /* The master may be transcoded in its own thread */
+        vlc_mutex_lock( &p_sys->id_master_sync->fifo.lock );
+        i_drift = p_sys->id_master_sync->i_drift;
+        vlc_mutex_unlock( &p_sys->id_master_sync->fifo.lock );
     }
-    return 0;
+    return i_drift;
 }
 
 static int ValidateDrift( void *cbdata, vlc_tick_t i_drift )
@@ -554,10 +579,12 @@ static int ValidateDrift( void *cbdata, vlc_tick_t i_drift )
 }
 
 static void *transcode_downstream_Add( sout_stream_t *p_stream,
+                                       sout_stream_id_sys_t *id,
                                        const es_format_t *fmt_orig,
                                        const es_format_t *fmt)
 {
     sout_stream_sys_t *p_sys = p_stream->p_sys;
+    VLC_UNUSED(id);
 
     es_format_t tmp;
     es_format_Init( &tmp, fmt->i_cat, fmt->i_codec );
@@ -655,7 +682,7 @@ static void *Add( sout_stream_t *p_stream, const es_format_t *p_fmt )
     {
         msg_Dbg( p_stream, "not transcoding a stream (fcc=`%4.4s')",
                  (char*)&p_fmt->i_codec );
-        id->downstream_id = transcode_downstream_Add( p_stream, p_fmt, p_fmt );
+        id->downstream_id = transcode_downstream_Add( p_stream, id, p_fmt, p_fmt );
         id->b_transcode = false;
 
         success = id->downstream_id;
@@ -664,6 +691,19 @@ static void *Add( sout_stream_t *p_stream, const es_format_t *p_fmt )
     if(!success)
         goto error;
 
+    if( p_sys->b_es_threads && id->b_transcode &&
+        ( p_fmt->i_cat == AUDIO_ES || p_fmt->i_cat == VIDEO_ES ) )
+    {
+        transcode_process_cb pf_process = p_fmt->i_cat == AUDIO_ES ?
+            transcode_audio_process : transcode_video_process;
+
+        /* Keep going synchronously if the thread cannot be created */
+        if( !transcode_worker_New( p_stream, id, pf_process ) )
+            msg_Warn( p_stream, "cannot create transcoding thread" );
+        else
+            TAB_APPEND( p_sys->i_workers, p_sys->pp_workers, id );
+    }
+
     return id;
 
 error:
@@ -675,18 +715,29 @@ static void Del( sout_stream_t *p_stream, void *_id )
 {
     sout_stream_sys_t *p_sys = p_stream->p_sys;
     sout_stream_id_sys_t *id = (sout_stream_id_sys_t *)_id;
+
+    /* Drains the ES and hands the remaining output over */
+    const bool b_drained = id->worker != NULL;
+    if( id->worker )
+    {
+        TAB_REMOVE( p_sys->i_workers, p_sys->pp_workers, id );
+        id->downstream_id = transcode_worker_Delete( id->worker );
+    }
+
     if( id->b_transcode )
     {
         switch( id->p_decoder->fmt_in.i_cat )
         {
         case AUDIO_ES:
-            Send( p_stream, id, NULL );
+            if( !b_drained )
+                Send( p_stream, id, NULL );
             transcode_audio_clean( p_stream, id );
             if( id == p_sys->id_master_sync )
                 p_sys->id_master_sync = NULL;
             break;
         case VIDEO_ES:
-            Send( p_stream, id, NULL );
+            if( !b_drained )
+                Send( p_stream, id, NULL );
             if( id == p_sys->id_video )
                 p_sys->id_video = NULL;
             transcode_video_clean( p_stream, id );
@@ -709,6 +760,9 @@ static int Send( sout_stream_t *p_stream, void *_id, block_t *p_buffer )
     sout_stream_id_sys_t *id = (sout_stream_id_sys_t *)_id;
     block_t *p_out = NULL;
 
+    if( id->worker )
+        return transcode_worker_Send( id->worker, p_buffer );
+
     if( id->b_error )
         goto error;
 
@@ -39,12 +39,18 @@ void sout_filters_config_clean( sout_filters_config_t *p_cfg )
 }
 
 typedef struct sout_stream_id_sys_t sout_stream_id_sys_t;
+typedef struct transcode_worker_t transcode_worker_t;
 
 typedef struct
 {
     sout_stream_id_sys_t *id_video;
 
     bool                  b_soverlay;
+    bool                  b_es_threads;
+
+    /* ES with a worker thread */
+    int                   i_workers;
+    sout_stream_id_sys_t **pp_workers;
 
     /* Audio */
     transcode_encoder_config_t aenc_cfg;
@@ -73,9 +79,13 @@ struct sout_stream_id_sys_t
     /* id of the out stream */
     void *downstream_id;
     void *(*pf_transcode_downstream_add)( sout_stream_t *,
+                                          sout_stream_id_sys_t *,
                                           const es_format_t *orig,
                                           const es_format_t *current );
 
+    /* Optional decode/filter/encode thread */
+    transcode_worker_t *worker;
+
     /* Decoder */
     decoder_t       *p_decoder;
 
@@ -170,6 +180,20 @@ static inline void es_format_SetMeta( es_format_t *p_dst, const es_format_t *p_s
     }
 }
 
+/* Worker */
+
+#define TRANSCODE_WORKER_QUEUE 64 /* Input blocks queued before Send blocks */
+
+typedef int (*transcode_process_cb)( sout_stream_t *, sout_stream_id_sys_t *,
+                                     block_t *, block_t ** );
+
+transcode_worker_t *transcode_worker_New( sout_stream_t *, sout_stream_id_sys_t *,
+                                          transcode_process_cb );
+int   transcode_worker_Send  ( transcode_worker_t *, block_t * );
+bool  transcode_worker_Flush ( transcode_worker_t * );
+void *transcode_worker_Downstream( transcode_worker_t * );
+void *transcode_worker_Delete( transcode_worker_t * );
+
 /* SPU */
 
 void transcode_spu_clean  ( sout_stream_t *, sout_stream_id_sys_t * );
@@ -337,12 +337,17 @@ void transcode_video_clean( sout_stream_t *p_stream,
 void transcode_video_push_spu( sout_stream_t *p_stream, sout_stream_id_sys_t *id,
                                subpicture_t *p_subpicture )
 {
+    /* The video may be transcoded in its own thread */
+    vlc_mutex_lock( &id->fifo.lock );
     if( !id->p_spu )
         id->p_spu = spu_Create( p_stream, NULL );
-    if( !id->p_spu )
+    spu_t *p_spu = id->p_spu;
+    vlc_mutex_unlock( &id->fifo.lock );
+
+    if( !p_spu )
         subpicture_Delete( p_subpicture );
     else
-        spu_PutSubpicture( id->p_spu, p_subpicture );
+        spu_PutSubpicture( p_spu, p_subpicture );
 }
 
 int transcode_video_get_output_dimensions( sout_stream_t *p_stream, sout_stream_id_sys_t *id,
@@ -366,7 +371,10 @@ static picture_t * RenderSubpictures( sout_stream_t *p_stream, sout_stream_id_sy
 {
     VLC_UNUSED(p_stream);
 
-    if( !id->p_spu )
+    vlc_mutex_lock( &id->fifo.lock );
+    spu_t *p_spu = id->p_spu;
+    vlc_mutex_unlock( &id->fifo.lock );
+    if( !p_spu )
         return p_pic;
 
     /* Check if we have a subpicture to overlay */
@@ -383,7 +391,7 @@ static picture_t * RenderSubpictures( sout_stream_t *p_stream, sout_stream_id_sy
         fmt.i_y_offset       = 0;
     }
 
-    subpicture_t *p_subpic = spu_Render( id->p_spu, NULL, &fmt,
+    subpicture_t *p_subpic = spu_Render( p_spu, NULL, &fmt,
                                          &outfmt,
                                          p_pic->date, p_pic->date, false, false );
 
@@ -403,7 +411,7 @@ static picture_t * RenderSubpictures( sout_stream_t *p_stream, sout_stream_id_sy
             }
         }
         if( unlikely( !id->p_spu_blender ) )
-            id->p_spu_blender = filter_NewBlend( VLC_OBJECT( id->p_spu ), &fmt );
+            id->p_spu_blender = filter_NewBlend( VLC_OBJECT( p_spu ), &fmt );
         if( likely( id->p_spu_blender ) )
             picture_BlendSubpicture( p_pic, id->p_spu_blender, p_subpic );
         subpicture_Delete( p_subpic );
@@ -432,6 +440,10 @@ int transcode_video_process( sout_stream_t *p_stream, sout_stream_id_sys_t *id,
 
     const bool b_eos = in && (in->i_flags & BLOCK_FLAG_END_OF_SEQUENCE);
 
+    /* The decoder may modify its input in place */
+    if( in != NULL && (in = block_MakeWritable( in )) == NULL )
+        return VLC_ENOMEM;
+
     int ret = id->p_decoder->pf_decode( id->p_decoder, in );
     if( ret != VLCDEC_SUCCESS )
         return VLC_EGENERIC;
@@ -513,7 +525,7 @@ int transcode_video_process( sout_stream_t *p_stream, sout_stream_id_sys_t *id,
 
             if( !id->downstream_id )
                 id->downstream_id =
-                    id->pf_transcode_downstream_add( p_stream,
+                    id->pf_transcode_downstream_add( p_stream, id,
                                                      &id->p_decoder->fmt_in,
                                                      transcode_encoder_format_out( id->encoder ) );
             if( !id->downstream_id )
@@ -0,0 +1,306 @@
+/*****************************************************************************
+ * worker.c: transcoding stream output module (per-ES threads)
+ *****************************************************************************
+ * Copyright (C) 2024 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+/*****************************************************************************
+ * Preamble
+ *****************************************************************************/
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <vlc_common.h>
+#include <vlc_sout.h>
+
+#include "transcode.h"
+
+/*
+ * A worker runs the decode -> filter -> encode process of one ES in its own
+ * thread. The next stream of the chain is never called from the worker: the
+ * output blocks (and the creation of the output ES) are queued and handed
+ * over by the thread calling Send, as the chain is not reentrant.
+ */
+struct transcode_worker_t
+{
+    vlc_thread_t          thread;
+    sout_stream_t        *p_stream;
+    sout_stream_id_sys_t *id;
+    transcode_process_cb  pf_process;
+
+    vlc_mutex_t lock;
+    vlc_cond_t  wait;       /* worker: input is available */
+    vlc_cond_t  wait_owner; /* owner: room in input, output or end */
+
+    block_t    *p_in;
+    block_t   **pp_in_last;
+    unsigned    i_in;
+    bool        b_busy;     /* a block (or the drain) is being processed */
+    bool        b_drain;
+    bool        b_done;
+    int         i_ret;
+
+    block_t    *p_out;
+    block_t   **pp_out_last;
+
+    /* Output ES creation, requested by the worker */
+    void *(*pf_downstream_add)( sout_stream_t *, sout_stream_id_sys_t *,
+                                const es_format_t *, const es_format_t * );
+    bool        b_add;
+    es_format_t fmt_orig;
+    es_format_t fmt;
+    void       *downstream_id; /* only used by the owner */
+};
+
+static void *DownstreamAdd( sout_stream_t *p_stream, sout_stream_id_sys_t *id,
+                            const es_format_t *p_orig, const es_format_t *p_fmt )
+{
+    transcode_worker_t *w = id->worker;
+    VLC_UNUSED(p_stream);
+
+    vlc_mutex_lock( &w->lock );
+    assert( !w->b_add );
+    es_format_Copy( &w->fmt_orig, p_orig );
+    es_format_Copy( &w->fmt, p_fmt );
+    w->b_add = true;
+    vlc_mutex_unlock( &w->lock );
+
+    /* Placeholder until the owner creates the actual ES */
+    return w;
+}
+
+static void *Run( void *data )
+{
+    transcode_worker_t *w = data;
+
+    vlc_mutex_lock( &w->lock );
+    for( ;; )
+    {
+        while( !w->p_in && !w->b_drain )
+            vlc_cond_wait( &w->wait, &w->lock );
+
+        /* NULL drains the decoder and encoder */
+        block_t *p_in = w->p_in;
+        if( p_in )
+        {
+            w->p_in = p_in->p_next;
+            if( !w->p_in )
+                w->pp_in_last = &w->p_in;
+            w->i_in--;
+            p_in->p_next = NULL;
+        }
+        w->b_busy = true;
+        vlc_mutex_unlock( &w->lock );
+
+        block_t *p_out = NULL;
+        int i_ret;
+        if( w->id->b_error )
+        {
+            if( p_in )
+                block_Release( p_in );
+            i_ret = VLC_EGENERIC;
+        }
+        else
+            i_ret = w->pf_process( w->p_stream, w->id, p_in, &p_out );
+
+        vlc_mutex_lock( &w->lock );
+        if( i_ret )
+            w->i_ret = i_ret;
+        block_ChainLastAppend( &w->pp_out_last, p_out );
+        w->b_busy = false;
+        if( !p_in )
+            w->b_done = true;
+        vlc_cond_signal( &w->wait_owner );
+        if( w->b_done )
+            break;
+    }
+    vlc_mutex_unlock( &w->lock );
+
+    return NULL;
+}
+
+/* Hands the pending output over to the next stream, from the owner thread */
+static int Deliver( transcode_worker_t *w )
+{
+    int i_ret = VLC_SUCCESS;
+
+    vlc_mutex_assert( &w->lock );
+
+    while( w->b_add || w->p_out )
+    {
+        const bool b_add = w->b_add;
+        block_t *p_out = w->p_out;
+
+        w->b_add = false;
+        w->p_out = NULL;
+        w->pp_out_last = &w->p_out;
+        vlc_mutex_unlock( &w->lock );
+
+        /* The format is not touched by the worker anymore */
+        if( b_add )
+        {
+            w->downstream_id = w->pf_downstream_add( w->p_stream, w->id,
+                                                     &w->fmt_orig, &w->fmt );
+            es_format_Clean( &w->fmt_orig );
+            es_format_Clean( &w->fmt );
+        }
+
+        if( p_out )
+        {
+            if( w->downstream_id )
+            {
+                if( sout_StreamIdSend( w->p_stream->p_next, w->downstream_id, p_out ) )
+                    i_ret = VLC_EGENERIC;
+            }
+            else
+            {
+                block_ChainRelease( p_out );
+                i_ret = VLC_EGENERIC;
+            }
+        }
+
+        vlc_mutex_lock( &w->lock );
+    }
+    return i_ret;
+}
+
+transcode_worker_t *transcode_worker_New( sout_stream_t *p_stream,
+                                          sout_stream_id_sys_t *id,
+                                          transcode_process_cb pf_process )
+{
+    transcode_worker_t *w = malloc( sizeof(*w) );
+    if( !w )
+        return NULL;
+
+    w->p_stream = p_stream;
+    w->id = id;
+    w->pf_process = pf_process;
+    vlc_mutex_init( &w->lock );
+    vlc_cond_init( &w->wait );
+    vlc_cond_init( &w->wait_owner );
+    w->p_in = NULL;
+    w->pp_in_last = &w->p_in;
+    w->i_in = 0;
+    w->b_busy = false;
+    w->b_drain = false;
+    w->b_done = false;
+    w->i_ret = VLC_SUCCESS;
+    w->p_out = NULL;
+    w->pp_out_last = &w->p_out;
+    w->pf_downstream_add = id->pf_transcode_downstream_add;
+    w->b_add = false;
+    w->downstream_id = NULL;
+
+    id->worker = w;
+    id->pf_transcode_downstream_add = DownstreamAdd;
+
+    if( vlc_clone( &w->thread, Run, w, VLC_THREAD_PRIORITY_VIDEO ) )
+    {
+        id->pf_transcode_downstream_add = w->pf_downstream_add;
+        id->worker = NULL;
+        vlc_cond_destroy( &w->wait_owner );
+        vlc_cond_destroy( &w->wait );
+        vlc_mutex_destroy( &w->lock );
+        free( w );
+        return NULL;
+    }
+    return w;
+}
+
+int transcode_worker_Send( transcode_worker_t *w, block_t *p_in )
+{
+    int i_ret;
+
+    vlc_mutex_lock( &w->lock );
+
+    /* Back-pressure: the demuxer is not allowed to run too far ahead */
+    i_ret = Deliver( w );
+    while( w->i_in >= TRANSCODE_WORKER_QUEUE )
+    {
+        vlc_cond_wait( &w->wait_owner, &w->lock );
+        if( Deliver( w ) )
+            i_ret = VLC_EGENERIC;
+    }
+
+    if( p_in )
+    {
+        block_ChainLastAppend( &w->pp_in_last, p_in );
+        w->i_in++;
+        vlc_cond_signal( &w->wait );
+    }
+
+    if( w->i_ret )
+        i_ret = w->i_ret;
+    vlc_mutex_unlock( &w->lock );
+
+    return i_ret;
+}
+
+/* Hands the pending output over, and tells whether all the input queued so
+ * far was processed */
+bool transcode_worker_Flush( transcode_worker_t *w )
+{
+    vlc_mutex_lock( &w->lock );
+    Deliver( w );
+    const bool b_idle = !w->p_in && !w->b_busy;
+    vlc_mutex_unlock( &w->lock );
+
+    return b_idle;
+}
+
+/* Returns the output ES, as created by the owner: the one known to the ES
+ * is only a placeholder, written by the worker */
+void *transcode_worker_Downstream( transcode_worker_t *w )
+{
+    vlc_mutex_lock( &w->lock );
+    Deliver( w );
+    vlc_mutex_unlock( &w->lock );
+
+    return w->downstream_id;
+}
+
+void *transcode_worker_Delete( transcode_worker_t *w )
+{
+    sout_stream_id_sys_t *id = w->id;
+
+    vlc_mutex_lock( &w->lock );
+    w->b_drain = true;
+    vlc_cond_signal( &w->wait );
+    for( ;; )
+    {
+        Deliver( w );
+        if( w->b_done )
+            break;
+        vlc_cond_wait( &w->wait_owner, &w->lock );
+    }
+    Deliver( w );
+    vlc_mutex_unlock( &w->lock );
+
+    vlc_join( w->thread, NULL );
+
+    void *downstream_id = w->downstream_id;
+
+    id->pf_transcode_downstream_add = w->pf_downstream_add;
+    id->worker = NULL;
+    vlc_cond_destroy( &w->wait_owner );
+    vlc_cond_destroy( &w->wait );
+    vlc_mutex_destroy( &w->lock );
+    free( w );
+
+    return downstream_id;
+}
@@ -31,17 +31,34 @@
 #include <vlc_plugin.h>
 #include <vlc_filter.h>
 #include <vlc_picture.h>
+#include <vlc_cpu.h>
 #include "filter_picture.h"
 
+#if defined(__GNUC__) && (defined(__i386__) || defined(__x86_64__))
+# define BLEND_SIMD_X86
+# include <immintrin.h>
+#endif
+#if defined(__ARM_NEON) || defined(__ARM_NEON__)
+# define BLEND_SIMD_NEON
+# include <arm_neon.h>
+#endif
+
 /*****************************************************************************
  * Module descriptor
  *****************************************************************************/
 static int  Open (vlc_object_t *);
 static void Close(vlc_object_t *);
 
+#define SIMD_TEXT N_("Use SIMD optimizations")
+#define SIMD_LONGTEXT N_("Use the vectorized blending routines when " \
+                         "the CPU supports them")
+
 vlc_module_begin()
     set_description(N_("Video pictures blending"))
     set_capability("video blending", 100)
+    set_category(CAT_VIDEO)
+    set_subcategory(SUBCAT_VIDEO_VFILTER)
+    add_bool("blend-simd", true, SIMD_TEXT, SIMD_LONGTEXT, true)
     set_callbacks(Open, Close)
 vlc_module_end()
 
@@ -553,6 +570,443 @@ void Blend(const CPicture &dst_data, const CPicture &src_data,
     }
 }
 
+/*
+ * Whole line kernels for the most common 8 bits paths (YUVA subpictures
+ * blended onto 4:2:0/4:4:4 video, RGBA onto RGB32). They compute exactly
+ * the same values as the per pixel templates above: a fully transparent
+ * pixel is merged instead of being skipped, which is a no-op for 8 bits.
+ */
+namespace {
+
+class CPlanes : public CPicture {
+public:
+    CPlanes(const CPicture &cfg) : CPicture(cfg)
+    {
+    }
+    uint8_t *getPixels(unsigned plane, unsigned dx, unsigned dy,
+                       unsigned rx = 1, unsigned ry = 1, unsigned bytes = 1) const
+    {
+        const plane_t *p = &picture->p[plane];
+        return &p->p_pixels[(y + dy) / ry * p->i_pitch + (x + dx) / rx * bytes];
+    }
+    unsigned getX() const
+    {
+        return x;
+    }
+    unsigned getY() const
+    {
+        return y;
+    }
+};
+
+/* Scalar kernels, also used for the tails of the vector ones */
+struct KernelsC {
+    /* dst[i] blended with src[i] at srca[i] */
+    static void merge(uint8_t *dst, const uint8_t *src, const uint8_t *srca,
+                      unsigned alpha, unsigned count)
+    {
+        for (unsigned i = 0; i < count; i++)
+            ::merge(&dst[i], src[i], div255(alpha * srca[i]));
+    }
+    /* dst[i] blended with src[2 * i] at srca[2 * i] */
+    static void mergeSub2(uint8_t *dst, const uint8_t *src, const uint8_t *srca,
+                          unsigned alpha, unsigned count)
+    {
+        for (unsigned i = 0; i < count; i++)
+            ::merge(&dst[i], src[2 * i], div255(alpha * srca[2 * i]));
+    }
+    /* interleaved dst[2 * i] and dst[2 * i + 1] blended with src_0[2 * i]
+     * and src_1[2 * i] at srca[2 * i] */
+    static void mergeSub2Interleaved(uint8_t *dst, const uint8_t *src_0,
+                                     const uint8_t *src_1, const uint8_t *srca,
+                                     unsigned alpha, unsigned count)
+    {
+        for (unsigned i = 0; i < count; i++) {
+            const unsigned a = div255(alpha * srca[2 * i]);
+            ::merge(&dst[2 * i + 0], src_0[2 * i], a);
+            ::merge(&dst[2 * i + 1], src_1[2 * i], a);
+        }
+    }
+    /* 4 bytes RGBA pixels onto 4 bytes pixels, map[] giving the source
+     * component of each destination byte (or -1 to keep it) */
+    static void mergePacked32(uint8_t *dst, const uint8_t *src, const int map[4],
+                              unsigned alpha, unsigned count)
+    {
+        for (unsigned i = 0; i < count; i++) {
+            const unsigned a = div255(alpha * src[4 * i + 3]);
+            for (unsigned j = 0; j < 4; j++)
+                if (map[j] >= 0)
+                    ::merge(&dst[4 * i + j], src[4 * i + map[j]], a);
+        }
+    }
+};
+
+template <class K, unsigned bytes, bool swap_uv>
+void BlendYUVA420(const CPicture &dst_data, const CPicture &src_data,
+                  unsigned width, unsigned height, int alpha)
+{
+    const CPlanes src(src_data);
+    const CPlanes dst(dst_data);
+
+    /* First source column landing on a chroma sample */
+    const unsigned cx = dst.getX() % 2;
+    const unsigned cw = width > cx ? (width - cx + 1) / 2 : 0;
+
+    for (unsigned y = 0; y < height; y++) {
+        const uint8_t *srca = src.getPixels(3, 0, y);
+
+        K::merge(dst.getPixels(0, 0, y), src.getPixels(0, 0, y), srca,
+                 alpha, width);
+        if ((dst.getY() + y) % 2 != 0 || cw == 0)
+            continue;
+
+        const uint8_t *src_u = src.getPixels(swap_uv ? 2 : 1, cx, y);
+        const uint8_t *src_v = src.getPixels(swap_uv ? 1 : 2, cx, y);
+        if (bytes == 2) {
+            /* Semi-planar */
+            K::mergeSub2Interleaved(dst.getPixels(1, cx, y, 2, 2, 2),
+                                    src_u, src_v, srca + cx, alpha, cw);
+        } else {
+            K::mergeSub2(dst.getPixels(1, cx, y, 2, 2), src_u, srca + cx,
+                         alpha, cw);
+            K::mergeSub2(dst.getPixels(2, cx, y, 2, 2), src_v, srca + cx,
+                         alpha, cw);
+        }
+    }
+}
+
+template <class K>
+void BlendYUVA444(const CPicture &dst_data, const CPicture &src_data,
+                  unsigned width, unsigned height, int alpha)
+{
+    const CPlanes src(src_data);
+    const CPlanes dst(dst_data);
+
+    for (unsigned y = 0; y < height; y++) {
+        const uint8_t *srca = src.getPixels(3, 0, y);
+        for (unsigned plane = 0; plane < 3; plane++)
+            K::merge(dst.getPixels(plane, 0, y), src.getPixels(plane, 0, y),
+                     srca, alpha, width);
+    }
+}
+
+template <class K>
+void BlendRGBAToRGB32(const CPicture &dst_data, const CPicture &src_data,
+                      unsigned width, unsigned height, int alpha)
+{
+    const CPlanes src(src_data);
+    const CPlanes dst(dst_data);
+
+    int offset_r, offset_g, offset_b;
+    GetPackedRgbIndexes(dst_data.getFormat(), &offset_r, &offset_g, &offset_b);
+
+    int map[4] = { -1, -1, -1, -1 };
+    map[offset_r] = 0;
+    map[offset_g] = 1;
+    map[offset_b] = 2;
+
+    for (unsigned y = 0; y < height; y++)
+        K::mergePacked32(dst.getPixels(0, 0, y, 1, 1, 4),
+                         src.getPixels(0, 0, y, 1, 1, 4), map, alpha, width);
+}
+
+#ifdef BLEND_SIMD_X86
+
+struct KernelsSSE4_1 {
+    VLC_SSE4_1 static inline __m128i div255(__m128i v)
+    {
+        v = _mm_add_epi16(v, _mm_srli_epi16(v, 8));
+        return _mm_srli_epi16(_mm_add_epi16(v, _mm_set1_epi16(1)), 8);
+    }
+    /* 8 components, with the alpha already applied */
+    VLC_SSE4_1 static inline __m128i merge8(__m128i d, __m128i s, __m128i a)
+    {
+        const __m128i na = _mm_sub_epi16(_mm_set1_epi16(255), a);
+        return div255(_mm_add_epi16(_mm_mullo_epi16(d, na),
+                                    _mm_mullo_epi16(s, a)));
+    }
+    /* 16 bytes, with the source alpha of each byte */
+    VLC_SSE4_1 static inline __m128i merge16(__m128i d, __m128i s, __m128i sa,
+                                             __m128i alpha)
+    {
+        const __m128i zero = _mm_setzero_si128();
+        const __m128i a_lo = div255(_mm_mullo_epi16(_mm_unpacklo_epi8(sa, zero), alpha));
+        const __m128i a_hi = div255(_mm_mullo_epi16(_mm_unpackhi_epi8(sa, zero), alpha));
+        return _mm_packus_epi16(merge8(_mm_unpacklo_epi8(d, zero),
+                                       _mm_unpacklo_epi8(s, zero), a_lo),
+                                merge8(_mm_unpackhi_epi8(d, zero),
+                                       _mm_unpackhi_epi8(s, zero), a_hi));
+    }
+
+    VLC_SSE4_1
+    static void merge(uint8_t *dst, const uint8_t *src, const uint8_t *srca,
+                      unsigned alpha, unsigned count)
+    {
+        const __m128i valpha = _mm_set1_epi16(alpha);
+        unsigned i = 0;
+        for (; i + 16 <= count; i += 16) {
+            const __m128i d = _mm_loadu_si128((const __m128i *)&dst[i]);
+            const __m128i s = _mm_loadu_si128((const __m128i *)&src[i]);
+            const __m128i sa = _mm_loadu_si128((const __m128i *)&srca[i]);
+            _mm_storeu_si128((__m128i *)&dst[i], merge16(d, s, sa, valpha));
+        }
+        KernelsC::merge(&dst[i], &src[i], &srca[i], alpha, count - i);
+    }
+    VLC_SSE4_1
+    static void mergeSub2(uint8_t *dst, const uint8_t *src, const uint8_t *srca,
+                          unsigned alpha, unsigned count)
+    {
+        const __m128i valpha = _mm_set1_epi16(alpha);
+        const __m128i even = _mm_set1_epi16(0x00ff);
+        unsigned i = 0;
+        for (; i + 8 < count; i += 8) {
+            const __m128i s = _mm_and_si128(_mm_loadu_si128((const __m128i *)&src[2 * i]), even);
+            const __m128i sa = _mm_and_si128(_mm_loadu_si128((const __m128i *)&srca[2 * i]), even);
+            const __m128i d = _mm_cvtepu8_epi16(_mm_loadl_epi64((const __m128i *)&dst[i]));
+            const __m128i r = merge8(d, s, div255(_mm_mullo_epi16(sa, valpha)));
+            _mm_storel_epi64((__m128i *)&dst[i], _mm_packus_epi16(r, r));
+        }
+        KernelsC::mergeSub2(&dst[i], &src[2 * i], &srca[2 * i], alpha, count - i);
+    }
+    VLC_SSE4_1
+    static void mergeSub2Interleaved(uint8_t *dst, const uint8_t *src_0,
+                                     const uint8_t *src_1, const uint8_t *srca,
+                                     unsigned alpha, unsigned count)
+    {
+        const __m128i valpha = _mm_set1_epi16(alpha);
+        const __m128i even = _mm_set1_epi16(0x00ff);
+        unsigned i = 0;
+        for (; i + 8 < count; i += 8) {
+            const __m128i s0 = _mm_and_si128(_mm_loadu_si128((const __m128i *)&src_0[2 * i]), even);
+            const __m128i s1 = _mm_and_si128(_mm_loadu_si128((const __m128i *)&src_1[2 * i]), even);
+            const __m128i sa = _mm_and_si128(_mm_loadu_si128((const __m128i *)&srca[2 * i]), even);
+            const __m128i d = _mm_loadu_si128((const __m128i *)&dst[2 * i]);
+            /* Interleave the components, and repeat the alpha */
+            const __m128i s = _mm_or_si128(s0, _mm_slli_epi16(s1, 8));
+            const __m128i a = _mm_or_si128(sa, _mm_slli_epi16(sa, 8));
+            _mm_storeu_si128((__m128i *)&dst[2 * i], merge16(d, s, a, valpha));
+        }
+        KernelsC::mergeSub2Interleaved(&dst[2 * i], &src_0[2 * i], &src_1[2 * i],
+                                       &srca[2 * i], alpha, count - i);
+    }
+    VLC_SSE4_1
+    static void mergePacked32(uint8_t *dst, const uint8_t *src, const int map[4],
+                              unsigned alpha, unsigned count)
+    {
+        /* Reorder the source components, and repeat the alpha on the
+         * blended components only (a null alpha keeps the others) */
+        int8_t shuffle[16], shuffle_a[16];
+        for (unsigned j = 0; j < 16; j++) {
+            const int c = map[j % 4];
+            shuffle[j]   = c >= 0 ? (j & ~3) + c : -1;
+            shuffle_a[j] = c >= 0 ? (j & ~3) + 3 : -1;
+        }
+        const __m128i vshuffle = _mm_loadu_si128((const __m128i *)shuffle);
+        const __m128i vshuffle_a = _mm_loadu_si128((const __m128i *)shuffle_a);
+        const __m128i valpha = _mm_set1_epi16(alpha);
+        unsigned i = 0;
+        for (; i + 4 <= count; i += 4) {
+            const __m128i v = _mm_loadu_si128((const __m128i *)&src[4 * i]);
+            const __m128i d = _mm_loadu_si128((const __m128i *)&dst[4 * i]);
+            _mm_storeu_si128((__m128i *)&dst[4 * i],
+                             merge16(d, _mm_shuffle_epi8(v, vshuffle),
+                                     _mm_shuffle_epi8(v, vshuffle_a), valpha));
+        }
+        KernelsC::mergePacked32(&dst[4 * i], &src[4 * i], map, alpha, count - i);
+    }
+};
+
+struct KernelsAVX2 {
+    VLC_AVX2 static inline __m256i div255(__m256i v)
+    {
+        v = _mm256_add_epi16(v, _mm256_srli_epi16(v, 8));
+        return _mm256_srli_epi16(_mm256_add_epi16(v, _mm256_set1_epi16(1)), 8);
+    }
+    VLC_AVX2 static inline __m256i merge16(__m256i d, __m256i s, __m256i a)
+    {
+        const __m256i na = _mm256_sub_epi16(_mm256_set1_epi16(255), a);
+        return div255(_mm256_add_epi16(_mm256_mullo_epi16(d, na),
+                                       _mm256_mullo_epi16(s, a)));
+    }
+    /* 32 bytes; the unpacking and the packing are both per 128 bits lane */
+    VLC_AVX2 static inline __m256i merge32(__m256i d, __m256i s, __m256i sa,
+                                           __m256i alpha)
+    {
+        const __m256i zero = _mm256_setzero_si256();
+        const __m256i a_lo = div255(_mm256_mullo_epi16(_mm256_unpacklo_epi8(sa, zero), alpha));
+        const __m256i a_hi = div255(_mm256_mullo_epi16(_mm256_unpackhi_epi8(sa, zero), alpha));
+        return _mm256_packus_epi16(merge16(_mm256_unpacklo_epi8(d, zero),
+                                           _mm256_unpacklo_epi8(s, zero), a_lo),
+                                   merge16(_mm256_unpackhi_epi8(d, zero),
+                                           _mm256_unpackhi_epi8(s, zero), a_hi));
+    }
+
+    VLC_AVX2
+    static void merge(uint8_t *dst, const uint8_t *src, const uint8_t *srca,
+                      unsigned alpha, unsigned count)
+    {
+        const __m256i valpha = _mm256_set1_epi16(alpha);
+        unsigned i = 0;
+        for (; i + 32 <= count; i += 32) {
+            const __m256i d = _mm256_loadu_si256((const __m256i *)&dst[i]);
+            const __m256i s = _mm256_loadu_si256((const __m256i *)&src[i]);
+            const __m256i sa = _mm256_loadu_si256((const __m256i *)&srca[i]);
+            _mm256_storeu_si256((__m256i *)&dst[i], merge32(d, s, sa, valpha));
+        }
+        KernelsSSE4_1::merge(&dst[i], &src[i], &srca[i], alpha, count - i);
+    }
+    VLC_AVX2
+    static void mergeSub2(uint8_t *dst, const uint8_t *src, const uint8_t *srca,
+                          unsigned alpha, unsigned count)
+    {
+        const __m256i valpha = _mm256_set1_epi16(alpha);
+        const __m256i even = _mm256_set1_epi16(0x00ff);
+        unsigned i = 0;
+        for (; i + 16 < count; i += 16) {
+            const __m256i s = _mm256_and_si256(_mm256_loadu_si256((const __m256i *)&src[2 * i]), even);
+            const __m256i sa = _mm256_and_si256(_mm256_loadu_si256((const __m256i *)&srca[2 * i]), even);
+            const __m256i d = _mm256_cvtepu8_epi16(_mm_loadu_si128((const __m128i *)&dst[i]));
+            const __m256i r = merge16(d, s, div255(_mm256_mullo_epi16(sa, valpha)));
+            /* Pack per lane, then gather the low halves */
+            const __m256i p = _mm256_permute4x64_epi64(_mm256_packus_epi16(r, r), 0xd8);
+            _mm_storeu_si128((__m128i *)&dst[i], _mm256_castsi256_si128(p));
+        }
+        KernelsSSE4_1::mergeSub2(&dst[i], &src[2 * i], &srca[2 * i], alpha, count - i);
+    }
+    VLC_AVX2
+    static void mergeSub2Interleaved(uint8_t *dst, const uint8_t *src_0,
+                                     const uint8_t *src_1, const uint8_t *srca,
+                                     unsigned alpha, unsigned count)
+    {
+        const __m256i valpha = _mm256_set1_epi16(alpha);
+        const __m256i even = _mm256_set1_epi16(0x00ff);
+        unsigned i = 0;
+        for (; i + 16 < count; i += 16) {
+            const __m256i s0 = _mm256_and_si256(_mm256_loadu_si256((const __m256i *)&src_0[2 * i]), even);
+            const __m256i s1 = _mm256_and_si256(_mm256_loadu_si256((const __m256i *)&src_1[2 * i]), even);
+            const __m256i sa = _mm256_and_si256(_mm256_loadu_si256((const __m256i *)&srca[2 * i]), even);
+            const __m256i d = _mm256_loadu_si256((const __m256i *)&dst[2 * i]);
+            const __m256i s = _mm256_or_si256(s0, _mm256_slli_epi16(s1, 8));
+            const __m256i a = _mm256_or_si256(sa, _mm256_slli_epi16(sa, 8));
+            _mm256_storeu_si256((__m256i *)&dst[2 * i], merge32(d, s, a, valpha));
+        }
+        KernelsSSE4_1::mergeSub2Interleaved(&dst[2 * i], &src_0[2 * i], &src_1[2 * i],
+                                            &srca[2 * i], alpha, count - i);
+    }
+    VLC_AVX2
+    static void mergePacked32(uint8_t *dst, const uint8_t *src, const int map[4],
+                              unsigned alpha, unsigned count)
+    {
+        int8_t shuffle[32], shuffle_a[32];
+        for (unsigned j = 0; j < 32; j++) {
+            /* The shuffles are per 128 bits lane */
+            const int c = map[j % 4];
+            shuffle[j]   = c >= 0 ? (j & 12) + c : -1;
+            shuffle_a[j] = c >= 0 ? (j & 12) + 3 : -1;
+        }
+        const __m256i vshuffle = _mm256_loadu_si256((const __m256i *)shuffle);
+        const __m256i vshuffle_a = _mm256_loadu_si256((const __m256i *)shuffle_a);
+        const __m256i valpha = _mm256_set1_epi16(alpha);
+        unsigned i = 0;
+        for (; i + 8 <= count; i += 8) {
+            const __m256i v = _mm256_loadu_si256((const __m256i *)&src[4 * i]);
+            const __m256i d = _mm256_loadu_si256((const __m256i *)&dst[4 * i]);
+            _mm256_storeu_si256((__m256i *)&dst[4 * i],
+                                merge32(d, _mm256_shuffle_epi8(v, vshuffle),
+                                        _mm256_shuffle_epi8(v, vshuffle_a), valpha));
+        }
+        KernelsSSE4_1::mergePacked32(&dst[4 * i], &src[4 * i], map, alpha, count - i);
+    }
+};
+#endif
+
+#ifdef BLEND_SIMD_NEON
+
+struct KernelsNEON {
+    static inline uint16x8_t div255(uint16x8_t v)
+    {
+        v = vaddq_u16(v, vshrq_n_u16(v, 8));
+        return vshrq_n_u16(vaddq_u16(v, vdupq_n_u16(1)), 8);
+    }
+    /* Applies the global alpha to 16 source alpha values */
+    static inline uint8x16_t alpha16(uint8x16_t sa, uint8x8_t alpha)
+    {
+        return vcombine_u8(vmovn_u16(div255(vmull_u8(vget_low_u8(sa), alpha))),
+                           vmovn_u16(div255(vmull_u8(vget_high_u8(sa), alpha))));
+    }
+    static inline uint8x16_t merge16(uint8x16_t d, uint8x16_t s, uint8x16_t a)
+    {
+        const uint8x16_t na = vmvnq_u8(a);
+        const uint16x8_t lo = vmlal_u8(vmull_u8(vget_low_u8(d), vget_low_u8(na)),
+                                       vget_low_u8(s), vget_low_u8(a));
+        const uint16x8_t hi = vmlal_u8(vmull_u8(vget_high_u8(d), vget_high_u8(na)),
+                                       vget_high_u8(s), vget_high_u8(a));
+        return vcombine_u8(vmovn_u16(div255(lo)), vmovn_u16(div255(hi)));
+    }
+
+    static void merge(uint8_t *dst, const uint8_t *src, const uint8_t *srca,
+                      unsigned alpha, unsigned count)
+    {
+        const uint8x8_t valpha = vdup_n_u8(alpha);
+        unsigned i = 0;
+        for (; i + 16 <= count; i += 16) {
+            const uint8x16_t a = alpha16(vld1q_u8(&srca[i]), valpha);
+            vst1q_u8(&dst[i], merge16(vld1q_u8(&dst[i]), vld1q_u8(&src[i]), a));
+        }
+        KernelsC::merge(&dst[i], &src[i], &srca[i], alpha, count - i);
+    }
+    static void mergeSub2(uint8_t *dst, const uint8_t *src, const uint8_t *srca,
+                          unsigned alpha, unsigned count)
+    {
+        const uint8x8_t valpha = vdup_n_u8(alpha);
+        unsigned i = 0;
+        for (; i + 16 < count; i += 16) {
+            /* val[0] holds the even samples */
+            const uint8x16x2_t s = vld2q_u8(&src[2 * i]);
+            const uint8x16_t a = alpha16(vld2q_u8(&srca[2 * i]).val[0], valpha);
+            vst1q_u8(&dst[i], merge16(vld1q_u8(&dst[i]), s.val[0], a));
+        }
+        KernelsC::mergeSub2(&dst[i], &src[2 * i], &srca[2 * i], alpha, count - i);
+    }
+    static void mergeSub2Interleaved(uint8_t *dst, const uint8_t *src_0,
+                                     const uint8_t *src_1, const uint8_t *srca,
+                                     unsigned alpha, unsigned count)
+    {
+        const uint8x8_t valpha = vdup_n_u8(alpha);
+        unsigned i = 0;
+        for (; i + 16 < count; i += 16) {
+            const uint8x16_t s0 = vld2q_u8(&src_0[2 * i]).val[0];
+            const uint8x16_t s1 = vld2q_u8(&src_1[2 * i]).val[0];
+            const uint8x16_t a = alpha16(vld2q_u8(&srca[2 * i]).val[0], valpha);
+            uint8x16x2_t d = vld2q_u8(&dst[2 * i]);
+            d.val[0] = merge16(d.val[0], s0, a);
+            d.val[1] = merge16(d.val[1], s1, a);
+            vst2q_u8(&dst[2 * i], d);
+        }
+        KernelsC::mergeSub2Interleaved(&dst[2 * i], &src_0[2 * i], &src_1[2 * i],
+                                       &srca[2 * i], alpha, count - i);
+    }
+    static void mergePacked32(uint8_t *dst, const uint8_t *src, const int map[4],
+                              unsigned alpha, unsigned count)
+    {
+        const uint8x8_t valpha = vdup_n_u8(alpha);
+        unsigned i = 0;
+        for (; i + 16 <= count; i += 16) {
+            const uint8x16x4_t s = vld4q_u8(&src[4 * i]);
+            const uint8x16_t a = alpha16(s.val[3], valpha);
+            uint8x16x4_t d = vld4q_u8(&dst[4 * i]);
+            for (unsigned j = 0; j < 4; j++)
+                if (map[j] >= 0)
+                    d.val[j] = merge16(d.val[j], s.val[map[j]], a);
+            vst4q_u8(&dst[4 * i], d);
+        }
+        KernelsC::mergePacked32(&dst[4 * i], &src[4 * i], map, alpha, count - i);
+    }
+};
+#endif
+
+} // namespace
+
 typedef void (*blend_function_t)(const CPicture &dst_data, const CPicture &src_data,
                                  unsigned width, unsigned height, int alpha);
 
@@ -632,6 +1086,55 @@ static const struct {
 #undef YUV
 };
 
+typedef struct {
+    vlc_fourcc_t     dst;
+    vlc_fourcc_t     src;
+    blend_function_t blend;
+} blend_simd_t;
+
+#define SIMD_BLENDS(K) { \
+    { VLC_CODEC_YV12,  VLC_CODEC_YUVA, BlendYUVA420<K, 1, true> }, \
+    { VLC_CODEC_J420,  VLC_CODEC_YUVA, BlendYUVA420<K, 1, false> }, \
+    { VLC_CODEC_I420,  VLC_CODEC_YUVA, BlendYUVA420<K, 1, false> }, \
+    { VLC_CODEC_NV12,  VLC_CODEC_YUVA, BlendYUVA420<K, 2, false> }, \
+    { VLC_CODEC_NV21,  VLC_CODEC_YUVA, BlendYUVA420<K, 2, true> }, \
+    { VLC_CODEC_J444,  VLC_CODEC_YUVA, BlendYUVA444<K> }, \
+    { VLC_CODEC_I444,  VLC_CODEC_YUVA, BlendYUVA444<K> }, \
+    { VLC_CODEC_RGB32, VLC_CODEC_RGBA, BlendRGBAToRGB32<K> }, \
+    { 0, 0, NULL } \
+}
+
+#ifdef BLEND_SIMD_X86
+static const blend_simd_t blends_avx2[] = SIMD_BLENDS(KernelsAVX2);
+static const blend_simd_t blends_sse4_1[] = SIMD_BLENDS(KernelsSSE4_1);
+#endif
+#ifdef BLEND_SIMD_NEON
+static const blend_simd_t blends_neon[] = SIMD_BLENDS(KernelsNEON);
+#endif
+#undef SIMD_BLENDS
+
+static blend_function_t FindSIMDBlend(vlc_fourcc_t dst, vlc_fourcc_t src)
+{
+    const blend_simd_t *blends = NULL;
+
+#ifdef BLEND_SIMD_X86
+    if (vlc_CPU_AVX2())
+        blends = blends_avx2;
+    else if (vlc_CPU_SSE4_1())
+        blends = blends_sse4_1;
+#endif
+#ifdef BLEND_SIMD_NEON
+    if (vlc_CPU_ARM_NEON())
+        blends = blends_neon;
+#endif
+
+    for (; blends != NULL && blends->blend != NULL; blends++) {
+        if (blends->src == src && blends->dst == dst)
+            return blends->blend;
+    }
+    return NULL;
+}
+
 struct filter_sys_t {
     filter_sys_t() : blend(NULL)
     {
@@ -682,7 +1185,9 @@ static int Open(vlc_object_t *object)
     const vlc_fourcc_t dst = filter->fmt_out.video.i_chroma;
 
     filter_sys_t *sys = new filter_sys_t();
-    for (size_t i = 0; i < sizeof(blends) / sizeof(*blends); i++) {
+    if (var_InheritBool(filter, "blend-simd"))
+        sys->blend = FindSIMDBlend(dst, src);
+    for (size_t i = 0; i < sizeof(blends) / sizeof(*blends) && !sys->blend; i++) {
         if (blends[i].src == src && blends[i].dst == dst)
             sys->blend = blends[i].blend;
     }
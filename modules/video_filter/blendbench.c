@@ -68,6 +68,16 @@ static picture_t *Filter( filter_t *, picture_t * );
 #define BLEND_CHROMA_LONGTEXT N_("Chroma which the blend image will be loaded" \
                                  " in")
 
+#define WIDTH_TEXT N_("Width of the generated images")
+#define HEIGHT_TEXT N_("Height of the generated images")
+#define SIZE_LONGTEXT N_("Images are generated with this size when no " \
+                         "image file is given")
+
+#define ALL_TEXT N_("Benchmark all the blending paths")
+#define ALL_LONGTEXT N_("Blend generated images for each common pair of " \
+                        "chromas, with and without the SIMD optimizations, " \
+                        "and report the speed of each path")
+
 #define CFG_PREFIX "blendbench-"
 
 vlc_module_begin ()
@@ -82,6 +92,9 @@ vlc_module_begin ()
               LOOPS_LONGTEXT, false )
     add_integer_with_range( CFG_PREFIX "alpha", 128, 0, 255, ALPHA_TEXT,
               ALPHA_LONGTEXT, false )
+    add_integer( CFG_PREFIX "width", 1920, WIDTH_TEXT, SIZE_LONGTEXT, true )
+    add_integer( CFG_PREFIX "height", 1080, HEIGHT_TEXT, SIZE_LONGTEXT, true )
+    add_bool( CFG_PREFIX "all", false, ALL_TEXT, ALL_LONGTEXT, false )
 
     set_section( N_("Base image"), NULL )
     add_loadfile(CFG_PREFIX "base-image", NULL,
@@ -99,8 +112,28 @@ vlc_module_begin ()
 vlc_module_end ()
 
 static const char *const ppsz_filter_options[] = {
-    "loops", "alpha", "base-image", "base-chroma", "blend-image",
-    "blend-chroma", NULL
+    "loops", "alpha", "width", "height", "all", "base-image", "base-chroma",
+    "blend-image", "blend-chroma", NULL
+};
+
+/* Paths benchmarked by blendbench-all, subpictures onto common video chromas */
+static const struct
+{
+    vlc_fourcc_t i_base_chroma;
+    vlc_fourcc_t i_blend_chroma;
+} p_paths[] = {
+    { VLC_CODEC_I420,  VLC_CODEC_YUVA },
+    { VLC_CODEC_YV12,  VLC_CODEC_YUVA },
+    { VLC_CODEC_NV12,  VLC_CODEC_YUVA },
+    { VLC_CODEC_NV21,  VLC_CODEC_YUVA },
+    { VLC_CODEC_I422,  VLC_CODEC_YUVA },
+    { VLC_CODEC_I444,  VLC_CODEC_YUVA },
+    { VLC_CODEC_YUYV,  VLC_CODEC_YUVA },
+    { VLC_CODEC_RGB32, VLC_CODEC_YUVA },
+    { VLC_CODEC_I420,  VLC_CODEC_RGBA },
+    { VLC_CODEC_NV12,  VLC_CODEC_RGBA },
+    { VLC_CODEC_RGB32, VLC_CODEC_RGBA },
+    { VLC_CODEC_RGBA,  VLC_CODEC_RGBA },
 };
 
 /*****************************************************************************
@@ -109,7 +142,9 @@ static const char *const ppsz_filter_options[] = {
 typedef struct
 {
     bool b_done;
+    bool b_all;
     int i_loops, i_alpha;
+    unsigned i_width, i_height;
 
     picture_t *p_base_image;
     picture_t *p_blend_image;
@@ -118,12 +153,50 @@ typedef struct
     vlc_fourcc_t i_blend_chroma;
 } filter_sys_t;
 
+static picture_t *blendbench_NewImage( vlc_fourcc_t i_chroma,
+                                       unsigned i_width, unsigned i_height )
+{
+    video_format_t fmt;
+    picture_t *p_pic;
+
+    video_format_Setup( &fmt, i_chroma, i_width, i_height,
+                        i_width, i_height, 1, 1 );
+    p_pic = picture_NewFromFormat( &fmt );
+    video_format_Clean( &fmt );
+    if( p_pic == NULL )
+        return NULL;
+
+    /* Gradients, so that the alpha goes through transparent, translucent
+     * and opaque values */
+    for( int i_plane = 0; i_plane < p_pic->i_planes; i_plane++ )
+    {
+        plane_t *p = &p_pic->p[i_plane];
+        for( int y = 0; y < p->i_lines; y++ )
+            for( int x = 0; x < p->i_pitch; x++ )
+                p->p_pixels[y * p->i_pitch + x] = x * 5 + y * 3 + i_plane * 64;
+    }
+    return p_pic;
+}
+
 static int blendbench_LoadImage( vlc_object_t *p_this, picture_t **pp_pic,
                                  vlc_fourcc_t i_chroma, char *psz_file, const char *psz_name )
 {
+    filter_sys_t *p_sys = ((filter_t *)p_this)->p_sys;
     image_handler_t *p_image;
     video_format_t fmt_out;
 
+    if( psz_file == NULL || *psz_file == '\0' )
+    {
+        *pp_pic = blendbench_NewImage( i_chroma, p_sys->i_width,
+                                       p_sys->i_height );
+        if( *pp_pic == NULL )
+        {
+            msg_Err( p_this, "Unable to generate %s image", psz_name );
+            return VLC_EGENERIC;
+        }
+        return VLC_SUCCESS;
+    }
+
     video_format_Init( &fmt_out, i_chroma );
 
     p_image = image_HandlerCreate( p_this );
@@ -173,6 +246,14 @@ static int Create( vlc_object_t *p_this )
                                                   CFG_PREFIX "loops" );
     p_sys->i_alpha = var_CreateGetIntegerCommand( p_filter,
                                                   CFG_PREFIX "alpha" );
+    p_sys->i_width = var_CreateGetInteger( p_filter, CFG_PREFIX "width" );
+    p_sys->i_height = var_CreateGetInteger( p_filter, CFG_PREFIX "height" );
+    p_sys->b_all = var_CreateGetBool( p_filter, CFG_PREFIX "all" );
+
+    p_sys->p_base_image = NULL;
+    p_sys->p_blend_image = NULL;
+    if( p_sys->b_all )
+        return VLC_SUCCESS;
 
     psz_temp = var_CreateGetStringCommand( p_filter, CFG_PREFIX "base-chroma" );
     p_sys->i_base_chroma = !psz_temp || strlen( psz_temp ) != 4 ? 0 :
@@ -218,58 +299,128 @@ static void Destroy( vlc_object_t *p_this )
     filter_t *p_filter = (filter_t *)p_this;
     filter_sys_t *p_sys = p_filter->p_sys;
 
-    picture_Release( p_sys->p_base_image );
-    picture_Release( p_sys->p_blend_image );
+    if( p_sys->p_base_image )
+        picture_Release( p_sys->p_base_image );
+    if( p_sys->p_blend_image )
+        picture_Release( p_sys->p_blend_image );
+    free( p_sys );
 }
 
 /*****************************************************************************
- * Render: displays previously rendered output
+ * blendbench_Run: blends i_loops times, returns the speed in Mpixels/s
  *****************************************************************************/
-static picture_t *Filter( filter_t *p_filter, picture_t *p_pic )
+static double blendbench_Run( filter_t *p_filter, picture_t *p_base,
+                              picture_t *p_blend_image, bool b_simd )
 {
     filter_sys_t *p_sys = p_filter->p_sys;
     filter_t *p_blend;
 
-    if( p_sys->b_done )
-        return p_pic;
-
     p_blend = vlc_object_create( p_filter, sizeof(filter_t) );
     if( !p_blend )
-    {
-        picture_Release( p_pic );
-        return NULL;
-    }
-    p_blend->fmt_out.video = p_sys->p_base_image->format;
-    p_blend->fmt_in.video = p_sys->p_blend_image->format;
+        return -1.;
+    p_blend->fmt_out.video = p_base->format;
+    p_blend->fmt_in.video = p_blend_image->format;
+    var_Create( p_blend, "blend-simd", VLC_VAR_BOOL );
+    var_SetBool( p_blend, "blend-simd", b_simd );
     p_blend->p_module = module_need( p_blend, "video blending", NULL, false );
     if( !p_blend->p_module )
     {
-        picture_Release( p_pic );
         vlc_object_release( p_blend );
-        return NULL;
+        return -1.;
     }
 
     vlc_tick_t time = vlc_tick_now();
     for( int i_iter = 0; i_iter < p_sys->i_loops; ++i_iter )
     {
-        p_blend->pf_video_blend( p_blend,
-                                 p_sys->p_base_image, p_sys->p_blend_image,
+        p_blend->pf_video_blend( p_blend, p_base, p_blend_image,
                                  0, 0, p_sys->i_alpha );
     }
     time = vlc_tick_now() - time;
 
-    msg_Info( p_filter, "Blended %d images in %f sec", p_sys->i_loops,
-              secf_from_vlc_tick(time) );
-    msg_Info( p_filter, "Speed is: %f images/second, %f pixels/second",
-              (float) p_sys->i_loops / time * CLOCK_FREQ,
-              (float) p_sys->i_loops / time * CLOCK_FREQ *
-                  p_sys->p_blend_image->p[Y_PLANE].i_visible_pitch *
-                  p_sys->p_blend_image->p[Y_PLANE].i_visible_lines );
-
     module_unneed( p_blend, p_blend->p_module );
-
     vlc_object_release( p_blend );
 
+    /* Blended area, clipped to the base image */
+    const double f_pixels =
+        __MIN( p_blend_image->format.i_visible_width,
+               p_base->format.i_visible_width ) *
+        (double)__MIN( p_blend_image->format.i_visible_height,
+                       p_base->format.i_visible_height );
+
+    msg_Dbg( p_filter, "Blended %d images in %f sec", p_sys->i_loops,
+             secf_from_vlc_tick(time) );
+    if( time <= 0 )
+        time = 1;
+    return p_sys->i_loops * f_pixels / secf_from_vlc_tick(time) / 1e6;
+}
+
+static void blendbench_RunAll( filter_t *p_filter )
+{
+    filter_sys_t *p_sys = p_filter->p_sys;
+
+    msg_Info( p_filter, "%-11s %10s %10s %8s", "path", "C", "SIMD",
+              "speedup" );
+    for( size_t i = 0; i < ARRAY_SIZE(p_paths); i++ )
+    {
+        const vlc_fourcc_t i_base = p_paths[i].i_base_chroma;
+        const vlc_fourcc_t i_blend = p_paths[i].i_blend_chroma;
+        picture_t *p_base = blendbench_NewImage( i_base, p_sys->i_width,
+                                                 p_sys->i_height );
+        picture_t *p_blend = blendbench_NewImage( i_blend, p_sys->i_width,
+                                                  p_sys->i_height );
+        if( p_base && p_blend )
+        {
+            const double f_c = blendbench_Run( p_filter, p_base, p_blend,
+                                               false );
+            const double f_simd = blendbench_Run( p_filter, p_base, p_blend,
+                                                  true );
+            if( f_c > 0. && f_simd > 0. )
+                msg_Info( p_filter, "%4.4s->%4.4s %10.1f %10.1f %7.2fx",
+                          (const char *)&i_blend, (const char *)&i_base,
+                          f_c, f_simd, f_simd / f_c );
+            else
+                msg_Warn( p_filter, "%4.4s->%4.4s not supported",
+                          (const char *)&i_blend, (const char *)&i_base );
+        }
+        if( p_base )
+            picture_Release( p_base );
+        if( p_blend )
+            picture_Release( p_blend );
+    }
+    msg_Info( p_filter, "(Mpixels/s, %ux%u, %d loops)", p_sys->i_width,
+              p_sys->i_height, p_sys->i_loops );
+}
+
+/*****************************************************************************
+ * Render: displays previously rendered output
+ *****************************************************************************/
+static picture_t *Filter( filter_t *p_filter, picture_t *p_pic )
+{
+    filter_sys_t *p_sys = p_filter->p_sys;
+
+    if( p_sys->b_done )
+        return p_pic;
+
+    if( p_sys->b_all )
+    {
+        blendbench_RunAll( p_filter );
+    }
+    else
+    {
+        const double f_speed = blendbench_Run( p_filter, p_sys->p_base_image,
+                                               p_sys->p_blend_image, true );
+        if( f_speed < 0. )
+        {
+            picture_Release( p_pic );
+            return NULL;
+        }
+        msg_Info( p_filter, "Speed is: %f images/second, %f Mpixels/second",
+                  f_speed * 1e6 /
+                  p_sys->p_blend_image->format.i_visible_width /
+                  p_sys->p_blend_image->format.i_visible_height,
+                  f_speed );
+    }
+
     p_sys->b_done = true;
     return p_pic;
 }
@@ -46,6 +46,82 @@
    Necessary preprocessor macros are defined in common.h. */
 #include "yadif.h"
 
+struct yadif_slice
+{
+    picture_t *p_dst;
+    const picture_t *p_prev;
+    const picture_t *p_cur;
+    const picture_t *p_next;
+    void (*filter)(uint8_t *dst, uint8_t *prev, uint8_t *cur, uint8_t *next,
+                   int w, int prefs, int mrefs, int parity, int mode);
+    int i_field;
+    int i_parity;
+};
+
+/* Deinterlaces a band of each plane. The lines duplicated at the top and
+ * the bottom of the planes are written by the bands next to them. */
+static void RenderYadifSlice( filter_t *p_filter, void *opaque,
+                              unsigned i_slice, unsigned i_slices )
+{
+    const struct yadif_slice *ctx = opaque;
+    picture_t *p_dst = ctx->p_dst;
+    const int i_field = ctx->i_field;
+    const int yadif_parity = ctx->i_parity;
+
+    VLC_UNUSED(p_filter);
+
+    for( int n = 0; n < p_dst->i_planes; n++ )
+    {
+        const plane_t *prevp = &ctx->p_prev->p[n];
+        const plane_t *curp  = &ctx->p_cur->p[n];
+        const plane_t *nextp = &ctx->p_next->p[n];
+        plane_t *dstp        = &p_dst->p[n];
+
+        if( dstp->i_visible_lines < 3 )
+            continue;
+
+        unsigned i_start, i_end;
+        filter_GetSliceLines( dstp->i_visible_lines - 2, i_slice, i_slices,
+                              &i_start, &i_end );
+
+        for( int y = i_start + 1; y < (int)i_end + 1; y++ )
+        {
+            if( (y % 2) == i_field  ||  yadif_parity == 2 )
+            {
+                memcpy( &dstp->p_pixels[y * dstp->i_pitch],
+                            &curp->p_pixels[y * curp->i_pitch], dstp->i_visible_pitch );
+            }
+            else
+            {
+                int mode;
+                /* Spatial checks only when enough data */
+                mode = (y >= 2 && y < dstp->i_visible_lines - 2) ? 0 : 2;
+
+                assert( prevp->i_pitch == curp->i_pitch && curp->i_pitch == nextp->i_pitch );
+                ctx->filter( &dstp->p_pixels[y * dstp->i_pitch],
+                             &prevp->p_pixels[y * prevp->i_pitch],
+                             &curp->p_pixels[y * curp->i_pitch],
+                             &nextp->p_pixels[y * nextp->i_pitch],
+                             dstp->i_visible_pitch,
+                             y < dstp->i_visible_lines - 2  ? curp->i_pitch : -curp->i_pitch,
+                             y  - 1  ?  -curp->i_pitch : curp->i_pitch,
+                             yadif_parity,
+                             mode );
+            }
+
+            /* We duplicate the first and last lines */
+            if( y == 1 )
+                memcpy(&dstp->p_pixels[(y-1) * dstp->i_pitch],
+                           &dstp->p_pixels[ y    * dstp->i_pitch],
+                           dstp->i_pitch);
+            else if( y == dstp->i_visible_lines - 2 )
+                memcpy(&dstp->p_pixels[(y+1) * dstp->i_pitch],
+                           &dstp->p_pixels[ y    * dstp->i_pitch],
+                           dstp->i_pitch);
+        }
+    }
+}
+
 int RenderYadifSingle( filter_t *p_filter, picture_t *p_dst, picture_t *p_src )
 {
     return RenderYadif( p_filter, p_dst, p_src, 0, 0 );
@@ -130,49 +206,14 @@ int RenderYadif( filter_t *p_filter, picture_t *p_dst, picture_t *p_src,
         if( p_sys->chroma->pixel_size == 2 )
             filter = yadif_filter_line_c_16bit;
 
-        for( int n = 0; n < p_dst->i_planes; n++ )
-        {
-            const plane_t *prevp = &p_prev->p[n];
-            const plane_t *curp  = &p_cur->p[n];
-            const plane_t *nextp = &p_next->p[n];
-            plane_t *dstp        = &p_dst->p[n];
-
-            for( int y = 1; y < dstp->i_visible_lines - 1; y++ )
-            {
-                if( (y % 2) == i_field  ||  yadif_parity == 2 )
-                {
-                    memcpy( &dstp->p_pixels[y * dstp->i_pitch],
-                                &curp->p_pixels[y * curp->i_pitch], dstp->i_visible_pitch );
-                }
-                else
-                {
-                    int mode;
-                    /* Spatial checks only when enough data */
-                    mode = (y >= 2 && y < dstp->i_visible_lines - 2) ? 0 : 2;
-
-                    assert( prevp->i_pitch == curp->i_pitch && curp->i_pitch == nextp->i_pitch );
-                    filter( &dstp->p_pixels[y * dstp->i_pitch],
-                            &prevp->p_pixels[y * prevp->i_pitch],
-                            &curp->p_pixels[y * curp->i_pitch],
-                            &nextp->p_pixels[y * nextp->i_pitch],
-                            dstp->i_visible_pitch,
-                            y < dstp->i_visible_lines - 2  ? curp->i_pitch : -curp->i_pitch,
-                            y  - 1  ?  -curp->i_pitch : curp->i_pitch,
-                            yadif_parity,
-                            mode );
-                }
-
-                /* We duplicate the first and last lines */
-                if( y == 1 )
-                    memcpy(&dstp->p_pixels[(y-1) * dstp->i_pitch],
-                               &dstp->p_pixels[ y    * dstp->i_pitch],
-                               dstp->i_pitch);
-                else if( y == dstp->i_visible_lines - 2 )
-                    memcpy(&dstp->p_pixels[(y+1) * dstp->i_pitch],
-                               &dstp->p_pixels[ y    * dstp->i_pitch],
-                               dstp->i_pitch);
-            }
-        }
+        struct yadif_slice ctx = {
+            .p_dst = p_dst, .p_prev = p_prev, .p_cur = p_cur, .p_next = p_next,
+            .filter = filter, .i_field = i_field, .i_parity = yadif_parity,
+        };
+        filter_RunSlices( p_filter,
+                          filter_GetSliceCount( p_filter,
+                                                p_dst->p[0].i_visible_lines ),
+                          RenderYadifSlice, &ctx );
 
         p_sys->context.i_frame_offset = 1; /* p_cur will be rendered at next frame, too */
 
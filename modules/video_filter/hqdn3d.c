@@ -109,7 +109,6 @@ static int Open(vlc_object_t *this)
     const video_format_t *fmt_out = &filter->fmt_out.video;
     const vlc_fourcc_t fourcc_in  = fmt_in->i_chroma;
     const vlc_fourcc_t fourcc_out = fmt_out->i_chroma;
-    int wmax = 0;
 
     const vlc_chroma_description_t *chroma =
             vlc_fourcc_GetChromaDescription(fourcc_in);
@@ -134,13 +133,15 @@ static int Open(vlc_object_t *this)
 
     for (int i = 0; i < 3; ++i) {
         sys->w[i] = fmt_in->i_width  * chroma->p[i].w.num / chroma->p[i].w.den;
-        if (sys->w[i] > wmax) wmax = sys->w[i];
         sys->h[i] = fmt_out->i_height * chroma->p[i].h.num / chroma->p[i].h.den;
-    }
-    cfg->Line = malloc(wmax*sizeof(unsigned int));
-    if (!cfg->Line) {
-        free(sys);
-        return VLC_ENOMEM;
+        /* One line buffer per plane, as the planes are denoised in parallel */
+        cfg->Line[i] = malloc(sys->w[i]*sizeof(unsigned int));
+        if (!cfg->Line[i]) {
+            while (i-- > 0)
+                free(cfg->Line[i]);
+            free(sys);
+            return VLC_ENOMEM;
+        }
     }
 
     config_ChainParse(filter, FILTER_PREFIX, filter_options,
@@ -183,14 +184,39 @@ static void Close(vlc_object_t *this)
 
     for (int i = 0; i < 3; ++i) {
         free(cfg->Frame[i]);
+        free(cfg->Line[i]);
     }
-    free(cfg->Line);
     free(sys);
 }
 
 /*****************************************************************************
  * Filter
  *****************************************************************************/
+struct hqdn3d_slice
+{
+    picture_t *src;
+    picture_t *dst;
+};
+
+static void DenoisePlane(filter_t *filter, void *opaque,
+                         unsigned plane, unsigned planes)
+{
+    const struct hqdn3d_slice *ctx = opaque;
+    filter_sys_t *sys = filter->p_sys;
+    struct vf_priv_s *cfg = &sys->cfg;
+    /* Luma uses the first coefficients, both chroma planes the last ones */
+    int *spat = cfg->Coefs[plane ? 2 : 0];
+    int *temp = cfg->Coefs[plane ? 3 : 1];
+
+    VLC_UNUSED(planes);
+    deNoise(ctx->src->p[plane].p_pixels, ctx->dst->p[plane].p_pixels,
+            cfg->Line[plane], &cfg->Frame[plane], sys->w[plane], sys->h[plane],
+            ctx->src->p[plane].i_pitch, ctx->dst->p[plane].i_pitch,
+            spat,
+            spat,
+            temp);
+}
+
 static picture_t *Filter(filter_t *filter, picture_t *src)
 {
     picture_t *dst;
@@ -220,24 +246,9 @@ static picture_t *Filter(filter_t *filter, picture_t *src)
     }
     vlc_mutex_unlock( &sys->coefs_mutex );
 
-    deNoise(src->p[0].p_pixels, dst->p[0].p_pixels,
-            cfg->Line, &cfg->Frame[0], sys->w[0], sys->h[0],
-            src->p[0].i_pitch, dst->p[0].i_pitch,
-            cfg->Coefs[0],
-            cfg->Coefs[0],
-            cfg->Coefs[1]);
-    deNoise(src->p[1].p_pixels, dst->p[1].p_pixels,
-            cfg->Line, &cfg->Frame[1], sys->w[1], sys->h[1],
-            src->p[1].i_pitch, dst->p[1].i_pitch,
-            cfg->Coefs[2],
-            cfg->Coefs[2],
-            cfg->Coefs[3]);
-    deNoise(src->p[2].p_pixels, dst->p[2].p_pixels,
-            cfg->Line, &cfg->Frame[2], sys->w[2], sys->h[2],
-            src->p[2].i_pitch, dst->p[2].i_pitch,
-            cfg->Coefs[2],
-            cfg->Coefs[2],
-            cfg->Coefs[3]);
+    /* The vertical recursion prevents from splitting the planes in bands */
+    struct hqdn3d_slice ctx = { .src = src, .dst = dst };
+    filter_RunSlices(filter, 3, DenoisePlane, &ctx);
 
     if(unlikely(!cfg->Frame[0] || !cfg->Frame[1] || !cfg->Frame[2]))
     {
@@ -32,7 +32,7 @@
 
 struct vf_priv_s {
         int Coefs[4][512*16];
-        unsigned int *Line;
+        unsigned int *Line[3];
         unsigned short *Frame[3];
 };
 
@@ -159,7 +159,7 @@ static void Destroy( vlc_object_t *p_this )
 #define IS_YUV_420_10BITS(fmt) (fmt == VLC_CODEC_I420_10L ||    \
                                 fmt == VLC_CODEC_I420_10B)
 
-#define SHARPEN_FRAME(maxval, data_t)                                   \
+#define SHARPEN_LINES(maxval, data_t)                                   \
     do                                                                  \
     {                                                                   \
         assert((maxval) >= 0);                                          \
@@ -168,12 +168,16 @@ static void Destroy( vlc_object_t *p_this )
         const unsigned data_sz = sizeof(data_t);                        \
         const int i_src_line_len = p_outpic->p[Y_PLANE].i_pitch / data_sz; \
         const int i_out_line_len = p_pic->p[Y_PLANE].i_pitch / data_sz; \
-        const int sigma = atomic_load(&p_sys->sigma);         \
                                                                         \
-        memcpy(p_out, p_src, i_visible_pitch);                          \
-                                                                        \
-        for( unsigned i = 1; i < i_visible_lines - 1; i++ )             \
+        for( unsigned i = i_start; i < i_end; i++ )                     \
         {                                                               \
+            if( i == 0 || i == i_visible_lines - 1 )                    \
+            {                                                           \
+                memcpy(&p_out[i * i_out_line_len],                      \
+                       &p_src[i * i_src_line_len], i_visible_pitch);    \
+                continue;                                               \
+            }                                                           \
+                                                                        \
             p_out[i * i_out_line_len] = p_src[i * i_src_line_len];      \
                                                                         \
             for( unsigned j = data_sz; j < i_visible_pitch - 1; j++ )   \
@@ -199,18 +203,42 @@ static void Destroy( vlc_object_t *p_this )
             p_out[i * i_out_line_len + i_visible_pitch / data_sz - 1] = \
                 p_src[i * i_src_line_len + i_visible_pitch / data_sz - 1];  \
         }                                                               \
-        memcpy(&p_out[(i_visible_lines - 1) * i_out_line_len],          \
-               &p_src[(i_visible_lines - 1) * i_src_line_len],          \
-               i_visible_pitch);                                        \
     } while (0)
 
-static picture_t *Filter( filter_t *p_filter, picture_t *p_pic )
+struct sharpen_slice
 {
+    picture_t *p_pic;
     picture_t *p_outpic;
+    int        sigma;
+};
+
+/* Sharpens a band of the luma plane, the bands only read the source */
+static void SharpenSlice( filter_t *p_filter, void *opaque,
+                          unsigned i_slice, unsigned i_slices )
+{
+    const struct sharpen_slice *ctx = opaque;
+    picture_t *p_pic = ctx->p_pic;
+    picture_t *p_outpic = ctx->p_outpic;
+    const int sigma = ctx->sigma;
     const int v1 = -1;
     const int v2 = 3; /* 2^3 = 8 */
     const unsigned i_visible_lines = p_pic->p[Y_PLANE].i_visible_lines;
     const unsigned i_visible_pitch = p_pic->p[Y_PLANE].i_visible_pitch;
+    unsigned i_start, i_end;
+
+    VLC_UNUSED(p_filter);
+    filter_GetSliceLines( i_visible_lines, i_slice, i_slices,
+                          &i_start, &i_end );
+
+    if (!IS_YUV_420_10BITS(p_pic->format.i_chroma))
+        SHARPEN_LINES(255, uint8_t);
+    else
+        SHARPEN_LINES(1023, uint16_t);
+}
+
+static picture_t *Filter( filter_t *p_filter, picture_t *p_pic )
+{
+    picture_t *p_outpic;
 
     p_outpic = filter_NewPicture( p_filter );
     if( !p_outpic )
@@ -220,11 +248,15 @@ static picture_t *Filter( filter_t *p_filter, picture_t *p_pic )
     }
 
     filter_sys_t *p_sys = p_filter->p_sys;
-
-    if (!IS_YUV_420_10BITS(p_pic->format.i_chroma))
-        SHARPEN_FRAME(255, uint8_t);
-    else
-        SHARPEN_FRAME(1023, uint16_t);
+    struct sharpen_slice ctx = {
+        .p_pic = p_pic,
+        .p_outpic = p_outpic,
+        .sigma = atomic_load(&p_sys->sigma),
+    };
+
+    filter_RunSlices( p_filter,
+        filter_GetSliceCount( p_filter, p_pic->p[Y_PLANE].i_visible_lines ),
+        SharpenSlice, &ctx );
 
     plane_CopyPixels( &p_outpic->p[U_PLANE], &p_pic->p[U_PLANE] );
     plane_CopyPixels( &p_outpic->p[V_PLANE], &p_pic->p[V_PLANE] );
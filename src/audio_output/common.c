@@ -29,8 +29,18 @@
 
 #include <vlc_common.h>
 #include <vlc_aout.h>
+#include <vlc_cpu.h>
 #include "aout_internal.h"
 
+#if defined(__GNUC__) && (defined(__i386__) || defined(__x86_64__))
+# define AOUT_SIMD_X86
+# include <immintrin.h>
+#endif
+#if defined(__ARM_NEON) || defined(__ARM_NEON__)
+# define AOUT_SIMD_NEON
+# include <arm_neon.h>
+#endif
+
 /*
  * Formats management (internal and external)
  */
@@ -353,6 +363,208 @@ do { \
     }
 }
 
+/*
+ * Vectorized (de)interleaving of 16-bits and 32-bits samples, for stereo and
+ * for multiples of four channels (quadraphony, 7.1...). The functions return
+ * the number of samples per channel processed, the remaining ones are left
+ * to the generic loops. Samples are only moved, never computed.
+ */
+#ifdef AOUT_SIMD_X86
+VLC_SSE2
+static size_t Interleave_SSE2( void *restrict dst, const void *const *srcv,
+                               size_t samples, unsigned chans, unsigned size )
+{
+    size_t j = 0;
+
+    if( size == 2 && chans == 2 )
+    {
+        const int16_t *l = srcv[0], *r = srcv[1];
+        int16_t *d = dst;
+
+        for( ; j + 8 <= samples; j += 8 )
+        {
+            __m128i a = _mm_loadu_si128( (const __m128i *)&l[j] );
+            __m128i b = _mm_loadu_si128( (const __m128i *)&r[j] );
+            _mm_storeu_si128( (__m128i *)&d[2 * j], _mm_unpacklo_epi16( a, b ) );
+            _mm_storeu_si128( (__m128i *)&d[2 * j + 8], _mm_unpackhi_epi16( a, b ) );
+        }
+    }
+    else if( size == 4 && chans == 2 )
+    {
+        const float *l = srcv[0], *r = srcv[1];
+        float *d = dst;
+
+        for( ; j + 4 <= samples; j += 4 )
+        {
+            __m128 a = _mm_loadu_ps( &l[j] ), b = _mm_loadu_ps( &r[j] );
+            _mm_storeu_ps( &d[2 * j], _mm_unpacklo_ps( a, b ) );
+            _mm_storeu_ps( &d[2 * j + 4], _mm_unpackhi_ps( a, b ) );
+        }
+    }
+    else if( size == 4 && (chans % 4) == 0 )
+    {
+        float *d = dst;
+
+        for( ; j + 4 <= samples; j += 4 )
+            for( unsigned c = 0; c < chans; c += 4 )
+            {
+                __m128 r0 = _mm_loadu_ps( (const float *)srcv[c] + j );
+                __m128 r1 = _mm_loadu_ps( (const float *)srcv[c + 1] + j );
+                __m128 r2 = _mm_loadu_ps( (const float *)srcv[c + 2] + j );
+                __m128 r3 = _mm_loadu_ps( (const float *)srcv[c + 3] + j );
+                _MM_TRANSPOSE4_PS( r0, r1, r2, r3 );
+                _mm_storeu_ps( &d[j * chans + c], r0 );
+                _mm_storeu_ps( &d[(j + 1) * chans + c], r1 );
+                _mm_storeu_ps( &d[(j + 2) * chans + c], r2 );
+                _mm_storeu_ps( &d[(j + 3) * chans + c], r3 );
+            }
+    }
+    return j;
+}
+
+VLC_SSE2
+static size_t Deinterleave_SSE2( void *restrict dst, const void *restrict src,
+                                 size_t samples, unsigned chans, unsigned size )
+{
+    size_t j = 0;
+
+    if( size == 2 && chans == 2 )
+    {
+        const int16_t *s = src;
+        int16_t *l = dst, *r = l + samples;
+
+        for( ; j + 8 <= samples; j += 8 )
+        {
+            __m128i a = _mm_loadu_si128( (const __m128i *)&s[2 * j] );
+            __m128i b = _mm_loadu_si128( (const __m128i *)&s[2 * j + 8] );
+            __m128i la = _mm_srai_epi32( _mm_slli_epi32( a, 16 ), 16 );
+            __m128i lb = _mm_srai_epi32( _mm_slli_epi32( b, 16 ), 16 );
+            _mm_storeu_si128( (__m128i *)&l[j], _mm_packs_epi32( la, lb ) );
+            _mm_storeu_si128( (__m128i *)&r[j],
+                              _mm_packs_epi32( _mm_srai_epi32( a, 16 ),
+                                               _mm_srai_epi32( b, 16 ) ) );
+        }
+    }
+    else if( size == 4 && chans == 2 )
+    {
+        const float *s = src;
+        float *l = dst, *r = l + samples;
+
+        for( ; j + 4 <= samples; j += 4 )
+        {
+            __m128 a = _mm_loadu_ps( &s[2 * j] ), b = _mm_loadu_ps( &s[2 * j + 4] );
+            _mm_storeu_ps( &l[j], _mm_shuffle_ps( a, b, _MM_SHUFFLE(2, 0, 2, 0) ) );
+            _mm_storeu_ps( &r[j], _mm_shuffle_ps( a, b, _MM_SHUFFLE(3, 1, 3, 1) ) );
+        }
+    }
+    else if( size == 4 && (chans % 4) == 0 )
+    {
+        const float *s = src;
+        float *d = dst;
+
+        for( ; j + 4 <= samples; j += 4 )
+            for( unsigned c = 0; c < chans; c += 4 )
+            {
+                __m128 r0 = _mm_loadu_ps( &s[j * chans + c] );
+                __m128 r1 = _mm_loadu_ps( &s[(j + 1) * chans + c] );
+                __m128 r2 = _mm_loadu_ps( &s[(j + 2) * chans + c] );
+                __m128 r3 = _mm_loadu_ps( &s[(j + 3) * chans + c] );
+                _MM_TRANSPOSE4_PS( r0, r1, r2, r3 );
+                _mm_storeu_ps( &d[c * samples + j], r0 );
+                _mm_storeu_ps( &d[(c + 1) * samples + j], r1 );
+                _mm_storeu_ps( &d[(c + 2) * samples + j], r2 );
+                _mm_storeu_ps( &d[(c + 3) * samples + j], r3 );
+            }
+    }
+    return j;
+}
+#endif
+
+#ifdef AOUT_SIMD_NEON
+static size_t Interleave_NEON( void *restrict dst, const void *const *srcv,
+                               size_t samples, unsigned chans, unsigned size )
+{
+    size_t j = 0;
+
+    if( size == 2 && chans == 2 )
+    {
+        const uint16_t *l = srcv[0], *r = srcv[1];
+        uint16_t *d = dst;
+
+        for( ; j + 8 <= samples; j += 8 )
+        {
+            uint16x8x2_t v = { { vld1q_u16( &l[j] ), vld1q_u16( &r[j] ) } };
+            vst2q_u16( &d[2 * j], v );
+        }
+    }
+    else if( size == 4 && chans == 2 )
+    {
+        const uint32_t *l = srcv[0], *r = srcv[1];
+        uint32_t *d = dst;
+
+        for( ; j + 4 <= samples; j += 4 )
+        {
+            uint32x4x2_t v = { { vld1q_u32( &l[j] ), vld1q_u32( &r[j] ) } };
+            vst2q_u32( &d[2 * j], v );
+        }
+    }
+    else if( size == 4 && chans == 4 )
+    {
+        const uint32_t *const *s = (const uint32_t *const *)srcv;
+        uint32_t *d = dst;
+
+        for( ; j + 4 <= samples; j += 4 )
+        {
+            uint32x4x4_t v = { { vld1q_u32( &s[0][j] ), vld1q_u32( &s[1][j] ),
+                                 vld1q_u32( &s[2][j] ), vld1q_u32( &s[3][j] ) } };
+            vst4q_u32( &d[4 * j], v );
+        }
+    }
+    return j;
+}
+
+static size_t Deinterleave_NEON( void *restrict dst, const void *restrict src,
+                                 size_t samples, unsigned chans, unsigned size )
+{
+    size_t j = 0;
+
+    if( size == 2 && chans == 2 )
+    {
+        const uint16_t *s = src;
+        uint16_t *d = dst;
+
+        for( ; j + 8 <= samples; j += 8 )
+        {
+            uint16x8x2_t v = vld2q_u16( &s[2 * j] );
+            vst1q_u16( &d[j], v.val[0] );
+            vst1q_u16( &d[samples + j], v.val[1] );
+        }
+    }
+    else if( size == 4 && (chans == 2 || chans == 4) )
+    {
+        const uint32_t *s = src;
+        uint32_t *d = dst;
+
+        for( ; j + 4 <= samples; j += 4 )
+        {
+            if( chans == 2 )
+            {
+                uint32x4x2_t v = vld2q_u32( &s[2 * j] );
+                vst1q_u32( &d[j], v.val[0] );
+                vst1q_u32( &d[samples + j], v.val[1] );
+            }
+            else
+            {
+                uint32x4x4_t v = vld4q_u32( &s[4 * j] );
+                for( unsigned c = 0; c < 4; c++ )
+                    vst1q_u32( &d[c * samples + j], v.val[c] );
+            }
+        }
+    }
+    return j;
+}
+#endif
+
 /**
  * Interleaves audio samples within a block of samples.
  * \param dst destination buffer for interleaved samples
@@ -366,12 +578,25 @@ do { \
 void aout_Interleave( void *restrict dst, const void *const *srcv,
                       unsigned samples, unsigned chans, vlc_fourcc_t fourcc )
 {
+    const unsigned size = aout_BitsPerSample( fourcc ) / 8;
+    size_t done = 0;
+
+#ifdef AOUT_SIMD_X86
+    if( vlc_CPU_SSE2() )
+        done = Interleave_SSE2( dst, srcv, samples, chans, size );
+#endif
+#ifdef AOUT_SIMD_NEON
+    if( vlc_CPU_ARM_NEON() )
+        done = Interleave_NEON( dst, srcv, samples, chans, size );
+#endif
+    VLC_UNUSED(size);
+
 #define INTERLEAVE_TYPE(type) \
 do { \
-    type *d = dst; \
+    type *d = (type *)dst + done * chans; \
     for( size_t i = 0; i < chans; i++ ) { \
-        const type *s = srcv[i]; \
-        for( size_t j = 0, k = 0; j < samples; j++, k += chans ) \
+        const type *s = (const type *)srcv[i] + done; \
+        for( size_t j = done, k = 0; j < samples; j++, k += chans ) \
             d[k] = *(s++); \
         d++; \
     } \
@@ -402,12 +627,26 @@ do { \
 void aout_Deinterleave( void *restrict dst, const void *restrict src,
                       unsigned samples, unsigned chans, vlc_fourcc_t fourcc )
 {
+    const unsigned size = aout_BitsPerSample( fourcc ) / 8;
+    size_t done = 0;
+
+#ifdef AOUT_SIMD_X86
+    if( vlc_CPU_SSE2() )
+        done = Deinterleave_SSE2( dst, src, samples, chans, size );
+#endif
+#ifdef AOUT_SIMD_NEON
+    if( vlc_CPU_ARM_NEON() )
+        done = Deinterleave_NEON( dst, src, samples, chans, size );
+#endif
+    VLC_UNUSED(size);
+
 #define DEINTERLEAVE_TYPE(type) \
 do { \
     type *d = dst; \
-    const type *s = src; \
+    const type *s = (const type *)src + done * chans; \
     for( size_t i = 0; i < chans; i++ ) { \
-        for( size_t j = 0, k = 0; j < samples; j++, k += chans ) \
+        d += done; \
+        for( size_t j = done, k = 0; j < samples; j++, k += chans ) \
             *(d++) = s[k]; \
         s++; \
     } \
@@ -400,11 +400,21 @@ static int confnamecmp (const void *key, const void *elem)
     return strcmp (key, (*conf)->psz_name);
 }
 
-static struct
+/**
+ * Index of the configuration items by name.
+ *
+ * The index is replaced when plugins are loaded on demand. Superseded
+ * indices are kept until config_UnsortConfig(), so that config_FindConfig()
+ * needs no locking.
+ */
+struct vlc_config_index
 {
-    module_config_t **list;
+    struct vlc_config_index *older; /**< Superseded index */
     size_t count;
-} config = { NULL, 0 };
+    module_config_t *list[];
+};
+
+static atomic_uintptr_t config_index;
 
 /**
  * Index the configuration items by name for faster lookups.
@@ -417,8 +427,9 @@ int config_SortConfig (void)
     for (p = vlc_plugins; p != NULL; p = p->next)
          nconf += p->conf.size;
 
-    module_config_t **clist = vlc_alloc (nconf, sizeof (*clist));
-    if (unlikely(clist == NULL))
+    struct vlc_config_index *index =
+        malloc (sizeof (*index) + nconf * sizeof (index->list[0]));
+    if (unlikely(index == NULL))
         return VLC_ENOMEM;
 
     nconf = 0;
@@ -432,26 +443,33 @@ int config_SortConfig (void)
         {
             if (!CONFIG_ITEM(item->i_type))
                 continue; /* ignore hints */
-            clist[nconf++] = item;
+            index->list[nconf++] = item;
         }
     }
 
-    qsort (clist, nconf, sizeof (*clist), confcmp);
+    qsort (index->list, nconf, sizeof (index->list[0]), confcmp);
 
-    config.list = clist;
-    config.count = nconf;
+    index->count = nconf;
+    index->older = (void *)atomic_load_explicit (&config_index,
+                                                 memory_order_relaxed);
+    atomic_store_explicit (&config_index, (uintptr_t)index,
+                           memory_order_release);
     return VLC_SUCCESS;
 }
 
 void config_UnsortConfig (void)
 {
-    module_config_t **clist;
+    struct vlc_config_index *index =
+        (void *)atomic_exchange_explicit (&config_index, 0,
+                                          memory_order_relaxed);
 
-    clist = config.list;
-    config.list = NULL;
-    config.count = 0;
+    while (index != NULL)
+    {
+        struct vlc_config_index *older = index->older;
 
-    free (clist);
+        free (index);
+        index = older;
+    }
 }
 
 module_config_t *config_FindConfig(const char *name)
@@ -459,8 +477,13 @@ module_config_t *config_FindConfig(const char *name)
     if (unlikely(name == NULL))
         return NULL;
 
+    const struct vlc_config_index *index =
+        (void *)atomic_load_explicit (&config_index, memory_order_acquire);
+    if (index == NULL)
+        return NULL;
+
     module_config_t *const *p;
-    p = bsearch (name, config.list, config.count, sizeof (*p), confnamecmp);
+    p = bsearch (name, index->list, index->count, sizeof (*p), confnamecmp);
     return p ? *p : NULL;
 }
 
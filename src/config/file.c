@@ -348,6 +348,8 @@ static int config_PrepareDir (vlc_object_t *obj)
  */
 int config_SaveConfigFile (vlc_object_t *p_this)
 {
+    /* The sections are named after the modules of the plugins */
+    module_LoadLazyPlugins();
 
     if( config_PrepareDir( p_this ) )
     {
@@ -431,7 +433,7 @@ int config_SaveConfigFile (vlc_object_t *p_this)
         module_t *p_parser = p->module;
         module_config_t *p_item, *p_end;
 
-        if (p->conf.count == 0)
+        if (p->conf.count == 0 || p_parser == NULL)
             continue;
 
         fprintf( file, "[%s]", module_get_object (p_parser) );
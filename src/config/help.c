@@ -596,15 +596,18 @@ static void Usage (vlc_object_t *p_this, char const *psz_search)
 
     const bool desc = var_InheritBool(p_this, "help-verbose");
 
+    module_LoadLazyPlugins();
+
     /* Enumerate the config for each module */
     for (const vlc_plugin_t *p = vlc_plugins; p != NULL; p = p->next)
     {
         const module_t *m = p->module;
-        const module_config_t *section = NULL;
-        const char *objname = module_get_object(m);
 
-        if (p->conf.count == 0)
+        if (p->conf.count == 0 || m == NULL)
             continue; /* Ignore modules without config options */
+
+        const module_config_t *section = NULL;
+        const char *objname = module_get_object(m);
         if (!module_match(m, psz_search, strict))
             continue;
         found = true;
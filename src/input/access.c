@@ -236,7 +236,17 @@ static block_t *AStreamReadBlock(stream_t *s, bool *restrict eof)
         struct input_stats *stats =
             priv->input ? input_priv(priv->input)->stats : NULL;
         if (stats != NULL)
+        {
             input_rate_Add(&stats->input_bitrate, block->i_buffer);
+
+            /* Packets were lost before this block: ask how many */
+            uint64_t lost;
+            if ((block->i_flags & BLOCK_FLAG_DISCONTINUITY)
+             && vlc_stream_Control(access, STREAM_GET_LOST_PACKETS,
+                                   &lost) == VLC_SUCCESS)
+                atomic_store_explicit(&stats->input_lost, lost,
+                                      memory_order_relaxed);
+        }
     }
 
     return block;
@@ -995,7 +995,7 @@ static void DecoderPlayCc( decoder_t *p_dec, block_t *p_cc,
 
         if( i_bitmap > 1 )
         {
-            block_FifoPut( p_ccowner->p_fifo, block_Duplicate(p_cc) );
+            block_FifoPut( p_ccowner->p_fifo, block_Share(p_cc) );
         }
         else
         {
@@ -1490,6 +1490,16 @@ static void DecoderProcess( decoder_t *p_dec, block_t *p_block )
         return;
     }
 #endif
+    /* Decoders may modify their input in place. The stream output only
+     * packetizes, and the packetizers rewriting the payload check
+     * block_IsWritable() themselves, so shared blocks are not copied there */
+    if( p_block )
+    {
+        p_block = block_MakeWritable( p_block );
+        if( unlikely(p_block == NULL) )
+            return;
+    }
+
     if( packetize )
     {
         block_t *p_packetized_block;
@@ -2225,7 +2225,7 @@ static int EsOutSend( es_out_t *out, es_out_id_t *es, block_t *p_block )
     /* Decode */
     if( es->p_dec_record )
     {
-        block_t *p_dup = block_Duplicate( p_block );
+        block_t *p_dup = block_Share( p_block );
         if( p_dup )
             input_DecoderDecode( es->p_dec_record, p_dup,
                                  input_priv(p_input)->b_out_pace_control );
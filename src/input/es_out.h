@@ -73,6 +73,9 @@ enum es_out_query_private_e
     /* Set next frame */
     ES_OUT_SET_FRAME_NEXT,                          /*                          res=can fail */
 
+    /* Jump within the timeshift buffer */
+    ES_OUT_JUMP_TIMESHIFT,                          /* arg1=vlc_tick_t i_delta  res=can fail */
+
     /* Set position/time/length */
     ES_OUT_SET_TIMES,                               /* arg1=double f_position arg2=vlc_tick_t i_time arg3=vlc_tick_t i_length res=cannot fail */
 
@@ -142,6 +145,10 @@ static inline int es_out_SetFrameNext( es_out_t *p_out )
 {
     return es_out_Control( p_out, ES_OUT_SET_FRAME_NEXT );
 }
+static inline int es_out_JumpTimeshift( es_out_t *p_out, vlc_tick_t i_delta )
+{
+    return es_out_Control( p_out, ES_OUT_JUMP_TIMESHIFT, i_delta );
+}
 static inline void es_out_SetTimes( es_out_t *p_out, double f_position, vlc_tick_t i_time, vlc_tick_t i_length )
 {
     int i_ret = es_out_Control( p_out, ES_OUT_SET_TIMES, f_position, i_time, i_length );
@@ -160,25 +160,33 @@ typedef struct attribute_packed
     } u;
 } ts_cmd_t;
 
+/* Maximum number of played segments kept as history, each holds a file */
+#define TS_HISTORY_MAX 64
+/* Size up to which the segments grow when the window needs more history */
+#define TS_SEGMENT_SIZE_MAX (INT64_C(1024)*1024*1024)
+
 typedef struct ts_storage_t ts_storage_t;
 struct ts_storage_t
 {
-    ts_storage_t *p_next;
-
-    /* */
 #ifdef _WIN32
     char    *psz_file;  /* Filename */
 #endif
     size_t  i_file_max; /* Max size in bytes */
     int64_t i_file_size;/* Current size in bytes */
-    FILE    *p_filew;   /* FILE handle for data writing */
-    FILE    *p_filer;   /* FILE handle for data reading */
+    FILE    *p_filew;   /* FILE handle for data writing (and reading once sealed) */
+    FILE    *p_filer;   /* FILE handle for data reading, NULL once sealed */
+
+    /* */
+    vlc_tick_t i_date_first;    /* Date of the first command */
+    vlc_tick_t i_date_last;     /* Date of the last command */
 
     /* */
     int      i_cmd_r;
     int      i_cmd_w;
+    int      i_cmd_done;    /* Commands before it were already executed */
     int      i_cmd_max;
-    ts_cmd_t *p_cmd;
+    ts_cmd_t *p_cmd;        /* NULL once retired to the file */
+    long     i_cmd_offset;  /* Offset of the commands in the file once retired */
 };
 
 typedef struct
@@ -206,9 +214,20 @@ typedef struct
     /* */
     vlc_tick_t     i_buffering_delay;
 
-    /* */
-    ts_storage_t   *p_storage_r;
-    ts_storage_t   *p_storage_w;
+    /* Segments, oldest first. The last one is being written, the ones
+     * before i_storage_r were played and are kept as history */
+    int            i_storage;
+    ts_storage_t   **pp_storage;
+    int            i_storage_r;
+
+    /* Oldest position that can be replayed */
+    int            i_barrier_storage;
+    int            i_barrier_cmd;
+
+    vlc_tick_t     i_window;
+    bool           b_history_full; /* The window was cut short once */
+    vlc_tick_t     i_read_date;
+    vlc_tick_t     i_jump;
 
     vlc_tick_t     i_cmd_delay;
 
@@ -227,6 +246,8 @@ typedef struct
     /* Configuration */
     int64_t        i_tmp_size_max;    /* Maximal temporary file size in byte */
     char           *psz_tmp_path;     /* Path for temporary files */
+    vlc_tick_t     i_window;          /* Duration of played data to keep */
+    bool           b_window_failed;   /* Do not retry to record the window */
 
     /* Lock for all following fields */
     vlc_mutex_t    lock;
@@ -258,6 +279,7 @@ static void         TsPushCmd( ts_thread_t *, ts_cmd_t * );
 static int          TsPopCmdLocked( ts_thread_t *, ts_cmd_t *, bool b_flush );
 static bool         TsHasCmd( ts_thread_t * );
 static bool         TsIsUnused( ts_thread_t * );
+static int          TsJump( ts_thread_t *, vlc_tick_t i_delta );
 static int          TsChangePause( ts_thread_t *, bool b_source_paused, bool b_paused, vlc_tick_t i_date );
 static int          TsChangeRate( ts_thread_t *, float src_rate, float rate );
 
@@ -266,12 +288,18 @@ static void         *TsRun( void * );
 static ts_storage_t *TsStorageNew( const char *psz_path, int64_t i_tmp_size_max );
 static void         TsStorageDelete( ts_storage_t * );
 static void         TsStoragePack( ts_storage_t *p_storage );
+static void         TsStorageSeal( ts_storage_t *p_storage );
 static bool         TsStorageIsFull( ts_storage_t *, const ts_cmd_t *p_cmd );
 static bool         TsStorageIsEmpty( ts_storage_t * );
 static void         TsStoragePushCmd( ts_storage_t *, const ts_cmd_t *p_cmd, bool b_flush );
-static void         TsStoragePopCmd( ts_storage_t *p_storage, ts_cmd_t *p_cmd, bool b_flush );
+static bool         TsStoragePopCmd( ts_storage_t *p_storage, ts_cmd_t *p_cmd, bool b_flush );
+static int          TsStorageRetire( ts_storage_t * );
+static vlc_tick_t   TsStorageGetDate( ts_storage_t *, int i_cmd );
 
 static void CmdClean( ts_cmd_t * );
+static void CmdExecute( es_out_t *, ts_cmd_t * );
+static bool CmdIsReplayable( const ts_cmd_t * );
+static bool CmdIsBarrier( const ts_cmd_t * );
 static void cmd_cleanup_routine( void *p ) { CmdClean( p ); }
 
 static int  CmdInitAdd    ( ts_cmd_t *, es_out_id_t *, const es_format_t *, bool b_copy );
@@ -318,6 +346,7 @@ es_out_t *input_EsOutTimeshiftNew( input_thread_t *p_input, es_out_t *p_next_out
 
     p_sys->b_delayed = false;
     p_sys->p_ts = NULL;
+    p_sys->b_window_failed = false;
 
     TAB_INIT( p_sys->i_es, p_sys->pp_es );
 
@@ -330,6 +359,11 @@ es_out_t *input_EsOutTimeshiftNew( input_thread_t *p_input, es_out_t *p_next_out
     msg_Dbg( p_input, "using timeshift granularity of %d MiB",
              (int)p_sys->i_tmp_size_max/(1024*1024) );
 
+    p_sys->i_window = vlc_tick_from_sec( var_InheritInteger( p_input, "input-timeshift-window" ) );
+    if( p_sys->i_window > 0 )
+        msg_Dbg( p_input, "using timeshift window of %"PRId64" s",
+                 SEC_FROM_VLC_TICK(p_sys->i_window) );
+
     p_sys->psz_tmp_path = var_InheritString( p_input, "input-timeshift-path" );
 #if defined (_WIN32) && !VLC_WINSTORE_APP
     if( p_sys->psz_tmp_path == NULL )
@@ -450,6 +484,15 @@ static int Send( es_out_t *p_out, es_out_id_t *p_es, block_t *p_block )
 
     TsAutoStop( p_out );
 
+    /* Live streams are always recorded when a window is configured */
+    if( !p_sys->b_delayed && p_sys->i_window > 0 && !p_sys->b_window_failed &&
+        !input_priv(p_sys->p_input)->b_can_pace_control &&
+        TsStart( p_out ) )
+    {
+        msg_Warn( p_sys->p_input, "es out timeshift: cannot record the window" );
+        p_sys->b_window_failed = true;
+    }
+
     CmdInitSend( &cmd, p_es, p_block );
     if( p_sys->b_delayed )
         TsPushCmd( p_sys->p_ts, &cmd );
@@ -716,6 +759,14 @@ static int ControlLocked( es_out_t *p_out, int i_query, va_list args )
     {
         return ControlLockedSetFrameNext( p_out );
     }
+    case ES_OUT_JUMP_TIMESHIFT:
+    {
+        const vlc_tick_t i_delta = va_arg( args, vlc_tick_t );
+
+        if( !p_sys->b_delayed || p_sys->i_window <= 0 )
+            return VLC_EGENERIC;
+        return TsJump( p_sys->p_ts, i_delta );
+    }
 
     case ES_OUT_GET_PCR_SYSTEM:
         if( p_sys->b_delayed )
@@ -811,8 +862,13 @@ static int TsStart( es_out_t *p_out )
     p_ts->i_rate_delay = 0;
     p_ts->i_buffering_delay = 0;
     p_ts->i_cmd_delay = 0;
-    p_ts->p_storage_r = NULL;
-    p_ts->p_storage_w = NULL;
+    TAB_INIT( p_ts->i_storage, p_ts->pp_storage );
+    p_ts->i_storage_r = 0;
+    p_ts->i_barrier_storage = 0;
+    p_ts->i_barrier_cmd = 0;
+    p_ts->i_window = p_sys->i_window;
+    p_ts->i_read_date = -1;
+    p_ts->i_jump = 0;
 
     p_sys->b_delayed = true;
     if( vlc_clone( &p_ts->thread, TsRun, p_ts, VLC_THREAD_PRIORITY_INPUT ) )
@@ -845,18 +901,9 @@ static void TsStop( ts_thread_t *p_ts )
     vlc_join( p_ts->thread, NULL );
 
     vlc_mutex_lock( &p_ts->lock );
-    for( ;; )
-    {
-        ts_cmd_t cmd;
-
-        if( TsPopCmdLocked( p_ts, &cmd, true ) )
-            break;
-
-        CmdClean( &cmd );
-    }
-    assert( !p_ts->p_storage_r || !p_ts->p_storage_r->p_next );
-    if( p_ts->p_storage_r )
-        TsStorageDelete( p_ts->p_storage_r );
+    for( int i = 0; i < p_ts->i_storage; i++ )
+        TsStorageDelete( p_ts->pp_storage[i] );
+    TAB_CLEAN( p_ts->i_storage, p_ts->pp_storage );
     vlc_mutex_unlock( &p_ts->lock );
 
     TsDestroy( p_ts );
@@ -865,7 +912,10 @@ static void TsPushCmd( ts_thread_t *p_ts, ts_cmd_t *p_cmd )
 {
     vlc_mutex_lock( &p_ts->lock );
 
-    if( !p_ts->p_storage_w || TsStorageIsFull( p_ts->p_storage_w, p_cmd ) )
+    ts_storage_t *p_storage_w = p_ts->i_storage > 0 ?
+                                p_ts->pp_storage[p_ts->i_storage - 1] : NULL;
+
+    if( !p_storage_w || TsStorageIsFull( p_storage_w, p_cmd ) )
     {
         ts_storage_t *p_storage = TsStorageNew( p_ts->psz_tmp_path, p_ts->i_tmp_size_max );
 
@@ -877,52 +927,116 @@ static void TsPushCmd( ts_thread_t *p_ts, ts_cmd_t *p_cmd )
             return;
         }
 
-        if( !p_ts->p_storage_w )
+        if( p_storage_w )
         {
-            p_ts->p_storage_r = p_ts->p_storage_w = p_storage;
-        }
-        else
-        {
-            TsStoragePack( p_ts->p_storage_w );
-            p_ts->p_storage_w->p_next = p_storage;
-            p_ts->p_storage_w = p_storage;
+            TsStoragePack( p_storage_w );
+            TsStorageSeal( p_storage_w );
         }
+        TAB_APPEND( p_ts->i_storage, p_ts->pp_storage, p_storage );
+        p_storage_w = p_storage;
     }
 
     /* TODO return error and warn the user (but only once) */
-    TsStoragePushCmd( p_ts->p_storage_w, p_cmd, p_ts->p_storage_r == p_ts->p_storage_w );
+    TsStoragePushCmd( p_storage_w, p_cmd, p_ts->i_storage_r == p_ts->i_storage - 1 );
 
     vlc_cond_signal( &p_ts->wait );
 
     vlc_mutex_unlock( &p_ts->lock );
 }
-static int TsPopCmdLocked( ts_thread_t *p_ts, ts_cmd_t *p_cmd, bool b_flush )
+static void TsDropStoragesLocked( ts_thread_t *p_ts, int i_count )
 {
     vlc_mutex_assert( &p_ts->lock );
+    assert( i_count <= p_ts->i_storage_r );
 
-    if( TsStorageIsEmpty( p_ts->p_storage_r ) )
-        return VLC_EGENERIC;
+    for( int i = 0; i < i_count; i++ )
+    {
+        TsStorageDelete( p_ts->pp_storage[0] );
+        TAB_ERASE( p_ts->i_storage, p_ts->pp_storage, 0 );
+    }
+    p_ts->i_storage_r -= i_count;
 
-    TsStoragePopCmd( p_ts->p_storage_r, p_cmd, b_flush );
+    if( p_ts->i_barrier_storage >= i_count )
+    {
+        p_ts->i_barrier_storage -= i_count;
+    }
+    else
+    {
+        p_ts->i_barrier_storage = 0;
+        p_ts->i_barrier_cmd = 0;
+    }
+}
+static void TsNextStorageLocked( ts_thread_t *p_ts )
+{
+    ts_storage_t *p_storage = p_ts->pp_storage[p_ts->i_storage_r++];
 
-    while( TsStorageIsEmpty( p_ts->p_storage_r ) )
+    /* Keep the played segment as history if possible, otherwise nothing
+     * before the new read position can be replayed anymore */
+    if( p_ts->i_window <= 0 || TsStorageRetire( p_storage ) )
     {
-        ts_storage_t *p_next = p_ts->p_storage_r->p_next;
-        if( !p_next )
-            break;
+        TsDropStoragesLocked( p_ts, p_ts->i_storage_r );
+        return;
+    }
 
-        TsStorageDelete( p_ts->p_storage_r );
-        p_ts->p_storage_r = p_next;
+    /* The window spans many segments: make the next ones larger, so that
+     * the history covers it with a bounded number of files */
+    if( p_ts->i_storage_r > TS_HISTORY_MAX / 2 &&
+        p_ts->i_tmp_size_max < TS_SEGMENT_SIZE_MAX )
+    {
+        p_ts->i_tmp_size_max = __MIN( 2 * p_ts->i_tmp_size_max,
+                                      TS_SEGMENT_SIZE_MAX );
+        msg_Dbg( p_ts->p_input, "es out timeshift: using %d MiB segments",
+                 (int)(p_ts->i_tmp_size_max / (1024*1024)) );
     }
 
-    return VLC_SUCCESS;
+    if( p_ts->i_storage_r > TS_HISTORY_MAX )
+    {
+        if( !p_ts->b_history_full )
+        {
+            msg_Warn( p_ts->p_input, "es out timeshift: the history is full, "
+                      "the window is cut short" );
+            p_ts->b_history_full = true;
+        }
+        TsDropStoragesLocked( p_ts, p_ts->i_storage_r - TS_HISTORY_MAX );
+    }
+}
+static int TsPopCmdLocked( ts_thread_t *p_ts, ts_cmd_t *p_cmd, bool b_flush )
+{
+    vlc_mutex_assert( &p_ts->lock );
+
+    while( p_ts->i_storage_r < p_ts->i_storage )
+    {
+        ts_storage_t *p_storage = p_ts->pp_storage[p_ts->i_storage_r];
+
+        if( TsStoragePopCmd( p_storage, p_cmd, b_flush ) )
+        {
+            /* History is not replayed across a change of the ES layout */
+            if( CmdIsBarrier( p_cmd ) )
+            {
+                p_ts->i_barrier_storage = p_ts->i_storage_r;
+                p_ts->i_barrier_cmd = p_storage->i_cmd_r;
+            }
+            return VLC_SUCCESS;
+        }
+
+        if( p_ts->i_storage_r + 1 >= p_ts->i_storage )
+            break;
+        TsNextStorageLocked( p_ts );
+    }
+    return VLC_EGENERIC;
+}
+static bool TsHasCmdLocked( ts_thread_t *p_ts )
+{
+    if( p_ts->i_storage_r + 1 < p_ts->i_storage )
+        return true;
+    return p_ts->i_storage > 0 &&
+           !TsStorageIsEmpty( p_ts->pp_storage[p_ts->i_storage_r] );
 }
 static bool TsHasCmd( ts_thread_t *p_ts )
 {
     bool b_cmd;
 
     vlc_mutex_lock( &p_ts->lock );
-    b_cmd = !TsStorageIsEmpty( p_ts->p_storage_r );
+    b_cmd = TsHasCmdLocked( p_ts );
     vlc_mutex_unlock( &p_ts->lock );
 
     return b_cmd;
@@ -934,11 +1048,164 @@ static bool TsIsUnused( ts_thread_t *p_ts )
     vlc_mutex_lock( &p_ts->lock );
     b_unused = !p_ts->b_paused &&
                p_ts->rate == p_ts->rate_source &&
-               TsStorageIsEmpty( p_ts->p_storage_r );
+               p_ts->i_window <= 0 &&
+               !TsHasCmdLocked( p_ts );
     vlc_mutex_unlock( &p_ts->lock );
 
     return b_unused;
 }
+/* The lock is released while commands are executed, the caller must not
+ * rely on any segment index afterwards. Only the timeshift thread seeks. */
+static void TsSeekLocked( ts_thread_t *p_ts, int i_storage, int i_cmd, vlc_tick_t i_date )
+{
+    ts_storage_t *p_target = p_ts->pp_storage[i_storage];
+
+    vlc_mutex_assert( &p_ts->lock );
+
+    if( i_storage < p_ts->i_storage_r ||
+        ( i_storage == p_ts->i_storage_r && i_cmd < p_target->i_cmd_r ) )
+    {
+        /* Backward, within the history */
+        for( int i = i_storage + 1; i <= p_ts->i_storage_r; i++ )
+            p_ts->pp_storage[i]->i_cmd_r = 0;
+        p_target->i_cmd_r = i_cmd;
+        p_ts->i_storage_r = i_storage;
+    }
+    else
+    {
+        /* Forward: drop the data but keep the ES state up to date.
+         * Only this thread removes segments, so the target stays valid
+         * while the lock is released. */
+        ts_cmd_t cmd;
+
+        while( ( p_ts->pp_storage[p_ts->i_storage_r] != p_target ||
+                 p_target->i_cmd_r < i_cmd ) &&
+               !TsPopCmdLocked( p_ts, &cmd, true ) )
+        {
+            if( CmdIsReplayable( &cmd ) )
+            {
+                CmdClean( &cmd );
+                continue;
+            }
+            vlc_mutex_unlock( &p_ts->lock );
+            CmdExecute( p_ts->p_out, &cmd );
+            vlc_mutex_lock( &p_ts->lock );
+        }
+    }
+
+    /* Play the new position where the previous command was */
+    vlc_mutex_unlock( &p_ts->lock );
+    es_out_Control( p_ts->p_out, ES_OUT_RESET_PCR );
+    vlc_mutex_lock( &p_ts->lock );
+
+    if( p_ts->i_read_date >= 0 )
+        p_ts->i_cmd_delay += p_ts->i_rate_delay + p_ts->i_read_date - i_date;
+    p_ts->i_rate_date = -1;
+    p_ts->i_rate_delay = 0;
+    p_ts->i_read_date = i_date;
+}
+static bool TsJumpLocked( ts_thread_t *p_ts )
+{
+    const vlc_tick_t i_target = p_ts->i_read_date + p_ts->i_jump;
+
+    vlc_mutex_assert( &p_ts->lock );
+
+    p_ts->i_jump = 0;
+    if( p_ts->i_storage <= 0 || p_ts->i_read_date < 0 )
+        return false;
+
+    /* Last segment starting before the target */
+    int i_storage = p_ts->i_barrier_storage;
+    int i_last = p_ts->i_storage - 1;
+    while( i_storage < i_last )
+    {
+        const int i_mid = ( i_storage + i_last + 1 ) / 2;
+
+        if( p_ts->pp_storage[i_mid]->i_date_first <= i_target )
+            i_storage = i_mid;
+        else
+            i_last = i_mid - 1;
+    }
+
+    /* First command of that segment not before the target */
+    ts_storage_t *p_storage = p_ts->pp_storage[i_storage];
+    int i_cmd = i_storage == p_ts->i_barrier_storage ? p_ts->i_barrier_cmd : 0;
+    int i_end = p_storage->i_cmd_w;
+    while( i_cmd < i_end )
+    {
+        const int i_mid = ( i_cmd + i_end ) / 2;
+
+        if( TsStorageGetDate( p_storage, i_mid ) < i_target )
+            i_cmd = i_mid + 1;
+        else
+            i_end = i_mid;
+    }
+
+    vlc_tick_t i_date;
+    if( i_cmd < p_storage->i_cmd_w )
+    {
+        i_date = TsStorageGetDate( p_storage, i_cmd );
+    }
+    else if( i_storage + 1 < p_ts->i_storage )
+    {
+        i_storage++;
+        i_cmd = 0;
+        i_date = p_ts->pp_storage[i_storage]->i_date_first;
+    }
+    else
+    {
+        /* Live */
+        i_date = __MIN( i_target, vlc_tick_now() );
+    }
+
+    msg_Dbg( p_ts->p_input, "es out timeshift: jump by %"PRId64" ms",
+             MS_FROM_VLC_TICK(i_date - p_ts->i_read_date) );
+    TsSeekLocked( p_ts, i_storage, i_cmd, i_date );
+    return true;
+}
+static bool TsReclaimLocked( ts_thread_t *p_ts )
+{
+    bool b_moved = false;
+
+    vlc_mutex_assert( &p_ts->lock );
+
+    if( p_ts->i_window <= 0 || p_ts->i_storage <= 0 )
+        return false;
+
+    const vlc_tick_t i_limit = vlc_tick_now() - p_ts->i_window;
+
+    /* Unplayed segments already out of the window (long pause) */
+    int i_skip = p_ts->i_storage_r;
+    while( i_skip + 1 < p_ts->i_storage &&
+           p_ts->pp_storage[i_skip]->i_date_last < i_limit )
+        i_skip++;
+    if( i_skip > p_ts->i_storage_r )
+    {
+        msg_Warn( p_ts->p_input, "es out timeshift: skipping data older than the window" );
+        TsSeekLocked( p_ts, i_skip, 0, p_ts->pp_storage[i_skip]->i_date_first );
+        b_moved = true;
+    }
+
+    /* Played segments out of the window or before the barrier */
+    int i_drop = p_ts->i_barrier_storage;
+    while( i_drop < p_ts->i_storage_r &&
+           p_ts->pp_storage[i_drop]->i_date_last < i_limit )
+        i_drop++;
+    if( i_drop > 0 )
+        TsDropStoragesLocked( p_ts, i_drop );
+
+    return b_moved;
+}
+static int TsJump( ts_thread_t *p_ts, vlc_tick_t i_delta )
+{
+    /* The jump is done asynchronously by the timeshift thread */
+    vlc_mutex_lock( &p_ts->lock );
+    p_ts->i_jump += i_delta;
+    vlc_cond_signal( &p_ts->wait );
+    vlc_mutex_unlock( &p_ts->lock );
+
+    return VLC_SUCCESS;
+}
 static int TsChangePause( ts_thread_t *p_ts, bool b_source_paused, bool b_paused, vlc_tick_t i_date )
 {
     vlc_mutex_lock( &p_ts->lock );
@@ -1007,6 +1274,10 @@ static void *TsRun( void *p_data )
         for( ;; )
         {
             const int canc = vlc_savecancel();
+            if( TsReclaimLocked( p_ts ) )
+                i_buffering_date = -1;
+            if( p_ts->i_jump != 0 && TsJumpLocked( p_ts ) )
+                i_buffering_date = -1;
             b_buffering = es_out_GetBuffering( p_ts->p_out );
 
             if( ( !p_ts->b_paused || b_buffering ) && !TsPopCmdLocked( p_ts, &cmd, false ) )
@@ -1019,6 +1290,8 @@ static void *TsRun( void *p_data )
             vlc_cond_wait( &p_ts->wait, &p_ts->lock );
         }
 
+        p_ts->i_read_date = cmd.i_date;
+
         if( b_buffering && i_buffering_date < 0 )
         {
             i_buffering_date = cmd.i_date;
@@ -1081,27 +1354,7 @@ static void *TsRun( void *p_data )
 
         /* Execute the command  */
         const int canc = vlc_savecancel();
-        switch( cmd.i_type )
-        {
-        case C_ADD:
-            CmdExecuteAdd( p_ts->p_out, &cmd );
-            CmdCleanAdd( &cmd );
-            break;
-        case C_SEND:
-            CmdExecuteSend( p_ts->p_out, &cmd );
-            CmdCleanSend( &cmd );
-            break;
-        case C_CONTROL:
-            CmdExecuteControl( p_ts->p_out, &cmd );
-            CmdCleanControl( &cmd );
-            break;
-        case C_DEL:
-            CmdExecuteDel( p_ts->p_out, &cmd );
-            break;
-        default:
-            vlc_assert_unreachable();
-            break;
-        }
+        CmdExecute( p_ts->p_out, &cmd );
         vlc_restorecancel( canc );
     }
 
@@ -1147,15 +1400,20 @@ static ts_storage_t *TsStorageNew( const char *psz_tmp_path, int64_t i_tmp_size_
 #else
     p_storage->psz_file = psz_file;
 #endif
-    p_storage->p_next = NULL;
 
     /* */
     p_storage->i_file_max = i_tmp_size_max;
     p_storage->i_file_size = 0;
 
+    /* */
+    p_storage->i_date_first = -1;
+    p_storage->i_date_last = -1;
+
     /* */
     p_storage->i_cmd_w = 0;
     p_storage->i_cmd_r = 0;
+    p_storage->i_cmd_done = 0;
+    p_storage->i_cmd_offset = -1;
     p_storage->i_cmd_max = 30000;
     p_storage->p_cmd = vlc_alloc( p_storage->i_cmd_max, sizeof(*p_storage->p_cmd) );
     //fprintf( stderr, "\nSTORAGE name=%s size=%d KiB\n", p_storage->psz_file, p_storage->i_cmd_max * sizeof(*p_storage->p_cmd) /1024 );
@@ -1174,17 +1432,13 @@ error:
 
 static void TsStorageDelete( ts_storage_t *p_storage )
 {
-    while( p_storage->i_cmd_r < p_storage->i_cmd_w )
-    {
-        ts_cmd_t cmd;
-
-        TsStoragePopCmd( p_storage, &cmd, true );
-
-        CmdClean( &cmd );
-    }
+    /* Only the commands never executed still own their data */
+    for( int i = p_storage->i_cmd_done; i < p_storage->i_cmd_w; i++ )
+        CmdClean( &p_storage->p_cmd[i] );
     free( p_storage->p_cmd );
 
-    fclose( p_storage->p_filer );
+    if( p_storage->p_filer )
+        fclose( p_storage->p_filer );
     fclose( p_storage->p_filew );
 #ifdef _WIN32
     vlc_unlink( p_storage->psz_file );
@@ -1205,6 +1459,21 @@ static void TsStoragePack( ts_storage_t *p_storage )
     if( p_new )
         p_storage->p_cmd = p_new;
 }
+static void TsStorageSeal( ts_storage_t *p_storage )
+{
+    /* Nothing is appended to the data anymore: read it through the writing
+     * handle, so that only the segment being written holds two files */
+    if( !p_storage->p_filer )
+        return;
+
+    fflush( p_storage->p_filew );
+    fclose( p_storage->p_filer );
+    p_storage->p_filer = NULL;
+}
+static FILE *TsStorageReader( ts_storage_t *p_storage )
+{
+    return p_storage->p_filer ? p_storage->p_filer : p_storage->p_filew;
+}
 static bool TsStorageIsFull( ts_storage_t *p_storage, const ts_cmd_t *p_cmd )
 {
     if( p_cmd && p_cmd->i_type == C_SEND && p_storage->i_cmd_w > 0 )
@@ -1226,6 +1495,10 @@ static void TsStoragePushCmd( ts_storage_t *p_storage, const ts_cmd_t *p_cmd, bo
 
     assert( !TsStorageIsFull( p_storage, p_cmd ) );
 
+    if( p_storage->i_cmd_w == 0 )
+        p_storage->i_date_first = cmd.i_date;
+    p_storage->i_date_last = cmd.i_date;
+
     if( cmd.i_type == C_SEND )
     {
         block_t *p_block = cmd.u.send.p_block;
@@ -1255,18 +1528,81 @@ static void TsStoragePushCmd( ts_storage_t *p_storage, const ts_cmd_t *p_cmd, bo
     }
     p_storage->p_cmd[p_storage->i_cmd_w++] = cmd;
 }
-static void TsStoragePopCmd( ts_storage_t *p_storage, ts_cmd_t *p_cmd, bool b_flush )
+static int TsStorageReadCmd( ts_storage_t *p_storage, int i_cmd, ts_cmd_t *p_cmd )
 {
-    assert( !TsStorageIsEmpty( p_storage ) );
+    if( p_storage->p_cmd )
+    {
+        *p_cmd = p_storage->p_cmd[i_cmd];
+        return VLC_SUCCESS;
+    }
+
+    FILE *p_file = TsStorageReader( p_storage );
+
+    if( fseek( p_file, p_storage->i_cmd_offset + i_cmd * (long)sizeof(*p_cmd), SEEK_SET ) ||
+        fread( p_cmd, sizeof(*p_cmd), 1, p_file ) != 1 )
+        return VLC_EGENERIC;
+    return VLC_SUCCESS;
+}
+static vlc_tick_t TsStorageGetDate( ts_storage_t *p_storage, int i_cmd )
+{
+    ts_cmd_t cmd;
+
+    if( TsStorageReadCmd( p_storage, i_cmd, &cmd ) )
+        return p_storage->i_date_last;
+    return cmd.i_date;
+}
+static int TsStorageRetire( ts_storage_t *p_storage )
+{
+    assert( p_storage->i_cmd_done == p_storage->i_cmd_w );
+
+    if( !p_storage->p_cmd )
+        return VLC_SUCCESS;
+
+    /* Move the (already executed) commands after the data, they are only
+     * needed to replay it */
+    if( fseek( p_storage->p_filew, 0, SEEK_END ) )
+        return VLC_EGENERIC;
+
+    const long i_offset = ftell( p_storage->p_filew );
+    if( i_offset < 0 ||
+        fwrite( p_storage->p_cmd, sizeof(*p_storage->p_cmd), p_storage->i_cmd_w,
+                p_storage->p_filew ) != (size_t)p_storage->i_cmd_w ||
+        fflush( p_storage->p_filew ) )
+        return VLC_EGENERIC;
+
+    free( p_storage->p_cmd );
+    p_storage->p_cmd = NULL;
+    p_storage->i_cmd_max = 0;
+    p_storage->i_cmd_offset = i_offset;
+    return VLC_SUCCESS;
+}
+static bool TsStoragePopCmd( ts_storage_t *p_storage, ts_cmd_t *p_cmd, bool b_flush )
+{
+    for( ;; )
+    {
+        if( TsStorageIsEmpty( p_storage ) )
+            return false;
+
+        const bool b_history = p_storage->i_cmd_r < p_storage->i_cmd_done;
+
+        if( TsStorageReadCmd( p_storage, p_storage->i_cmd_r++, p_cmd ) )
+            continue;
+
+        if( !b_history )
+            p_storage->i_cmd_done = p_storage->i_cmd_r;
+        else if( !CmdIsReplayable( p_cmd ) )
+            continue;
+        break;
+    }
 
-    *p_cmd = p_storage->p_cmd[p_storage->i_cmd_r++];
     if( p_cmd->i_type == C_SEND )
     {
+        FILE *p_file = TsStorageReader( p_storage );
         block_t block;
 
         if( !b_flush &&
-            !fseek( p_storage->p_filer, p_cmd->u.send.i_offset, SEEK_SET ) &&
-            fread( &block, sizeof(block), 1, p_storage->p_filer ) == 1 )
+            !fseek( p_file, p_cmd->u.send.i_offset, SEEK_SET ) &&
+            fread( &block, sizeof(block), 1, p_file ) == 1 )
         {
             block_t *p_block = block_Alloc( block.i_buffer );
             if( p_block )
@@ -1276,7 +1612,7 @@ static void TsStoragePopCmd( ts_storage_t *p_storage, ts_cmd_t *p_cmd, bool b_fl
                 p_block->i_flags    = block.i_flags;
                 p_block->i_length   = block.i_length;
                 p_block->i_nb_samples = block.i_nb_samples;
-                p_block->i_buffer = fread( p_block->p_buffer, 1, block.i_buffer, p_storage->p_filer );
+                p_block->i_buffer = fread( p_block->p_buffer, 1, block.i_buffer, p_file );
             }
             p_cmd->u.send.p_block = p_block;
         }
@@ -1286,6 +1622,7 @@ static void TsStoragePopCmd( ts_storage_t *p_storage, ts_cmd_t *p_cmd, bool b_fl
             p_cmd->u.send.p_block = block_Alloc( 1 );
         }
     }
+    return true;
 }
 
 /*****************************************************************************
@@ -1311,6 +1648,58 @@ static void CmdClean( ts_cmd_t *p_cmd )
         break;
     }
 }
+static void CmdExecute( es_out_t *p_out, ts_cmd_t *p_cmd )
+{
+    switch( p_cmd->i_type )
+    {
+    case C_ADD:
+        CmdExecuteAdd( p_out, p_cmd );
+        CmdCleanAdd( p_cmd );
+        break;
+    case C_SEND:
+        CmdExecuteSend( p_out, p_cmd );
+        CmdCleanSend( p_cmd );
+        break;
+    case C_CONTROL:
+        CmdExecuteControl( p_out, p_cmd );
+        CmdCleanControl( p_cmd );
+        break;
+    case C_DEL:
+        CmdExecuteDel( p_out, p_cmd );
+        break;
+    default:
+        vlc_assert_unreachable();
+        break;
+    }
+}
+/* Commands executed again when jumping back in the history, the other ones
+ * changed a state that is kept */
+static bool CmdIsReplayable( const ts_cmd_t *p_cmd )
+{
+    if( p_cmd->i_type == C_SEND )
+        return true;
+    if( p_cmd->i_type != C_CONTROL )
+        return false;
+
+    switch( p_cmd->u.control.i_query )
+    {
+    case ES_OUT_SET_PCR:
+    case ES_OUT_SET_GROUP_PCR:
+    case ES_OUT_SET_TIMES:
+        return true;
+    default:
+        return false;
+    }
+}
+/* Commands after which the history can not be replayed */
+static bool CmdIsBarrier( const ts_cmd_t *p_cmd )
+{
+    if( p_cmd->i_type == C_DEL )
+        return true;
+    return p_cmd->i_type == C_CONTROL &&
+           ( p_cmd->u.control.i_query == ES_OUT_SET_ES_FMT ||
+             p_cmd->u.control.i_query == ES_OUT_RESTART_ES );
+}
 
 static int CmdInitAdd( ts_cmd_t *p_cmd, es_out_id_t *p_es, const es_format_t *p_fmt, bool b_copy )
 {
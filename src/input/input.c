@@ -1935,6 +1935,15 @@ static bool Control( input_thread_t *p_input,
                 break;
             }
 
+            /* Relative jumps within the timeshift window do not need the
+             * demuxer (which is usually not seekable anyway) */
+            if( !absolute &&
+                !es_out_JumpTimeshift( priv->p_es_out, param.time.i_val ) )
+            {
+                b_force_update = true;
+                break;
+            }
+
             /* Reset the decoders states and clock sync (before calling the demuxer */
             es_out_Control( priv->p_es_out, ES_OUT_RESET_PCR );
 
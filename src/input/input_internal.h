@@ -346,6 +346,7 @@ typedef struct input_rate_t
 
 struct input_stats {
     input_rate_t input_bitrate;
+    atomic_uintmax_t input_lost;
     input_rate_t demux_bitrate;
     atomic_uintmax_t demux_corrupted;
     atomic_uintmax_t demux_discontinuity;
@@ -58,6 +58,7 @@ struct input_stats *input_stats_Create(void)
         return NULL;
 
     input_rate_Init(&stats->input_bitrate);
+    atomic_init(&stats->input_lost, 0);
     input_rate_Init(&stats->demux_bitrate);
     atomic_init(&stats->demux_corrupted, 0);
     atomic_init(&stats->demux_discontinuity, 0);
@@ -85,6 +86,8 @@ void input_stats_Compute(struct input_stats *stats, input_stats_t *st)
     st->i_read_bytes = stats->input_bitrate.value;
     st->f_input_bitrate = stats_GetRate(&stats->input_bitrate);
     vlc_mutex_unlock(&stats->input_bitrate.lock);
+    st->i_lost_packets = atomic_load_explicit(&stats->input_lost,
+                                              memory_order_relaxed);
 
     vlc_mutex_lock(&stats->demux_bitrate.lock);
     st->i_demux_read_bytes = stats->demux_bitrate.value;
@@ -387,6 +387,18 @@ static const char *const ppsz_pos_descriptions[] =
     "picture quality, for instance deinterlacing, or distort " \
     "the video.")
 
+#define VIDEO_FILTER_AHEAD_TEXT N_("Pictures filtered ahead")
+#define VIDEO_FILTER_AHEAD_LONGTEXT N_( \
+    "Number of pictures the video filters process in a separate thread " \
+    "while the current picture is displayed. This helps with heavy " \
+    "filters, at the cost of memory. 0 filters each picture just before " \
+    "its display.")
+
+#define VIDEO_FILTER_THREADS_TEXT N_("Video filter threads")
+#define VIDEO_FILTER_THREADS_LONGTEXT N_( \
+    "Number of threads sharing the processing of the pictures, for the " \
+    "video filters supporting it. 0 uses one thread per processor.")
+
 #define SNAP_PATH_TEXT N_("Video snapshot directory (or filename)")
 #define SNAP_PATH_LONGTEXT N_( \
     "Directory where the video snapshots will be stored.")
@@ -696,6 +708,14 @@ static const char *const ppsz_prefres[] = {
     "This is the maximum size in bytes of the temporary files " \
     "that will be used to store the timeshifted streams." )
 
+#define INPUT_TIMESHIFT_WINDOW_TEXT N_("Timeshift window")
+#define INPUT_TIMESHIFT_WINDOW_LONGTEXT N_( \
+    "Duration in seconds of already played live stream that is kept on " \
+    "disk, so that it is possible to jump back within it. " \
+    "Older data is reclaimed in the background. 0 disables it. " \
+    "The history is limited to 64 files, which grow from the timeshift " \
+    "granularity up to 1 GiB each for long windows." )
+
 #define INPUT_TITLE_FORMAT_TEXT N_( "Change title according to current media" )
 #define INPUT_TITLE_FORMAT_LONGTEXT N_( "This option allows you to set the title according to what's being played<br>"  \
     "$a: Artist<br>$b: Album<br>$c: Copyright<br>$t: Title<br>$g: Genre<br>"  \
@@ -839,6 +859,11 @@ static const char *const ppsz_prefres[] = {
     "However allocation of port numbers below 1025 is usually restricted " \
     "by the operating system." )
 
+#define HTTP_THREADS_TEXT N_( "HTTP server threads" )
+#define HTTP_THREADS_LONGTEXT N_( \
+    "Number of threads serving the clients of each HTTP, HTTPS or RTSP " \
+    "server. Clients are spread among the threads." )
+
 #define HTTPS_PORT_TEXT N_( "HTTPS server port" )
 #define HTTPS_PORT_LONGTEXT N_( \
     "The HTTPS server will listen on this TCP port. " \
@@ -1037,6 +1062,18 @@ static const char *const ppsz_prefres[] = {
     "the correct demuxer is not automatically detected. You should not "\
     "set this as a global option unless you really know what you are doing." )
 
+#define DEMUX_INDEX_CACHE_TEXT N_("Cache seek indexes")
+#define DEMUX_INDEX_CACHE_LONGTEXT N_( \
+    "Demultiplexers that need to scan a file to seek into it (AVI without " \
+    "index, MKV without cues, MPEG-TS duration probing) store the result " \
+    "of the scan in the user cache directory, and reuse it the next time " \
+    "the same file is opened." )
+
+#define DEMUX_INDEX_CACHE_SIZE_TEXT N_("Seek indexes cache size (MiB)")
+#define DEMUX_INDEX_CACHE_SIZE_LONGTEXT N_( \
+    "Maximum size of the cached seek indexes. The oldest indexes are " \
+    "removed first when it is exceeded." )
+
 #define VOD_SERVER_TEXT N_("VoD server module")
 #define VOD_SERVER_LONGTEXT N_( \
     "You can select which VoD server module you want to use. Set this " \
@@ -1073,6 +1110,12 @@ static const char *const ppsz_prefres[] = {
     "Scan plugin directories for new plugins at startup. " \
     "This increases the startup time of VLC.")
 
+#define PLUGINS_LAZY_TEXT N_("Load plugins on demand")
+#define PLUGINS_LAZY_LONGTEXT N_( \
+    "Only load the plugins of a capability from the plugins cache when " \
+    "that capability is first needed. Plugin directories with a valid " \
+    "cache are then not scanned for new plugins.")
+
 #define KEYSTORE_TEXT N_("Preferred keystore list")
 #define KEYSTORE_LONGTEXT N_( \
     "List of keystores that VLC will use in priority." )
@@ -1145,10 +1188,26 @@ static const char *const ppsz_prefres[] = {
 #define PREPARSE_THREADS_LONGTEXT N_( \
     "Maximum number of threads used to preparse items" )
 
+#define PREPARSE_NETWORK_THREADS_TEXT N_( "Network preparsing threads" )
+#define PREPARSE_NETWORK_THREADS_LONGTEXT N_( \
+    "Maximum number of threads used to preparse network items. They are " \
+    "preparsed separately, so that slow servers do not delay local items." )
+
 #define FETCH_ART_THREADS_TEXT N_( "Fetch-art threads" )
 #define FETCH_ART_THREADS_LONGTEXT N_( \
     "Maximum number of threads used to fetch art" )
 
+#define FETCH_ART_NETWORK_THREADS_TEXT N_( "Network fetch-art threads" )
+#define FETCH_ART_NETWORK_THREADS_LONGTEXT N_( \
+    "Maximum number of threads used to search and download art from the " \
+    "network" )
+
+#define FETCH_ART_DOWNLOAD_THREADS_TEXT N_( "Art download threads" )
+#define FETCH_ART_DOWNLOAD_THREADS_LONGTEXT N_( \
+    "Maximum number of threads used to download the art found by the " \
+    "searches. They download separately, so that pending searches do not " \
+    "delay the art already found." )
+
 #define METADATA_NETWORK_TEXT N_( "Allow metadata network access" )
 
 static const char *const psz_recursive_list[] = {
@@ -1688,6 +1747,12 @@ vlc_module_begin ()
     set_subcategory( SUBCAT_VIDEO_VFILTER )
     add_module_list("video-filter", "video filter", NULL,
                     VIDEO_FILTER_TEXT, VIDEO_FILTER_LONGTEXT)
+    add_integer_with_range( "video-filter-ahead", 0, 0, 8,
+                            VIDEO_FILTER_AHEAD_TEXT,
+                            VIDEO_FILTER_AHEAD_LONGTEXT, true )
+    add_integer_with_range( "video-filter-threads", 0, 0, 16,
+                            VIDEO_FILTER_THREADS_TEXT,
+                            VIDEO_FILTER_THREADS_LONGTEXT, true )
 
 #if 0
     add_string( "pixel-ratio", "1", PIXEL_RATIO_TEXT, PIXEL_RATIO_TEXT )
@@ -1829,6 +1894,8 @@ vlc_module_begin ()
         change_integer_range( 1, 65535 )
     add_integer( "https-port", 8443, HTTPS_PORT_TEXT, HTTPS_PORT_LONGTEXT, true )
         change_integer_range( 1, 65535 )
+    add_integer( "http-threads", 1, HTTP_THREADS_TEXT, HTTP_THREADS_LONGTEXT, true )
+        change_integer_range( 1, 64 )
     add_string( "rtsp-host", NULL, RTSP_HOST_TEXT, RTSP_HOST_LONGTEXT, true )
     add_integer( "rtsp-port", 554, RTSP_PORT_TEXT, RTSP_PORT_LONGTEXT, true )
         change_integer_range( 1, 65535 )
@@ -1955,6 +2022,9 @@ vlc_module_begin ()
                   INPUT_TIMESHIFT_PATH_TEXT, INPUT_TIMESHIFT_PATH_LONGTEXT)
     add_integer( "input-timeshift-granularity", -1, INPUT_TIMESHIFT_GRANULARITY_TEXT,
                  INPUT_TIMESHIFT_GRANULARITY_LONGTEXT, true )
+    add_integer( "input-timeshift-window", 0, INPUT_TIMESHIFT_WINDOW_TEXT,
+                 INPUT_TIMESHIFT_WINDOW_LONGTEXT, true )
+        change_integer_range( 0, 86400 )
 
     add_string( "input-title-format", "$Z", INPUT_TITLE_FORMAT_TEXT, INPUT_TITLE_FORMAT_LONGTEXT, false );
 
@@ -1974,6 +2044,11 @@ vlc_module_begin ()
 
     set_subcategory( SUBCAT_INPUT_DEMUX )
     add_module("demux", "demux", "any", DEMUX_TEXT, DEMUX_LONGTEXT)
+    add_bool( "demux-index-cache", false,
+              DEMUX_INDEX_CACHE_TEXT, DEMUX_INDEX_CACHE_LONGTEXT, true )
+    add_integer( "demux-index-cache-size", 32, DEMUX_INDEX_CACHE_SIZE_TEXT,
+                 DEMUX_INDEX_CACHE_SIZE_LONGTEXT, true )
+        change_integer_range( 0, 4096 )
     set_subcategory( SUBCAT_INPUT_ACODEC )
     set_subcategory( SUBCAT_INPUT_SCODEC )
     add_obsolete_bool( "prefer-system-codecs" )
@@ -2060,6 +2135,8 @@ vlc_module_begin ()
               PLUGINS_CACHE_LONGTEXT, true )
     add_bool( "plugins-scan", true, PLUGINS_SCAN_TEXT,
               PLUGINS_SCAN_LONGTEXT, true )
+    add_bool( "plugins-lazy", false, PLUGINS_LAZY_TEXT,
+              PLUGINS_LAZY_LONGTEXT, true )
     add_obsolete_string( "plugin-path" ) /* since 2.0.0 */
 #endif
     add_obsolete_string( "data-path" ) /* since 2.1.0 */
@@ -2141,9 +2218,20 @@ vlc_module_begin ()
     add_integer( "preparse-threads", 1, PREPARSE_THREADS_TEXT,
                  PREPARSE_THREADS_LONGTEXT, false )
 
+    add_integer( "preparse-network-threads", 2, PREPARSE_NETWORK_THREADS_TEXT,
+                 PREPARSE_NETWORK_THREADS_LONGTEXT, false )
+
     add_integer( "fetch-art-threads", 1, FETCH_ART_THREADS_TEXT,
                  FETCH_ART_THREADS_LONGTEXT, false )
 
+    add_integer( "fetch-art-network-threads", 2,
+                 FETCH_ART_NETWORK_THREADS_TEXT,
+                 FETCH_ART_NETWORK_THREADS_LONGTEXT, false )
+
+    add_integer( "fetch-art-download-threads", 2,
+                 FETCH_ART_DOWNLOAD_THREADS_TEXT,
+                 FETCH_ART_DOWNLOAD_THREADS_LONGTEXT, false )
+
     add_obsolete_integer( "album-art" )
     add_bool( "metadata-network-access", false, METADATA_NETWORK_TEXT,
                  METADATA_NETWORK_TEXT, false )
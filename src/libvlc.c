@@ -99,6 +99,7 @@ libvlc_int_t * libvlc_InternalCreate( void )
     priv->main_playlist = NULL;
     priv->p_vlm = NULL;
     priv->media_source_provider = NULL;
+    priv->slices = NULL;
 
     vlc_ExitInit( &priv->exit );
 
@@ -475,10 +476,15 @@ void libvlc_InternalCleanup( libvlc_int_t *p_libvlc )
 
     libvlc_InternalActionsClean( p_libvlc );
 
+    vlc_slices_Destroy( priv->slices );
+
     /* Save the configuration */
     if( !var_InheritBool( p_libvlc, "ignore-config" ) )
         config_AutoSaveConfigFile( VLC_OBJECT(p_libvlc) );
 
+    if( var_InheritBool( p_libvlc, "stats" ) )
+        block_CacheDump( VLC_OBJECT(p_libvlc) );
+
     /* Free module bank. It is refcounted, so we call this each time  */
     vlc_LogDeinit (p_libvlc);
     module_EndBank (true);
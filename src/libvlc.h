@@ -43,6 +43,28 @@ int EnumClockSource( const char *, char ***, char *** );
 #endif
 void vlc_CPU_dump(vlc_object_t *);
 
+/*
+ * Block allocator
+ */
+struct vlc_block_cache_stats
+{
+    uintmax_t hits; /**< Allocations served from the cache */
+    uintmax_t misses; /**< Cacheable allocations not served from the cache */
+    uintmax_t requested; /**< Bytes requested by cacheable allocations */
+    uintmax_t rounded; /**< Bytes allocated, once rounded to a size class */
+    size_t in_flight; /**< Bytes of cacheable blocks in use */
+    size_t depot; /**< Bytes of free blocks in the global depot */
+};
+
+void block_CacheStats(struct vlc_block_cache_stats *);
+void block_CacheDump(vlc_object_t *);
+
+/*
+ * Video filter threads
+ */
+struct vlc_slices;
+void vlc_slices_Destroy(struct vlc_slices *);
+
 /*
  * Threads subsystem
  */
@@ -201,6 +223,7 @@ typedef struct libvlc_priv_t
     vlc_actions_t *actions; ///< Hotkeys handler
     struct vlc_medialibrary_t *p_media_library; ///< Media library instance
     struct vlc_thumbnailer_t *p_thumbnailer; ///< Lazily instantiated media thumbnailer
+    struct vlc_slices *slices; ///< Lazily instantiated video filter threads
 
     /* Exit callback */
     vlc_exit_t       exit;
@@ -34,6 +34,8 @@ struct task {
     void* id; /**< id associated with entity */
     void* entity; /**< the entity to process */
     vlc_tick_t timeout; /**< timeout duration in vlc_tick_t */
+    int priority; /**< tasks with a higher priority are taken first */
+    vlc_tick_t date; /**< date at which the task was queued */
 };
 
 struct background_worker;
@@ -57,15 +59,16 @@ struct background_worker {
     int nthreads; /**< number of threads in the threads list */
     struct vlc_list threads; /**< list of active background_thread instances */
 
-    struct vlc_list queue; /**< queue of tasks */
+    struct vlc_list queue; /**< queue of tasks, by decreasing priority */
     vlc_cond_t queue_wait; /**< wait for the queue to be non-empty */
+    struct background_worker_stats stats;
 
     vlc_cond_t nothreads_wait; /**< wait for nthreads == 0 */
     bool closing; /**< true if background worker deletion is requested */
 };
 
 static struct task *task_Create(struct background_worker *worker, void *id,
-                                void *entity, int timeout)
+                                void *entity, int timeout, int priority)
 {
     struct task *task = malloc(sizeof(*task));
     if (unlikely(!task))
@@ -74,6 +77,7 @@ static struct task *task_Create(struct background_worker *worker, void *id,
     task->id = id;
     task->entity = entity;
     task->timeout = timeout < 0 ? worker->conf.default_timeout : VLC_TICK_FROM_MS(timeout);
+    task->priority = priority;
     worker->conf.pf_hold(task->entity);
     return task;
 }
@@ -102,13 +106,45 @@ static struct task *QueueTake(struct background_worker *worker, int timeout_ms)
     assert(task);
     vlc_list_remove(&task->node);
 
+    struct background_worker_stats *stats = &worker->stats;
+    vlc_tick_t wait = vlc_tick_now() - task->date;
+    stats->queued--;
+    stats->started++;
+    stats->wait_total += wait;
+    if (wait > stats->wait_max)
+        stats->wait_max = wait;
+
     return task;
 }
 
+static void QueueInsert(struct background_worker *worker, struct task *task)
+{
+    vlc_mutex_assert(&worker->lock);
+
+    /* Most tasks have the same priority: look for the insertion point from
+     * the tail, so that they are queued in constant time */
+    struct task *prev = vlc_list_last_entry_or_null(&worker->queue,
+                                                    struct task, node);
+    while (prev && prev->priority < task->priority)
+        prev = vlc_list_prev_entry_or_null(&worker->queue, prev,
+                                           struct task, node);
+
+    if (prev)
+        vlc_list_add_after(&task->node, &prev->node);
+    else
+        vlc_list_prepend(&task->node, &worker->queue);
+}
+
 static void QueuePush(struct background_worker *worker, struct task *task)
 {
     vlc_mutex_assert(&worker->lock);
-    vlc_list_append(&task->node, &worker->queue);
+
+    task->date = vlc_tick_now();
+    QueueInsert(worker, task);
+
+    struct background_worker_stats *stats = &worker->stats;
+    if (++stats->queued > stats->max_queued)
+        stats->max_queued = stats->queued;
     vlc_cond_signal(&worker->queue_wait);
 }
 
@@ -122,6 +158,9 @@ static void QueueRemoveAll(struct background_worker *worker, void *id)
         {
             vlc_list_remove(&task->node);
             task_Destroy(worker, task);
+            worker->stats.queued--;
+            worker->stats.cancelled++;
+            worker->uncompleted--;
         }
     }
 }
@@ -163,6 +202,7 @@ static struct background_worker *background_worker_Create(void *owner,
     vlc_list_init(&worker->threads);
     vlc_list_init(&worker->queue);
     vlc_cond_init(&worker->queue_wait);
+    worker->stats = (struct background_worker_stats) { 0 };
     vlc_cond_init(&worker->nothreads_wait);
     worker->closing = false;
     return worker;
@@ -292,9 +332,9 @@ struct background_worker* background_worker_New( void* owner,
 }
 
 int background_worker_Push( struct background_worker* worker, void* entity,
-                        void* id, int timeout )
+                        void* id, int timeout, int priority )
 {
-    struct task *task = task_Create(worker, id, entity, timeout);
+    struct task *task = task_Create(worker, id, entity, timeout, priority);
     if (unlikely(!task))
         return VLC_ENOMEM;
 
@@ -333,6 +373,72 @@ void background_worker_Cancel( struct background_worker* worker, void* id )
     vlc_mutex_unlock(&worker->lock);
 }
 
+bool background_worker_Prioritize( struct background_worker* worker, void* id,
+                                  int priority,
+                                  void (*pf_merge)( void*, void* ), void* data )
+{
+    assert(id);
+
+    vlc_mutex_lock(&worker->lock);
+
+    /* Move the tasks to raise aside, then insert them back at their new rank,
+     * in their original order */
+    struct vlc_list raised;
+    vlc_list_init(&raised);
+
+    bool queued = false;
+    struct task *task;
+    vlc_list_foreach(task, &worker->queue, node)
+    {
+        if (task->id != id)
+            continue;
+
+        if (!queued && pf_merge != NULL)
+            pf_merge(task->entity, data);
+        queued = true;
+        if (task->priority < priority)
+        {
+            vlc_list_remove(&task->node);
+            task->priority = priority;
+            vlc_list_append(&task->node, &raised);
+        }
+    }
+
+    vlc_list_foreach(task, &raised, node)
+    {
+        vlc_list_remove(&task->node);
+        QueueInsert(worker, task);
+    }
+
+    vlc_mutex_unlock(&worker->lock);
+    return queued;
+}
+
+void background_worker_GetStats( struct background_worker* worker,
+                                 struct background_worker_stats* stats )
+{
+    vlc_mutex_lock(&worker->lock);
+    *stats = worker->stats;
+    stats->running = worker->uncompleted - stats->queued;
+    vlc_mutex_unlock(&worker->lock);
+}
+
+void background_worker_LogStats( struct background_worker* worker,
+                                 vlc_object_t* obj, const char* name )
+{
+    struct background_worker_stats stats;
+
+    background_worker_GetStats(worker, &stats);
+    if (stats.started == 0)
+        return;
+
+    msg_Dbg(obj, "%s: %"PRIu64" tasks, %u max queued, %"PRIu64" cancelled, "
+            "waited %"PRId64" ms on average, %"PRId64" ms at most", name,
+            stats.started, stats.max_queued, stats.cancelled,
+            MS_FROM_VLC_TICK(stats.wait_total / stats.started),
+            MS_FROM_VLC_TICK(stats.wait_max));
+}
+
 void background_worker_RequestProbe( struct background_worker* worker )
 {
     vlc_mutex_lock(&worker->lock);
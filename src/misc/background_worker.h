@@ -121,6 +121,22 @@ struct background_worker_config {
     void( *pf_stop )( void* owner, void* handle );
 };
 
+/**
+ * Background-worker statistics
+ *
+ * Snapshot of the state of a background-worker, and of its activity since it
+ * was created, as returned by \ref background_worker_GetStats.
+ **/
+struct background_worker_stats {
+    unsigned queued; /**< number of tasks waiting in the queue */
+    unsigned running; /**< number of tasks being executed */
+    unsigned max_queued; /**< highest number of tasks waiting at once */
+    uint64_t started; /**< number of tasks taken from the queue */
+    uint64_t cancelled; /**< number of tasks removed before being started */
+    vlc_tick_t wait_total; /**< total time spent in the queue by tasks */
+    vlc_tick_t wait_max; /**< longest time spent in the queue by a task */
+};
+
 /**
  * Create a background-worker
  *
@@ -156,8 +172,9 @@ void background_worker_RequestProbe( struct background_worker* worker );
  * Push an entity into the background-worker
  *
  * This function is used to push an entity into the queue of pending work. The
- * entities will be processed in the order in which they are received (in terms
- * of the order of invocations in a single-threaded environment).
+ * entities will be processed by decreasing priority and, for a same priority,
+ * in the order in which they are received (in terms of the order of
+ * invocations in a single-threaded environment).
  *
  * \param worker the background-worker
  * \param entity the entity which is to be queued
@@ -165,11 +182,54 @@ void background_worker_RequestProbe( struct background_worker* worker );
  * \param timeout the timeout of the entity in milliseconds, `0` denotes no
  *                timeout, a negative value will use the default timeout
  *                associated with the background-worker.
+ * \param priority the priority of the entity, `0` being the default: entities
+ *                 are queued ahead of the ones with a lower priority.
  * \return VLC_SUCCESS if the entity was successfully queued, an error-code on
  *         failure.
  **/
 int background_worker_Push( struct background_worker* worker, void* entity,
-    void* id, int timeout );
+    void* id, int timeout, int priority );
+
+/**
+ * Raise the priority of queued entities
+ *
+ * This function moves the queued entities associated with the given id, if
+ * their priority is lower, at the rank of an entity pushed with `priority`.
+ * Entities already being processed are not affected.
+ *
+ * \param worker the background-worker
+ * \param id the id associated with the entities, not `NULL`
+ * \param priority the new priority of the entities
+ * \param pf_merge if not `NULL`, called with the first queued entity of the
+ *                 id and `data`, before that entity can be started
+ * \param data the opaque data passed to `pf_merge`
+ * \return true if an entity associated with the id is still queued, false
+ *         otherwise.
+ **/
+bool background_worker_Prioritize( struct background_worker* worker, void* id,
+    int priority, void (*pf_merge)( void* entity, void* data ), void* data );
+
+/**
+ * Get the statistics of a background-worker
+ *
+ * \param worker the background-worker
+ * \param stats [out] the current statistics
+ **/
+void background_worker_GetStats( struct background_worker* worker,
+    struct background_worker_stats* stats );
+
+/**
+ * Log the statistics of a background-worker
+ *
+ * This function prints the activity of the background-worker since it was
+ * created as a debug message, if it started any task.
+ *
+ * \param worker the background-worker
+ * \param obj the object to log the message as
+ * \param name the name of the background-worker in the message
+ **/
+void background_worker_LogStats( struct background_worker* worker,
+    vlc_object_t* obj, const char* name );
 
 /**
  * Remove entities from the background-worker
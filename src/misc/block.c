@@ -28,12 +28,15 @@
 #include <sys/stat.h>
 #include <assert.h>
 #include <errno.h>
+#include <stdatomic.h>
 #include <unistd.h>
 #include <fcntl.h>
 
 #include <vlc_common.h>
 #include <vlc_block.h>
+#include <vlc_atomic.h>
 #include <vlc_fs.h>
+#include "libvlc.h"
 
 #ifndef NDEBUG
 static void block_Check (block_t *block)
@@ -105,6 +108,495 @@ static void BlockMetaCopy( block_t *restrict out, const block_t *in )
 /** Initial reserved header and footer size. */
 #define BLOCK_PADDING      32
 
+/*
+ * Size-class block cache
+ *
+ * Allocations of up to 64 KiB (including the block header and padding) are
+ * rounded up to a size class and recycled instead of being freed. There are
+ * two classes per power of two, 2^n and 3 * 2^(n-1), so that no more than a
+ * third of a cached block is lost to rounding.
+ *
+ * Each thread keeps, for each size class, two magazines, i.e. fixed-size
+ * stacks of free blocks. Allocations pop from and releases push to the loaded
+ * magazine. When it is exhausted (or full), it is swapped with the previous
+ * one, or exchanged whole against a full (or empty) magazine from a global
+ * depot. Blocks are typically allocated by one thread (e.g. the demuxer) and
+ * released by another (e.g. the decoder), so magazines circulate through the
+ * depot in constant time, without touching the cached blocks themselves.
+ *
+ * The free blocks held by each thread and by the depot are bounded. The
+ * VLC_BLOCK_CACHE environment variable overrides the depot bound, in KiB;
+ * zero disables the cache altogether.
+ */
+#define BLOCK_CLASS_MIN_SHIFT 9 /* 512 bytes */
+#define BLOCK_CLASS_MAX_SHIFT 16 /* 64 KiB */
+#define BLOCK_CLASSES (2 * (BLOCK_CLASS_MAX_SHIFT - BLOCK_CLASS_MIN_SHIFT) + 1)
+
+/** Bytes per magazine */
+#define BLOCK_MAGAZINE_SIZE (64 << 10)
+/** Maximum bytes of free blocks held by a thread (approximately) */
+#define BLOCK_THREAD_SIZE (256 << 10)
+/** Default maximum bytes of free blocks held by the global depot */
+#define BLOCK_DEPOT_SIZE (8 << 20)
+/** Number of allocations and releases between statistics updates */
+#define BLOCK_STATS_PERIOD 256
+
+#if defined (__SANITIZE_ADDRESS__)
+/* Let the sanitizer track each block lifetime */
+# define BLOCK_NO_CACHE 1
+#elif defined (__has_feature)
+# if __has_feature(address_sanitizer)
+#  define BLOCK_NO_CACHE 1
+# endif
+#endif
+
+#ifndef BLOCK_NO_CACHE
+struct block_magazine
+{
+    struct block_magazine *next;
+    size_t count;
+    block_t *blocks[];
+};
+
+struct block_cache
+{
+    struct
+    {
+        struct block_magazine *loaded;
+        struct block_magazine *previous;
+    } classes[BLOCK_CLASSES];
+    size_t cached; /**< Bytes of free blocks in the magazines */
+    unsigned ops;
+    uintmax_t hits;
+    uintmax_t misses;
+    uintmax_t requested;
+    size_t allocated;
+    size_t released;
+};
+
+static struct
+{
+    vlc_mutex_t lock;
+    struct
+    {
+        struct block_magazine *full;
+        struct block_magazine *empty;
+    } classes[BLOCK_CLASSES];
+} block_depot = { VLC_STATIC_MUTEX, { { NULL, NULL } } };
+
+static atomic_uintmax_t block_hits = ATOMIC_VAR_INIT(0);
+static atomic_uintmax_t block_misses = ATOMIC_VAR_INIT(0);
+static atomic_uintmax_t block_requested = ATOMIC_VAR_INIT(0);
+static atomic_uintmax_t block_rounded = ATOMIC_VAR_INIT(0);
+static atomic_size_t block_allocated = ATOMIC_VAR_INIT(0);
+static atomic_size_t block_released = ATOMIC_VAR_INIT(0);
+static atomic_size_t block_depot_bytes = ATOMIC_VAR_INIT(0);
+
+/* Bounds, set once from the environment */
+static size_t block_depot_max;
+static size_t block_thread_max;
+
+static _Thread_local struct block_cache *block_cache;
+static vlc_threadvar_t block_cache_key;
+
+static size_t block_class_size(unsigned cls)
+{
+    size_t size = (size_t)1 << (cls / 2 + BLOCK_CLASS_MIN_SHIFT);
+
+    return (cls & 1) ? size + size / 2 : size;
+}
+
+static unsigned block_class(size_t alloc)
+{
+    if (alloc <= block_class_size(0))
+        return 0;
+    if (alloc > block_class_size(BLOCK_CLASSES - 1))
+        return BLOCK_CLASSES; /* not cached */
+
+    /* 2^(n-1) < alloc <= 2^n */
+    unsigned n = (sizeof (unsigned) * 8) - vlc_clz(alloc - 1);
+    unsigned cls = 2 * (n - BLOCK_CLASS_MIN_SHIFT);
+
+    if (alloc <= block_class_size(cls - 1))
+        cls--;
+    return cls;
+}
+
+static size_t block_magazine_capacity(unsigned cls)
+{
+    return BLOCK_MAGAZINE_SIZE / block_class_size(cls);
+}
+
+static void block_magazine_Empty(struct block_magazine *mag)
+{
+    while (mag->count > 0)
+        free(mag->blocks[--mag->count]);
+}
+
+/**
+ * Hands a full (or partial) magazine over to the depot, and gets an empty one
+ * in exchange. If the depot is full, the blocks are freed instead.
+ *
+ * @param full magazine to hand over (or NULL)
+ * @return an empty magazine, or NULL on memory error
+ */
+static struct block_magazine *block_depot_Exchange(unsigned cls,
+                                                   struct block_magazine *full)
+{
+    const size_t capacity = block_magazine_capacity(cls);
+    struct block_magazine *empty = NULL;
+
+    vlc_mutex_lock(&block_depot.lock);
+    if (full != NULL)
+    {
+        size_t bytes = full->count * block_class_size(cls);
+        size_t depot = atomic_load_explicit(&block_depot_bytes,
+                                            memory_order_relaxed);
+
+        if (depot + bytes <= block_depot_max)
+        {
+            atomic_store_explicit(&block_depot_bytes, depot + bytes,
+                                  memory_order_relaxed);
+            full->next = block_depot.classes[cls].full;
+            block_depot.classes[cls].full = full;
+            full = NULL;
+        }
+    }
+
+    if (full == NULL)
+    {
+        empty = block_depot.classes[cls].empty;
+        if (empty != NULL)
+            block_depot.classes[cls].empty = empty->next;
+    }
+    vlc_mutex_unlock(&block_depot.lock);
+
+    if (full != NULL)
+    {   /* Depot is full: recycle the magazine itself */
+        block_magazine_Empty(full);
+        return full;
+    }
+
+    if (empty == NULL)
+    {
+        empty = malloc(sizeof (*empty) + capacity * sizeof (block_t *));
+        if (unlikely(empty == NULL))
+            return NULL;
+        empty->count = 0;
+    }
+    assert(empty->count == 0);
+    return empty;
+}
+
+/**
+ * Gets a full magazine from the depot, and hands an empty one over in
+ * exchange. The empty magazine is kept if no full one is available.
+ *
+ * @param emptyp pointer to the magazine to hand over [IN/OUT]
+ * @return a full magazine, or NULL if the depot is empty
+ */
+static struct block_magazine *block_depot_Get(unsigned cls,
+                                              struct block_magazine **emptyp)
+{
+    struct block_magazine *full;
+
+    vlc_mutex_lock(&block_depot.lock);
+    full = block_depot.classes[cls].full;
+    if (full != NULL)
+    {
+        struct block_magazine *empty = *emptyp;
+
+        block_depot.classes[cls].full = full->next;
+        atomic_fetch_sub_explicit(&block_depot_bytes,
+                                  full->count * block_class_size(cls),
+                                  memory_order_relaxed);
+
+        if (empty != NULL)
+        {
+            assert(empty->count == 0);
+            empty->next = block_depot.classes[cls].empty;
+            block_depot.classes[cls].empty = empty;
+            *emptyp = NULL;
+        }
+    }
+    vlc_mutex_unlock(&block_depot.lock);
+    return full;
+}
+
+static void block_cache_FlushStats(struct block_cache *cache)
+{
+    atomic_fetch_add_explicit(&block_hits, cache->hits, memory_order_relaxed);
+    atomic_fetch_add_explicit(&block_misses, cache->misses,
+                              memory_order_relaxed);
+    atomic_fetch_add_explicit(&block_requested, cache->requested,
+                              memory_order_relaxed);
+    atomic_fetch_add_explicit(&block_rounded, cache->allocated,
+                              memory_order_relaxed);
+    atomic_fetch_add_explicit(&block_allocated, cache->allocated,
+                              memory_order_relaxed);
+    atomic_fetch_add_explicit(&block_released, cache->released,
+                              memory_order_relaxed);
+    cache->ops = 0;
+    cache->hits = cache->misses = 0;
+    cache->requested = 0;
+    cache->allocated = cache->released = 0;
+}
+
+static void block_cache_Account(struct block_cache *cache)
+{
+    if (++cache->ops >= BLOCK_STATS_PERIOD)
+        block_cache_FlushStats(cache);
+}
+
+static void block_cache_Destroy(void *data)
+{
+    struct block_cache *cache = data;
+
+    for (unsigned i = 0; i < BLOCK_CLASSES; i++)
+    {
+        struct block_magazine *mags[2] = {
+            cache->classes[i].loaded, cache->classes[i].previous,
+        };
+
+        for (unsigned j = 0; j < 2; j++)
+        {
+            struct block_magazine *mag = mags[j];
+
+            if (mag != NULL && mag->count > 0)
+                mag = block_depot_Exchange(i, mag);
+            free(mag);
+        }
+    }
+
+    block_cache_FlushStats(cache);
+    free(cache);
+    block_cache = NULL;
+}
+
+static void block_cache_Init(void)
+{
+    const char *env = getenv("VLC_BLOCK_CACHE");
+
+    block_depot_max = BLOCK_DEPOT_SIZE;
+    if (env != NULL)
+        block_depot_max = strtoul(env, NULL, 0) << 10;
+    block_thread_max = __MIN(block_depot_max, BLOCK_THREAD_SIZE);
+
+    if (vlc_threadvar_create(&block_cache_key, block_cache_Destroy))
+        abort();
+}
+
+/** Whether the block cache is enabled (see VLC_BLOCK_CACHE) */
+static bool block_cache_Enabled(void)
+{
+    static vlc_once_t once = VLC_STATIC_ONCE;
+
+    vlc_once(&once, block_cache_Init);
+    return block_depot_max > 0;
+}
+
+static struct block_cache *block_cache_Get(void)
+{
+    struct block_cache *cache = block_cache;
+
+    if (likely(cache != NULL))
+        return cache;
+
+    cache = calloc(1, sizeof (*cache));
+    if (unlikely(cache == NULL))
+        return NULL;
+    /* The thread-specific variable only serves to destroy the cache */
+    if (vlc_threadvar_set(block_cache_key, cache))
+    {
+        free(cache);
+        return NULL;
+    }
+    block_cache = cache;
+    return cache;
+}
+
+static void block_cached_Release(block_t *block)
+{
+    const size_t alloc = sizeof (*block) + block->i_size;
+    const unsigned cls = block_class(alloc);
+    struct block_cache *cache = block_cache_Get();
+
+    assert(block->p_start == (unsigned char *)(block + 1));
+    assert(cls < BLOCK_CLASSES && alloc == block_class_size(cls));
+
+    if (unlikely(cache == NULL))
+    {
+        free(block);
+        atomic_fetch_add_explicit(&block_released, alloc,
+                                  memory_order_relaxed);
+        return;
+    }
+
+    struct block_magazine **loaded = &cache->classes[cls].loaded;
+    struct block_magazine **previous = &cache->classes[cls].previous;
+    const size_t capacity = block_magazine_capacity(cls);
+
+    cache->released += alloc;
+    block_cache_Account(cache);
+
+    if (cache->cached + alloc > block_thread_max)
+    {   /* Over the thread bound: hand the blocks of this class over */
+        struct block_magazine **mags[2] = { previous, loaded };
+
+        for (unsigned i = 0; i < 2; i++)
+            if (*mags[i] != NULL && (*mags[i])->count > 0)
+            {
+                cache->cached -= (*mags[i])->count * alloc;
+                *mags[i] = block_depot_Exchange(cls, *mags[i]);
+            }
+    }
+
+    if (*loaded == NULL || (*loaded)->count == capacity)
+    {
+        if (*previous != NULL && (*previous)->count < capacity)
+        {
+            struct block_magazine *mag = *loaded;
+
+            *loaded = *previous;
+            *previous = mag;
+        }
+        else
+        {
+            struct block_magazine *mag = block_depot_Exchange(cls, *previous);
+
+            if (*previous != NULL)
+                cache->cached -= capacity * alloc;
+            *previous = *loaded;
+            *loaded = mag;
+            if (unlikely(mag == NULL))
+            {
+                free(block);
+                return;
+            }
+        }
+    }
+
+    (*loaded)->blocks[(*loaded)->count++] = block;
+    cache->cached += alloc;
+}
+
+static const struct vlc_block_callbacks block_cached_cbs =
+{
+    block_cached_Release,
+};
+
+static block_t *block_cached_Alloc(unsigned cls, size_t requested)
+{
+    struct block_cache *cache = block_cache_Get();
+    const size_t alloc = block_class_size(cls);
+    block_t *b;
+
+    if (unlikely(cache == NULL))
+    {
+        b = malloc(alloc);
+        if (b != NULL)
+        {
+            atomic_fetch_add_explicit(&block_misses, 1, memory_order_relaxed);
+            atomic_fetch_add_explicit(&block_requested, requested,
+                                      memory_order_relaxed);
+            atomic_fetch_add_explicit(&block_rounded, alloc,
+                                      memory_order_relaxed);
+            atomic_fetch_add_explicit(&block_allocated, alloc,
+                                      memory_order_relaxed);
+        }
+        return b;
+    }
+
+    struct block_magazine **loaded = &cache->classes[cls].loaded;
+    struct block_magazine **previous = &cache->classes[cls].previous;
+
+    if (*loaded == NULL || (*loaded)->count == 0)
+    {
+        if (*previous != NULL && (*previous)->count > 0)
+        {
+            struct block_magazine *mag = *loaded;
+
+            *loaded = *previous;
+            *previous = mag;
+        }
+        else
+        {
+            struct block_magazine *mag = block_depot_Get(cls, previous);
+
+            if (mag != NULL)
+            {
+                free(*previous); /* only if the depot did not take it */
+                *previous = *loaded;
+                *loaded = mag;
+                cache->cached += mag->count * alloc;
+            }
+        }
+    }
+
+    if (*loaded != NULL && (*loaded)->count > 0)
+    {
+        b = (*loaded)->blocks[--(*loaded)->count];
+        cache->cached -= alloc;
+        cache->hits++;
+    }
+    else
+    {
+        b = malloc(alloc);
+        if (unlikely(b == NULL))
+            return NULL;
+        cache->misses++;
+    }
+
+    cache->requested += requested;
+    cache->allocated += alloc;
+    block_cache_Account(cache);
+    return b;
+}
+
+void block_CacheStats(struct vlc_block_cache_stats *st)
+{
+    struct block_cache *cache = block_cache;
+
+    if (cache != NULL)
+        block_cache_FlushStats(cache);
+
+    size_t allocated = atomic_load_explicit(&block_allocated,
+                                            memory_order_relaxed);
+    size_t released = atomic_load_explicit(&block_released,
+                                           memory_order_relaxed);
+
+    st->hits = atomic_load_explicit(&block_hits, memory_order_relaxed);
+    st->misses = atomic_load_explicit(&block_misses, memory_order_relaxed);
+    st->requested = atomic_load_explicit(&block_requested,
+                                         memory_order_relaxed);
+    st->rounded = atomic_load_explicit(&block_rounded, memory_order_relaxed);
+    st->in_flight = allocated - released;
+    st->depot = atomic_load_explicit(&block_depot_bytes,
+                                     memory_order_relaxed);
+}
+#else
+void block_CacheStats(struct vlc_block_cache_stats *st)
+{
+    memset(st, 0, sizeof (*st));
+}
+#endif
+
+void block_CacheDump(vlc_object_t *obj)
+{
+    struct vlc_block_cache_stats st;
+
+    block_CacheStats(&st);
+    if (st.hits + st.misses == 0)
+        return; /* disabled or unused */
+
+    msg_Info(obj, "block cache: %ju hits, %ju misses (%.1f%% hit rate)",
+             st.hits, st.misses, 100. * st.hits / (st.hits + st.misses));
+    msg_Info(obj, "block cache: %ju KiB requested, %ju KiB allocated",
+             st.requested >> 10, st.rounded >> 10);
+    msg_Info(obj, "block cache: %zu KiB in flight, %zu KiB in depot",
+             st.in_flight >> 10, st.depot >> 10);
+}
+
 block_t *block_Alloc (size_t size)
 {
     if (unlikely(size >> 27))
@@ -114,16 +606,29 @@ block_t *block_Alloc (size_t size)
     }
 
     /* 2 * BLOCK_PADDING: pre + post padding */
-    const size_t alloc = sizeof (block_t) + BLOCK_ALIGN + (2 * BLOCK_PADDING)
-                       + size;
+    size_t alloc = sizeof (block_t) + BLOCK_ALIGN + (2 * BLOCK_PADDING)
+                 + size;
     if (unlikely(alloc <= size))
         return NULL;
 
-    block_t *b = malloc (alloc);
+    const struct vlc_block_callbacks *cbs = &block_generic_cbs;
+    block_t *b;
+#ifndef BLOCK_NO_CACHE
+    const unsigned cls = block_class(alloc);
+
+    if (cls < BLOCK_CLASSES && block_cache_Enabled())
+    {
+        cbs = &block_cached_cbs;
+        b = block_cached_Alloc(cls, alloc);
+        alloc = block_class_size(cls);
+    }
+    else
+#endif
+        b = malloc (alloc);
     if (unlikely(b == NULL))
         return NULL;
 
-    block_Init(b, &block_generic_cbs, b + 1, alloc - sizeof (*b));
+    block_Init(b, cbs, b + 1, alloc - sizeof (*b));
     static_assert ((BLOCK_PADDING % BLOCK_ALIGN) == 0,
                    "BLOCK_PADDING must be a multiple of BLOCK_ALIGN");
     b->p_buffer += BLOCK_PADDING + BLOCK_ALIGN - 1;
@@ -141,6 +646,105 @@ void block_Release(block_t *block)
     block->cbs->free(block);
 }
 
+/*
+ * Shared blocks
+ *
+ * Sharing a block moves its payload under a reference counted owner, with
+ * one reference per block header pointing to it. The first header, the
+ * origin, is kept until the last reference is released, then freed with its
+ * own callbacks. The headers find the owner from their callbacks, which are
+ * embedded in it, so that block_t needs no extra field.
+ */
+struct block_payload
+{
+    struct vlc_block_callbacks cbs;
+    vlc_atomic_rc_t rc;
+    block_t *origin;
+    const struct vlc_block_callbacks *origin_cbs;
+};
+
+static void block_shared_Release(block_t *block)
+{
+    struct block_payload *payload = container_of(block->cbs,
+                                                 struct block_payload, cbs);
+    block_t *origin = payload->origin;
+    const bool last = vlc_atomic_rc_dec(&payload->rc);
+
+    if (block != origin)
+        free(block);
+    if (last)
+    {
+        origin->cbs = payload->origin_cbs;
+        free(payload);
+        origin->cbs->free(origin);
+    }
+}
+
+/** Returns the owner of a shared payload, or NULL if it is not shared */
+static struct block_payload *block_Payload(const block_t *block)
+{
+    if (block->cbs->free != block_shared_Release)
+        return NULL;
+    return container_of(block->cbs, struct block_payload, cbs);
+}
+
+block_t *block_Share(block_t *block)
+{
+    block_t *b = malloc(sizeof (*b));
+    if (unlikely(b == NULL))
+        return NULL;
+
+    struct block_payload *payload = block_Payload(block);
+    if (payload == NULL)
+    {
+        payload = malloc(sizeof (*payload));
+        if (unlikely(payload == NULL))
+        {
+            free(b);
+            return NULL;
+        }
+        payload->cbs.free = block_shared_Release;
+        vlc_atomic_rc_init(&payload->rc);
+        payload->origin = block;
+        payload->origin_cbs = block->cbs;
+        block->cbs = &payload->cbs;
+    }
+    vlc_atomic_rc_inc(&payload->rc);
+
+    block_Init(b, &payload->cbs, block->p_start, block->i_size);
+    b->p_buffer = block->p_buffer;
+    b->i_buffer = block->i_buffer;
+    block_CopyProperties(b, block);
+    return b;
+}
+
+bool block_IsWritable(const block_t *block)
+{
+    const struct block_payload *payload = block_Payload(block);
+
+    /* The payload is private if this block holds the only reference, even if
+     * the origin or the other blocks sharing it were released. */
+    return payload == NULL
+        || atomic_load_explicit(&payload->rc.refs, memory_order_acquire) == 1;
+}
+
+block_t *block_MakeWritable(block_t *block)
+{
+    block_Check(block);
+
+    if (block_IsWritable(block))
+        return block;
+
+    block_t *copy = block_Alloc(block->i_buffer);
+    if (likely(copy != NULL))
+    {
+        memcpy(copy->p_buffer, block->p_buffer, block->i_buffer);
+        BlockMetaCopy(copy, block);
+    }
+    block_Release(block);
+    return copy;
+}
+
 block_t *block_TryRealloc (block_t *p_block, ssize_t i_prebody, size_t i_body)
 {
     block_Check( p_block );
@@ -174,10 +778,12 @@ block_t *block_TryRealloc (block_t *p_block, ssize_t i_prebody, size_t i_body)
         p_block->i_buffer = i_body;
 
     size_t requested = i_prebody + i_body;
+    /* The spare space around a shared payload is shared too */
+    const bool b_shared = !block_IsWritable( p_block );
 
     if( p_block->i_buffer == 0 )
     {   /* Corner case: nothing to preserve */
-        if( requested <= p_block->i_size )
+        if( requested <= p_block->i_size && !b_shared )
         {   /* Enough room: recycle buffer */
             size_t extra = p_block->i_size - requested;
 
@@ -202,7 +808,8 @@ block_t *block_TryRealloc (block_t *p_block, ssize_t i_prebody, size_t i_body)
     /* Second, reallocate the buffer if we lack space. */
     assert( i_prebody >= 0 );
     if( (size_t)(p_block->p_buffer - p_start) < (size_t)i_prebody
-     || (size_t)(p_end - p_block->p_buffer) < i_body )
+     || (size_t)(p_end - p_block->p_buffer) < i_body
+     || (b_shared && (i_prebody > 0 || i_body > p_block->i_buffer)) )
     {
         block_t *p_rea = block_Alloc( requested );
         if( p_rea == NULL )
@@ -26,6 +26,8 @@
 #endif
 
 #include <assert.h>
+#include <stdalign.h>
+#include <stdatomic.h>
 #include <stdlib.h>
 
 #include <vlc_common.h>
@@ -235,3 +237,248 @@ size_t block_FifoCount (block_fifo_t *fifo)
     vlc_mutex_unlock (&fifo->lock);
     return depth;
 }
+
+/**
+ * Single-producer single-consumer queue node
+ *
+ * Each node carries one block list as queued by the producer. The consumer
+ * owns the node at the tail of the list; its blocks have already been
+ * dequeued (or it is the initial stub node). Nodes between the first one and
+ * the tail have been consumed and are recycled by the producer.
+ */
+struct block_spsc_node
+{
+    atomic_uintptr_t next;
+    block_t *chain;
+};
+
+struct block_spsc_t
+{
+    /* Consumer side */
+    alignas (64)
+    atomic_uintptr_t tail; /**< Last consumed node */
+    block_t *pending; /**< Remainder of the last consumed block list */
+    atomic_size_t out_count;
+    atomic_size_t out_bytes;
+
+    /* Producer side */
+    alignas (64)
+    struct block_spsc_node *head; /**< Last queued node */
+    struct block_spsc_node *first; /**< Oldest node (to be recycled) */
+    struct block_spsc_node *tail_copy; /**< Producer cache of the tail */
+    atomic_size_t in_count;
+    atomic_size_t in_bytes;
+
+    /* Consumer sleep (slow path) */
+    alignas (64)
+    atomic_bool waiting;
+    vlc_mutex_t lock;
+    vlc_cond_t wait;
+};
+
+block_spsc_t *block_SpscNew(void)
+{
+    block_spsc_t *fifo = aligned_alloc(alignof (block_spsc_t),
+                                       sizeof (block_spsc_t));
+    if (unlikely(fifo == NULL))
+        return NULL;
+
+    struct block_spsc_node *stub = malloc(sizeof (*stub));
+    if (unlikely(stub == NULL))
+    {
+        aligned_free(fifo);
+        return NULL;
+    }
+
+    atomic_init(&stub->next, 0);
+    stub->chain = NULL;
+
+    atomic_init(&fifo->tail, (uintptr_t)stub);
+    fifo->pending = NULL;
+    atomic_init(&fifo->out_count, 0);
+    atomic_init(&fifo->out_bytes, 0);
+    fifo->head = stub;
+    fifo->first = stub;
+    fifo->tail_copy = stub;
+    atomic_init(&fifo->in_count, 0);
+    atomic_init(&fifo->in_bytes, 0);
+    atomic_init(&fifo->waiting, false);
+    vlc_mutex_init(&fifo->lock);
+    vlc_cond_init(&fifo->wait);
+    return fifo;
+}
+
+void block_SpscRelease(block_spsc_t *fifo)
+{
+    struct block_spsc_node *node = fifo->first;
+
+    while (node != NULL)
+    {
+        struct block_spsc_node *next =
+            (void *)atomic_load_explicit(&node->next, memory_order_relaxed);
+
+        block_ChainRelease(node->chain);
+        free(node);
+        node = next;
+    }
+
+    block_ChainRelease(fifo->pending);
+    vlc_cond_destroy(&fifo->wait);
+    vlc_mutex_destroy(&fifo->lock);
+    aligned_free(fifo);
+}
+
+/* Producer: gets a free node, recycling consumed ones if possible */
+static struct block_spsc_node *block_SpscNodeGet(block_spsc_t *fifo)
+{
+    struct block_spsc_node *node = fifo->first;
+
+    if (node == fifo->tail_copy)
+    {
+        fifo->tail_copy = (void *)atomic_load_explicit(&fifo->tail,
+                                                       memory_order_acquire);
+        if (node == fifo->tail_copy)
+            return malloc(sizeof (*node));
+    }
+
+    fifo->first = (void *)atomic_load_explicit(&node->next,
+                                               memory_order_relaxed);
+    return node;
+}
+
+void block_SpscPut(block_spsc_t *fifo, block_t *block)
+{
+    if (block == NULL)
+        return;
+
+    struct block_spsc_node *node = block_SpscNodeGet(fifo);
+    if (unlikely(node == NULL))
+    {
+        block_ChainRelease(block);
+        return;
+    }
+
+    size_t count = 0, bytes = 0;
+
+    for (block_t *b = block; b != NULL; b = b->p_next)
+    {
+        count++;
+        bytes += b->i_buffer;
+    }
+
+    atomic_store_explicit(&node->next, 0, memory_order_relaxed);
+    node->chain = block;
+
+    /* Account before publishing, so that the counters never underflow */
+    atomic_store_explicit(&fifo->in_count, count +
+        atomic_load_explicit(&fifo->in_count, memory_order_relaxed),
+        memory_order_relaxed);
+    atomic_store_explicit(&fifo->in_bytes, bytes +
+        atomic_load_explicit(&fifo->in_bytes, memory_order_relaxed),
+        memory_order_relaxed);
+
+    atomic_store_explicit(&fifo->head->next, (uintptr_t)node,
+                          memory_order_release);
+    fifo->head = node;
+
+    /* Pairs with the fence in block_SpscGet() */
+    atomic_thread_fence(memory_order_seq_cst);
+
+    if (atomic_load_explicit(&fifo->waiting, memory_order_relaxed))
+    {
+        vlc_mutex_lock(&fifo->lock);
+        vlc_cond_signal(&fifo->wait);
+        vlc_mutex_unlock(&fifo->lock);
+    }
+}
+
+/* Consumer: checks whether block_SpscTryGet() would fail */
+static bool block_SpscIsEmpty(block_spsc_t *fifo)
+{
+    struct block_spsc_node *tail =
+        (void *)atomic_load_explicit(&fifo->tail, memory_order_relaxed);
+
+    return fifo->pending == NULL
+        && atomic_load_explicit(&tail->next, memory_order_relaxed) == 0;
+}
+
+block_t *block_SpscTryGet(block_spsc_t *fifo)
+{
+    block_t *block = fifo->pending;
+
+    if (block == NULL)
+    {
+        struct block_spsc_node *tail =
+            (void *)atomic_load_explicit(&fifo->tail, memory_order_relaxed);
+        struct block_spsc_node *node =
+            (void *)atomic_load_explicit(&tail->next, memory_order_acquire);
+
+        if (node == NULL)
+            return NULL;
+
+        block = node->chain;
+        node->chain = NULL;
+        /* Hands the previous tail node over to the producer */
+        atomic_store_explicit(&fifo->tail, (uintptr_t)node,
+                              memory_order_release);
+    }
+
+    fifo->pending = block->p_next;
+    block->p_next = NULL;
+
+    atomic_store_explicit(&fifo->out_count, 1 +
+        atomic_load_explicit(&fifo->out_count, memory_order_relaxed),
+        memory_order_release);
+    atomic_store_explicit(&fifo->out_bytes, block->i_buffer +
+        atomic_load_explicit(&fifo->out_bytes, memory_order_relaxed),
+        memory_order_release);
+    return block;
+}
+
+static void block_SpscCleanup(void *data)
+{
+    block_spsc_t *fifo = data;
+
+    atomic_store_explicit(&fifo->waiting, false, memory_order_relaxed);
+    vlc_mutex_unlock(&fifo->lock);
+}
+
+block_t *block_SpscGet(block_spsc_t *fifo)
+{
+    vlc_testcancel();
+
+    for (;;)
+    {
+        block_t *block = block_SpscTryGet(fifo);
+        if (block != NULL)
+            return block;
+
+        vlc_mutex_lock(&fifo->lock);
+        atomic_store_explicit(&fifo->waiting, true, memory_order_relaxed);
+        /* Pairs with the fence in block_SpscPut() */
+        atomic_thread_fence(memory_order_seq_cst);
+
+        vlc_cleanup_push(block_SpscCleanup, fifo);
+        if (block_SpscIsEmpty(fifo))
+            vlc_cond_wait(&fifo->wait, &fifo->lock);
+        vlc_cleanup_pop();
+        block_SpscCleanup(fifo);
+    }
+}
+
+size_t block_SpscGetCount(const block_spsc_t *fifo)
+{
+    /* Load the consumer counter first, so the difference is never negative */
+    size_t out = atomic_load_explicit(&fifo->out_count, memory_order_acquire);
+    size_t in = atomic_load_explicit(&fifo->in_count, memory_order_acquire);
+
+    return in - out;
+}
+
+size_t block_SpscGetBytes(const block_spsc_t *fifo)
+{
+    size_t out = atomic_load_explicit(&fifo->out_bytes, memory_order_acquire);
+    size_t in = atomic_load_explicit(&fifo->in_bytes, memory_order_acquire);
+
+    return in - out;
+}
@@ -0,0 +1,221 @@
+/*****************************************************************************
+ * slices.c: slice-parallel execution of video filters
+ *****************************************************************************
+ * Copyright (C) 2024 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+#ifdef HAVE_CONFIG_H
+# include "config.h"
+#endif
+
+#include <assert.h>
+
+#include <vlc_common.h>
+#include <vlc_atomic.h>
+#include <vlc_filter.h>
+#include "../libvlc.h"
+
+/* Bands smaller than this cost more to dispatch than to filter */
+#define SLICE_MIN_LINES   32
+#define SLICE_MAX_THREADS 16
+
+/*
+ * The worker threads are shared by all the filters of an instance. The
+ * thread calling filter_RunSlices() processes slices too, so that it never
+ * waits for a worker busy with the slices of another filter; it only waits
+ * for the slices already taken by the workers to be completed.
+ */
+struct vlc_slice_job
+{
+    struct vlc_slice_job *next;
+    filter_t        *filter;
+    filter_slice_cb  cb;
+    void            *opaque;
+    unsigned         count;
+    atomic_uint      taken;
+    unsigned         done;
+};
+
+struct vlc_slices
+{
+    vlc_mutex_t lock;
+    vlc_cond_t  wait;      /* workers: a job has slices left */
+    vlc_cond_t  wait_done; /* callers: a job has been completed */
+    struct vlc_slice_job *jobs;
+    bool        dead;
+    unsigned    thread_count;
+    vlc_thread_t threads[];
+};
+
+static vlc_mutex_t slices_lock = VLC_STATIC_MUTEX;
+
+static struct vlc_slice_job *SlicesFindJob(struct vlc_slices *slices)
+{
+    for (struct vlc_slice_job *job = slices->jobs; job != NULL; job = job->next)
+        if (atomic_load_explicit(&job->taken, memory_order_relaxed) < job->count)
+            return job;
+    return NULL;
+}
+
+static void *SlicesThread(void *data)
+{
+    struct vlc_slices *slices = data;
+
+    vlc_mutex_lock(&slices->lock);
+    for (;;) {
+        struct vlc_slice_job *job;
+
+        while (!slices->dead && (job = SlicesFindJob(slices)) == NULL)
+            vlc_cond_wait(&slices->wait, &slices->lock);
+        if (slices->dead)
+            break;
+
+        unsigned index = atomic_fetch_add(&job->taken, 1);
+        if (index >= job->count)
+            continue;
+        vlc_mutex_unlock(&slices->lock);
+
+        job->cb(job->filter, job->opaque, index, job->count);
+
+        vlc_mutex_lock(&slices->lock);
+        if (++job->done == job->count)
+            vlc_cond_broadcast(&slices->wait_done);
+    }
+    vlc_mutex_unlock(&slices->lock);
+    return NULL;
+}
+
+static struct vlc_slices *SlicesCreate(libvlc_int_t *libvlc)
+{
+    int64_t count = var_InheritInteger(libvlc, "video-filter-threads");
+    if (count <= 0)
+        count = vlc_GetCPUCount();
+    /* The calling thread is one of them */
+    count = VLC_CLIP(count, 1, SLICE_MAX_THREADS) - 1;
+
+    struct vlc_slices *slices = malloc(sizeof(*slices)
+                                       + count * sizeof(vlc_thread_t));
+    if (unlikely(slices == NULL))
+        return NULL;
+
+    vlc_mutex_init(&slices->lock);
+    vlc_cond_init(&slices->wait);
+    vlc_cond_init(&slices->wait_done);
+    slices->jobs = NULL;
+    slices->dead = false;
+    slices->thread_count = 0;
+
+    for (unsigned i = 0; i < count; i++) {
+        if (vlc_clone(&slices->threads[i], SlicesThread, slices,
+                      VLC_THREAD_PRIORITY_VIDEO))
+            break;
+        slices->thread_count++;
+    }
+    msg_Dbg(libvlc, "using %u video filter threads", slices->thread_count + 1);
+    return slices;
+}
+
+void vlc_slices_Destroy(struct vlc_slices *slices)
+{
+    if (slices == NULL)
+        return;
+
+    vlc_mutex_lock(&slices->lock);
+    assert(slices->jobs == NULL);
+    slices->dead = true;
+    vlc_cond_broadcast(&slices->wait);
+    vlc_mutex_unlock(&slices->lock);
+
+    for (unsigned i = 0; i < slices->thread_count; i++)
+        vlc_join(slices->threads[i], NULL);
+
+    vlc_cond_destroy(&slices->wait_done);
+    vlc_cond_destroy(&slices->wait);
+    vlc_mutex_destroy(&slices->lock);
+    free(slices);
+}
+
+static struct vlc_slices *SlicesGet(filter_t *filter)
+{
+    libvlc_priv_t *priv = libvlc_priv(filter->obj.libvlc);
+
+    /* Created on first use, most instances never filter video */
+    vlc_mutex_lock(&slices_lock);
+    if (priv->slices == NULL)
+        priv->slices = SlicesCreate(filter->obj.libvlc);
+    struct vlc_slices *slices = priv->slices;
+    vlc_mutex_unlock(&slices_lock);
+    return slices;
+}
+
+unsigned filter_GetSliceCount(filter_t *filter, unsigned lines)
+{
+    struct vlc_slices *slices = SlicesGet(filter);
+    if (slices == NULL)
+        return 1;
+
+    unsigned count = __MIN(slices->thread_count + 1, lines / SLICE_MIN_LINES);
+    return __MAX(count, 1);
+}
+
+void filter_RunSlices(filter_t *filter, unsigned count,
+                      filter_slice_cb cb, void *opaque)
+{
+    struct vlc_slices *slices = count > 1 ? SlicesGet(filter) : NULL;
+
+    if (slices == NULL || slices->thread_count == 0) {
+        for (unsigned i = 0; i < count; i++)
+            cb(filter, opaque, i, count);
+        return;
+    }
+
+    struct vlc_slice_job job = {
+        .filter = filter,
+        .cb = cb,
+        .opaque = opaque,
+        .count = count,
+        .done = 0,
+    };
+    atomic_init(&job.taken, 0);
+
+    vlc_mutex_lock(&slices->lock);
+    job.next = slices->jobs;
+    slices->jobs = &job;
+    if (count > 2)
+        vlc_cond_broadcast(&slices->wait);
+    else
+        vlc_cond_signal(&slices->wait);
+    vlc_mutex_unlock(&slices->lock);
+
+    unsigned done = 0, index;
+    while ((index = atomic_fetch_add(&job.taken, 1)) < count) {
+        cb(filter, opaque, index, count);
+        done++;
+    }
+
+    vlc_mutex_lock(&slices->lock);
+    for (struct vlc_slice_job **pp = &slices->jobs; ; pp = &(*pp)->next)
+        if (*pp == &job) {
+            *pp = job.next;
+            break;
+        }
+
+    job.done += done;
+    while (job.done < count)
+        vlc_cond_wait(&slices->wait_done, &slices->lock);
+    vlc_mutex_unlock(&slices->lock);
+}
@@ -36,9 +36,6 @@
 #include <sys/types.h>
 #include <sys/stat.h>
 #include <unistd.h>
-#ifdef HAVE_SEARCH_H
-# include <search.h>
-#endif
 
 #include <vlc_common.h>
 #include <vlc_plugin.h>
@@ -49,112 +46,179 @@
 #include "config/configuration.h"
 #include "modules/modules.h"
 
-typedef struct vlc_modcap
-{
-    char *name;
-    module_t **modv;
-    size_t modc;
-} vlc_modcap_t;
-
-static int vlc_modcap_cmp(const void *a, const void *b)
+static struct
 {
-    const vlc_modcap_t *capa = a, *capb = b;
-    return strcmp(capa->name, capb->name);
-}
+    vlc_mutex_t lock;
+    block_t *caches;
+    vlc_modcap_t *caps; /**< Capabilities, sorted by name */
+    size_t caps_count;
+#ifdef HAVE_DYNAMIC_PLUGINS
+    vlc_cache_t **lazy; /**< Caches of the not yet loaded plugins */
+    size_t lazy_count;
+#endif
+    unsigned usage;
+} modules = { VLC_STATIC_MUTEX, NULL, NULL, 0,
+#ifdef HAVE_DYNAMIC_PLUGINS
+              NULL, 0,
+#endif
+              0 };
 
-static void vlc_modcap_free(void *data)
-{
-    vlc_modcap_t *cap = data;
+/** Whether some plugins are loaded on demand (see modules.lazy) */
+static atomic_bool modules_lazy = false;
 
-    free(cap->modv);
-    free(cap->name);
-    free(cap);
-}
+vlc_plugin_t *vlc_plugins = NULL;
 
-static int vlc_module_cmp (const void *a, const void *b)
+/**
+ * Looks up a capability in the bank.
+ * \param pos [OUT] index of the capability if found,
+ *                  or of its insertion point otherwise
+ * \return whether the capability was found
+ */
+static bool vlc_modcap_find(const char *name, size_t *restrict pos)
 {
-    const module_t *const *ma = a, *const *mb = b;
-    /* Note that qsort() uses _ascending_ order,
-     * so the smallest module is the one with the biggest score. */
-    return (*mb)->i_score - (*ma)->i_score;
-}
+    size_t lo = 0, hi = modules.caps_count;
 
-static void vlc_modcap_sort(const void *node, const VISIT which,
-                            const int depth)
-{
-    vlc_modcap_t *const *cp = node, *cap = *cp;
+    while (lo < hi)
+    {
+        size_t mid = (lo + hi) / 2;
+        int cmp = strcmp(name, modules.caps[mid].name);
 
-    if (which != postorder && which != leaf)
-        return;
+        if (cmp == 0)
+        {
+            *pos = mid;
+            return true;
+        }
+
+        if (cmp < 0)
+            hi = mid;
+        else
+            lo = mid + 1;
+    }
 
-    qsort(cap->modv, cap->modc, sizeof (*cap->modv), vlc_module_cmp);
-    (void) depth;
+    *pos = lo;
+    return false;
 }
 
-static struct
+/**
+ * Gets a capability from the bank, adding it if needed.
+ */
+static vlc_modcap_t *vlc_modcap_get(const char *name)
 {
-    vlc_mutex_t lock;
-    block_t *caches;
-    void *caps_tree;
-    unsigned usage;
-} modules = { VLC_STATIC_MUTEX, NULL, NULL, 0 };
+    size_t pos;
 
-vlc_plugin_t *vlc_plugins = NULL;
+    if (vlc_modcap_find(name, &pos))
+        return modules.caps + pos;
+
+    vlc_modcap_t *tab = vlc_reallocarray(modules.caps, modules.caps_count + 1,
+                                         sizeof (*tab));
+    if (unlikely(tab == NULL))
+        return NULL;
+
+    memmove(tab + pos + 1, tab + pos,
+            sizeof (*tab) * (modules.caps_count - pos));
+    tab[pos].name = name;
+    tab[pos].modv = NULL;
+    tab[pos].modc = 0;
+    tab[pos].complete = false;
+    modules.caps = tab;
+    modules.caps_count++;
+    return tab + pos;
+}
 
 /**
  * Adds a module to the bank
  */
 static int vlc_module_store(module_t *mod)
 {
-    const char *name = module_get_capability(mod);
-    vlc_modcap_t *cap = malloc(sizeof (*cap));
+    vlc_modcap_t *cap = vlc_modcap_get(module_get_capability(mod));
     if (unlikely(cap == NULL))
         return -1;
 
-    cap->name = strdup(name);
-    cap->modv = NULL;
-    cap->modc = 0;
-
-    if (unlikely(cap->name == NULL))
-        goto error;
+    module_t **modv = vlc_reallocarray(cap->modv, cap->modc + 1,
+                                       sizeof (*modv));
+    if (unlikely(modv == NULL))
+        return -1;
 
-    vlc_modcap_t **cp = tsearch(cap, &modules.caps_tree, vlc_modcap_cmp);
-    if (unlikely(cp == NULL))
-        goto error;
+    /* Keep the modules sorted by decreasing score */
+    size_t i = cap->modc;
 
-    if (*cp != cap)
+    while (i > 0 && modv[i - 1]->i_score < mod->i_score)
     {
-        vlc_modcap_free(cap);
-        cap = *cp;
+        modv[i] = modv[i - 1];
+        i--;
     }
 
-    module_t **modv = realloc(cap->modv, sizeof (*modv) * (cap->modc + 1));
+    modv[i] = mod;
+    cap->modv = modv;
+    cap->modc++;
+    return 0;
+}
+
+#ifdef HAVE_DYNAMIC_PLUGINS
+/**
+ * Adds the modules of a capability from a plugins cache index to the bank
+ */
+static int vlc_modcap_merge(const vlc_modcap_t *from)
+{
+    vlc_modcap_t *cap = vlc_modcap_get(from->name);
+    if (unlikely(cap == NULL))
+        return -1;
+
+    size_t n = cap->modc + from->modc;
+    module_t **modv = vlc_alloc(n, sizeof (*modv));
     if (unlikely(modv == NULL))
         return -1;
 
+    /* Both tables are sorted by decreasing score already */
+    size_t i = 0, j = 0, k = 0;
+
+    while (i < cap->modc && j < from->modc)
+        if (cap->modv[i]->i_score >= from->modv[j]->i_score)
+            modv[k++] = cap->modv[i++];
+        else
+            modv[k++] = from->modv[j++];
+    while (i < cap->modc)
+        modv[k++] = cap->modv[i++];
+    while (j < from->modc)
+        modv[k++] = from->modv[j++];
+
+    assert(k == n);
+    free(cap->modv);
     cap->modv = modv;
-    cap->modv[cap->modc] = mod;
-    cap->modc++;
+    cap->modc = n;
     return 0;
-error:
-    vlc_modcap_free(cap);
-    return -1;
 }
+#endif
 
 /**
- * Adds a plugin (and all its modules) to the bank
+ * Adds a plugin to the list of plugins, without indexing its modules
  */
-static void vlc_plugin_store(vlc_plugin_t *lib)
+static void vlc_plugin_add(vlc_plugin_t *lib)
 {
     vlc_mutex_assert(&modules.lock);
 
     lib->next = vlc_plugins;
     vlc_plugins = lib;
+}
 
+/**
+ * Indexes the modules of a plugin by capability
+ */
+static void vlc_plugin_index(vlc_plugin_t *lib)
+{
     for (module_t *m = lib->module; m != NULL; m = m->next)
         vlc_module_store(m);
 }
 
+/**
+ * Adds a plugin (and all its modules) to the bank
+ */
+static void vlc_plugin_store(vlc_plugin_t *lib)
+{
+    vlc_plugin_add(lib);
+    vlc_plugin_index(lib);
+}
+
 /**
  * Registers a statically-linked plug-in.
  */
@@ -247,6 +311,7 @@ typedef enum
     CACHE_READ_FILE  = 0x1,
     CACHE_SCAN_DIR   = 0x2,
     CACHE_WRITE_FILE = 0x4,
+    CACHE_LAZY       = 0x8,
 } cache_mode_t;
 
 typedef struct module_bank
@@ -258,6 +323,7 @@ typedef struct module_bank
     size_t        size;
     vlc_plugin_t **plugins;
     vlc_plugin_t *cache;
+    size_t        cache_hits; /**< Plug-ins taken as is from the cache */
 } module_bank_t;
 
 /**
@@ -282,6 +348,8 @@ static int AllocatePluginFile (module_bank_t *bank, const char *abspath,
             vlc_plugin_destroy(plugin);
             plugin = NULL;
         }
+        else if (plugin != NULL)
+            bank->cache_hits++;
     }
 
     if (plugin == NULL)
@@ -299,15 +367,14 @@ static int AllocatePluginFile (module_bank_t *bank, const char *abspath,
     if (plugin == NULL)
         return -1;
 
-    vlc_plugin_store(plugin);
+    /* Modules are indexed by AllocatePluginPath() */
+    vlc_plugin_add(plugin);
 
-    if (bank->mode & CACHE_WRITE_FILE) /* Add entry to to-be-saved cache */
-    {
-        bank->plugins = xrealloc(bank->plugins,
-                                 (bank->size + 1) * sizeof (vlc_plugin_t *));
-        bank->plugins[bank->size] = plugin;
-        bank->size++;
-    }
+    /* Add entry to to-be-indexed (and to-be-saved) list */
+    bank->plugins = xrealloc(bank->plugins,
+                             (bank->size + 1) * sizeof (vlc_plugin_t *));
+    bank->plugins[bank->size] = plugin;
+    bank->size++;
 
     /* TODO: deal with errors */
     return  0;
@@ -404,8 +471,50 @@ static void AllocatePluginPath(vlc_object_t *obj, const char *path,
         .mode = mode,
     };
 
+    vlc_cache_index_t index = { .caps = NULL, .count = 0, .plugins = 0 };
+
+    if (mode & CACHE_LAZY)
+    {   /* Defer loading of the cached plugins until they are needed */
+        vlc_cache_t *cache = vlc_cache_open(obj, path, &modules.caches);
+        vlc_cache_t **tab = NULL;
+
+        if (cache != NULL)
+            tab = vlc_reallocarray(modules.lazy, modules.lazy_count + 1,
+                                   sizeof (*tab));
+        if (likely(tab != NULL))
+        {
+            vlc_plugin_t *list = NULL;
+
+            msg_Dbg(obj, "deferring plug-ins of `%s'", path);
+            tab[modules.lazy_count++] = cache;
+            modules.lazy = tab;
+            atomic_store_explicit(&modules_lazy, true, memory_order_relaxed);
+
+            /* Register the configuration items of the plugins right away,
+             * so that their options and defaults are known. The config is
+             * sorted by module_LoadPlugins() */
+            if (vlc_cache_register(cache, &list))
+                msg_Warn(obj, "plugins cache partly loaded (corrupted)");
+
+            while (list != NULL)
+            {
+                vlc_plugin_t *plugin = list;
+
+                list = plugin->next;
+                vlc_plugin_add(plugin);
+            }
+            return;
+        }
+
+        if (cache != NULL)
+            vlc_cache_close(cache);
+        else
+            mode &= ~CACHE_READ_FILE; /* no (valid) cache */
+        /* Fall back to loading (or scanning) the plugins now */
+    }
+
     if (mode & CACHE_READ_FILE)
-        bank.cache = vlc_cache_load(obj, path, &modules.caches);
+        bank.cache = vlc_cache_load(obj, path, &modules.caches, &index);
     else
         msg_Dbg(bank.obj, "ignoring plugins cache file");
 
@@ -424,10 +533,32 @@ static void AllocatePluginPath(vlc_object_t *obj, const char *path,
 
         bank.cache = plugin->next;
         if (mode & CACHE_SCAN_DIR)
+        {
             vlc_plugin_destroy(plugin);
-        else
-            vlc_plugin_store(plugin);
+            continue;
+        }
+
+        vlc_plugin_add(plugin);
+        bank.plugins = xrealloc(bank.plugins,
+                                (bank.size + 1) * sizeof (vlc_plugin_t *));
+        bank.plugins[bank.size++] = plugin;
+        bank.cache_hits++;
+    }
+
+    /* If the plug-ins are exactly those of the cache, use its precomputed
+     * capabilities index. Otherwise, index each module individually. */
+    if (bank.size > 0 && bank.cache_hits == bank.size
+     && index.plugins == bank.size)
+    {
+        for (size_t i = 0; i < index.count; i++)
+            vlc_modcap_merge(index.caps + i);
+    }
+    else
+    {
+        for (size_t i = 0; i < bank.size; i++)
+            vlc_plugin_index(bank.plugins[i]);
     }
+    vlc_cache_index_clean(&index);
 
     if (mode & CACHE_WRITE_FILE)
         CacheSave(obj, path, bank.plugins, bank.size);
@@ -454,6 +585,8 @@ static void AllocateAllPlugins (vlc_object_t *p_this)
         mode |= CACHE_SCAN_DIR;
     if (var_InheritBool(p_this, "reset-plugins-cache"))
         mode = (mode | CACHE_WRITE_FILE) & ~CACHE_READ_FILE;
+    if ((mode & CACHE_READ_FILE) && var_InheritBool(p_this, "plugins-lazy"))
+        mode |= CACHE_LAZY;
 
 #if VLC_WINSTORE_APP
     /* Windows Store Apps can not load external plugins with absolute paths. */
@@ -562,6 +695,59 @@ static void module_Unmap(vlc_plugin_t *plugin)
     if (handle != NULL)
         vlc_dlclose(handle);
 }
+
+/**
+ * Loads the deferred plugins providing a capability.
+ */
+static void module_LoadLazyCap(const char *name)
+{
+    vlc_mutex_assert(&modules.lock);
+
+    size_t pos;
+
+    if (vlc_modcap_find(name, &pos) && modules.caps[pos].complete)
+        return;
+
+    for (size_t i = 0; i < modules.lazy_count; i++)
+        vlc_cache_load_cap(modules.lazy[i], name, vlc_plugin_index);
+
+    /* Unknown capabilities are not recorded, as the name is not owned. */
+    if (vlc_modcap_find(name, &pos))
+        modules.caps[pos].complete = true;
+}
+
+/**
+ * Loads the deferred plugins defining a module.
+ */
+static void module_LoadLazyName(const char *module)
+{
+    vlc_mutex_assert(&modules.lock);
+
+    for (size_t i = 0; i < modules.lazy_count; i++)
+        vlc_cache_load_name(modules.lazy[i], module, vlc_plugin_index);
+}
+
+/**
+ * Loads all the plugins whose loading was deferred.
+ *
+ * This is needed whenever all plugins must be enumerated, e.g. to list all
+ * configuration items.
+ */
+void module_LoadLazyPlugins(void)
+{
+    if (!atomic_load_explicit(&modules_lazy, memory_order_acquire))
+        return;
+
+    vlc_mutex_lock(&modules.lock);
+    if (atomic_load_explicit(&modules_lazy, memory_order_relaxed))
+    {
+        for (size_t i = 0; i < modules.lazy_count; i++)
+            vlc_cache_load_cap(modules.lazy[i], NULL, vlc_plugin_index);
+
+        atomic_store_explicit(&modules_lazy, false, memory_order_release);
+    }
+    vlc_mutex_unlock(&modules.lock);
+}
 #else
 int module_Map(vlc_object_t *obj, vlc_plugin_t *plugin)
 {
@@ -573,6 +759,10 @@ static void module_Unmap(vlc_plugin_t *plugin)
 {
     (void) plugin;
 }
+
+void module_LoadLazyPlugins(void)
+{
+}
 #endif /* HAVE_DYNAMIC_PLUGINS */
 
 /**
@@ -617,7 +807,8 @@ void module_EndBank (bool b_plugins)
 {
     vlc_plugin_t *libs = NULL;
     block_t *caches = NULL;
-    void *caps_tree = NULL;
+    vlc_modcap_t *caps = NULL;
+    size_t caps_count = 0;
 
     /* If plugins were _not_ loaded, then the caller still has the bank lock
      * from module_InitBank(). */
@@ -632,14 +823,26 @@ void module_EndBank (bool b_plugins)
         config_UnsortConfig ();
         libs = vlc_plugins;
         caches = modules.caches;
-        caps_tree = modules.caps_tree;
+        caps = modules.caps;
+        caps_count = modules.caps_count;
         vlc_plugins = NULL;
         modules.caches = NULL;
-        modules.caps_tree = NULL;
+        modules.caps = NULL;
+        modules.caps_count = 0;
+#ifdef HAVE_DYNAMIC_PLUGINS
+        for (size_t i = 0; i < modules.lazy_count; i++)
+            vlc_cache_close(modules.lazy[i]);
+        free(modules.lazy);
+        modules.lazy = NULL;
+        modules.lazy_count = 0;
+        atomic_store_explicit(&modules_lazy, false, memory_order_relaxed);
+#endif
     }
     vlc_mutex_unlock (&modules.lock);
 
-    tdestroy(caps_tree, vlc_modcap_free);
+    for (size_t i = 0; i < caps_count; i++)
+        free(caps[i].modv);
+    free(caps);
 
     while (libs != NULL)
     {
@@ -673,14 +876,13 @@ void module_LoadPlugins(vlc_object_t *obj)
 #endif
         config_UnsortConfig ();
         config_SortConfig ();
-
-        twalk(modules.caps_tree, vlc_modcap_sort);
     }
+
+    size_t count = 0;
+    for (const vlc_plugin_t *lib = vlc_plugins; lib != NULL; lib = lib->next)
+        count += lib->modules_count;
     vlc_mutex_unlock (&modules.lock);
 
-    size_t count;
-    module_t **list = module_list_get (&count);
-    module_list_free (list);
     msg_Dbg (obj, "plug-ins loaded: %zu modules", count);
 }
 
@@ -708,6 +910,9 @@ module_t **module_list_get (size_t *n)
 
     assert (n != NULL);
 
+    /* All plugins must be enumerated */
+    module_LoadLazyPlugins();
+
     for (vlc_plugin_t *lib = vlc_plugins; lib != NULL; lib = lib->next)
     {
         module_t **nt = realloc(tab, (i + lib->modules_count) * sizeof (*tab));
@@ -736,20 +941,74 @@ module_t **module_list_get (size_t *n)
  */
 ssize_t module_list_cap (module_t ***restrict list, const char *name)
 {
-    const vlc_modcap_t **cp = tfind(&name, &modules.caps_tree, vlc_modcap_cmp);
-    if (cp == NULL)
+    /* Once all plugins are loaded, the bank is read-only */
+    bool lazy = atomic_load_explicit(&modules_lazy, memory_order_acquire);
+    ssize_t ret = 0;
+    size_t pos;
+
+    *list = NULL;
+
+    if (lazy)
     {
-        *list = NULL;
-        return 0;
+        vlc_mutex_lock(&modules.lock);
+#ifdef HAVE_DYNAMIC_PLUGINS
+        module_LoadLazyCap(name);
+#endif
     }
 
-    const vlc_modcap_t *cap = *cp;
-    size_t n = cap->modc;
-    module_t **tab = vlc_alloc (n, sizeof (*tab));
-    *list = tab;
-    if (unlikely(tab == NULL))
-        return -1;
+    if (vlc_modcap_find(name, &pos) && modules.caps[pos].modc > 0)
+    {
+        const vlc_modcap_t *cap = modules.caps + pos;
+        size_t n = cap->modc;
+        module_t **tab = vlc_alloc (n, sizeof (*tab));
+
+        if (likely(tab != NULL))
+        {
+            memcpy(tab, cap->modv, sizeof (*tab) * n);
+            *list = tab;
+            ret = n;
+        }
+        else
+            ret = -1;
+    }
+
+    if (lazy)
+        vlc_mutex_unlock(&modules.lock);
+    return ret;
+}
+
+/**
+ * Looks a module up by name.
+ *
+ * Only the deferred plugins defining that module are loaded, if any.
+ *
+ * \param name module name (first shortcut)
+ * \return the module or NULL if not found
+ */
+module_t *module_lookup(const char *name)
+{
+    bool lazy = atomic_load_explicit(&modules_lazy, memory_order_acquire);
+    module_t *module = NULL;
+
+    if (lazy)
+    {
+        vlc_mutex_lock(&modules.lock);
+#ifdef HAVE_DYNAMIC_PLUGINS
+        module_LoadLazyName(name);
+#endif
+    }
 
-    memcpy(tab, cap->modv, sizeof (*tab) * n);
-    return n;
+    for (vlc_plugin_t *lib = vlc_plugins; lib != NULL && module == NULL;
+         lib = lib->next)
+        for (module_t *m = lib->module; m != NULL; m = m->next)
+            if (likely(m->i_shortcuts > 0)
+             && !strcmp(m->pp_shortcuts[0], name))
+            {
+                module = m;
+                break;
+            }
+
+    if (lazy)
+        vlc_mutex_unlock(&modules.lock);
+    return module;
 }
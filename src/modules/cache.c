@@ -28,6 +28,7 @@
 #endif
 
 #include <stdalign.h>
+#include <stddef.h>
 #include <stdlib.h>
 #include <stdio.h>
 #include <string.h>
@@ -35,12 +36,16 @@
 #include <sys/stat.h>
 #include <unistd.h>
 #include <assert.h>
+#ifdef HAVE_SEARCH_H
+# include <search.h>
+#endif
 
 #include <vlc_common.h>
 #include <vlc_block.h>
 #include "libvlc.h"
 
 #include <vlc_plugin.h>
+#include <vlc_modules.h>
 #include <errno.h>
 
 #include "config/configuration.h"
@@ -56,13 +61,122 @@
 #ifdef HAVE_DYNAMIC_PLUGINS
 /* Sub-version number
  * (only used to avoid breakage in dev version when cache structure changes) */
-#define CACHE_SUBVERSION_NUM 35
+#define CACHE_SUBVERSION_NUM 36
 
 /* Cache filename */
 #define CACHE_NAME "plugins.dat"
 /* Magic for the cache filename */
 #define CACHE_STRING "cache "PACKAGE_NAME" "PACKAGE_VERSION
 
+/*
+ * Cache file layout
+ *
+ * The cache file is mapped in memory and used in place. After the magic
+ * string and the sub-version number, a fixed header locates a series of
+ * tables of fixed-size records. Records never contain pointers: they refer
+ * to strings by offset within the string table, and to other records by
+ * index within their table, so that the file is relocatable and needs no
+ * parsing. Strings are interned: each distinct string is stored once, and
+ * offset zero denotes the NULL string.
+ *
+ * The capabilities table lists each capability once, with its modules sorted
+ * by decreasing score, so that the module bank can be indexed without any
+ * sorting or searching at start-up.
+ */
+struct vlc_cache_table
+{
+    uint32_t offset; /**< Byte offset from the start of the file */
+    uint32_t count; /**< Number of records (bytes for the string table) */
+};
+
+struct vlc_cache_header
+{
+    struct vlc_cache_table plugins;
+    struct vlc_cache_table modules;
+    struct vlc_cache_table configs;
+    struct vlc_cache_table refs; /**< String references */
+    struct vlc_cache_table ints; /**< Integer choices */
+    struct vlc_cache_table caps;
+    struct vlc_cache_table capmods; /**< Module references */
+    struct vlc_cache_table strings;
+};
+
+struct vlc_cache_plugin
+{
+    int64_t mtime;
+    uint64_t size;
+    uint32_t path;
+    uint32_t textdomain;
+    uint32_t modules; /**< First module */
+    uint32_t modules_count;
+    uint32_t configs; /**< First configuration item */
+    uint32_t configs_count;
+    uint8_t unloadable;
+};
+
+struct vlc_cache_module
+{
+    uint32_t shortname;
+    uint32_t longname;
+    uint32_t help;
+    uint32_t capability;
+    uint32_t activate;
+    uint32_t deactivate;
+    uint32_t shortcuts; /**< First shortcut string reference */
+    uint32_t shortcuts_count;
+    int32_t score;
+};
+
+union vlc_cache_value
+{
+    int64_t i;
+    float f;
+    uint32_t psz;
+};
+
+struct vlc_cache_config
+{
+    union vlc_cache_value orig;
+    union vlc_cache_value min;
+    union vlc_cache_value max;
+    uint32_t type;
+    uint32_t name;
+    uint32_t text;
+    uint32_t longtext;
+    uint32_t list_cb_name;
+    uint32_t list; /**< First choice (string reference or integer) */
+    uint32_t list_text; /**< First choice name string reference */
+    uint16_t list_count;
+    uint8_t i_type;
+    char i_short;
+    uint8_t flags;
+};
+
+#define CACHE_CONFIG_INTERNAL   0x1
+#define CACHE_CONFIG_UNSAVEABLE 0x2
+#define CACHE_CONFIG_SAFE       0x4
+#define CACHE_CONFIG_REMOVED    0x8
+
+struct vlc_cache_cap
+{
+    uint32_t name;
+    uint32_t modules; /**< First module reference */
+    uint32_t modules_count;
+};
+
+/** Mapped cache file */
+struct vlc_cache_map
+{
+    struct vlc_cache_header hdr;
+    const struct vlc_cache_plugin *plugins;
+    const struct vlc_cache_module *modules;
+    const struct vlc_cache_config *configs;
+    const uint32_t *refs;
+    const int *ints;
+    const struct vlc_cache_cap *caps;
+    const uint32_t *capmods;
+    const char *strings;
+};
 
 static int vlc_cache_load_immediate(void *out, block_t *in, size_t size)
 {
@@ -75,267 +189,245 @@ static int vlc_cache_load_immediate(void *out, block_t *in, size_t size)
     return 0;
 }
 
-static int vlc_cache_load_bool(bool *out, block_t *in)
+static const void *vlc_cache_load_table(const uint8_t *base, size_t length,
+                                        const struct vlc_cache_table *table,
+                                        size_t size, size_t align)
 {
-    unsigned char b;
-
-    if (vlc_cache_load_immediate(&b, in, 1) || b > 1)
-        return -1;
+    if (table->offset > length || (table->offset % align) != 0
+     || table->count > (length - table->offset) / size)
+        return NULL;
 
-    *out = b;
-    return 0;
+    return base + table->offset;
 }
 
-static int vlc_cache_load_array(const void **p, size_t size, size_t n,
-                                block_t *file)
+static bool vlc_cache_range(uint32_t first, uint32_t count, uint32_t total)
 {
-    if (n == 0)
-    {
-        *p = NULL;
-        return 0;
-    }
-
-    if (unlikely(size * n < size))
-        return -1;
-
-    size *= n;
-
-    if (file->i_buffer < size)
-        return -1;
-
-    *p = file->p_buffer;
-    file->p_buffer += size;
-    file->i_buffer -= size;
-    return 0;
+    return first <= total && count <= total - first;
 }
 
-static int vlc_cache_load_string(const char **restrict p, block_t *file)
+static int vlc_cache_load_string(const char **restrict p,
+                                 const struct vlc_cache_map *map,
+                                 uint32_t offset)
 {
-    uint16_t size;
-
-    if (vlc_cache_load_immediate(&size, file, sizeof (size)) || size > 16384)
-        return -1;
-
-    if (size == 0)
+    if (offset == 0)
     {
         *p = NULL;
         return 0;
     }
 
-    const char *str = (char *)file->p_buffer;
-
-    if (file->i_buffer < size || str[size - 1] != '\0')
-        return -1;
-
-    file->p_buffer += size;
-    file->i_buffer -= size;
-    *p = str;
-    return 0;
-}
-
-static int vlc_cache_load_align(size_t align, block_t *file)
-{
-    assert(align > 0);
-
-    size_t skip = (-(uintptr_t)file->p_buffer) % align;
-    if (skip == 0)
-        return 0;
-
-    assert(skip < align);
-
-    if (file->i_buffer < skip)
+    /* The string table is nul-terminated, see vlc_cache_load(). */
+    if (offset >= map->hdr.strings.count)
         return -1;
 
-    file->p_buffer += skip;
-    file->i_buffer -= skip;
-    assert((((uintptr_t)file->p_buffer) % align) == 0);
+    *p = map->strings + offset;
     return 0;
 }
 
-#define LOAD_IMMEDIATE(a) \
-    if (vlc_cache_load_immediate(&(a), file, sizeof (a))) \
-        goto error
-#define LOAD_FLAG(a) \
-    do \
-    { \
-        bool b; \
-        if (vlc_cache_load_bool(&b, file)) \
-            goto error; \
-        (a) = b; \
-    } while (0)
-#define LOAD_ARRAY(a,n) \
-    do \
-    { \
-        const void *base; \
-        if (vlc_cache_load_array(&base, sizeof (*(a)), (n), file)) \
-            goto error; \
-        (a) = base; \
-    } while (0)
-#define LOAD_STRING(a) \
-    if (vlc_cache_load_string(&(a), file)) \
-        goto error
-#define LOAD_ALIGNOF(t) \
-    if (vlc_cache_load_align(alignof(t), file)) \
+#define LOAD_STRING(a, offset) \
+    if (vlc_cache_load_string(&(a), map, (offset))) \
         goto error
 
-static int vlc_cache_load_config(module_config_t *cfg, block_t *file)
+static int vlc_cache_load_config(module_config_t *cfg,
+                                 const struct vlc_cache_map *map,
+                                 const struct vlc_cache_config *rec)
 {
-    LOAD_IMMEDIATE (cfg->i_type);
-    LOAD_IMMEDIATE (cfg->i_short);
-    LOAD_FLAG (cfg->b_internal);
-    LOAD_FLAG (cfg->b_unsaveable);
-    LOAD_FLAG (cfg->b_safe);
-    LOAD_FLAG (cfg->b_removed);
-    LOAD_STRING (cfg->psz_type);
-    LOAD_STRING (cfg->psz_name);
-    LOAD_STRING (cfg->psz_text);
-    LOAD_STRING (cfg->psz_longtext);
-    LOAD_IMMEDIATE (cfg->list_count);
+    cfg->i_type = rec->i_type;
+    cfg->i_short = rec->i_short;
+    cfg->b_internal = (rec->flags & CACHE_CONFIG_INTERNAL) != 0;
+    cfg->b_unsaveable = (rec->flags & CACHE_CONFIG_UNSAVEABLE) != 0;
+    cfg->b_safe = (rec->flags & CACHE_CONFIG_SAFE) != 0;
+    cfg->b_removed = (rec->flags & CACHE_CONFIG_REMOVED) != 0;
+    LOAD_STRING(cfg->psz_type, rec->type);
+    LOAD_STRING(cfg->psz_name, rec->name);
+    LOAD_STRING(cfg->psz_text, rec->text);
+    LOAD_STRING(cfg->psz_longtext, rec->longtext);
+    LOAD_STRING(cfg->list_cb_name, rec->list_cb_name);
+
+    if (!vlc_cache_range(rec->list_text, rec->list_count,
+                         map->hdr.refs.count))
+        goto error;
 
-    if (IsConfigStringType (cfg->i_type))
+    if (IsConfigStringType(cfg->i_type))
     {
+        if (!vlc_cache_range(rec->list, rec->list_count, map->hdr.refs.count))
+            goto error;
+
+        if (rec->list_count > 0)
+        {
+            cfg->list.psz = vlc_alloc(rec->list_count, sizeof (char *));
+            if (unlikely(cfg->list.psz == NULL))
+                goto error;
+            cfg->list_count = rec->list_count;
+
+            for (unsigned i = 0; i < cfg->list_count; i++)
+            {
+                LOAD_STRING(cfg->list.psz[i], map->refs[rec->list + i]);
+                if (cfg->list.psz[i] == NULL) /* NULL -> empty string */
+                    cfg->list.psz[i] = "";
+            }
+        }
+
         const char *psz;
-        LOAD_STRING(psz);
+        LOAD_STRING(psz, rec->orig.psz);
         cfg->orig.psz = (char *)psz;
-        cfg->value.psz = (psz != NULL) ? strdup (cfg->orig.psz) : NULL;
-
-        if (cfg->list_count)
-            cfg->list.psz = xmalloc (cfg->list_count * sizeof (char *));
-        else
-            LOAD_STRING(cfg->list_cb_name);
-        for (unsigned i = 0; i < cfg->list_count; i++)
+        if (psz != NULL)
         {
-            LOAD_STRING (cfg->list.psz[i]);
-            if (cfg->list.psz[i] == NULL /* NULL -> empty string */
-             && (cfg->list.psz[i] = calloc (1, 1)) == NULL)
+            cfg->value.psz = strdup(psz);
+            if (unlikely(cfg->value.psz == NULL))
                 goto error;
         }
     }
     else
     {
-        LOAD_IMMEDIATE (cfg->orig);
-        LOAD_IMMEDIATE (cfg->min);
-        LOAD_IMMEDIATE (cfg->max);
-        cfg->value = cfg->orig;
+        if (!vlc_cache_range(rec->list, rec->list_count, map->hdr.ints.count))
+            goto error;
 
-        if (cfg->list_count)
+        if (IsConfigFloatType(cfg->i_type))
         {
-            LOAD_ALIGNOF(*cfg->list.i);
+            cfg->orig.f = rec->orig.f;
+            cfg->min.f = rec->min.f;
+            cfg->max.f = rec->max.f;
         }
         else
-            LOAD_STRING(cfg->list_cb_name);
-
-        LOAD_ARRAY(cfg->list.i, cfg->list_count);
-    }
-
-    cfg->list_text = xmalloc (cfg->list_count * sizeof (char *));
-    for (unsigned i = 0; i < cfg->list_count; i++)
-    {
-        LOAD_STRING (cfg->list_text[i]);
-        if (cfg->list_text[i] == NULL /* NULL -> empty string */
-         && (cfg->list_text[i] = calloc (1, 1)) == NULL)
-            goto error;
-    }
-
-    return 0;
-error:
-    return -1; /* FIXME: leaks */
-}
-
-static int vlc_cache_load_plugin_config(vlc_plugin_t *plugin, block_t *file)
-{
-    uint16_t lines;
-
-    /* Calculate the structure length */
-    LOAD_IMMEDIATE (lines);
-
-    /* Allocate memory */
-    if (lines)
-    {
-        plugin->conf.items = calloc(sizeof (module_config_t), lines);
-        if (unlikely(plugin->conf.items == NULL))
         {
-            plugin->conf.size = 0;
-            return -1;
+            cfg->orig.i = rec->orig.i;
+            cfg->min.i = rec->min.i;
+            cfg->max.i = rec->max.i;
         }
-    }
-    else
-        plugin->conf.items = NULL;
+        cfg->value = cfg->orig;
 
-    plugin->conf.size = lines;
+        /* Integer choices are used in place */
+        cfg->list.i = map->ints + rec->list;
+        cfg->list_count = rec->list_count;
+    }
 
-    /* Do the duplication job */
-    for (size_t i = 0; i < lines; i++)
+    if (cfg->list_count > 0)
     {
-        module_config_t *item = plugin->conf.items + i;
-
-        if (vlc_cache_load_config(item, file))
-            return -1;
+        cfg->list_text = vlc_alloc(cfg->list_count, sizeof (char *));
+        if (unlikely(cfg->list_text == NULL))
+            goto error;
 
-        if (CONFIG_ITEM(item->i_type))
+        for (unsigned i = 0; i < cfg->list_count; i++)
         {
-            plugin->conf.count++;
-            if (item->i_type == CONFIG_ITEM_BOOL)
-                plugin->conf.booleans++;
+            LOAD_STRING(cfg->list_text[i], map->refs[rec->list_text + i]);
+            if (cfg->list_text[i] == NULL) /* NULL -> empty string */
+                cfg->list_text[i] = "";
         }
-        item->owner = plugin;
     }
-
     return 0;
 error:
-    return -1; /* FIXME: leaks */
+    return -1; /* items are released with the plugin */
 }
 
-static int vlc_cache_load_module(vlc_plugin_t *plugin, block_t *file)
+static int vlc_cache_load_module(vlc_plugin_t *plugin,
+                                 const struct vlc_cache_map *map,
+                                 const struct vlc_cache_module *rec,
+                                 module_t **restrict modp)
 {
     module_t *module = vlc_module_create(plugin);
     if (unlikely(module == NULL))
         return -1;
 
-    LOAD_STRING(module->psz_shortname);
-    LOAD_STRING(module->psz_longname);
-    LOAD_STRING(module->psz_help);
+    *modp = module;
 
-    LOAD_IMMEDIATE(module->i_shortcuts);
-    if (module->i_shortcuts > MODULE_SHORTCUT_MAX)
+    LOAD_STRING(module->psz_shortname, rec->shortname);
+    LOAD_STRING(module->psz_longname, rec->longname);
+    LOAD_STRING(module->psz_help, rec->help);
+
+    if (rec->shortcuts_count > MODULE_SHORTCUT_MAX
+     || !vlc_cache_range(rec->shortcuts, rec->shortcuts_count,
+                         map->hdr.refs.count))
         goto error;
-    else
+
+    if (rec->shortcuts_count > 0)
     {
-        module->pp_shortcuts =
-            xmalloc (sizeof (*module->pp_shortcuts) * module->i_shortcuts);
+        module->pp_shortcuts = vlc_alloc(rec->shortcuts_count,
+                                         sizeof (*module->pp_shortcuts));
+        if (unlikely(module->pp_shortcuts == NULL))
+            goto error;
+        module->i_shortcuts = rec->shortcuts_count;
+
         for (unsigned j = 0; j < module->i_shortcuts; j++)
-            LOAD_STRING(module->pp_shortcuts[j]);
+            LOAD_STRING(module->pp_shortcuts[j], map->refs[rec->shortcuts + j]);
     }
 
-    LOAD_STRING(module->activate_name);
-    LOAD_STRING(module->deactivate_name);
-    LOAD_STRING(module->psz_capability);
-    LOAD_IMMEDIATE(module->i_score);
+    LOAD_STRING(module->activate_name, rec->activate);
+    LOAD_STRING(module->deactivate_name, rec->deactivate);
+    LOAD_STRING(module->psz_capability, rec->capability);
+    module->i_score = rec->score;
     return 0;
 error:
     return -1;
 }
 
-static vlc_plugin_t *vlc_cache_load_plugin(block_t *file)
+/**
+ * Loads the modules of a plug-in loaded with vlc_cache_load_plugin().
+ */
+static int vlc_cache_load_modules(vlc_plugin_t *plugin,
+                                  const struct vlc_cache_map *map,
+                                  const struct vlc_cache_plugin *rec,
+                                  module_t **modv)
+{
+    assert(plugin->module == NULL);
+
+    for (uint32_t i = rec->modules; i < rec->modules + rec->modules_count; i++)
+        if (vlc_cache_load_module(plugin, map, map->modules + i, modv + i))
+        {
+            memset(modv + rec->modules, 0,
+                   rec->modules_count * sizeof (*modv));
+            vlc_module_destroy(plugin->module);
+            plugin->module = NULL;
+            plugin->modules_count = 0;
+            return -1;
+        }
+    return 0;
+}
+
+/**
+ * Loads a plug-in, with its configuration items but without its modules.
+ */
+static vlc_plugin_t *vlc_cache_load_plugin(const struct vlc_cache_map *map,
+                                           const struct vlc_cache_plugin *rec)
 {
     vlc_plugin_t *plugin = vlc_plugin_create();
     if (unlikely(plugin == NULL))
         return NULL;
 
-    uint32_t modules;
-    LOAD_IMMEDIATE(modules);
+    /* The modules range was checked by vlc_cache_open() */
+    if (!vlc_cache_range(rec->configs, rec->configs_count,
+                         map->hdr.configs.count))
+        goto error;
 
-    for (size_t i = 0; i < modules; i++)
-        if (vlc_cache_load_module(plugin, file))
+    if (rec->configs_count > 0)
+    {
+        plugin->conf.items = calloc(rec->configs_count,
+                                    sizeof (module_config_t));
+        if (unlikely(plugin->conf.items == NULL))
             goto error;
 
-    if (vlc_cache_load_plugin_config(plugin, file))
-        goto error;
+        plugin->conf.size = rec->configs_count;
+    }
 
-    LOAD_STRING(plugin->textdomain);
+    for (size_t i = 0; i < plugin->conf.size; i++)
+    {
+        module_config_t *item = plugin->conf.items + i;
+
+        if (vlc_cache_load_config(item, map, map->configs + rec->configs + i))
+            goto error;
+
+        if (CONFIG_ITEM(item->i_type))
+        {
+            plugin->conf.count++;
+            if (item->i_type == CONFIG_ITEM_BOOL)
+                plugin->conf.booleans++;
+        }
+        item->owner = plugin;
+    }
+
+    LOAD_STRING(plugin->textdomain, rec->textdomain);
 
     const char *path;
-    LOAD_STRING(path);
+    LOAD_STRING(path, rec->path);
     if (path == NULL)
         goto error;
 
@@ -343,9 +435,12 @@ static vlc_plugin_t *vlc_cache_load_plugin(block_t *file)
     if (unlikely(plugin->path == NULL))
         goto error;
 
-    LOAD_FLAG(plugin->unloadable);
-    LOAD_IMMEDIATE(plugin->mtime);
-    LOAD_IMMEDIATE(plugin->size);
+    if (rec->unloadable > 1)
+        goto error;
+
+    plugin->unloadable = rec->unloadable;
+    plugin->mtime = rec->mtime;
+    plugin->size = rec->size;
 
     if (plugin->textdomain != NULL)
         vlc_bindtextdomain(plugin->textdomain);
@@ -358,15 +453,88 @@ error:
 }
 
 /**
- * Loads a plugins cache file.
+ * Loads the capabilities index of a plugins cache.
+ */
+static int vlc_cache_load_index(vlc_cache_index_t *index,
+                                const struct vlc_cache_map *map,
+                                module_t *const *modv)
+{
+    index->caps = vlc_alloc(map->hdr.caps.count, sizeof (*index->caps));
+    index->modv = vlc_alloc(map->hdr.capmods.count, sizeof (*index->modv));
+    if (unlikely((index->caps == NULL && map->hdr.caps.count > 0)
+              || (index->modv == NULL && map->hdr.capmods.count > 0)))
+        goto error;
+
+    for (size_t i = 0; i < map->hdr.caps.count; i++)
+    {
+        const struct vlc_cache_cap *rec = map->caps + i;
+        vlc_modcap_t *cap = index->caps + i;
+
+        if (!vlc_cache_range(rec->modules, rec->modules_count,
+                             map->hdr.capmods.count))
+            goto error;
+
+        LOAD_STRING(cap->name, rec->name);
+        if (cap->name == NULL)
+            goto error;
+
+        cap->modv = index->modv + rec->modules;
+        cap->modc = rec->modules_count;
+        cap->complete = false;
+
+        for (size_t j = 0; j < cap->modc; j++)
+        {
+            uint32_t m = map->capmods[rec->modules + j];
+
+            if (m >= map->hdr.modules.count || modv[m] == NULL
+             || strcmp(module_get_capability(modv[m]), cap->name))
+                goto error;
+            if (j > 0 && cap->modv[j - 1]->i_score < modv[m]->i_score)
+                goto error;
+
+            cap->modv[j] = modv[m];
+        }
+        index->count++;
+    }
+    return 0;
+error:
+    vlc_cache_index_clean(index);
+    return -1;
+}
+
+/**
+ * Releases the capabilities index of a plugins cache.
+ */
+void vlc_cache_index_clean(vlc_cache_index_t *index)
+{
+    free(index->modv);
+    free(index->caps);
+    index->caps = NULL;
+    index->count = 0;
+    index->plugins = 0;
+    index->modv = NULL;
+}
+
+/** Opened plugins cache */
+struct vlc_cache
+{
+    struct vlc_cache_map map;
+    char *dir; /**< Plug-ins base directory */
+    module_t **modv; /**< Loaded modules, by module index */
+    vlc_plugin_t **plugins; /**< Registered plug-ins (NULL on error) */
+    bool *loaded; /**< Whether the modules of each plug-in were loaded
+                       (or failed to) */
+};
+
+/**
+ * Opens a plugins cache file.
  *
- * This function will load the plugin cache if present and valid. This cache
- * will in turn be queried by AllocateAllPlugins() to see if it needs to
- * actually load the dynamically loadable module.
- * This allows us to only fully load plugins when they are actually used.
+ * The cache file is memory-mapped and validated, but no plug-in is loaded.
+ * The mapping is added to the backing storage list, as it must outlive the
+ * plug-ins loaded from the cache.
  */
-vlc_plugin_t *vlc_cache_load(vlc_object_t *p_this, const char *dir,
-                             block_t **backingp)
+vlc_cache_t *vlc_cache_open(vlc_object_t *p_this, const char *dir,
+                            block_t **backingp)
 {
     char *psz_filename;
 
@@ -385,6 +553,9 @@ vlc_plugin_t *vlc_cache_load(vlc_object_t *p_this, const char *dir,
     if (file == NULL)
         return NULL;
 
+    const uint8_t *base = file->p_buffer;
+    const size_t length = file->i_buffer;
+
     /* Check the file is a plugins cache */
     char cachestr[sizeof (CACHE_STRING) - 1];
 
@@ -436,164 +607,676 @@ vlc_plugin_t *vlc_cache_load(vlc_object_t *p_this, const char *dir,
         return NULL;
     }
 
-    vlc_plugin_t *cache = NULL;
+    vlc_cache_t *cache = malloc(sizeof (*cache));
+    if (unlikely(cache == NULL))
+    {
+        block_Release(file);
+        return NULL;
+    }
+
+    struct vlc_cache_map *map = &cache->map;
+    size_t offset = length - file->i_buffer;
 
-    while (file->i_buffer > 0)
+    cache->dir = NULL;
+    cache->modv = NULL;
+    cache->plugins = NULL;
+    cache->loaded = NULL;
+
+    offset += (-offset) % alignof (struct vlc_cache_header);
+    if (((uintptr_t)base % alignof (max_align_t)) != 0
+     || offset > length || length - offset < sizeof (map->hdr))
+        goto error;
+
+    memcpy(&map->hdr, base + offset, sizeof (map->hdr));
+
+#define LOAD_TABLE(name, type) \
+    map->name = vlc_cache_load_table(base, length, &map->hdr.name, \
+                                     sizeof (type), alignof (type)); \
+    if (map->name == NULL) \
+        goto error
+
+    LOAD_TABLE(plugins, struct vlc_cache_plugin);
+    LOAD_TABLE(modules, struct vlc_cache_module);
+    LOAD_TABLE(configs, struct vlc_cache_config);
+    LOAD_TABLE(refs, uint32_t);
+    LOAD_TABLE(ints, int);
+    LOAD_TABLE(caps, struct vlc_cache_cap);
+    LOAD_TABLE(capmods, uint32_t);
+    LOAD_TABLE(strings, char);
+#undef LOAD_TABLE
+
+    /* All strings are terminated if the table is */
+    if (map->hdr.strings.count == 0
+     || map->strings[0] != '\0'
+     || map->strings[map->hdr.strings.count - 1] != '\0')
+        goto error;
+
+    /* Modules must be stored in plug-in order, see vlc_cache_find(). */
+    uint32_t modules = 0;
+
+    for (size_t i = 0; i < map->hdr.plugins.count; i++)
     {
-        vlc_plugin_t *plugin = vlc_cache_load_plugin(file);
-        if (plugin == NULL)
-            goto error;
+        const struct vlc_cache_plugin *rec = map->plugins + i;
 
-        if (unlikely(asprintf(&plugin->abspath, "%s" DIR_SEP "%s", dir,
-                              plugin->path) == -1))
-        {
-            plugin->abspath = NULL;
-            vlc_plugin_destroy(plugin);
+        if (rec->modules < modules
+         || !vlc_cache_range(rec->modules, rec->modules_count,
+                             map->hdr.modules.count))
             goto error;
-        }
-
-        plugin->next = cache;
-        cache = plugin;
+        modules = rec->modules + rec->modules_count;
     }
 
+    cache->dir = strdup(dir);
+    cache->modv = calloc(map->hdr.modules.count, sizeof (*cache->modv));
+    cache->plugins = calloc(map->hdr.plugins.count, sizeof (*cache->plugins));
+    cache->loaded = calloc(map->hdr.plugins.count, sizeof (*cache->loaded));
+    if (unlikely(cache->dir == NULL
+              || (cache->modv == NULL && map->hdr.modules.count > 0)
+              || (cache->plugins == NULL && map->hdr.plugins.count > 0)
+              || (cache->loaded == NULL && map->hdr.plugins.count > 0)))
+        goto error;
+
     file->p_next = *backingp;
     *backingp = file;
     return cache;
 
 error:
     msg_Warn( p_this, "plugins cache not loaded (corrupted)" );
-
-    /* TODO: cleanup */
+    free(cache->loaded);
+    free(cache->plugins);
+    free(cache->modv);
+    free(cache->dir);
+    free(cache);
     block_Release(file);
     return NULL;
 }
 
-#define SAVE_IMMEDIATE( a ) \
-    if (fwrite (&(a), sizeof(a), 1, file) != 1) \
-        goto error
-#define SAVE_FLAG(a) \
-    do { \
-        char b = (a); \
-        SAVE_IMMEDIATE(b); \
-    } while (0)
+/**
+ * Closes a plugins cache.
+ *
+ * Plug-ins loaded from the cache remain valid.
+ */
+void vlc_cache_close(vlc_cache_t *cache)
+{
+    free(cache->loaded);
+    free(cache->plugins);
+    free(cache->modv);
+    free(cache->dir);
+    free(cache);
+}
 
-static int CacheSaveString (FILE *file, const char *str)
+/**
+ * Finds the plug-in containing a given module.
+ * \return the plug-in index, or SIZE_MAX if not found
+ */
+static size_t vlc_cache_find(const struct vlc_cache_map *map, uint32_t module)
 {
-    uint16_t size = (str != NULL) ? (strlen (str) + 1) : 0;
+    size_t lo = 0, hi = map->hdr.plugins.count;
 
-    SAVE_IMMEDIATE (size);
-    if (size != 0 && fwrite(str, 1, size, file) != size)
+    while (lo < hi)
     {
-error:
-        return -1;
+        size_t mid = (lo + hi) / 2;
+        const struct vlc_cache_plugin *rec = map->plugins + mid;
+
+        if (module < rec->modules)
+            hi = mid;
+        else if (module - rec->modules >= rec->modules_count)
+            lo = mid + 1;
+        else
+            return mid;
+    }
+    return SIZE_MAX;
+}
+
+/**
+ * Registers the plug-ins of a cache, and prepends them to a list.
+ *
+ * The plug-ins are loaded with their configuration items, so that the
+ * options of all the plug-ins are known with their default values. Their
+ * modules are only loaded later on, see vlc_cache_load_cap().
+ *
+ * \return 0 on success, -1 if some plug-ins could not be loaded
+ */
+int vlc_cache_register(vlc_cache_t *cache, vlc_plugin_t **restrict list)
+{
+    const struct vlc_cache_map *map = &cache->map;
+    int ret = 0;
+
+    /* Reverse order, so that the list ends up in file order */
+    for (size_t i = map->hdr.plugins.count; i > 0; i--)
+    {
+        vlc_plugin_t *plugin = vlc_cache_load_plugin(map, map->plugins + i - 1);
+
+        if (plugin != NULL
+         && unlikely(asprintf(&plugin->abspath, "%s" DIR_SEP "%s", cache->dir,
+                              plugin->path) == -1))
+        {
+            plugin->abspath = NULL;
+            vlc_plugin_destroy(plugin);
+            plugin = NULL;
+        }
+
+        if (plugin == NULL)
+        {
+            cache->loaded[i - 1] = true; /* do not retry */
+            ret = -1;
+            continue;
+        }
+
+        cache->plugins[i - 1] = plugin;
+        plugin->next = *list;
+        *list = plugin;
     }
+    return ret;
+}
+
+/**
+ * Loads the modules of a registered plug-in.
+ */
+static int vlc_cache_load_at(vlc_cache_t *cache, size_t i,
+                             void (*cb)(vlc_plugin_t *))
+{
+    vlc_plugin_t *plugin = cache->plugins[i];
+
+    assert(!cache->loaded[i]);
+    cache->loaded[i] = true; /* do not retry on error */
+
+    if (vlc_cache_load_modules(plugin, &cache->map, cache->map.plugins + i,
+                               cache->modv))
+        return -1;
+
+    if (cb != NULL)
+        cb(plugin);
     return 0;
 }
 
-#define SAVE_STRING( a ) \
-    if (CacheSaveString (file, (a))) \
-        goto error
+/**
+ * Loads the modules of the registered plug-ins that provide a capability.
+ *
+ * Plug-ins whose modules were already loaded are skipped.
+ *
+ * \param cap capability name, or NULL to load all remaining plug-ins
+ * \param cb callback for each plug-in whose modules were loaded, or NULL
+ * \return 0 on success, -1 if some plug-ins could not be loaded
+ */
+int vlc_cache_load_cap(vlc_cache_t *cache, const char *cap,
+                       void (*cb)(vlc_plugin_t *))
+{
+    const struct vlc_cache_map *map = &cache->map;
+    int ret = 0;
 
-static int CacheSaveAlign(FILE *file, size_t align)
+    if (cap == NULL)
+    {
+        for (size_t i = 0; i < map->hdr.plugins.count; i++)
+            if (!cache->loaded[i] && vlc_cache_load_at(cache, i, cb))
+                ret = -1;
+        return ret;
+    }
+
+    for (size_t i = 0; i < map->hdr.caps.count; i++)
+    {
+        const struct vlc_cache_cap *rec = map->caps + i;
+        const char *name;
+
+        if (vlc_cache_load_string(&name, map, rec->name) || name == NULL
+         || !vlc_cache_range(rec->modules, rec->modules_count,
+                             map->hdr.capmods.count))
+        {
+            ret = -1;
+            continue;
+        }
+
+        if (strcmp(name, cap))
+            continue;
+
+        for (size_t j = 0; j < rec->modules_count; j++)
+        {
+            size_t p = vlc_cache_find(map, map->capmods[rec->modules + j]);
+
+            if (p == SIZE_MAX)
+                ret = -1;
+            else
+            if (!cache->loaded[p] && vlc_cache_load_at(cache, p, cb))
+                ret = -1;
+        }
+    }
+    return ret;
+}
+
+/**
+ * Checks whether a cached plug-in defines a given module.
+ */
+static bool vlc_cache_plugin_has(const struct vlc_cache_map *map,
+                                 const struct vlc_cache_plugin *rec,
+                                 const char *module)
 {
-    assert(align > 0);
+    for (uint32_t i = 0; i < rec->modules_count; i++)
+    {
+        const struct vlc_cache_module *mod = map->modules + rec->modules + i;
+        const char *name;
+
+        if (mod->shortcuts_count > 0
+         && vlc_cache_range(mod->shortcuts, 1, map->hdr.refs.count)
+         && !vlc_cache_load_string(&name, map, map->refs[mod->shortcuts])
+         && name != NULL && !strcmp(name, module))
+            return true;
+    }
+    return false;
+}
+
+/**
+ * Loads the modules of the registered plug-ins that define a given module.
+ *
+ * Plug-ins whose modules were already loaded are skipped.
+ *
+ * \param module module name (first shortcut)
+ * \param cb callback for each plug-in whose modules were loaded, or NULL
+ * \return 0 on success, -1 if some plug-ins could not be loaded
+ */
+int vlc_cache_load_name(vlc_cache_t *cache, const char *module,
+                        void (*cb)(vlc_plugin_t *))
+{
+    const struct vlc_cache_map *map = &cache->map;
+    int ret = 0;
+
+    for (size_t i = 0; i < map->hdr.plugins.count; i++)
+        if (!cache->loaded[i]
+         && vlc_cache_plugin_has(map, map->plugins + i, module)
+         && vlc_cache_load_at(cache, i, cb))
+            ret = -1;
+    return ret;
+}
+
+/**
+ * Loads a plugins cache file.
+ *
+ * This function will load the plugin cache if present and valid. This cache
+ * will in turn be queried by AllocateAllPlugins() to see if it needs to
+ * actually load the dynamically loadable module.
+ * This allows us to only fully load plugins when they are actually used.
+ *
+ * \param index capabilities index of the cache [OUT]
+ * (release with vlc_cache_index_clean())
+ */
+vlc_plugin_t *vlc_cache_load(vlc_object_t *p_this, const char *dir,
+                             block_t **backingp, vlc_cache_index_t *index)
+{
+    index->caps = NULL;
+    index->count = 0;
+    index->plugins = 0;
+    index->modv = NULL;
+
+    vlc_cache_t *cache = vlc_cache_open(p_this, dir, backingp);
+    if (cache == NULL)
+        return NULL;
+
+    vlc_plugin_t *list = NULL;
+
+    if (vlc_cache_register(cache, &list)
+     || vlc_cache_load_cap(cache, NULL, NULL)
+     || vlc_cache_load_index(index, &cache->map, cache->modv))
+    {
+        msg_Warn( p_this, "plugins cache not loaded (corrupted)" );
+
+        while (list != NULL)
+        {
+            vlc_plugin_t *plugin = list;
+
+            list = plugin->next;
+            vlc_plugin_destroy(plugin);
+        }
+    }
+    else
+        index->plugins = cache->map.hdr.plugins.count;
+
+    vlc_cache_close(cache);
+    return list;
+}
+
+/** Growable table of records, for writing the cache */
+struct vlc_cache_buf
+{
+    void *data;
+    size_t count;
+    size_t alloc;
+};
+
+/**
+ * Appends zeroed records to a table.
+ * \return a pointer to the first new record, or NULL on error
+ */
+static void *CacheAppend(struct vlc_cache_buf *buf, size_t size, size_t n)
+{
+    if (buf->data == NULL || buf->count + n > buf->alloc)
+    {
+        size_t alloc = (buf->alloc > 0) ? buf->alloc : 16;
+
+        while (alloc < buf->count + n)
+            alloc *= 2;
+
+        void *data = vlc_reallocarray(buf->data, alloc, size);
+        if (unlikely(data == NULL))
+            return NULL;
+
+        buf->data = data;
+        buf->alloc = alloc;
+    }
+
+    void *p = (char *)buf->data + buf->count * size;
+
+    memset(p, 0, n * size);
+    buf->count += n;
+    return p;
+}
+
+struct vlc_cache_string
+{
+    const char *str;
+    uint32_t offset;
+};
+
+static int vlc_cache_string_cmp(const void *a, const void *b)
+{
+    const struct vlc_cache_string *sa = a, *sb = b;
+    return strcmp(sa->str, sb->str);
+}
 
-    size_t skip = (-ftell(file)) % align;
-    if (skip == 0)
+/** Module reference, for building the capabilities table */
+struct vlc_cache_capmod
+{
+    uint32_t name;
+    int32_t score;
+    uint32_t module;
+};
+
+static int vlc_cache_capmod_cmp(const void *a, const void *b)
+{
+    const struct vlc_cache_capmod *ca = a, *cb = b;
+
+    /* Strings are interned, so comparing offsets is enough for grouping. */
+    if (ca->name != cb->name)
+        return (ca->name < cb->name) ? -1 : 1;
+    /* Highest score first */
+    if (ca->score != cb->score)
+        return (ca->score > cb->score) ? -1 : 1;
+    return (ca->module < cb->module) ? -1 : (ca->module > cb->module);
+}
+
+struct vlc_cache_writer
+{
+    void *strings_tree;
+    struct vlc_cache_buf plugins;
+    struct vlc_cache_buf modules;
+    struct vlc_cache_buf configs;
+    struct vlc_cache_buf refs;
+    struct vlc_cache_buf ints;
+    struct vlc_cache_buf caps;
+    struct vlc_cache_buf capmods;
+    struct vlc_cache_buf strings;
+    struct vlc_cache_buf modcaps; /**< Unsorted module references */
+};
+
+/**
+ * Interns a string into the string table.
+ */
+static int CacheSaveString(struct vlc_cache_writer *w, const char *str,
+                           uint32_t *restrict offset)
+{
+    if (str == NULL)
+    {
+        *offset = 0;
         return 0;
+    }
+
+    struct vlc_cache_string key = { .str = str }, **pp;
 
-    assert(((ftell(file) + skip) % align) == 0);
-    return fseek(file, skip, SEEK_CUR);
+    pp = tfind(&key, &w->strings_tree, vlc_cache_string_cmp);
+    if (pp != NULL)
+    {
+        *offset = (*pp)->offset;
+        return 0;
+    }
+
+    size_t len = strlen(str) + 1;
+    if (w->strings.count + len > UINT32_MAX)
+        return -1;
+
+    struct vlc_cache_string *s = malloc(sizeof (*s));
+    if (unlikely(s == NULL))
+        return -1;
+
+    s->str = str;
+    s->offset = w->strings.count;
+
+    char *p = CacheAppend(&w->strings, 1, len);
+    if (unlikely(p == NULL))
+    {
+        free(s);
+        return -1;
+    }
+
+    if (unlikely(tsearch(s, &w->strings_tree, vlc_cache_string_cmp) == NULL))
+    {
+        w->strings.count -= len;
+        free(s);
+        return -1;
+    }
+
+    memcpy(p, str, len);
+    *offset = s->offset;
+    return 0;
 }
 
-#define SAVE_ALIGNOF(t) \
-    if (CacheSaveAlign(file, alignof (t))) \
+#define SAVE_STRING(a, str) \
+    if (CacheSaveString(w, (str), &(a))) \
         goto error
 
-static int CacheSaveConfig (FILE *file, const module_config_t *cfg)
+static int CacheSaveConfig(struct vlc_cache_writer *w,
+                           const module_config_t *cfg)
 {
-    SAVE_IMMEDIATE (cfg->i_type);
-    SAVE_IMMEDIATE (cfg->i_short);
-    SAVE_FLAG (cfg->b_internal);
-    SAVE_FLAG (cfg->b_unsaveable);
-    SAVE_FLAG (cfg->b_safe);
-    SAVE_FLAG (cfg->b_removed);
-    SAVE_STRING (cfg->psz_type);
-    SAVE_STRING (cfg->psz_name);
-    SAVE_STRING (cfg->psz_text);
-    SAVE_STRING (cfg->psz_longtext);
-    SAVE_IMMEDIATE (cfg->list_count);
+    struct vlc_cache_config *rec = CacheAppend(&w->configs, sizeof (*rec), 1);
+    if (unlikely(rec == NULL))
+        goto error;
 
-    if (IsConfigStringType (cfg->i_type))
+    rec->i_type = cfg->i_type;
+    rec->i_short = cfg->i_short;
+    rec->flags = (cfg->b_internal ? CACHE_CONFIG_INTERNAL : 0)
+               | (cfg->b_unsaveable ? CACHE_CONFIG_UNSAVEABLE : 0)
+               | (cfg->b_safe ? CACHE_CONFIG_SAFE : 0)
+               | (cfg->b_removed ? CACHE_CONFIG_REMOVED : 0);
+    SAVE_STRING(rec->type, cfg->psz_type);
+    SAVE_STRING(rec->name, cfg->psz_name);
+    SAVE_STRING(rec->text, cfg->psz_text);
+    SAVE_STRING(rec->longtext, cfg->psz_longtext);
+    rec->list_count = cfg->list_count;
+
+    if (cfg->list_count == 0)
+        SAVE_STRING(rec->list_cb_name, cfg->list_cb_name);
+
+    if (IsConfigStringType(cfg->i_type))
     {
-        SAVE_STRING (cfg->orig.psz);
-        if (cfg->list_count == 0)
-            SAVE_STRING(cfg->list_cb_name);
+        SAVE_STRING(rec->orig.psz, cfg->orig.psz);
+
+        rec->list = w->refs.count;
+
+        uint32_t *refs = CacheAppend(&w->refs, sizeof (*refs),
+                                     cfg->list_count);
+        if (unlikely(refs == NULL))
+            goto error;
 
         for (unsigned i = 0; i < cfg->list_count; i++)
-            SAVE_STRING (cfg->list.psz[i]);
+            SAVE_STRING(refs[i], cfg->list.psz[i]);
     }
     else
     {
-        SAVE_IMMEDIATE (cfg->orig);
-        SAVE_IMMEDIATE (cfg->min);
-        SAVE_IMMEDIATE (cfg->max);
-
-        if (cfg->list_count > 0)
+        if (IsConfigFloatType(cfg->i_type))
         {
-            SAVE_ALIGNOF(*cfg->list.i);
+            rec->orig.f = cfg->orig.f;
+            rec->min.f = cfg->min.f;
+            rec->max.f = cfg->max.f;
         }
         else
-            SAVE_STRING(cfg->list_cb_name);
+        {
+            rec->orig.i = cfg->orig.i;
+            rec->min.i = cfg->min.i;
+            rec->max.i = cfg->max.i;
+        }
 
-        for (unsigned i = 0; i < cfg->list_count; i++)
-             SAVE_IMMEDIATE (cfg->list.i[i]);
+        rec->list = w->ints.count;
+
+        int *ints = CacheAppend(&w->ints, sizeof (*ints), cfg->list_count);
+        if (unlikely(ints == NULL))
+            goto error;
+        if (cfg->list_count > 0)
+            memcpy(ints, cfg->list.i, sizeof (*ints) * cfg->list_count);
     }
+
+    rec->list_text = w->refs.count;
+
+    uint32_t *refs = CacheAppend(&w->refs, sizeof (*refs), cfg->list_count);
+    if (unlikely(refs == NULL))
+        goto error;
+
     for (unsigned i = 0; i < cfg->list_count; i++)
-        SAVE_STRING (cfg->list_text[i]);
+        SAVE_STRING(refs[i], cfg->list_text[i]);
 
     return 0;
 error:
     return -1;
 }
 
-static int CacheSaveModuleConfig(FILE *file, const vlc_plugin_t *plugin)
+static int CacheSaveModule(struct vlc_cache_writer *w, const module_t *module)
 {
-    uint16_t lines = plugin->conf.size;
+    uint32_t index = w->modules.count;
+    struct vlc_cache_module *rec = CacheAppend(&w->modules, sizeof (*rec), 1);
+    if (unlikely(rec == NULL))
+        goto error;
+
+    SAVE_STRING(rec->shortname, module->psz_shortname);
+    SAVE_STRING(rec->longname, module->psz_longname);
+    SAVE_STRING(rec->help, module->psz_help);
+
+    rec->shortcuts = w->refs.count;
+    rec->shortcuts_count = module->i_shortcuts;
 
-    SAVE_IMMEDIATE (lines);
+    uint32_t *refs = CacheAppend(&w->refs, sizeof (*refs),
+                                 module->i_shortcuts);
+    if (unlikely(refs == NULL))
+        goto error;
+
+    for (size_t j = 0; j < module->i_shortcuts; j++)
+        SAVE_STRING(refs[j], module->pp_shortcuts[j]);
 
-    for (size_t i = 0; i < lines; i++)
-        if (CacheSaveConfig(file, plugin->conf.items + i))
-           goto error;
+    SAVE_STRING(rec->activate, module->activate_name);
+    SAVE_STRING(rec->deactivate, module->deactivate_name);
+    SAVE_STRING(rec->capability, module->psz_capability);
+    rec->score = module->i_score;
 
+    /* Capabilities index, keyed as in the module bank */
+    struct vlc_cache_capmod *cm = CacheAppend(&w->modcaps, sizeof (*cm), 1);
+    if (unlikely(cm == NULL))
+        goto error;
+
+    SAVE_STRING(cm->name, module_get_capability(module));
+    cm->score = module->i_score;
+    cm->module = index;
     return 0;
 error:
     return -1;
 }
 
-static int CacheSaveModule(FILE *file, const module_t *module)
+static int CacheSavePlugin(struct vlc_cache_writer *w,
+                           const vlc_plugin_t *plugin)
 {
-    SAVE_STRING(module->psz_shortname);
-    SAVE_STRING(module->psz_longname);
-    SAVE_STRING(module->psz_help);
-    SAVE_IMMEDIATE(module->i_shortcuts);
+    struct vlc_cache_plugin *rec = CacheAppend(&w->plugins, sizeof (*rec), 1);
+    if (unlikely(rec == NULL))
+        goto error;
 
-    for (size_t j = 0; j < module->i_shortcuts; j++)
-         SAVE_STRING(module->pp_shortcuts[j]);
+    rec->modules = w->modules.count;
+    for (module_t *module = plugin->module;
+         module != NULL;
+         module = module->next)
+        if (CacheSaveModule(w, module))
+            goto error;
+    rec->modules_count = w->modules.count - rec->modules;
+
+    rec->configs = w->configs.count;
+    for (size_t i = 0; i < plugin->conf.size; i++)
+        if (CacheSaveConfig(w, plugin->conf.items + i))
+            goto error;
+    rec->configs_count = w->configs.count - rec->configs;
 
-    SAVE_STRING(module->activate_name);
-    SAVE_STRING(module->deactivate_name);
-    SAVE_STRING(module->psz_capability);
-    SAVE_IMMEDIATE(module->i_score);
+    SAVE_STRING(rec->textdomain, plugin->textdomain);
+    SAVE_STRING(rec->path, plugin->path);
+    rec->unloadable = plugin->unloadable;
+    rec->mtime = plugin->mtime;
+    rec->size = plugin->size;
     return 0;
 error:
     return -1;
 }
 
+/**
+ * Builds the capabilities table, with modules by decreasing score.
+ */
+static int CacheSaveCaps(struct vlc_cache_writer *w)
+{
+    struct vlc_cache_capmod *cms = w->modcaps.data;
+    struct vlc_cache_cap *cap = NULL;
+
+    if (w->modcaps.count > 0)
+        qsort(cms, w->modcaps.count, sizeof (*cms), vlc_cache_capmod_cmp);
+
+    for (size_t i = 0; i < w->modcaps.count; i++)
+    {
+        if (cap == NULL || cap->name != cms[i].name)
+        {
+            cap = CacheAppend(&w->caps, sizeof (*cap), 1);
+            if (unlikely(cap == NULL))
+                return -1;
+
+            cap->name = cms[i].name;
+            cap->modules = w->capmods.count;
+        }
+
+        uint32_t *ref = CacheAppend(&w->capmods, sizeof (*ref), 1);
+        if (unlikely(ref == NULL))
+            return -1;
+
+        *ref = cms[i].module;
+        cap->modules_count++;
+    }
+    return 0;
+}
+
+static int CacheSaveAlign(FILE *file, size_t align)
+{
+    assert(align > 0);
+
+    for (size_t skip = (-ftell(file)) % align; skip > 0; skip--)
+        if (putc(0, file) == EOF)
+            return -1;
+
+    assert((ftell(file) % align) == 0);
+    return 0;
+}
+
 static int CacheSaveBank(FILE *file, vlc_plugin_t *const *cache, size_t n)
 {
+    struct vlc_cache_writer writer = { .strings_tree = NULL }, *w = &writer;
+    struct vlc_cache_header hdr;
     uint32_t i_file_size = 0;
+    int ret = -1;
+
+    /* Offset zero denotes the NULL string */
+    if (CacheAppend(&w->strings, 1, 1) == NULL)
+        goto error;
+
+    for (size_t i = 0; i < n; i++)
+        if (CacheSavePlugin(w, cache[i]))
+            goto error;
+
+    if (CacheSaveCaps(w))
+        goto error;
 
     /* Contains version number */
     if (fputs (CACHE_STRING, file) == EOF)
@@ -614,37 +1297,81 @@ static int CacheSaveBank(FILE *file, vlc_plugin_t *const *cache, size_t n)
     if (fwrite (&i_file_size, sizeof (i_file_size), 1, file) != 1)
         goto error;
 
-    for (size_t i = 0; i < n; i++)
+    const struct
+    {
+        struct vlc_cache_table *table;
+        const struct vlc_cache_buf *buf;
+        size_t size;
+        size_t align;
+    } tables[] = {
+#define TABLE(name, type) \
+        { &hdr.name, &w->name, sizeof (type), alignof (type) }
+        TABLE(plugins, struct vlc_cache_plugin),
+        TABLE(modules, struct vlc_cache_module),
+        TABLE(configs, struct vlc_cache_config),
+        TABLE(refs, uint32_t),
+        TABLE(ints, int),
+        TABLE(caps, struct vlc_cache_cap),
+        TABLE(capmods, uint32_t),
+        TABLE(strings, char),
+#undef TABLE
+    };
+
+    /* Lay the tables out after the header */
+    size_t offset = ftell(file);
+
+    offset += (-offset) % alignof (struct vlc_cache_header);
+    offset += sizeof (hdr);
+
+    for (size_t i = 0; i < ARRAY_SIZE(tables); i++)
     {
-        const vlc_plugin_t *plugin = cache[i];
-        uint32_t count = plugin->modules_count;
+        size_t count = tables[i].buf->count;
 
-        SAVE_IMMEDIATE(count);
+        offset += (-offset) % tables[i].align;
+        if (offset > UINT32_MAX || count > UINT32_MAX)
+            goto error;
 
-        for (module_t *module = plugin->module;
-             module != NULL;
-             module = module->next)
-            if (CacheSaveModule(file, module))
-                goto error;
+        tables[i].table->offset = offset;
+        tables[i].table->count = count;
+        offset += count * tables[i].size;
+    }
+
+    if (offset > UINT32_MAX)
+        goto error;
 
-        /* Config stuff */
-        if (CacheSaveModuleConfig(file, plugin))
+    if (CacheSaveAlign(file, alignof (struct vlc_cache_header))
+     || fwrite(&hdr, sizeof (hdr), 1, file) != 1)
+        goto error;
+
+    for (size_t i = 0; i < ARRAY_SIZE(tables); i++)
+    {
+        size_t count = tables[i].buf->count;
+
+        if (CacheSaveAlign(file, tables[i].align))
             goto error;
+        assert((size_t)ftell(file) == tables[i].table->offset);
 
-        /* Save common info */
-        SAVE_STRING(plugin->textdomain);
-        SAVE_STRING(plugin->path);
-        SAVE_FLAG(plugin->unloadable);
-        SAVE_IMMEDIATE(plugin->mtime);
-        SAVE_IMMEDIATE(plugin->size);
+        if (count > 0
+         && fwrite(tables[i].buf->data, tables[i].size, count, file) != count)
+            goto error;
     }
 
     if (fflush (file)) /* flush libc buffers */
         goto error;
-    return 0; /* success! */
+    ret = 0; /* success! */
 
 error:
-    return -1;
+    tdestroy(w->strings_tree, free);
+    free(w->plugins.data);
+    free(w->modules.data);
+    free(w->configs.data);
+    free(w->refs.data);
+    free(w->ints.data);
+    free(w->caps.data);
+    free(w->capmods.data);
+    free(w->strings.data);
+    free(w->modcaps.data);
+    return ret;
 }
 
 /**
@@ -113,6 +113,8 @@ void module_EndBank (bool);
 int module_Map(vlc_object_t *, vlc_plugin_t *);
 
 ssize_t module_list_cap (module_t ***, const char *);
+void module_LoadLazyPlugins(void);
+module_t *module_lookup(const char *);
 
 int vlc_bindtextdomain (const char *);
 
@@ -160,8 +162,38 @@ void *vlc_dlsym(void *handle, const char *) VLC_USED;
  */
 char *vlc_dlerror(void) VLC_USED;
 
+/** Modules of a capability, sorted by decreasing score */
+typedef struct vlc_modcap
+{
+    const char *name;
+    module_t **modv;
+    size_t modc;
+    bool complete; /**< Whether lazily loaded plugins were added */
+} vlc_modcap_t;
+
+/** Capabilities index of a plugins cache */
+typedef struct vlc_cache_index
+{
+    vlc_modcap_t *caps;
+    size_t count; /**< Number of capabilities */
+    size_t plugins; /**< Number of plugins covered by the index */
+    module_t **modv; /**< Storage for the modules of all capabilities */
+} vlc_cache_index_t;
+
 /* Plugins cache */
-vlc_plugin_t *vlc_cache_load(vlc_object_t *, const char *, block_t **);
+vlc_plugin_t *vlc_cache_load(vlc_object_t *, const char *, block_t **,
+                             vlc_cache_index_t *);
+void vlc_cache_index_clean(vlc_cache_index_t *);
+
+typedef struct vlc_cache vlc_cache_t;
+
+vlc_cache_t *vlc_cache_open(vlc_object_t *, const char *, block_t **);
+int vlc_cache_register(vlc_cache_t *, vlc_plugin_t **);
+int vlc_cache_load_cap(vlc_cache_t *, const char *cap,
+                       void (*)(vlc_plugin_t *));
+int vlc_cache_load_name(vlc_cache_t *, const char *module,
+                        void (*)(vlc_plugin_t *));
+void vlc_cache_close(vlc_cache_t *);
 vlc_plugin_t *vlc_cache_lookup(vlc_plugin_t **, const char *relpath);
 
 void CacheSave(vlc_object_t *, const char *, vlc_plugin_t *const *, size_t);
@@ -42,11 +42,14 @@
 #include <vlc_url.h>
 #include <vlc_mime.h>
 #include <vlc_block.h>
+#include <vlc_atomic.h>
+#include <vlc_fs.h>
 #include "../libvlc.h"
 
 #include <string.h>
 #include <errno.h>
 #include <unistd.h>
+#include <fcntl.h>
 #ifdef HAVE_SYS_UIO_H
 # include <sys/uio.h>
 #endif
@@ -54,6 +57,9 @@
 #ifdef HAVE_POLL
 # include <poll.h>
 #endif
+#ifdef HAVE_SYS_EPOLL_H
+# include <sys/epoll.h>
+#endif
 
 #if defined(_WIN32)
 #   include <winsock2.h>
@@ -68,10 +74,31 @@
 #define HTTPD_CL_BUFSIZE 10000
 #endif
 
+/* maximum number of shared stream blocks sent at once to a client */
+#define HTTPD_CL_IOV_MAX 64
+
+typedef struct httpd_stream_data_t httpd_stream_data_t;
+
 static void httpd_ClientDestroy(httpd_client_t *cl);
-static void httpd_AppendData(httpd_stream_t *stream, uint8_t *p_data, int i_data);
+static void httpd_StreamDataRelease(httpd_stream_data_t *data);
+
+/* each worker thread serves its own share of the host clients */
+typedef struct httpd_worker_t
+{
+    httpd_host_t *host;
+    vlc_thread_t thread;
+    vlc_mutex_t  lock;
+
+    size_t client_count;
+    struct vlc_list clients;
+
+    int wakeup[2];  /* pipe to interrupt the worker wait, or -1 */
+#ifdef HAVE_SYS_EPOLL_H
+    int epfd;       /* persistent event set, or -1 to use poll() */
+#endif
+} httpd_worker_t;
 
-/* each host run in his own thread */
+/* each host run in his own threads, the first one accepts connections */
 struct httpd_host_t
 {
     struct vlc_common_members obj;
@@ -85,7 +112,6 @@ struct httpd_host_t
     unsigned     nfd;
     unsigned     port;
 
-    vlc_thread_t thread;
     vlc_mutex_t lock;
     vlc_cond_t  wait;
 
@@ -95,8 +121,8 @@ struct httpd_host_t
      * */
     struct vlc_list urls;
 
-    size_t client_count;
-    struct vlc_list clients;
+    httpd_worker_t *workers;
+    unsigned        nworkers;
 
     /* TLS data */
     vlc_tls_server_t *p_tls;
@@ -147,6 +173,9 @@ struct httpd_client_t
     bool    b_stream_mode;
     uint8_t i_state;
 
+    /* events registered in the worker event set, -1 if not registered */
+    int     i_poll_events;
+
     vlc_tick_t i_activity_date;
     vlc_tick_t i_activity_timeout;
 
@@ -162,6 +191,12 @@ struct httpd_client_t
      */
     int64_t i_keyframe_wait_to_pass;
 
+    /* stream data shared with other clients, sent without copy */
+    httpd_stream_data_t *shared[HTTPD_CL_IOV_MAX];
+    unsigned i_shared;
+    size_t   i_shared_offset; /* bytes of shared[0] already sent */
+    size_t   i_shared_size;   /* bytes left to send from i_shared_offset */
+
     /* */
     httpd_message_t query;  /* client -> httpd */
     httpd_message_t answer; /* httpd -> client */
@@ -588,6 +623,29 @@ void httpd_RedirectDelete(httpd_redirect_t *rdir)
 /*****************************************************************************
  * High Level Funtions: httpd_stream_t
  *****************************************************************************/
+
+/* A muxed block, shared by the stream and all the clients sending it */
+struct httpd_stream_data_t
+{
+    vlc_atomic_rc_t rc;
+    block_t *block;
+    int64_t  i_pos; /* absolute position of the first byte */
+};
+
+static httpd_stream_data_t *httpd_StreamDataHold(httpd_stream_data_t *data)
+{
+    vlc_atomic_rc_inc(&data->rc);
+    return data;
+}
+
+static void httpd_StreamDataRelease(httpd_stream_data_t *data)
+{
+    if (vlc_atomic_rc_dec(&data->rc)) {
+        block_Release(data->block);
+        free(data);
+    }
+}
+
 struct httpd_stream_t
 {
     vlc_mutex_t lock;
@@ -607,9 +665,12 @@ struct httpd_stream_t
     bool        b_has_keyframes;
     int64_t     i_last_keyframe_seen_pos;
 
-    /* circular buffer */
-    int         i_buffer_size;      /* buffer size, can't be reallocated smaller */
-    uint8_t     *p_buffer;          /* buffer */
+    /* ring of shared blocks, ordered by position */
+    httpd_stream_data_t **pp_ring;
+    size_t      i_ring_alloc;       /* ring capacity, in blocks */
+    size_t      i_ring_first;       /* index of the oldest block */
+    size_t      i_ring_count;       /* number of blocks */
+    int64_t     i_buffer_size;      /* maximum bytes kept in the ring */
     int64_t     i_buffer_pos;       /* absolute position from beginning */
     int64_t     i_buffer_last_pos;  /* a new connection will start with that */
 
@@ -618,6 +679,76 @@ struct httpd_stream_t
     httpd_header * p_http_headers;
 };
 
+static httpd_stream_data_t *httpd_StreamRingAt(const httpd_stream_t *stream,
+                                                size_t i)
+{
+    return stream->pp_ring[(stream->i_ring_first + i) % stream->i_ring_alloc];
+}
+
+/* Returns the index of the ring block containing the given position,
+ * or i_ring_count if the position is not (or no longer) buffered */
+static size_t httpd_StreamRingFind(const httpd_stream_t *stream, int64_t i_pos)
+{
+    size_t lo = 0, hi = stream->i_ring_count;
+
+    if (hi == 0 || i_pos < httpd_StreamRingAt(stream, 0)->i_pos
+     || i_pos >= stream->i_buffer_pos)
+        return stream->i_ring_count;
+
+    while (hi - lo > 1) {
+        size_t mid = lo + (hi - lo) / 2;
+
+        if (httpd_StreamRingAt(stream, mid)->i_pos <= i_pos)
+            lo = mid;
+        else
+            hi = mid;
+    }
+    return lo;
+}
+
+/* Attaches buffered blocks to the client, starting from the body offset.
+ * Must be called with the stream lock held. */
+static int httpd_StreamAttach(httpd_stream_t *stream, httpd_client_t *cl,
+                              httpd_message_t *answer)
+{
+    int64_t i_oldest = stream->i_ring_count > 0
+                     ? httpd_StreamRingAt(stream, 0)->i_pos
+                     : stream->i_buffer_pos;
+
+    if (answer->i_body_offset < i_oldest) {
+        /* This client isn't fast enough: skip to the last keyframe if still
+         * buffered, otherwise to the last block */
+        int64_t i_resume = stream->i_buffer_last_pos;
+
+        if (stream->b_has_keyframes
+         && stream->i_last_keyframe_seen_pos >= i_oldest)
+            i_resume = stream->i_last_keyframe_seen_pos;
+
+        msg_Warn(stream->url->host, "client too slow, dropping %"PRId64
+                 " bytes", i_resume - answer->i_body_offset);
+        answer->i_body_offset = i_resume;
+    }
+
+    size_t i = httpd_StreamRingFind(stream, answer->i_body_offset);
+    if (i >= stream->i_ring_count)
+        return VLC_EGENERIC;    /* wait, no data available */
+
+    cl->i_shared_offset = answer->i_body_offset
+                        - httpd_StreamRingAt(stream, i)->i_pos;
+
+    assert(cl->i_shared == 0);
+    cl->i_shared_size = 0;
+    while (i < stream->i_ring_count && cl->i_shared < HTTPD_CL_IOV_MAX) {
+        httpd_stream_data_t *data = httpd_StreamRingAt(stream, i++);
+
+        cl->shared[cl->i_shared++] = httpd_StreamDataHold(data);
+        cl->i_shared_size += data->block->i_buffer;
+        answer->i_body_offset = data->i_pos + data->block->i_buffer;
+    }
+    cl->i_shared_size -= cl->i_shared_offset;
+    return VLC_SUCCESS;
+}
+
 static int httpd_StreamCallBack(httpd_callback_sys_t *p_sys,
                                  httpd_client_t *cl, httpd_message_t *answer,
                                  const httpd_message_t *query)
@@ -628,47 +759,37 @@ static int httpd_StreamCallBack(httpd_callback_sys_t *p_sys,
         return VLC_SUCCESS;
 
     if (answer->i_body_offset > 0) {
-        int     i_pos;
+        int ret = VLC_EGENERIC;
 
+        vlc_mutex_lock(&stream->lock);
         if (answer->i_body_offset >= stream->i_buffer_pos)
-            return VLC_EGENERIC;    /* wait, no data available */
+            goto out;   /* wait, no data available */
 
         if (cl->i_keyframe_wait_to_pass >= 0) {
             if (stream->i_last_keyframe_seen_pos <= cl->i_keyframe_wait_to_pass)
                 /* still waiting for the next keyframe */
-                return VLC_EGENERIC;
+                goto out;
 
             /* seek to the new keyframe */
             answer->i_body_offset = stream->i_last_keyframe_seen_pos;
             cl->i_keyframe_wait_to_pass = -1;
         }
 
-        if (answer->i_body_offset + stream->i_buffer_size < stream->i_buffer_pos)
-            answer->i_body_offset = stream->i_buffer_last_pos; /* this client isn't fast enough */
-
-        i_pos   = answer->i_body_offset % stream->i_buffer_size;
-        int64_t i_write = stream->i_buffer_pos - answer->i_body_offset;
-
-        if (i_write > HTTPD_CL_BUFSIZE)
-            i_write = HTTPD_CL_BUFSIZE;
-        else if (i_write <= 0)
-            return VLC_EGENERIC;    /* wait, no data available */
-
-        /* Don't go past the end of the circular buffer */
-        i_write = __MIN(i_write, stream->i_buffer_size - i_pos);
+        ret = httpd_StreamAttach(stream, cl, answer);
+        if (ret != VLC_SUCCESS)
+            goto out;
 
         /* using HTTPD_MSG_ANSWER -> data available */
         answer->i_proto  = HTTPD_PROTO_HTTP;
         answer->i_version= 0;
         answer->i_type   = HTTPD_MSG_ANSWER;
 
-        answer->i_body = i_write;
-        answer->p_body = xmalloc(i_write);
-        memcpy(answer->p_body, &stream->p_buffer[i_pos], i_write);
-
-        answer->i_body_offset += i_write;
-
-        return VLC_SUCCESS;
+        /* the body is sent from the shared blocks */
+        answer->i_body = 0;
+        answer->p_body = NULL;
+out:
+        vlc_mutex_unlock(&stream->lock);
+        return ret;
     } else {
         answer->i_proto  = HTTPD_PROTO_HTTP;
         answer->i_version= 0;
@@ -764,8 +885,11 @@ httpd_stream_t *httpd_StreamNew(httpd_host_t *host,
 
     stream->i_header = 0;
     stream->p_header = NULL;
+    stream->pp_ring = NULL;
+    stream->i_ring_alloc = 0;
+    stream->i_ring_first = 0;
+    stream->i_ring_count = 0;
     stream->i_buffer_size = 5000000;    /* 5 Mo per stream */
-    stream->p_buffer = xmalloc(stream->i_buffer_size);
     /* We set to 1 to make life simpler
      * (this way i_body_offset can never be 0) */
     stream->i_buffer_pos = 1;
@@ -801,31 +925,59 @@ int httpd_StreamHeader(httpd_stream_t *stream, uint8_t *p_data, int i_data)
     return VLC_SUCCESS;
 }
 
-static void httpd_AppendData(httpd_stream_t *stream, uint8_t *p_data, int i_data)
+static int httpd_AppendData(httpd_stream_t *stream, httpd_stream_data_t *data)
 {
-    int i_pos = stream->i_buffer_pos % stream->i_buffer_size;
-    int i_count = i_data;
-    while (i_count > 0) {
-        int i_copy = __MIN(i_count, stream->i_buffer_size - i_pos);
-
-        /* Ok, we can't go past the end of our buffer */
-        memcpy(&stream->p_buffer[i_pos], p_data, i_copy);
-
-        i_pos = (i_pos + i_copy) % stream->i_buffer_size;
-        i_count -= i_copy;
-        p_data  += i_copy;
+    if (stream->i_ring_count == stream->i_ring_alloc) {
+        size_t alloc = stream->i_ring_alloc ? 2 * stream->i_ring_alloc : 256;
+        httpd_stream_data_t **ring = vlc_alloc(alloc, sizeof (*ring));
+        if (unlikely(ring == NULL))
+            return VLC_ENOMEM;
+
+        /* unwrap the ring */
+        for (size_t i = 0; i < stream->i_ring_count; i++)
+            ring[i] = httpd_StreamRingAt(stream, i);
+        free(stream->pp_ring);
+        stream->pp_ring = ring;
+        stream->i_ring_alloc = alloc;
+        stream->i_ring_first = 0;
     }
 
-    stream->i_buffer_pos += i_data;
+    size_t i = (stream->i_ring_first + stream->i_ring_count++)
+             % stream->i_ring_alloc;
+    stream->pp_ring[i] = data;
+    stream->i_buffer_pos += data->block->i_buffer;
+
+    /* Drop the oldest blocks. Clients still sending them hold a reference. */
+    while (stream->i_ring_count > 1
+        && stream->i_buffer_pos - httpd_StreamRingAt(stream, 1)->i_pos
+                                                    >= stream->i_buffer_size) {
+        httpd_StreamDataRelease(httpd_StreamRingAt(stream, 0));
+        stream->i_ring_first = (stream->i_ring_first + 1) % stream->i_ring_alloc;
+        stream->i_ring_count--;
+    }
+    return VLC_SUCCESS;
 }
 
-int httpd_StreamSend(httpd_stream_t *stream, const block_t *p_block)
+int httpd_StreamSendBlock(httpd_stream_t *stream, block_t *p_block)
 {
-    if (!p_block || !p_block->p_buffer)
+    if (!p_block)
+        return VLC_SUCCESS;
+    if (p_block->i_buffer == 0) {
+        block_Release(p_block);
         return VLC_SUCCESS;
+    }
+
+    httpd_stream_data_t *data = malloc(sizeof (*data));
+    if (unlikely(data == NULL)) {
+        block_Release(p_block);
+        return VLC_ENOMEM;
+    }
+    vlc_atomic_rc_init(&data->rc);
+    data->block = p_block;
 
     vlc_mutex_lock(&stream->lock);
 
+    data->i_pos = stream->i_buffer_pos;
     /* save this pointer (to be used by new connection) */
     stream->i_buffer_last_pos = stream->i_buffer_pos;
 
@@ -834,10 +986,27 @@ int httpd_StreamSend(httpd_stream_t *stream, const block_t *p_block)
         stream->i_last_keyframe_seen_pos = stream->i_buffer_pos;
     }
 
-    httpd_AppendData(stream, p_block->p_buffer, p_block->i_buffer);
+    int ret = httpd_AppendData(stream, data);
 
     vlc_mutex_unlock(&stream->lock);
-    return VLC_SUCCESS;
+
+    if (ret != VLC_SUCCESS)
+        httpd_StreamDataRelease(data);
+    return ret;
+}
+
+int httpd_StreamSend(httpd_stream_t *stream, const block_t *p_block)
+{
+    if (!p_block || !p_block->p_buffer)
+        return VLC_SUCCESS;
+
+    block_t *p_dup = block_Alloc(p_block->i_buffer);
+    if (unlikely(p_dup == NULL))
+        return VLC_ENOMEM;
+
+    memcpy(p_dup->p_buffer, p_block->p_buffer, p_block->i_buffer);
+    p_dup->i_flags = p_block->i_flags;
+    return httpd_StreamSendBlock(stream, p_dup);
 }
 
 void httpd_StreamDelete(httpd_stream_t *stream)
@@ -851,7 +1020,9 @@ void httpd_StreamDelete(httpd_stream_t *stream)
     vlc_mutex_destroy(&stream->lock);
     free(stream->psz_mime);
     free(stream->p_header);
-    free(stream->p_buffer);
+    for (size_t i = 0; i < stream->i_ring_count; i++)
+        httpd_StreamDataRelease(httpd_StreamRingAt(stream, i));
+    free(stream->pp_ring);
     free(stream);
 }
 
@@ -862,6 +1033,82 @@ static void* httpd_HostThread(void *);
 static httpd_host_t *httpd_HostCreate(vlc_object_t *, const char *,
                                        const char *, vlc_tls_server_t *);
 
+static int httpd_WorkerInit(httpd_host_t *host, httpd_worker_t *worker)
+{
+    worker->host = host;
+    vlc_mutex_init(&worker->lock);
+    worker->client_count = 0;
+    vlc_list_init(&worker->clients);
+    worker->wakeup[0] = worker->wakeup[1] = -1;
+#ifdef HAVE_SYS_EPOLL_H
+    worker->epfd = -1;
+#endif
+
+#ifndef _WIN32
+    /* always needed, if only to reap the clients of a deleted url */
+    if (vlc_pipe(worker->wakeup)) {
+        vlc_mutex_destroy(&worker->lock);
+        return VLC_EGENERIC;
+    }
+    fcntl(worker->wakeup[1], F_SETFL, O_NONBLOCK);
+#endif
+
+#ifdef HAVE_SYS_EPOLL_H
+    worker->epfd = epoll_create1(EPOLL_CLOEXEC);
+    if (worker->epfd == -1)
+        return VLC_SUCCESS; /* fallback to poll() */
+
+    struct epoll_event ev = { .events = EPOLLIN, .data.ptr = worker };
+
+    if (worker->wakeup[0] != -1)
+        epoll_ctl(worker->epfd, EPOLL_CTL_ADD, worker->wakeup[0], &ev);
+
+    if (worker == &host->workers[0])
+        for (unsigned i = 0; i < host->nfd; i++) {
+            ev.data.ptr = &host->fds[i];
+            epoll_ctl(worker->epfd, EPOLL_CTL_ADD, host->fds[i], &ev);
+        }
+#endif
+    return VLC_SUCCESS;
+}
+
+static void httpd_WorkerClean(httpd_worker_t *worker)
+{
+    httpd_client_t *client;
+
+    vlc_list_foreach(client, &worker->clients, node) {
+        msg_Warn(worker->host, "client still connected");
+        httpd_ClientDestroy(client);
+    }
+
+#ifdef HAVE_SYS_EPOLL_H
+    if (worker->epfd != -1)
+        vlc_close(worker->epfd);
+#endif
+    if (worker->wakeup[0] != -1) {
+        vlc_close(worker->wakeup[1]);
+        vlc_close(worker->wakeup[0]);
+    }
+    vlc_mutex_destroy(&worker->lock);
+}
+
+/* stops and cleans the first count workers */
+static void httpd_HostStop(httpd_host_t *host, unsigned count)
+{
+    for (unsigned i = 0; i < count; i++)
+        vlc_cancel(host->workers[i].thread);
+    for (unsigned i = 0; i < count; i++) {
+        vlc_join(host->workers[i].thread, NULL);
+        httpd_WorkerClean(&host->workers[i]);
+    }
+}
+
+static void httpd_WorkerWake(httpd_worker_t *worker)
+{
+    if (worker->wakeup[1] != -1)
+        vlc_write(worker->wakeup[1], &(char){ 0 }, 1);
+}
+
 /* create a new host */
 httpd_host_t *vlc_http_HostNew(vlc_object_t *p_this)
 {
@@ -934,6 +1181,7 @@ static httpd_host_t *httpd_HostCreate(vlc_object_t *p_this,
                                               "http host");
     if (!host)
         goto error;
+    host->workers = NULL;
 
     vlc_mutex_init(&host->lock);
     vlc_cond_init(&host->wait);
@@ -952,16 +1200,34 @@ static httpd_host_t *httpd_HostCreate(vlc_object_t *p_this,
 
     host->port     = port;
     vlc_list_init(&host->urls);
-    host->client_count = 0;
-    vlc_list_init(&host->clients);
     host->p_tls    = p_tls;
 
-    /* create the thread */
-    if (vlc_clone(&host->thread, httpd_HostThread, host,
-                   VLC_THREAD_PRIORITY_LOW)) {
-        msg_Err(p_this, "cannot spawn http host thread");
+#ifndef _WIN32
+    host->nworkers = var_InheritInteger(p_this, "http-threads");
+#else
+    host->nworkers = 1; /* no wake up pipe to share the clients */
+#endif
+    host->workers = vlc_alloc(host->nworkers, sizeof (*host->workers));
+    if (unlikely(host->workers == NULL))
         goto error;
-    }
+
+    for (unsigned i = 0; i < host->nworkers; i++)
+        if (httpd_WorkerInit(host, &host->workers[i])) {
+            while (i > 0)
+                httpd_WorkerClean(&host->workers[--i]);
+            goto error;
+        }
+
+    /* create the threads */
+    for (unsigned i = 0; i < host->nworkers; i++)
+        if (vlc_clone(&host->workers[i].thread, httpd_HostThread,
+                      &host->workers[i], VLC_THREAD_PRIORITY_LOW)) {
+            msg_Err(p_this, "cannot spawn http host thread");
+            httpd_HostStop(host, i);
+            for (unsigned j = i; j < host->nworkers; j++)
+                httpd_WorkerClean(&host->workers[j]);
+            goto error;
+        }
 
     /* now add it to httpd */
     vlc_list_append(&host->node, &httpd.hosts);
@@ -973,6 +1239,7 @@ error:
     vlc_mutex_unlock(&httpd.mutex);
 
     if (host) {
+        free(host->workers);
         net_ListenClose(host->fds);
         vlc_cond_destroy(&host->wait);
         vlc_mutex_destroy(&host->lock);
@@ -986,8 +1253,6 @@ error:
 /* delete a host */
 void httpd_HostDelete(httpd_host_t *host)
 {
-    httpd_client_t *client;
-
     vlc_mutex_lock(&httpd.mutex);
 
     if (atomic_fetch_sub_explicit(&host->ref, 1, memory_order_relaxed) > 1) {
@@ -998,17 +1263,12 @@ void httpd_HostDelete(httpd_host_t *host)
     }
 
     vlc_list_remove(&host->node);
-    vlc_cancel(host->thread);
-    vlc_join(host->thread, NULL);
+    httpd_HostStop(host, host->nworkers);
 
     msg_Dbg(host, "HTTP host removed");
 
-    vlc_list_foreach(client, &host->clients, node) {
-        msg_Warn(host, "client still connected");
-        httpd_ClientDestroy(client);
-    }
-
     assert(vlc_list_is_empty(&host->urls));
+    free(host->workers);
     vlc_tls_ServerDelete(host->p_tls);
     net_ListenClose(host->fds);
     vlc_cond_destroy(&host->wait);
@@ -1077,23 +1337,32 @@ void httpd_UrlDelete(httpd_url_t *url)
 
     vlc_mutex_lock(&host->lock);
     vlc_list_remove(&url->node);
+    vlc_mutex_unlock(&host->lock);
+
+    /* Once the worker lock is held, no callback of this url is running, and
+     * the client is destroyed by its worker before any new event. */
+    for (unsigned i = 0; i < host->nworkers; i++) {
+        httpd_worker_t *worker = &host->workers[i];
+
+        vlc_mutex_lock(&worker->lock);
+        vlc_list_foreach(client, &worker->clients, node) {
+            if (client->url != url)
+                continue;
+
+            /* TODO complete it */
+            msg_Warn(host, "force closing connections");
+            client->url = NULL;
+            client->i_state = HTTPD_CLIENT_DEAD;
+        }
+        vlc_mutex_unlock(&worker->lock);
+        httpd_WorkerWake(worker);
+    }
 
     vlc_mutex_destroy(&url->lock);
     free(url->psz_url);
     free(url->psz_user);
     free(url->psz_password);
-
-    vlc_list_foreach(client, &host->clients, node) {
-        if (client->url != url)
-            continue;
-
-        /* TODO complete it */
-        msg_Warn(host, "force closing connections");
-        host->client_count--;
-        httpd_ClientDestroy(client);
-    }
     free(url);
-    vlc_mutex_unlock(&host->lock);
 }
 
 static void httpd_MsgInit(httpd_message_t *msg)
@@ -1175,6 +1444,9 @@ static void httpd_ClientInit(httpd_client_t *cl, vlc_tick_t now)
     cl->p_buffer = xmalloc(cl->i_buffer_size);
     cl->i_keyframe_wait_to_pass = -1;
     cl->b_stream_mode = false;
+    cl->i_shared = 0;
+    cl->i_shared_offset = 0;
+    cl->i_shared_size = 0;
 
     httpd_MsgInit(&cl->query);
     httpd_MsgInit(&cl->answer);
@@ -1197,6 +1469,8 @@ static void httpd_ClientDestroy(httpd_client_t *cl)
     httpd_MsgClean(&cl->answer);
     httpd_MsgClean(&cl->query);
 
+    for (unsigned i = 0; i < cl->i_shared; i++)
+        httpd_StreamDataRelease(cl->shared[i]);
     free(cl->p_buffer);
     free(cl);
 }
@@ -1209,6 +1483,7 @@ static httpd_client_t *httpd_ClientNew(vlc_tls_t *sock, vlc_tick_t now)
 
     cl->sock    = sock;
     cl->url     = NULL;
+    cl->i_poll_events = -1;
 
     httpd_ClientInit(cl, now);
     return cl;
@@ -1537,9 +1812,45 @@ static void httpd_ClientRecv(httpd_client_t *cl)
         cl->i_activity_timeout = 0;
 }
 
-static void httpd_ClientSend(httpd_client_t *cl)
+/* Sends the shared stream blocks with a single gathered write */
+static ssize_t httpd_ClientSendShared(httpd_client_t *cl)
 {
-    int i_len;
+    vlc_tls_t *sock = cl->sock;
+    struct iovec iov[HTTPD_CL_IOV_MAX];
+    size_t i_skip = cl->i_shared_offset;
+
+    for (unsigned i = 0; i < cl->i_shared; i++) {
+        const block_t *block = cl->shared[i]->block;
+
+        iov[i].iov_base = block->p_buffer + i_skip;
+        iov[i].iov_len = block->i_buffer - i_skip;
+        i_skip = 0;
+    }
+
+    ssize_t i_len = sock->ops->writev(sock, iov, cl->i_shared);
+    if (i_len <= 0)
+        return i_len;
+
+    /* Release what has been fully sent */
+    size_t i_sent = i_len;
+    unsigned i_done = 0;
+
+    while (i_done < cl->i_shared && i_sent >= iov[i_done].iov_len) {
+        i_sent -= iov[i_done].iov_len;
+        httpd_StreamDataRelease(cl->shared[i_done++]);
+    }
+    cl->i_shared -= i_done;
+    memmove(cl->shared, cl->shared + i_done,
+            cl->i_shared * sizeof (cl->shared[0]));
+    cl->i_shared_offset = (i_done > 0 ? 0 : cl->i_shared_offset) + i_sent;
+    cl->i_shared_size -= i_len;
+    assert((cl->i_shared_size == 0) == (cl->i_shared == 0));
+    return i_len;
+}
+
+static void httpd_ClientSend(httpd_host_t *host, httpd_client_t *cl)
+{
+    ssize_t i_len;
 
     if (cl->i_buffer < 0) {
         /* We need to create the header */
@@ -1572,12 +1883,22 @@ static void httpd_ClientSend(httpd_client_t *cl)
         cl->i_buffer_size = (uint8_t*)p - cl->p_buffer;
     }
 
-    i_len = httpd_NetSend(cl, &cl->p_buffer[cl->i_buffer],
-                           cl->i_buffer_size - cl->i_buffer);
-    if (i_len >= 0) {
-        cl->i_buffer += i_len;
+    /* The shared stream blocks are only attached once the buffer, holding
+     * the header, has been sent; they have their own cursor and end. */
+    bool b_done;
 
-        if (cl->i_buffer >= cl->i_buffer_size) {
+    if (cl->i_shared_size > 0) {
+        i_len = httpd_ClientSendShared(cl);
+        b_done = cl->i_shared_size == 0;
+    } else {
+        i_len = httpd_NetSend(cl, &cl->p_buffer[cl->i_buffer],
+                               cl->i_buffer_size - cl->i_buffer);
+        if (i_len > 0)
+            cl->i_buffer += i_len;
+        b_done = cl->i_buffer >= cl->i_buffer_size;
+    }
+    if (i_len >= 0) {
+        if (b_done) {
             if (cl->answer.i_body == 0  && cl->answer.i_body_offset > 0) {
                 /* catch more body data */
                 int     i_msg = cl->query.i_type;
@@ -1586,8 +1907,10 @@ static void httpd_ClientSend(httpd_client_t *cl)
                 httpd_MsgClean(&cl->answer);
                 cl->answer.i_body_offset = i_offset;
 
+                vlc_mutex_lock(&host->lock);
                 cl->url->catch[i_msg].cb(cl->url->catch[i_msg].p_sys, cl,
                                           &cl->answer, &cl->query);
+                vlc_mutex_unlock(&host->lock);
             }
 
             if (cl->answer.i_body > 0) {
@@ -1599,7 +1922,7 @@ static void httpd_ClientSend(httpd_client_t *cl)
 
                 cl->answer.i_body = 0;
                 cl->answer.p_body = NULL;
-            } else /* send finished */
+            } else if (cl->i_shared_size == 0) /* send finished */
                 cl->i_state = HTTPD_CLIENT_SEND_DONE;
         }
     } else {
@@ -1666,367 +1989,547 @@ auth_failed:
     return false;
 }
 
-static void httpdLoop(httpd_host_t *host)
+/* Handles the client state changes that do not depend on socket events */
+static void httpd_ClientPrepare(httpd_host_t *host, httpd_client_t *cl)
 {
-    struct pollfd ufd[host->nfd + host->client_count];
-    unsigned nfd;
-    for (nfd = 0; nfd < host->nfd; nfd++) {
-        ufd[nfd].fd = host->fds[nfd];
-        ufd[nfd].events = POLLIN;
-        ufd[nfd].revents = 0;
-    }
-
-    vlc_mutex_lock(&host->lock);
-    /* add all socket that should be read/write and close dead connection */
-    while (vlc_list_is_empty(&host->urls)) {
-        mutex_cleanup_push(&host->lock);
-        vlc_cond_wait(&host->wait, &host->lock);
-        vlc_cleanup_pop();
-    }
-
-    vlc_tick_t now = vlc_tick_now();
-    bool b_low_delay = false;
-    httpd_client_t *cl;
-
-    int canc = vlc_savecancel();
-    vlc_list_foreach(cl, &host->clients, node) {
-        int64_t i_offset;
-
-        if (cl->i_state == HTTPD_CLIENT_DEAD
-         || (cl->i_activity_timeout > 0
-          && cl->i_activity_date + cl->i_activity_timeout < now)) {
-            host->client_count--;
-            httpd_ClientDestroy(cl);
-            continue;
-        }
+    int64_t i_offset;
+
+    switch (cl->i_state) {
+        case HTTPD_CLIENT_RECEIVE_DONE: {
+            httpd_message_t *answer = &cl->answer;
+            httpd_message_t *query  = &cl->query;
+
+            httpd_MsgInit(answer);
+
+            /* Handle what we received */
+            switch (query->i_type) {
+                case HTTPD_MSG_ANSWER:
+                    cl->url     = NULL;
+                    cl->i_state = HTTPD_CLIENT_DEAD;
+                    break;
+
+                case HTTPD_MSG_OPTIONS:
+                    answer->i_type   = HTTPD_MSG_ANSWER;
+                    answer->i_proto  = query->i_proto;
+                    answer->i_status = 200;
+                    answer->i_body = 0;
+                    answer->p_body = NULL;
+
+                    httpd_MsgAdd(answer, "Server", "VLC/%s", VERSION);
+                    httpd_MsgAdd(answer, "Content-Length", "0");
+
+                    switch(query->i_proto) {
+                    case HTTPD_PROTO_HTTP:
+                        answer->i_version = 1;
+                        httpd_MsgAdd(answer, "Allow", "GET,HEAD,POST,OPTIONS");
+                        break;
 
-        struct pollfd *pufd = ufd + nfd;
-        assert (pufd < ufd + (sizeof (ufd) / sizeof (ufd[0])));
+                    case HTTPD_PROTO_RTSP:
+                        answer->i_version = 0;
 
-        pufd->events = pufd->revents = 0;
+                        const char *p = httpd_MsgGet(query, "Cseq");
+                        if (p)
+                            httpd_MsgAdd(answer, "Cseq", "%s", p);
+                        p = httpd_MsgGet(query, "Timestamp");
+                        if (p)
+                            httpd_MsgAdd(answer, "Timestamp", "%s", p);
 
-        switch (cl->i_state) {
-            case HTTPD_CLIENT_RECEIVING:
-            case HTTPD_CLIENT_TLS_HS_IN:
-                pufd->events = POLLIN;
-                break;
+                        p = httpd_MsgGet(query, "Require");
+                        if (p) {
+                            answer->i_status = 551;
+                            httpd_MsgAdd(query, "Unsupported", "%s", p);
+                        }
 
-            case HTTPD_CLIENT_SENDING:
-            case HTTPD_CLIENT_TLS_HS_OUT:
-                pufd->events = POLLOUT;
-                break;
+                        httpd_MsgAdd(answer, "Public", "DESCRIBE,SETUP,"
+                                "TEARDOWN,PLAY,PAUSE,GET_PARAMETER");
+                        break;
+                    }
 
-            case HTTPD_CLIENT_RECEIVE_DONE: {
-                httpd_message_t *answer = &cl->answer;
-                httpd_message_t *query  = &cl->query;
+                    if (httpd_MsgGet(&cl->query, "Connection") != NULL)
+                        httpd_MsgAdd(answer, "Connection", "close");
 
-                httpd_MsgInit(answer);
+                    cl->i_buffer = -1;  /* Force the creation of the answer in
+                                         * httpd_ClientSend */
+                    cl->i_state = HTTPD_CLIENT_SENDING;
+                    break;
 
-                /* Handle what we received */
-                switch (query->i_type) {
-                    case HTTPD_MSG_ANSWER:
-                        cl->url     = NULL;
+                case HTTPD_MSG_NONE:
+                    if (query->i_proto == HTTPD_PROTO_NONE) {
+                        cl->url = NULL;
                         cl->i_state = HTTPD_CLIENT_DEAD;
-                        break;
-
-                    case HTTPD_MSG_OPTIONS:
+                    } else {
+                        /* unimplemented */
+                        answer->i_proto  = query->i_proto ;
                         answer->i_type   = HTTPD_MSG_ANSWER;
-                        answer->i_proto  = query->i_proto;
-                        answer->i_status = 200;
-                        answer->i_body = 0;
-                        answer->p_body = NULL;
+                        answer->i_version= 0;
+                        answer->i_status = 501;
 
-                        httpd_MsgAdd(answer, "Server", "VLC/%s", VERSION);
-                        httpd_MsgAdd(answer, "Content-Length", "0");
+                        char *p;
+                        answer->i_body = httpd_HtmlError (&p, 501, NULL);
+                        answer->p_body = (uint8_t *)p;
+                        httpd_MsgAdd(answer, "Content-Length", "%d", answer->i_body);
+                        httpd_MsgAdd(answer, "Connection", "close");
 
-                        switch(query->i_proto) {
-                        case HTTPD_PROTO_HTTP:
-                            answer->i_version = 1;
-                            httpd_MsgAdd(answer, "Allow", "GET,HEAD,POST,OPTIONS");
-                            break;
+                        cl->i_buffer = -1;  /* Force the creation of the answer in httpd_ClientSend */
+                        cl->i_state = HTTPD_CLIENT_SENDING;
+                    }
+                    break;
+
+                default: {
+                    httpd_url_t *url;
+                    int i_msg = query->i_type;
+                    bool b_auth_failed = false;
+
+                    /* Search the url and trigger callbacks. Request callbacks
+                     * are serialized by the host lock, whatever the worker. */
+                    vlc_mutex_lock(&host->lock);
+                    vlc_list_foreach(url, &host->urls, node) {
+                        if (strcmp(url->psz_url, query->psz_url))
+                            continue;
+                        if (!url->catch[i_msg].cb)
+                            continue;
 
-                        case HTTPD_PROTO_RTSP:
-                            answer->i_version = 0;
+                        if (answer) {
+                            b_auth_failed = !httpdAuthOk(url->psz_user,
+                               url->psz_password,
+                               httpd_MsgGet(query, "Authorization")); /* BASIC id */
+                            if (b_auth_failed)
+                               break;
+                        }
 
-                            const char *p = httpd_MsgGet(query, "Cseq");
-                            if (p)
-                                httpd_MsgAdd(answer, "Cseq", "%s", p);
-                            p = httpd_MsgGet(query, "Timestamp");
-                            if (p)
-                                httpd_MsgAdd(answer, "Timestamp", "%s", p);
+                        if (url->catch[i_msg].cb(url->catch[i_msg].p_sys, cl, answer, query))
+                            continue;
 
-                            p = httpd_MsgGet(query, "Require");
-                            if (p) {
-                                answer->i_status = 551;
-                                httpd_MsgAdd(query, "Unsupported", "%s", p);
-                            }
+                        if (answer->i_proto == HTTPD_PROTO_NONE)
+                            cl->i_buffer = cl->i_buffer_size; /* Raw answer from a CGI */
+                        else
+                            cl->i_buffer = -1;
 
-                            httpd_MsgAdd(answer, "Public", "DESCRIBE,SETUP,"
-                                    "TEARDOWN,PLAY,PAUSE,GET_PARAMETER");
-                            break;
-                        }
+                        /* only one url can answer */
+                        answer = NULL;
+                        if (!cl->url)
+                            cl->url = url;
+                    }
+                    vlc_mutex_unlock(&host->lock);
 
+                    if (answer) {
+                        answer->i_proto  = query->i_proto;
+                        answer->i_type   = HTTPD_MSG_ANSWER;
+                        answer->i_version= 0;
+
+                       if (b_auth_failed) {
+                            httpd_MsgAdd(answer, "WWW-Authenticate",
+                                    "Basic realm=\"VLC stream\"");
+                            answer->i_status = 401;
+                        } else
+                            answer->i_status = 404; /* no url registered */
+
+                        char *p;
+                        answer->i_body = httpd_HtmlError (&p, answer->i_status,
+                                query->psz_url);
+                        answer->p_body = (uint8_t *)p;
+
+                        cl->i_buffer = -1;  /* Force the creation of the answer in httpd_ClientSend */
+                        httpd_MsgAdd(answer, "Content-Length", "%d", answer->i_body);
+                        httpd_MsgAdd(answer, "Content-Type", "%s", "text/html");
                         if (httpd_MsgGet(&cl->query, "Connection") != NULL)
                             httpd_MsgAdd(answer, "Connection", "close");
+                    }
 
-                        cl->i_buffer = -1;  /* Force the creation of the answer in
-                                             * httpd_ClientSend */
-                        cl->i_state = HTTPD_CLIENT_SENDING;
-                        break;
+                    cl->i_state = HTTPD_CLIENT_SENDING;
+                }
+            }
+            break;
+        }
 
-                    case HTTPD_MSG_NONE:
-                        if (query->i_proto == HTTPD_PROTO_NONE) {
-                            cl->url = NULL;
-                            cl->i_state = HTTPD_CLIENT_DEAD;
-                        } else {
-                            /* unimplemented */
-                            answer->i_proto  = query->i_proto ;
-                            answer->i_type   = HTTPD_MSG_ANSWER;
-                            answer->i_version= 0;
-                            answer->i_status = 501;
-
-                            char *p;
-                            answer->i_body = httpd_HtmlError (&p, 501, NULL);
-                            answer->p_body = (uint8_t *)p;
-                            httpd_MsgAdd(answer, "Content-Length", "%d", answer->i_body);
-                            httpd_MsgAdd(answer, "Connection", "close");
+        case HTTPD_CLIENT_SEND_DONE:
+            if (!cl->b_stream_mode || cl->answer.i_body_offset == 0) {
+                bool do_close = false;
 
-                            cl->i_buffer = -1;  /* Force the creation of the answer in httpd_ClientSend */
-                            cl->i_state = HTTPD_CLIENT_SENDING;
-                        }
-                        break;
+                cl->url = NULL;
 
-                    default: {
-                        httpd_url_t *url;
-                        int i_msg = query->i_type;
-                        bool b_auth_failed = false;
-
-                        /* Search the url and trigger callbacks */
-                        vlc_list_foreach(url, &host->urls, node) {
-                            if (strcmp(url->psz_url, query->psz_url))
-                                continue;
-                            if (!url->catch[i_msg].cb)
-                                continue;
-
-                            if (answer) {
-                                b_auth_failed = !httpdAuthOk(url->psz_user,
-                                   url->psz_password,
-                                   httpd_MsgGet(query, "Authorization")); /* BASIC id */
-                                if (b_auth_failed)
-                                   break;
-                            }
-
-                            if (url->catch[i_msg].cb(url->catch[i_msg].p_sys, cl, answer, query))
-                                continue;
-
-                            if (answer->i_proto == HTTPD_PROTO_NONE)
-                                cl->i_buffer = cl->i_buffer_size; /* Raw answer from a CGI */
-                            else
-                                cl->i_buffer = -1;
-
-                            /* only one url can answer */
-                            answer = NULL;
-                            if (!cl->url)
-                                cl->url = url;
-                        }
+                if (cl->query.i_proto != HTTPD_PROTO_HTTP
+                 || cl->query.i_version > 0)
+                {
+                    const char *psz_connection = httpd_MsgGet(&cl->answer,
+                                                             "Connection");
+                    if (psz_connection != NULL)
+                        do_close = !strcasecmp(psz_connection, "close");
+                }
+                else
+                    do_close = true;
 
-                        if (answer) {
-                            answer->i_proto  = query->i_proto;
-                            answer->i_type   = HTTPD_MSG_ANSWER;
-                            answer->i_version= 0;
-
-                           if (b_auth_failed) {
-                                httpd_MsgAdd(answer, "WWW-Authenticate",
-                                        "Basic realm=\"VLC stream\"");
-                                answer->i_status = 401;
-                            } else
-                                answer->i_status = 404; /* no url registered */
-
-                            char *p;
-                            answer->i_body = httpd_HtmlError (&p, answer->i_status,
-                                    query->psz_url);
-                            answer->p_body = (uint8_t *)p;
-
-                            cl->i_buffer = -1;  /* Force the creation of the answer in httpd_ClientSend */
-                            httpd_MsgAdd(answer, "Content-Length", "%d", answer->i_body);
-                            httpd_MsgAdd(answer, "Content-Type", "%s", "text/html");
-                            if (httpd_MsgGet(&cl->query, "Connection") != NULL)
-                                httpd_MsgAdd(answer, "Connection", "close");
-                        }
+                if (!do_close) {
+                    httpd_MsgClean(&cl->query);
+                    httpd_MsgInit(&cl->query);
 
-                        cl->i_state = HTTPD_CLIENT_SENDING;
-                    }
-                }
-                break;
+                    cl->i_buffer = 0;
+                    cl->i_buffer_size = 1000;
+                    free(cl->p_buffer);
+                    // Allocate an extra byte for the null terminating byte
+                    cl->p_buffer = xmalloc(cl->i_buffer_size + 1);
+                    cl->i_state = HTTPD_CLIENT_RECEIVING;
+                } else
+                    cl->i_state = HTTPD_CLIENT_DEAD;
+                httpd_MsgClean(&cl->answer);
+            } else {
+                i_offset = cl->answer.i_body_offset;
+                httpd_MsgClean(&cl->answer);
+
+                cl->answer.i_body_offset = i_offset;
+                free(cl->p_buffer);
+                cl->p_buffer = NULL;
+                cl->i_buffer = 0;
+                cl->i_buffer_size = 0;
+
+                cl->i_state = HTTPD_CLIENT_WAITING;
             }
+            break;
 
-            case HTTPD_CLIENT_SEND_DONE:
-                if (!cl->b_stream_mode || cl->answer.i_body_offset == 0) {
-                    bool do_close = false;
+        case HTTPD_CLIENT_WAITING:
+            i_offset = cl->answer.i_body_offset;
+            int i_msg = cl->query.i_type;
 
-                    cl->url = NULL;
+            httpd_MsgInit(&cl->answer);
+            cl->answer.i_body_offset = i_offset;
 
-                    if (cl->query.i_proto != HTTPD_PROTO_HTTP
-                     || cl->query.i_version > 0)
-                    {
-                        const char *psz_connection = httpd_MsgGet(&cl->answer,
-                                                                 "Connection");
-                        if (psz_connection != NULL)
-                            do_close = !strcasecmp(psz_connection, "close");
-                    }
-                    else
-                        do_close = true;
-
-                    if (!do_close) {
-                        httpd_MsgClean(&cl->query);
-                        httpd_MsgInit(&cl->query);
-
-                        cl->i_buffer = 0;
-                        cl->i_buffer_size = 1000;
-                        free(cl->p_buffer);
-                        // Allocate an extra byte for the null terminating byte
-                        cl->p_buffer = xmalloc(cl->i_buffer_size + 1);
-                        cl->i_state = HTTPD_CLIENT_RECEIVING;
-                    } else
-                        cl->i_state = HTTPD_CLIENT_DEAD;
-                    httpd_MsgClean(&cl->answer);
-                } else {
-                    i_offset = cl->answer.i_body_offset;
-                    httpd_MsgClean(&cl->answer);
+            vlc_mutex_lock(&host->lock);
+            cl->url->catch[i_msg].cb(cl->url->catch[i_msg].p_sys, cl,
+                    &cl->answer, &cl->query);
+            vlc_mutex_unlock(&host->lock);
+            if (cl->answer.i_type != HTTPD_MSG_NONE) {
+                /* we have new data, so re-enter send mode */
+                cl->i_buffer      = 0;
+                cl->p_buffer      = cl->answer.p_body;
+                cl->i_buffer_size = cl->answer.i_body;
+                cl->answer.p_body = NULL;
+                cl->answer.i_body = 0;
+                cl->i_state = HTTPD_CLIENT_SENDING;
+            }
+    }
+}
 
-                    cl->answer.i_body_offset = i_offset;
-                    free(cl->p_buffer);
-                    cl->p_buffer = NULL;
-                    cl->i_buffer = 0;
-                    cl->i_buffer_size = 0;
+static short httpd_ClientEvents(const httpd_client_t *cl)
+{
+    switch (cl->i_state) {
+        case HTTPD_CLIENT_RECEIVING:
+        case HTTPD_CLIENT_TLS_HS_IN:
+            return POLLIN;
+        case HTTPD_CLIENT_SENDING:
+        case HTTPD_CLIENT_TLS_HS_OUT:
+            return POLLOUT;
+    }
+    return 0;
+}
 
-                    cl->i_state = HTTPD_CLIENT_WAITING;
-                }
-                break;
+static void httpd_ClientEvent(httpd_host_t *host, httpd_client_t *cl,
+                              vlc_tick_t now)
+{
+    cl->i_activity_date = now;
 
-            case HTTPD_CLIENT_WAITING:
-                i_offset = cl->answer.i_body_offset;
-                int i_msg = cl->query.i_type;
+    switch (cl->i_state) {
+        case HTTPD_CLIENT_RECEIVING: httpd_ClientRecv(cl); break;
+        case HTTPD_CLIENT_SENDING:   httpd_ClientSend(host, cl); break;
+        case HTTPD_CLIENT_TLS_HS_IN:
+        case HTTPD_CLIENT_TLS_HS_OUT:
+            httpd_ClientTlsHandshake(host, cl);
+            break;
+    }
+}
 
-                httpd_MsgInit(&cl->answer);
-                cl->answer.i_body_offset = i_offset;
+/* Gives a new client to the least loaded worker.
+ * Called from the first worker, with its lock held. */
+static void httpd_WorkerAdd(httpd_worker_t *self, httpd_client_t *cl)
+{
+    httpd_host_t *host = self->host;
+    httpd_worker_t *worker = self;
+    size_t count = self->client_count;
 
-                cl->url->catch[i_msg].cb(cl->url->catch[i_msg].p_sys, cl,
-                        &cl->answer, &cl->query);
-                if (cl->answer.i_type != HTTPD_MSG_NONE) {
-                    /* we have new data, so re-enter send mode */
-                    cl->i_buffer      = 0;
-                    cl->p_buffer      = cl->answer.p_body;
-                    cl->i_buffer_size = cl->answer.i_body;
-                    cl->answer.p_body = NULL;
-                    cl->answer.i_body = 0;
-                    cl->i_state = HTTPD_CLIENT_SENDING;
-                }
+    for (unsigned i = 0; i < host->nworkers; i++) {
+        httpd_worker_t *w = &host->workers[i];
+
+        if (w == self)
+            continue;
+        vlc_mutex_lock(&w->lock);
+        if (w->client_count < count) {
+            count = w->client_count;
+            worker = w;
         }
+        vlc_mutex_unlock(&w->lock);
+    }
 
-        pufd->fd = vlc_tls_GetPollFD(cl->sock, &pufd->events);
+    if (worker != self) {
+        vlc_mutex_lock(&worker->lock);
+        worker->client_count++;
+        vlc_list_append(&cl->node, &worker->clients);
+        vlc_mutex_unlock(&worker->lock);
+        httpd_WorkerWake(worker);
+    } else {
+        self->client_count++;
+        vlc_list_append(&cl->node, &self->clients);
+    }
+}
 
-        if (pufd->events != 0)
-            nfd++;
-        else
-            b_low_delay = true;
+static void httpd_HostAccept(httpd_worker_t *self, int fd, vlc_tick_t now)
+{
+    httpd_host_t *host = self->host;
+
+    fd = vlc_accept (fd, NULL, NULL, true);
+    if (fd == -1)
+        return;
+    setsockopt (fd, SOL_SOCKET, SO_REUSEADDR,
+            &(int){ 1 }, sizeof(int));
+
+    vlc_tls_t *sk = vlc_tls_SocketOpen(fd);
+    if (unlikely(sk == NULL))
+    {
+        vlc_close(fd);
+        return;
     }
-    vlc_mutex_unlock(&host->lock);
-    vlc_restorecancel(canc);
 
-    /* we will wait 20ms (not too big) if HTTPD_CLIENT_WAITING */
-    while (poll(ufd, nfd, b_low_delay ? 20 : -1) < 0)
+    if (host->p_tls != NULL)
+    {
+        const char *alpn[] = { "http/1.1", NULL };
+        vlc_tls_t *tls;
+
+        tls = vlc_tls_ServerSessionCreate(host->p_tls, sk, alpn);
+        if (tls == NULL)
+        {
+            vlc_tls_SessionDelete(sk);
+            return;
+        }
+        sk = tls;
+    }
+
+    httpd_client_t *cl = httpd_ClientNew(sk, now);
+    if (unlikely(cl == NULL))
+    {
+        vlc_tls_Close(sk);
+        return;
+    }
+
+    if (host->p_tls != NULL)
+        cl->i_state = HTTPD_CLIENT_TLS_HS_OUT;
+
+    httpd_WorkerAdd(self, cl);
+}
+
+/* Without a wake up pipe, the wait is bounded so that the clients of a
+ * deleted url still get reaped. */
+static int httpd_WorkerTimeout(const httpd_worker_t *worker, bool b_low_delay)
+{
+    if (b_low_delay)
+        return 20; /* not too big if HTTPD_CLIENT_WAITING */
+    return (worker->wakeup[0] != -1) ? -1 : 500;
+}
+
+static void httpd_WorkerDrain(httpd_worker_t *worker)
+{
+    char buf[64];
+
+    if (read(worker->wakeup[0], buf, sizeof (buf)) < 0)
+        msg_Err(worker->host, "wake up error: %s", vlc_strerror_c(errno));
+}
+
+#ifdef HAVE_SYS_EPOLL_H
+static void httpd_WorkerWatch(httpd_worker_t *worker, httpd_client_t *cl,
+                              int fd, short events)
+{
+    if (cl->i_poll_events == events)
+        return;
+
+    struct epoll_event ev = {
+        .events = ((events & POLLIN) ? EPOLLIN : 0)
+                | ((events & POLLOUT) ? EPOLLOUT : 0),
+        .data.ptr = cl,
+    };
+
+    if (epoll_ctl(worker->epfd, (cl->i_poll_events < 0) ? EPOLL_CTL_ADD
+                                                        : EPOLL_CTL_MOD,
+                  fd, &ev) == 0)
+        cl->i_poll_events = events;
+    else
+        cl->i_state = HTTPD_CLIENT_DEAD;
+}
+
+static void httpd_WorkerWaitEpoll(httpd_worker_t *worker, bool b_low_delay)
+{
+    httpd_host_t *host = worker->host;
+    struct epoll_event ev[64];
+    int n;
+
+    vlc_mutex_unlock(&worker->lock);
+
+    while ((n = epoll_wait(worker->epfd, ev, ARRAY_SIZE(ev),
+                           httpd_WorkerTimeout(worker, b_low_delay))) < 0)
     {
         if (errno != EINTR)
             msg_Err(host, "polling error: %s", vlc_strerror_c(errno));
     }
 
-    canc = vlc_savecancel();
-    vlc_mutex_lock(&host->lock);
+    int canc = vlc_savecancel();
+    vlc_mutex_lock(&worker->lock);
 
-    /* Handle client sockets */
-    now = vlc_tick_now();
-    nfd = host->nfd;
+    vlc_tick_t now = vlc_tick_now();
 
-    vlc_list_foreach(cl, &host->clients, node) {
-        const struct pollfd *pufd = &ufd[nfd];
+    for (int i = 0; i < n; i++) {
+        void *ptr = ev[i].data.ptr;
 
-        assert(pufd < &ufd[sizeof(ufd) / sizeof(ufd[0])]);
+        if (ptr == worker) {
+            httpd_WorkerDrain(worker);
+            continue;
+        }
 
-        if (vlc_tls_GetFD(cl->sock) != pufd->fd)
-            continue; // we were not waiting for this client
-        ++nfd;
-        if (pufd->revents == 0)
-            continue; // no event received
+        /* only the first worker listens */
+        unsigned j = (worker == &host->workers[0]) ? 0 : host->nfd;
 
-        cl->i_activity_date = now;
+        while (j < host->nfd && ptr != &host->fds[j])
+            j++;
 
-        switch (cl->i_state) {
-            case HTTPD_CLIENT_RECEIVING: httpd_ClientRecv(cl); break;
-            case HTTPD_CLIENT_SENDING:   httpd_ClientSend(cl); break;
-            case HTTPD_CLIENT_TLS_HS_IN:
-            case HTTPD_CLIENT_TLS_HS_OUT:
-                httpd_ClientTlsHandshake(host, cl);
-                break;
+        if (j < host->nfd) {
+            httpd_HostAccept(worker, host->fds[j], now);
+        } else {
+            httpd_client_t *cl = ptr;
+
+            if (cl->i_state == HTTPD_CLIENT_WAITING
+             && (ev[i].events & (EPOLLERR|EPOLLHUP)))
+                cl->i_state = HTTPD_CLIENT_DEAD; /* gone while waiting data */
+            else
+                httpd_ClientEvent(host, cl, now);
         }
     }
 
-    /* Handle server sockets (accept new connections) */
-    for (nfd = 0; nfd < host->nfd; nfd++) {
-        int fd = ufd[nfd].fd;
+    vlc_restorecancel(canc);
+}
+#endif
 
-        assert (fd == host->fds[nfd]);
+static void httpd_WorkerWaitPoll(httpd_worker_t *worker, bool b_low_delay)
+{
+    httpd_host_t *host = worker->host;
+    const unsigned nlisten = (worker == &host->workers[0]) ? host->nfd : 0;
+    const unsigned nwake = (worker->wakeup[0] != -1) ? 1 : 0;
+    struct pollfd ufd[nlisten + nwake + worker->client_count];
+    httpd_client_t *clients[worker->client_count + 1];
+    httpd_client_t *cl;
+    unsigned nfd = 0, ncl = 0;
 
-        if (ufd[nfd].revents == 0)
-            continue;
+    for (unsigned i = 0; i < nlisten; i++) {
+        ufd[nfd].fd = host->fds[i];
+        ufd[nfd].events = POLLIN;
+        ufd[nfd++].revents = 0;
+    }
+    if (nwake) {
+        ufd[nfd].fd = worker->wakeup[0];
+        ufd[nfd].events = POLLIN;
+        ufd[nfd++].revents = 0;
+    }
 
-        /* */
-        fd = vlc_accept (fd, NULL, NULL, true);
-        if (fd == -1)
-            continue;
-        setsockopt (fd, SOL_SOCKET, SO_REUSEADDR,
-                &(int){ 1 }, sizeof(int));
+    vlc_list_foreach(cl, &worker->clients, node) {
+        short events = httpd_ClientEvents(cl);
+        int fd = vlc_tls_GetPollFD(cl->sock, &events);
 
-        vlc_tls_t *sk = vlc_tls_SocketOpen(fd);
-        if (unlikely(sk == NULL))
-        {
-            vlc_close(fd);
+        if (events == 0)
             continue;
+        assert(nfd < ARRAY_SIZE(ufd));
+        ufd[nfd].fd = fd;
+        ufd[nfd].events = events;
+        ufd[nfd++].revents = 0;
+        clients[ncl++] = cl;
+    }
+
+    vlc_mutex_unlock(&worker->lock);
+
+    while (poll(ufd, nfd, httpd_WorkerTimeout(worker, b_low_delay)) < 0)
+    {
+        if (errno != EINTR)
+            msg_Err(host, "polling error: %s", vlc_strerror_c(errno));
+    }
+
+    int canc = vlc_savecancel();
+    vlc_mutex_lock(&worker->lock);
+
+    /* Handle client sockets */
+    vlc_tick_t now = vlc_tick_now();
+
+    for (unsigned i = 0; i < ncl; i++)
+        if (ufd[nlisten + nwake + i].revents != 0)
+            httpd_ClientEvent(host, clients[i], now);
+
+    if (nwake && ufd[nlisten].revents != 0)
+        httpd_WorkerDrain(worker);
+
+    /* Handle server sockets (accept new connections) */
+    for (unsigned i = 0; i < nlisten; i++)
+        if (ufd[i].revents != 0)
+            httpd_HostAccept(worker, ufd[i].fd, now);
+
+    vlc_restorecancel(canc);
+}
+
+static void httpdLoop(httpd_worker_t *worker)
+{
+    httpd_host_t *host = worker->host;
+
+    if (worker == &host->workers[0]) {
+        /* do not accept connections until an url is registered */
+        vlc_mutex_lock(&host->lock);
+        while (vlc_list_is_empty(&host->urls)) {
+            mutex_cleanup_push(&host->lock);
+            vlc_cond_wait(&host->wait, &host->lock);
+            vlc_cleanup_pop();
         }
+        vlc_mutex_unlock(&host->lock);
+    }
 
-        if (host->p_tls != NULL)
-        {
-            const char *alpn[] = { "http/1.1", NULL };
-            vlc_tls_t *tls;
+    vlc_mutex_lock(&worker->lock);
+    /* add all socket that should be read/write and close dead connection */
+    vlc_tick_t now = vlc_tick_now();
+    bool b_low_delay = false;
+    httpd_client_t *cl;
 
-            tls = vlc_tls_ServerSessionCreate(host->p_tls, sk, alpn);
-            if (tls == NULL)
-            {
-                vlc_tls_SessionDelete(sk);
-                continue;
-            }
-            sk = tls;
+    int canc = vlc_savecancel();
+    vlc_list_foreach(cl, &worker->clients, node) {
+        if (cl->i_state == HTTPD_CLIENT_DEAD
+         || (cl->i_activity_timeout > 0
+          && cl->i_activity_date + cl->i_activity_timeout < now)) {
+            worker->client_count--;
+            httpd_ClientDestroy(cl);
+            continue;
         }
 
-        cl = httpd_ClientNew(sk, now);
+        httpd_ClientPrepare(host, cl);
 
-        if (host->p_tls != NULL)
-            cl->i_state = HTTPD_CLIENT_TLS_HS_OUT;
+        short events = httpd_ClientEvents(cl);
+        int fd = vlc_tls_GetPollFD(cl->sock, &events);
 
-        host->client_count++;
-        vlc_list_append(&cl->node, &host->clients);
+        if (events == 0)
+            b_low_delay = true;
+#ifdef HAVE_SYS_EPOLL_H
+        if (worker->epfd != -1)
+            httpd_WorkerWatch(worker, cl, fd, events);
+#else
+        VLC_UNUSED(fd);
+#endif
     }
-
-    vlc_mutex_unlock(&host->lock);
     vlc_restorecancel(canc);
+
+    /* the lock is released while waiting for events */
+#ifdef HAVE_SYS_EPOLL_H
+    if (worker->epfd != -1)
+        httpd_WorkerWaitEpoll(worker, b_low_delay);
+    else
+#endif
+        httpd_WorkerWaitPoll(worker, b_low_delay);
+    vlc_mutex_unlock(&worker->lock);
 }
 
 static void* httpd_HostThread(void *data)
 {
-    httpd_host_t *host = data;
+    httpd_worker_t *worker = data;
+    httpd_host_t *host = worker->host;
 
     while (atomic_load_explicit(&host->ref, memory_order_relaxed) > 0)
-        httpdLoop(host);
+        httpdLoop(worker);
     return NULL;
 }
 
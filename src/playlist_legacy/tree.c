@@ -137,6 +137,9 @@ void playlist_NodeDeleteExplicit( playlist_t *p_playlist,
 
     PL_DEBUG( "deleting item `%s'", p_root->p_input->psz_name );
 
+    /* Do not preparse a deleted item */
+    libvlc_MetadataCancel( p_playlist->obj.libvlc, p_root );
+
     /* Remove the item from its parent */
     playlist_item_t *p_parent = p_root->p_parent;
     if( p_parent != NULL )
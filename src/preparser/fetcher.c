@@ -189,6 +189,11 @@ static int SearchArt( input_fetcher_t* fetcher, input_item_t* item, int scope)
     return CheckArt( item );
 }
 
+static int RequestPriority( struct fetcher_request* req )
+{
+    return ( req->options & META_REQUEST_OPTION_PRIORITY ) ? 1 : 0;
+}
+
 static int SearchByScope( input_fetcher_t* fetcher,
     struct fetcher_request* req, int scope )
 {
@@ -207,7 +212,8 @@ static int SearchByScope( input_fetcher_t* fetcher,
         ! SearchArt( fetcher, item, scope ) )
     {
         AddAlbumCache( fetcher, req->item, false );
-        if( !background_worker_Push( fetcher->downloader, req, NULL, 0 ) )
+        if( !background_worker_Push( fetcher->downloader, req, NULL, 0,
+                                     RequestPriority( req ) ) )
             return VLC_SUCCESS;
     }
 
@@ -294,7 +300,8 @@ static void SearchLocal( input_fetcher_t* fetcher, struct fetcher_request* req )
     if( var_InheritBool( fetcher->owner, "metadata-network-access" ) ||
         req->options & META_REQUEST_OPTION_SCOPE_NETWORK )
     {
-        if( background_worker_Push( fetcher->network, req, NULL, 0 ) )
+        if( background_worker_Push( fetcher->network, req, NULL, 0,
+                                    RequestPriority( req ) ) )
             NotifyArtFetchEnded(req, false);
     }
     else
@@ -397,11 +404,12 @@ DEF_STARTER(SearchNetwork, fetcher->network )
 DEF_STARTER(   Downloader, fetcher->downloader )
 
 static void WorkerInit( input_fetcher_t* fetcher,
-    struct background_worker** worker, int( *starter )( void*, void*, void** ) )
+    struct background_worker** worker, int( *starter )( void*, void*, void** ),
+    const char* threads )
 {
     struct background_worker_config conf = {
         .default_timeout = 0,
-        .max_threads = var_InheritInteger( fetcher->owner, "fetch-art-threads" ),
+        .max_threads = var_InheritInteger( fetcher->owner, threads ),
         .pf_start = starter,
         .pf_probe = ProbeWorker,
         .pf_stop = CloseWorker,
@@ -420,9 +428,15 @@ input_fetcher_t* input_fetcher_New( vlc_object_t* owner )
 
     fetcher->owner = owner;
 
-    WorkerInit( fetcher, &fetcher->local, StartSearchLocal );
-    WorkerInit( fetcher, &fetcher->network, StartSearchNetwork );
-    WorkerInit( fetcher, &fetcher->downloader, StartDownloader );
+    /* Network requests may stall on slow servers: give them their own
+     * threads, so that they do not hold back the local searches; and give
+     * the downloads theirs, so that they do not wait for the searches */
+    WorkerInit( fetcher, &fetcher->local, StartSearchLocal,
+                "fetch-art-threads" );
+    WorkerInit( fetcher, &fetcher->network, StartSearchNetwork,
+                "fetch-art-network-threads" );
+    WorkerInit( fetcher, &fetcher->downloader, StartDownloader,
+                "fetch-art-download-threads" );
 
     if( unlikely( !fetcher->local || !fetcher->network || !fetcher->downloader ) )
     {
@@ -462,7 +476,8 @@ int input_fetcher_Push( input_fetcher_t* fetcher, input_item_t* item,
     vlc_atomic_rc_init( &req->rc );
     input_item_Hold( item );
 
-    if( background_worker_Push( fetcher->local, req, NULL, 0 ) )
+    if( background_worker_Push( fetcher->local, req, NULL, 0,
+                                RequestPriority( req ) ) )
         NotifyArtFetchEnded(req, false);
 
     RequestRelease( req );
@@ -471,6 +486,12 @@ int input_fetcher_Push( input_fetcher_t* fetcher, input_item_t* item,
 
 void input_fetcher_Delete( input_fetcher_t* fetcher )
 {
+    background_worker_LogStats( fetcher->local, fetcher->owner,
+                                "local art fetcher" );
+    background_worker_LogStats( fetcher->network, fetcher->owner,
+                                "network art fetcher" );
+    background_worker_LogStats( fetcher->downloader, fetcher->owner,
+                                "art downloader" );
     background_worker_Delete( fetcher->local );
     background_worker_Delete( fetcher->network );
     background_worker_Delete( fetcher->downloader );
@@ -35,15 +35,19 @@ struct input_preparser_t
 {
     vlc_object_t* owner;
     input_fetcher_t* fetcher;
-    struct background_worker* worker;
+    struct background_worker* local; /**< worker for local items */
+    struct background_worker* network; /**< worker for network items */
     atomic_bool deactivated;
 };
 
 typedef struct input_preparser_req_t
 {
     input_item_t *item;
+    struct background_worker *worker;
+    input_item_meta_request_option_t options;
     const input_preparser_callbacks_t *cbs;
     void *userdata;
+    struct input_preparser_req_t *dup; /**< merged duplicate request */
     vlc_atomic_rc_t rc;
 } input_preparser_req_t;
 
@@ -58,6 +62,8 @@ typedef struct input_preparser_task_t
 } input_preparser_task_t;
 
 static input_preparser_req_t *ReqCreate(input_item_t *item,
+                                        struct background_worker *worker,
+                                        input_item_meta_request_option_t options,
                                         const input_preparser_callbacks_t *cbs,
                                         void *userdata)
 {
@@ -66,8 +72,11 @@ static input_preparser_req_t *ReqCreate(input_item_t *item,
         return NULL;
 
     req->item = item;
+    req->worker = worker;
+    req->options = options;
     req->cbs = cbs;
     req->userdata = userdata;
+    req->dup = NULL;
     vlc_atomic_rc_init(&req->rc);
 
     input_item_Hold(item);
@@ -84,11 +93,35 @@ static void ReqRelease(input_preparser_req_t *req)
 {
     if (vlc_atomic_rc_dec(&req->rc))
     {
+        if (req->dup != NULL)
+            ReqRelease(req->dup);
         input_item_Release(req->item);
         free(req);
     }
 }
 
+static void ReqNotifyEnded(input_preparser_req_t *req, int status)
+{
+    for (; req != NULL; req = req->dup)
+        if (req->cbs && req->cbs->on_preparse_ended)
+            req->cbs->on_preparse_ended(req->item, status, req->userdata);
+}
+
+/**
+ * Merges a duplicate request into a queued one, so that both are called
+ * back when the item is preparsed. Called with the worker lock held.
+ */
+static void ReqMerge(void *req_, void *dup_)
+{
+    input_preparser_req_t *req = req_;
+    input_preparser_req_t *dup = dup_;
+
+    req->options |= dup->options;
+    while (req->dup != NULL)
+        req = req->dup;
+    req->dup = dup;
+}
+
 static void InputEvent( input_thread_t *input,
                         const struct vlc_input_event *event, void *task_ )
 {
@@ -103,13 +136,15 @@ static void InputEvent( input_thread_t *input,
 
         case INPUT_EVENT_DEAD:
             atomic_store( &task->done, true );
-            background_worker_RequestProbe( task->preparser->worker );
+            background_worker_RequestProbe( task->req->worker );
             break;
         case INPUT_EVENT_SUBITEMS:
         {
-            input_preparser_req_t *req = task->req;
-            if (req->cbs && req->cbs->on_subtree_added)
-                req->cbs->on_subtree_added(req->item, event->subitems, req->userdata);
+            for (input_preparser_req_t *req = task->req; req != NULL;
+                 req = req->dup)
+                if (req->cbs && req->cbs->on_subtree_added)
+                    req->cbs->on_subtree_added(req->item, event->subitems,
+                                               req->userdata);
             break;
         }
         default: ;
@@ -129,14 +164,13 @@ static int PreparserOpenInput( void* preparser_, void* req_, void** out )
     atomic_init( &task->done, false );
 
     task->preparser = preparser_;
+    task->req = req;
+    task->preparse_status = -1;
     task->input = input_CreatePreparser( preparser->owner, InputEvent,
                                          task, req->item );
     if( !task->input )
         goto error;
 
-    task->req = req;
-    task->preparse_status = -1;
-
     if( input_Start( task->input ) )
     {
         input_Close( task->input );
@@ -149,8 +183,7 @@ static int PreparserOpenInput( void* preparser_, void* req_, void** out )
 
 error:
     free( task );
-    if (req->cbs && req->cbs->on_preparse_ended)
-        req->cbs->on_preparse_ended(req->item, ITEM_PREPARSE_FAILED, req->userdata);
+    ReqNotifyEnded(req, ITEM_PREPARSE_FAILED);
     return VLC_EGENERIC;
 }
 
@@ -169,9 +202,7 @@ static void on_art_fetch_ended(input_item_t *item, bool fetched, void *userdata)
     input_preparser_req_t *req = task->req;
 
     input_item_SetPreparsed(req->item, true);
-
-    if (req->cbs && req->cbs->on_preparse_ended)
-        req->cbs->on_preparse_ended(req->item, task->preparse_status, req->userdata);
+    ReqNotifyEnded(req, task->preparse_status);
 
     ReqRelease(req);
     free(task);
@@ -209,8 +240,11 @@ static void PreparserCloseInput( void* preparser_, void* task_ )
     if( preparser->fetcher )
     {
         task->preparse_status = status;
-        if (!input_fetcher_Push(preparser->fetcher, item, 0,
-                               &input_fetcher_callbacks, task))
+        /* Only keep the priority: the scope of the art search is decided by
+         * the fetcher for preparsed items */
+        if (!input_fetcher_Push(preparser->fetcher, item,
+                                req->options & META_REQUEST_OPTION_PRIORITY,
+                                &input_fetcher_callbacks, task))
         {
             ReqHold(task->req);
             return;
@@ -220,8 +254,7 @@ static void PreparserCloseInput( void* preparser_, void* task_ )
     free(task);
 
     input_item_SetPreparsed( item, true );
-    if (req->cbs && req->cbs->on_preparse_ended)
-        req->cbs->on_preparse_ended(req->item, status, req->userdata);
+    ReqNotifyEnded(req, status);
 }
 
 static void ReqHoldVoid(void *item) { ReqHold(item); }
@@ -230,6 +263,8 @@ static void ReqReleaseVoid(void *item) { ReqRelease(item); }
 input_preparser_t* input_preparser_New( vlc_object_t *parent )
 {
     input_preparser_t* preparser = malloc( sizeof *preparser );
+    if( unlikely( !preparser ) )
+        return NULL;
 
     struct background_worker_config conf = {
         .default_timeout = VLC_TICK_FROM_MS(var_InheritInteger( parent, "preparse-timeout" )),
@@ -241,12 +276,19 @@ input_preparser_t* input_preparser_New( vlc_object_t *parent )
         .pf_hold = ReqHoldVoid
     };
 
+    preparser->local = background_worker_New( preparser, &conf );
 
-    if( likely( preparser ) )
-        preparser->worker = background_worker_New( preparser, &conf );
+    /* Network items are mostly waiting for their server: preparse them on
+     * their own threads, so that they do not hold back the local ones */
+    conf.max_threads = var_InheritInteger( parent, "preparse-network-threads" );
+    preparser->network = background_worker_New( preparser, &conf );
 
-    if( unlikely( !preparser || !preparser->worker ) )
+    if( unlikely( !preparser->local || !preparser->network ) )
     {
+        if( preparser->local )
+            background_worker_Delete( preparser->local );
+        if( preparser->network )
+            background_worker_Delete( preparser->network );
         free( preparser );
         return NULL;
     }
@@ -289,9 +331,26 @@ void input_preparser_Push( input_preparser_t *preparser,
             return;
     }
 
-    struct input_preparser_req_t *req = ReqCreate(item, cbs, cbs_userdata);
+    struct background_worker *worker = b_net ? preparser->network
+                                             : preparser->local;
+    int priority = (i_options & META_REQUEST_OPTION_PRIORITY) ? 1 : 0;
+
+    struct input_preparser_req_t *req = ReqCreate(item, worker, i_options,
+                                                  cbs, cbs_userdata);
+    if (unlikely(!req))
+    {
+        if (cbs && cbs->on_preparse_ended)
+            cbs->on_preparse_ended(item, ITEM_PREPARSE_FAILED, cbs_userdata);
+        return;
+    }
+
+    /* The item is already queued: move it ahead rather than preparsing it
+     * twice. The queued request now owns this one. */
+    if (priority && id
+     && background_worker_Prioritize(worker, id, priority, ReqMerge, req))
+        return;
 
-    if (background_worker_Push(preparser->worker, req, id, timeout))
+    if (background_worker_Push(worker, req, id, timeout, priority))
         if (req->cbs && cbs->on_preparse_ended)
             cbs->on_preparse_ended(item, ITEM_PREPARSE_FAILED, cbs_userdata);
 
@@ -309,18 +368,25 @@ void input_preparser_fetcher_Push( input_preparser_t *preparser,
 
 void input_preparser_Cancel( input_preparser_t *preparser, void *id )
 {
-    background_worker_Cancel( preparser->worker, id );
+    background_worker_Cancel( preparser->local, id );
+    background_worker_Cancel( preparser->network, id );
 }
 
 void input_preparser_Deactivate( input_preparser_t* preparser )
 {
     atomic_store( &preparser->deactivated, true );
-    background_worker_Cancel( preparser->worker, NULL );
+    background_worker_Cancel( preparser->local, NULL );
+    background_worker_Cancel( preparser->network, NULL );
 }
 
 void input_preparser_Delete( input_preparser_t *preparser )
 {
-    background_worker_Delete( preparser->worker );
+    background_worker_LogStats( preparser->local, preparser->owner,
+                                "local preparser" );
+    background_worker_LogStats( preparser->network, preparser->owner,
+                                "network preparser" );
+    background_worker_Delete( preparser->local );
+    background_worker_Delete( preparser->network );
 
     if( preparser->fetcher )
         input_fetcher_Delete( preparser->fetcher );
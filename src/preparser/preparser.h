@@ -50,6 +50,13 @@ input_preparser_t *input_preparser_New( vlc_object_t * );
  * indefinitely. If > 0, the timeout will be used (in milliseconds).
  * @param id unique id provided by the caller. This is can be used to cancel
  * the request with input_preparser_Cancel()
+ *
+ * Network items are preparsed by their own threads ("preparse-network-threads")
+ * so that they do not delay local ones. Requests with
+ * META_REQUEST_OPTION_PRIORITY are queued ahead of the others; if a request
+ * with the same non-NULL id is still queued, it is moved ahead instead and
+ * this one is merged into it: the options are combined, and both requests
+ * are called back when the item is preparsed.
  */
 void input_preparser_Push( input_preparser_t *, input_item_t *,
                            input_item_meta_request_option_t,
@@ -86,11 +86,132 @@ static void test_block (void)
     //assert (block == NULL);
 }
 
+static void test_block_Share (void)
+{
+    block_t *block = block_Alloc (sizeof (text));
+    assert (block != NULL);
+    memcpy (block->p_buffer, text, sizeof (text));
+    block->i_pts = VLC_TICK_0 + 42;
+    assert (block_IsWritable (block));
+
+    block_t *shared = block_Share (block);
+    assert (shared != NULL);
+    assert (shared->p_buffer == block->p_buffer);
+    assert (shared->i_buffer == block->i_buffer);
+    assert (shared->i_pts == block->i_pts);
+    assert (!block_IsWritable (block));
+    assert (!block_IsWritable (shared));
+
+    /* Sharing a shared block */
+    block_t *shared2 = block_Share (shared);
+    assert (shared2 != NULL);
+    assert (shared2->p_buffer == block->p_buffer);
+
+    /* Writing to a shared block copies it */
+    shared2 = block_MakeWritable (shared2);
+    assert (shared2 != NULL);
+    assert (shared2->p_buffer != block->p_buffer);
+    assert (shared2->i_pts == block->i_pts);
+    assert (!memcmp (shared2->p_buffer, text, sizeof (text)));
+    memset (shared2->p_buffer, 'A', shared2->i_buffer);
+    block_Release (shared2);
+    assert (!memcmp (block->p_buffer, text, sizeof (text)));
+
+    /* Growing a shared block copies it too */
+    shared = block_Realloc (shared, 4, shared->i_buffer);
+    assert (shared != NULL);
+    assert (shared->p_buffer + 4 != block->p_buffer);
+    assert (!memcmp (shared->p_buffer + 4, text, sizeof (text)));
+    memset (shared->p_buffer, 'B', 4);
+    assert (block_IsWritable (block));
+    assert (block_IsWritable (shared));
+    block_Release (shared);
+
+    /* The last shared block keeps the payload alive */
+    shared = block_Share (block);
+    assert (shared != NULL);
+    block_Release (block);
+    assert (block_IsWritable (shared));
+    shared = block_MakeWritable (shared);
+    assert (shared != NULL);
+    assert (!memcmp (shared->p_buffer, text, sizeof (text)));
+
+    /* Shrinking does not copy */
+    block = block_Share (shared);
+    assert (block != NULL);
+    block = block_Realloc (block, -5, sizeof (text) - 5);
+    assert (block != NULL);
+    assert (block->p_buffer == shared->p_buffer + 5);
+    assert (block->i_buffer == sizeof (text) - 10);
+    block_Release (shared);
+    block_Release (block);
+
+    /* Custom blocks are freed with their own callbacks, once */
+    void *heap = malloc (sizeof (text));
+    assert (heap != NULL);
+    block = block_heap_Alloc (heap, sizeof (text));
+    assert (block != NULL);
+    shared = block_Share (block);
+    assert (shared != NULL);
+    assert (shared->p_buffer == heap);
+    block_Release (block);
+    block_Release (shared);
+}
+
+#define CACHE_BLOCKS 4096
+
+static void *test_block_CacheThread (void *data)
+{
+    block_t **blocks = data;
+
+    /* Release blocks allocated by another thread */
+    for (unsigned i = 0; i < CACHE_BLOCKS; i++)
+    {
+        block_t *block = blocks[i];
+
+        for (size_t j = 0; j < block->i_buffer; j++)
+            assert (block->p_buffer[j] == (unsigned char)i);
+        block_Release (block);
+    }
+    return NULL;
+}
+
+static void test_block_Cache (void)
+{
+    static block_t *blocks[CACHE_BLOCKS];
+
+    for (unsigned round = 0; round < 4; round++)
+    {
+        for (unsigned i = 0; i < CACHE_BLOCKS; i++)
+        {
+            size_t size = (i * 37) % 70000;
+            block_t *block = block_Alloc (size);
+
+            assert (block != NULL);
+            assert (block->i_buffer == size);
+            assert (((uintptr_t)block->p_buffer % 32) == 0);
+            assert (block->p_buffer >= block->p_start);
+            assert (block->p_buffer + size <= block->p_start + block->i_size);
+            memset (block->p_start, 0xA5, block->i_size);
+            memset (block->p_buffer, i, size);
+            blocks[i] = block;
+        }
+
+        vlc_thread_t th;
+
+        assert (!vlc_clone (&th, test_block_CacheThread, blocks,
+                            VLC_THREAD_PRIORITY_LOW));
+        vlc_join (th, NULL);
+    }
+}
+
 int main (void)
 {
     test_block_File(false);
     test_block_File(true);
     test_block ();
+    test_block_Share ();
+    test_block_Cache ();
     return 0;
 }
 
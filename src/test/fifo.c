@@ -0,0 +1,190 @@
+/*****************************************************************************
+ * fifo.c: Test and benchmark for block FIFOs
+ *****************************************************************************
+ * Copyright (C) 2024 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+#ifdef HAVE_CONFIG_H
+# include "config.h"
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+#undef NDEBUG
+#include <assert.h>
+
+#include <vlc_common.h>
+#include <vlc_block.h>
+
+#define PACKET_SIZE 188 /* MPEG-TS packet, i.e. a typical high rate input */
+
+static block_t *packet(unsigned i)
+{
+    block_t *block = block_Alloc(PACKET_SIZE);
+    assert(block != NULL);
+    block->i_dts = i;
+    block->i_buffer = 1 + (i % PACKET_SIZE);
+    return block;
+}
+
+static size_t packet_size(unsigned i)
+{
+    return 1 + (i % PACKET_SIZE);
+}
+
+static void test_spsc_accounting(void)
+{
+    block_spsc_t *fifo = block_SpscNew();
+    assert(fifo != NULL);
+    assert(block_SpscGetCount(fifo) == 0);
+    assert(block_SpscGetBytes(fifo) == 0);
+    assert(block_SpscTryGet(fifo) == NULL);
+
+    block_SpscPut(fifo, NULL);
+    assert(block_SpscGetCount(fifo) == 0);
+
+    /* One list of three blocks, then a single block */
+    block_t *chain = packet(0);
+    chain->p_next = packet(1);
+    chain->p_next->p_next = packet(2);
+    block_SpscPut(fifo, chain);
+    block_SpscPut(fifo, packet(3));
+
+    size_t bytes = 0;
+    for (unsigned i = 0; i < 4; i++)
+        bytes += packet_size(i);
+    assert(block_SpscGetCount(fifo) == 4);
+    assert(block_SpscGetBytes(fifo) == bytes);
+
+    for (unsigned i = 0; i < 4; i++)
+    {
+        block_t *block = block_SpscTryGet(fifo);
+        assert(block != NULL);
+        assert(block->i_dts == (vlc_tick_t)i);
+        assert(block->p_next == NULL);
+        bytes -= block->i_buffer;
+        block_Release(block);
+        assert(block_SpscGetCount(fifo) == 3 - i);
+        assert(block_SpscGetBytes(fifo) == bytes);
+    }
+    assert(block_SpscTryGet(fifo) == NULL);
+
+    /* Recycled nodes, and blocks left over at destruction */
+    for (unsigned i = 0; i < 64; i++)
+    {
+        block_SpscPut(fifo, packet(i));
+        if (i & 1)
+            block_Release(block_SpscGet(fifo));
+    }
+    assert(block_SpscGetCount(fifo) == 32);
+    block_SpscRelease(fifo);
+}
+
+struct bench
+{
+    void *fifo;
+    unsigned count;
+};
+
+static void *consume_fifo(void *data)
+{
+    struct bench *b = data;
+
+    for (unsigned i = 0; i < b->count; i++)
+    {
+        block_t *block = block_FifoGet(b->fifo);
+        assert(block->i_dts == (vlc_tick_t)i);
+        assert(block->i_buffer == packet_size(i));
+        block_Release(block);
+    }
+    return NULL;
+}
+
+static void *consume_spsc(void *data)
+{
+    struct bench *b = data;
+
+    for (unsigned i = 0; i < b->count; i++)
+    {
+        block_t *block = block_SpscGet(b->fifo);
+        assert(block->i_dts == (vlc_tick_t)i);
+        assert(block->i_buffer == packet_size(i));
+        block_Release(block);
+    }
+    return NULL;
+}
+
+static vlc_tick_t bench_fifo(unsigned count)
+{
+    struct bench b = { block_FifoNew(), count };
+    vlc_thread_t th;
+
+    assert(b.fifo != NULL);
+
+    vlc_tick_t start = vlc_tick_now();
+    assert(!vlc_clone(&th, consume_fifo, &b, VLC_THREAD_PRIORITY_LOW));
+    for (unsigned i = 0; i < count; i++)
+        block_FifoPut(b.fifo, packet(i));
+    vlc_join(th, NULL);
+    start = vlc_tick_now() - start;
+
+    vlc_fifo_Lock(b.fifo);
+    assert(vlc_fifo_IsEmpty(b.fifo));
+    vlc_fifo_Unlock(b.fifo);
+    block_FifoRelease(b.fifo);
+    return start;
+}
+
+static vlc_tick_t bench_spsc(unsigned count)
+{
+    struct bench b = { block_SpscNew(), count };
+    vlc_thread_t th;
+
+    assert(b.fifo != NULL);
+
+    vlc_tick_t start = vlc_tick_now();
+    assert(!vlc_clone(&th, consume_spsc, &b, VLC_THREAD_PRIORITY_LOW));
+    for (unsigned i = 0; i < count; i++)
+        block_SpscPut(b.fifo, packet(i));
+    vlc_join(th, NULL);
+    start = vlc_tick_now() - start;
+
+    assert(block_SpscGetCount(b.fifo) == 0);
+    assert(block_SpscGetBytes(b.fifo) == 0);
+    block_SpscRelease(b.fifo);
+    return start;
+}
+
+static void report(const char *name, unsigned count, vlc_tick_t duration)
+{
+    double secs = secf_from_vlc_tick(duration);
+
+    printf("%-10s %u packets in %.3f s: %.2f Mpackets/s\n", name, count,
+           secs, (count / 1e6) / secs);
+}
+
+int main(int argc, char *argv[])
+{
+    /* Keep "make check" short; pass a larger count for benchmarking */
+    unsigned count = (argc > 1) ? strtoul(argv[1], NULL, 0) : 100000;
+
+    test_spsc_accounting();
+
+    report("block_fifo", count, bench_fifo(count));
+    report("spsc", count, bench_spsc(count));
+    return 0;
+}
@@ -216,10 +216,23 @@ void vout_GetResetStatistic(vout_thread_t *vout, unsigned *restrict displayed,
 
 bool vout_IsEmpty(vout_thread_t *vout)
 {
-    picture_t *picture = picture_fifo_Peek(vout->p->decoder_fifo);
+    vout_thread_sys_t *sys = vout->p;
+
+    picture_t *picture = picture_fifo_Peek(sys->decoder_fifo);
     if (picture)
         picture_Release(picture);
 
+    if (!picture && sys->pipeline.depth > 0) {
+        vlc_mutex_lock(&sys->pipeline.lock);
+        bool is_empty = sys->pipeline.count == 0 &&
+                        sys->pipeline.reformat == NULL && !sys->pipeline.busy;
+        vlc_mutex_unlock(&sys->pipeline.lock);
+
+        picture = picture_fifo_Peek(sys->pipeline.requeued);
+        if (picture)
+            picture_Release(picture);
+        return is_empty && !picture;
+    }
     return !picture;
 }
 
@@ -316,9 +329,16 @@ picture_t *vout_GetPicture(vout_thread_t *vout)
  */
 void vout_PutPicture(vout_thread_t *vout, picture_t *picture)
 {
+    vout_thread_sys_t *sys = vout->p;
+
     picture->p_next = NULL;
-    picture_fifo_Push(vout->p->decoder_fifo, picture);
-    vout_control_Wake(&vout->p->control);
+    picture_fifo_Push(sys->decoder_fifo, picture);
+    if (sys->pipeline.depth > 0) {
+        vlc_mutex_lock(&sys->pipeline.lock);
+        vlc_cond_signal(&sys->pipeline.wait);
+        vlc_mutex_unlock(&sys->pipeline.lock);
+    }
+    vout_control_Wake(&sys->control);
 }
 
 /* */
@@ -669,6 +689,66 @@ static picture_t *VoutVideoFilterStaticNewPicture(filter_t *filter)
     return picture_NewFromFormat(&filter->fmt_out.video);
 }
 
+/* A picture filtered ahead by the pipeline thread */
+typedef struct vout_prepared {
+    struct vout_prepared *next;
+    picture_t *decoded;  /* NULL for the extra outputs of chain_static */
+    picture_t *picture;  /* chain_static output */
+    picture_t *filtered; /* chain_interactive output, or NULL */
+} vout_prepared_t;
+
+static void ThreadPipelineFlush(vout_thread_t *vout)
+{
+    vout_thread_sys_t *sys = vout->p;
+
+    vlc_mutex_assert(&sys->filter.lock);
+    if (sys->pipeline.depth == 0)
+        return;
+
+    vlc_mutex_lock(&sys->pipeline.lock);
+
+    /* The decoded pictures taken by the pipeline thread but not displayed
+     * yet go back, in order, ahead of the ones still to be filtered. They
+     * are filtered again once the vout thread has taken its first picture,
+     * so that the reused picture goes through the chains first. */
+    picture_t *pending = NULL, **pending_last = &pending, *picture;
+    while ((picture = picture_fifo_Pop(sys->pipeline.requeued)) != NULL) {
+        *pending_last = picture;
+        pending_last = &picture->p_next;
+    }
+
+    vout_prepared_t *prepared = sys->pipeline.first;
+    while (prepared != NULL) {
+        vout_prepared_t *next = prepared->next;
+
+        if (prepared->decoded)
+            picture_fifo_Push(sys->pipeline.requeued, prepared->decoded);
+        picture_Release(prepared->picture);
+        if (prepared->filtered)
+            picture_Release(prepared->filtered);
+        free(prepared);
+        prepared = next;
+    }
+    sys->pipeline.first    = NULL;
+    sys->pipeline.last_ptr = &sys->pipeline.first;
+    sys->pipeline.count    = 0;
+
+    if (sys->pipeline.reformat) {
+        picture_fifo_Push(sys->pipeline.requeued, sys->pipeline.reformat);
+        sys->pipeline.reformat = NULL;
+    }
+
+    while (pending != NULL) {
+        picture = pending;
+        pending = picture->p_next;
+        picture->p_next = NULL;
+        picture_fifo_Push(sys->pipeline.requeued, picture);
+    }
+
+    sys->pipeline.held = true;
+    vlc_mutex_unlock(&sys->pipeline.lock);
+}
+
 static void ThreadFilterFlush(vout_thread_t *vout, bool is_locked)
 {
     if (vout->p->displayed.current)
@@ -679,8 +759,17 @@ static void ThreadFilterFlush(vout_thread_t *vout, bool is_locked)
         picture_Release( vout->p->displayed.next );
     vout->p->displayed.next = NULL;
 
+    if (vout->p->displayed.current_filtered)
+        picture_Release( vout->p->displayed.current_filtered );
+    vout->p->displayed.current_filtered = NULL;
+
+    if (vout->p->displayed.next_filtered)
+        picture_Release( vout->p->displayed.next_filtered );
+    vout->p->displayed.next_filtered = NULL;
+
     if (!is_locked)
         vlc_mutex_lock(&vout->p->filter.lock);
+    ThreadPipelineFlush(vout);
     filter_chain_VideoFlush(vout->p->filter.chain_static);
     filter_chain_VideoFlush(vout->p->filter.chain_interactive);
     if (!is_locked)
@@ -814,9 +903,290 @@ static void ThreadChangeFilters(vout_thread_t *vout,
 }
 
 
+static bool ThreadIsPictureLate(vout_thread_t *vout, const picture_t *decoded)
+{
+    if (decoded->b_force)
+        return false;
+
+    vlc_tick_t late_threshold;
+    if (decoded->format.i_frame_rate && decoded->format.i_frame_rate_base)
+        late_threshold = VLC_TICK_FROM_MS(500) * decoded->format.i_frame_rate_base / decoded->format.i_frame_rate;
+    else
+        late_threshold = VOUT_DISPLAY_LATE_THRESHOLD;
+    const vlc_tick_t predicted = vlc_tick_now() + 0; /* TODO improve */
+    const vlc_tick_t late = predicted - decoded->date;
+    if (late > late_threshold) {
+        msg_Warn(vout, "picture is too late to be displayed (missing %"PRId64" ms)", MS_FROM_VLC_TICK(late));
+        return true;
+    } else if (late > 0) {
+        msg_Dbg(vout, "picture might be displayed late (missing %"PRId64" ms)", MS_FROM_VLC_TICK(late));
+    }
+    return false;
+}
+
+static void ThreadSetDecoded(vout_thread_t *vout, picture_t *decoded)
+{
+    if (vout->p->displayed.decoded)
+        picture_Release(vout->p->displayed.decoded);
+
+    vout->p->displayed.decoded       = decoded;
+    vout->p->displayed.timestamp     = decoded->date;
+    vout->p->displayed.is_interlaced = !decoded->b_progressive;
+}
+
+/*****************************************************************************
+ * Pipeline: filters the next pictures while the current one is displayed
+ *****************************************************************************
+ * The pipeline thread takes the decoded pictures and runs both filter chains
+ * on them, up to "video-filter-ahead" pictures in advance. The vout thread
+ * then only renders the subpictures and displays. Everything that depends on
+ * the vout thread state (late picture dropping, filters rebuilding on format
+ * changes, reuse of the last decoded picture) stays in the vout thread.
+ *****************************************************************************/
+static bool ThreadPipelineHasInput(vout_thread_t *vout)
+{
+    vout_thread_sys_t *sys = vout->p;
+
+    picture_t *picture = picture_fifo_Peek(sys->pipeline.requeued);
+    if (!picture)
+        picture = picture_fifo_Peek(sys->decoder_fifo);
+    if (!picture)
+        return false;
+    picture_Release(picture);
+    return true;
+}
+
+static void ThreadPipelineFilter(vout_thread_t *vout)
+{
+    vout_thread_sys_t *sys = vout->p;
+    picture_t *decoded, *picture;
+
+    vlc_mutex_assert(&sys->filter.lock);
+
+    /* The extra outputs of the picture reused by the vout thread, such as
+     * its second field, go before the next picture */
+    decoded = NULL;
+    picture = filter_chain_VideoFilter(sys->filter.chain_static, NULL);
+
+    while (!picture) {
+        decoded = picture_fifo_Pop(sys->pipeline.requeued);
+        if (!decoded)
+            decoded = picture_fifo_Pop(sys->decoder_fifo);
+        if (!decoded)
+            return;
+
+        if (!VideoFormatIsCropArEqual(&decoded->format, &sys->filter.format)) {
+            /* The vout thread rebuilds the filters once it has displayed
+             * the pictures filtered with the current ones */
+            vlc_mutex_lock(&sys->pipeline.lock);
+            sys->pipeline.reformat = decoded;
+            vlc_mutex_unlock(&sys->pipeline.lock);
+            return;
+        }
+
+        picture = filter_chain_VideoFilter(sys->filter.chain_static,
+                                           picture_Hold(decoded));
+        if (!picture)
+            picture_Release(decoded);
+    }
+
+    vout_prepared_t *first = NULL, **last_ptr = &first;
+    unsigned count = 0;
+
+    while (picture) {
+        vout_prepared_t *prepared = malloc(sizeof(*prepared));
+        if (unlikely(prepared == NULL)) {
+            picture_Release(picture);
+            break;
+        }
+        prepared->next     = NULL;
+        prepared->decoded  = decoded;
+        prepared->picture  = picture;
+        prepared->filtered = filter_chain_VideoFilter(sys->filter.chain_interactive,
+                                                      picture_Hold(picture));
+        decoded = NULL;
+
+        *last_ptr = prepared;
+        last_ptr  = &prepared->next;
+        count++;
+
+        picture = filter_chain_VideoFilter(sys->filter.chain_static, NULL);
+    }
+    if (decoded)
+        picture_Release(decoded);
+
+    if (first != NULL) {
+        vlc_mutex_lock(&sys->pipeline.lock);
+        *sys->pipeline.last_ptr = first;
+        sys->pipeline.last_ptr  = last_ptr;
+        sys->pipeline.count    += count;
+        vlc_mutex_unlock(&sys->pipeline.lock);
+    }
+}
+
+static void *ThreadPipeline(void *object)
+{
+    vout_thread_t *vout = object;
+    vout_thread_sys_t *sys = vout->p;
+
+    vlc_mutex_lock(&sys->pipeline.lock);
+    for (;;) {
+        while (!sys->pipeline.dead &&
+               (sys->pipeline.held || sys->pipeline.reformat != NULL ||
+                sys->pipeline.count >= sys->pipeline.depth ||
+                !ThreadPipelineHasInput(vout)))
+            vlc_cond_wait(&sys->pipeline.wait, &sys->pipeline.lock);
+        if (sys->pipeline.dead)
+            break;
+        sys->pipeline.busy = true;
+        vlc_mutex_unlock(&sys->pipeline.lock);
+
+        vlc_mutex_lock(&sys->filter.lock);
+        /* A flush may have happened meanwhile */
+        vlc_mutex_lock(&sys->pipeline.lock);
+        const bool is_held = sys->pipeline.held || sys->pipeline.dead;
+        vlc_mutex_unlock(&sys->pipeline.lock);
+        if (!is_held)
+            ThreadPipelineFilter(vout);
+        vlc_mutex_unlock(&sys->filter.lock);
+
+        vlc_mutex_lock(&sys->pipeline.lock);
+        sys->pipeline.busy = false;
+        vlc_cond_signal(&sys->pipeline.wait_ready);
+        vout_control_Wake(&sys->control);
+    }
+    vlc_mutex_unlock(&sys->pipeline.lock);
+    return NULL;
+}
+
+static void ThreadPipelineOffsetDate(vout_thread_t *vout, vlc_tick_t duration)
+{
+    vout_thread_sys_t *sys = vout->p;
+
+    if (sys->pipeline.depth == 0)
+        return;
+
+    vlc_mutex_lock(&sys->filter.lock);
+    vlc_mutex_lock(&sys->pipeline.lock);
+    picture_fifo_OffsetDate(sys->pipeline.requeued, duration);
+    for (vout_prepared_t *prepared = sys->pipeline.first;
+         prepared != NULL; prepared = prepared->next)
+        if (prepared->decoded)
+            prepared->decoded->date += duration;
+    if (sys->pipeline.reformat)
+        sys->pipeline.reformat->date += duration;
+    vlc_mutex_unlock(&sys->pipeline.lock);
+    vlc_mutex_unlock(&sys->filter.lock);
+}
+
+static int ThreadPipelinePreparePicture(vout_thread_t *vout, bool reuse, bool frame_by_frame)
+{
+    vout_thread_sys_t *sys = vout->p;
+    bool is_late_dropped = sys->is_late_dropped && !sys->pause.is_on && !frame_by_frame;
+    picture_t *picture = NULL;
+    picture_t *filtered = NULL;
+
+    if (reuse && sys->displayed.decoded) {
+        /* As without the pipeline, the outputs still pending in the static
+         * chain go before the reused picture */
+        vlc_mutex_lock(&sys->filter.lock);
+        picture = filter_chain_VideoFilter(sys->filter.chain_static, NULL);
+        if (!picture)
+            picture = filter_chain_VideoFilter(sys->filter.chain_static,
+                                               picture_Hold(sys->displayed.decoded));
+        vlc_mutex_unlock(&sys->filter.lock);
+        sys->pipeline.dropping = false;
+    }
+
+    vlc_mutex_lock(&sys->pipeline.lock);
+    if (sys->pipeline.held) {
+        sys->pipeline.held = false;
+        vlc_cond_signal(&sys->pipeline.wait);
+    }
+
+    while (!picture) {
+        while (sys->pipeline.count == 0 && sys->pipeline.reformat == NULL &&
+               (sys->pipeline.busy || ThreadPipelineHasInput(vout)))
+            vlc_cond_wait(&sys->pipeline.wait_ready, &sys->pipeline.lock);
+
+        vout_prepared_t *prepared = sys->pipeline.first;
+        if (prepared == NULL) {
+            picture_t *decoded = sys->pipeline.reformat;
+            if (decoded == NULL)
+                break;
+
+            /* Rebuild the filters for the new format, as without the
+             * pipeline, while the pipeline thread is held */
+            sys->pipeline.reformat = NULL;
+            sys->pipeline.held = true;
+            vlc_mutex_unlock(&sys->pipeline.lock);
+
+            vlc_mutex_lock(&sys->filter.lock);
+            ThreadChangeFilters(vout, &decoded->format, sys->filter.configuration, -1, true);
+            picture = filter_chain_VideoFilter(sys->filter.chain_static,
+                                               picture_Hold(decoded));
+            vlc_mutex_unlock(&sys->filter.lock);
+            ThreadSetDecoded(vout, decoded);
+            sys->pipeline.dropping = false;
+
+            vlc_mutex_lock(&sys->pipeline.lock);
+            sys->pipeline.held = false;
+            vlc_cond_signal(&sys->pipeline.wait);
+            continue;
+        }
+
+        sys->pipeline.first = prepared->next;
+        if (sys->pipeline.first == NULL)
+            sys->pipeline.last_ptr = &sys->pipeline.first;
+        sys->pipeline.count--;
+        vlc_cond_signal(&sys->pipeline.wait);
+        vlc_mutex_unlock(&sys->pipeline.lock);
+
+        /* The extra outputs of a dropped picture are dropped with it */
+        if (prepared->decoded) {
+            sys->pipeline.dropping = is_late_dropped &&
+                                     ThreadIsPictureLate(vout, prepared->decoded);
+            if (sys->pipeline.dropping) {
+                picture_Release(prepared->decoded);
+                vout_statistic_AddLost(&sys->statistic, 1);
+            } else
+                ThreadSetDecoded(vout, prepared->decoded);
+        }
+
+        if (sys->pipeline.dropping) {
+            picture_Release(prepared->picture);
+            if (prepared->filtered)
+                picture_Release(prepared->filtered);
+        } else {
+            picture  = prepared->picture;
+            filtered = prepared->filtered;
+        }
+        free(prepared);
+
+        vlc_mutex_lock(&sys->pipeline.lock);
+    }
+    vlc_mutex_unlock(&sys->pipeline.lock);
+
+    if (!picture)
+        return VLC_EGENERIC;
+
+    assert(!sys->displayed.next);
+    if (!sys->displayed.current) {
+        sys->displayed.current          = picture;
+        sys->displayed.current_filtered = filtered;
+    } else {
+        sys->displayed.next             = picture;
+        sys->displayed.next_filtered    = filtered;
+    }
+    return VLC_SUCCESS;
+}
+
 /* */
 static int ThreadDisplayPreparePicture(vout_thread_t *vout, bool reuse, bool frame_by_frame)
 {
+    if (vout->p->pipeline.depth > 0)
+        return ThreadPipelinePreparePicture(vout, reuse, frame_by_frame);
+
     bool is_late_dropped = vout->p->is_late_dropped && !vout->p->pause.is_on && !frame_by_frame;
 
     vlc_mutex_lock(&vout->p->filter.lock);
@@ -831,22 +1201,10 @@ static int ThreadDisplayPreparePicture(vout_thread_t *vout, bool reuse, bool fra
         } else {
             decoded = picture_fifo_Pop(vout->p->decoder_fifo);
             if (decoded) {
-                if (is_late_dropped && !decoded->b_force) {
-                    vlc_tick_t late_threshold;
-                    if (decoded->format.i_frame_rate && decoded->format.i_frame_rate_base)
-                        late_threshold = VLC_TICK_FROM_MS(500) * decoded->format.i_frame_rate_base / decoded->format.i_frame_rate;
-                    else
-                        late_threshold = VOUT_DISPLAY_LATE_THRESHOLD;
-                    const vlc_tick_t predicted = vlc_tick_now() + 0; /* TODO improve */
-                    const vlc_tick_t late = predicted - decoded->date;
-                    if (late > late_threshold) {
-                        msg_Warn(vout, "picture is too late to be displayed (missing %"PRId64" ms)", MS_FROM_VLC_TICK(late));
-                        picture_Release(decoded);
-                        vout_statistic_AddLost(&vout->p->statistic, 1);
-                        continue;
-                    } else if (late > 0) {
-                        msg_Dbg(vout, "picture might be displayed late (missing %"PRId64" ms)", MS_FROM_VLC_TICK(late));
-                    }
+                if (is_late_dropped && ThreadIsPictureLate(vout, decoded)) {
+                    picture_Release(decoded);
+                    vout_statistic_AddLost(&vout->p->statistic, 1);
+                    continue;
                 }
                 if (!VideoFormatIsCropArEqual(&decoded->format, &vout->p->filter.format))
                     ThreadChangeFilters(vout, &decoded->format, vout->p->filter.configuration, -1, true);
@@ -857,12 +1215,7 @@ static int ThreadDisplayPreparePicture(vout_thread_t *vout, bool reuse, bool fra
             break;
         reuse = false;
 
-        if (vout->p->displayed.decoded)
-            picture_Release(vout->p->displayed.decoded);
-
-        vout->p->displayed.decoded       = picture_Hold(decoded);
-        vout->p->displayed.timestamp     = decoded->date;
-        vout->p->displayed.is_interlaced = !decoded->b_progressive;
+        ThreadSetDecoded(vout, picture_Hold(decoded));
 
         picture = filter_chain_VideoFilter(vout->p->filter.chain_static, decoded);
     }
@@ -940,13 +1293,23 @@ static int ThreadDisplayRenderPicture(vout_thread_t *vout, bool is_forced)
     vout_thread_sys_t *sys = vout->p;
     vout_display_t *vd = sys->display;
 
-    picture_t *torender = picture_Hold(sys->displayed.current);
-
     vout_chrono_Start(&sys->render);
 
-    vlc_mutex_lock(&sys->filter.lock);
-    picture_t *filtered = filter_chain_VideoFilter(sys->filter.chain_interactive, torender);
-    vlc_mutex_unlock(&sys->filter.lock);
+    picture_t *filtered = sys->displayed.current_filtered;
+    if (filtered != NULL) {
+        /* Filtered ahead. While paused, the refreshes filter the picture
+         * again to show the changes of the interactive filters. */
+        if (sys->pause.is_on)
+            sys->displayed.current_filtered = NULL;
+        else
+            picture_Hold(filtered);
+    } else {
+        picture_t *torender = picture_Hold(sys->displayed.current);
+
+        vlc_mutex_lock(&sys->filter.lock);
+        filtered = filter_chain_VideoFilter(sys->filter.chain_interactive, torender);
+        vlc_mutex_unlock(&sys->filter.lock);
+    }
 
     if (!filtered)
         return VLC_EGENERIC;
@@ -1180,6 +1543,11 @@ static int ThreadDisplayPicture(vout_thread_t *vout, vlc_tick_t *deadline)
         picture_Release(sys->displayed.current);
         sys->displayed.current = sys->displayed.next;
         sys->displayed.next    = NULL;
+
+        if (sys->displayed.current_filtered)
+            picture_Release(sys->displayed.current_filtered);
+        sys->displayed.current_filtered = sys->displayed.next_filtered;
+        sys->displayed.next_filtered    = NULL;
     }
 
     if (!sys->displayed.current)
@@ -1206,6 +1574,7 @@ void vout_ChangePause(vout_thread_t *vout, bool is_paused, vlc_tick_t date)
         picture_fifo_OffsetDate(vout->p->decoder_fifo, duration);
         if (vout->p->displayed.decoded)
             vout->p->displayed.decoded->date += duration;
+        ThreadPipelineOffsetDate(vout, duration);
         spu_OffsetSubtitleDate(vout->p->spu, duration);
 
         ThreadFilterFlush(vout, false);
@@ -1244,6 +1613,8 @@ static void vout_FlushUnlocked(vout_thread_t *vout, bool below,
     }
 
     picture_fifo_Flush(vout->p->decoder_fifo, date, below);
+    if (vout->p->pipeline.depth > 0)
+        picture_fifo_Flush(vout->p->pipeline.requeued, date, below);
     vout_FilterFlush(vout->p->display);
 }
 
@@ -1337,6 +1708,11 @@ static int vout_Start(vout_thread_t *vout, const vout_configuration_t *cfg)
     sys->dpb_size = cfg->dpb_size;
     sys->decoder_fifo = picture_fifo_New();
     sys->decoder_pool = NULL;
+    /* A previous start may have run without the pipeline thread */
+    sys->pipeline.depth = sys->pipeline.ahead;
+    sys->pipeline.requeued = NULL;
+    if (sys->pipeline.depth > 0)
+        sys->pipeline.requeued = picture_fifo_New();
     sys->display_pool = NULL;
     sys->private_pool = NULL;
 
@@ -1413,6 +1789,8 @@ static int vout_Start(vout_thread_t *vout, const vout_configuration_t *cfg)
 
     sys->displayed.current       = NULL;
     sys->displayed.next          = NULL;
+    sys->displayed.current_filtered = NULL;
+    sys->displayed.next_filtered = NULL;
     sys->displayed.decoded       = NULL;
     sys->displayed.date          = VLC_TICK_INVALID;
     sys->displayed.timestamp     = VLC_TICK_INVALID;
@@ -1427,6 +1805,28 @@ static int vout_Start(vout_thread_t *vout, const vout_configuration_t *cfg)
     sys->spu_blend_chroma        = 0;
     sys->spu_blend               = NULL;
 
+    if (sys->pipeline.depth > 0) {
+        sys->pipeline.first    = NULL;
+        sys->pipeline.last_ptr = &sys->pipeline.first;
+        sys->pipeline.count    = 0;
+        sys->pipeline.reformat = NULL;
+        sys->pipeline.busy     = false;
+        sys->pipeline.held     = false;
+        sys->pipeline.dead     = false;
+        sys->pipeline.dropping = false;
+
+        if (sys->pipeline.requeued == NULL ||
+            vlc_clone(&sys->pipeline.thread, ThreadPipeline, vout,
+                      VLC_THREAD_PRIORITY_VIDEO)) {
+            msg_Warn(vout, "cannot filter pictures ahead, "
+                     "filtering before the display this time");
+            if (sys->pipeline.requeued != NULL)
+                picture_fifo_Delete(sys->pipeline.requeued);
+            sys->pipeline.requeued = NULL;
+            sys->pipeline.depth = 0;
+        }
+    }
+
     video_format_Print(VLC_OBJECT(vout), "original format", &sys->original);
     return VLC_SUCCESS;
 error:
@@ -1440,11 +1840,28 @@ error:
     video_format_Clean(&sys->filter.format);
     if (sys->decoder_fifo != NULL)
         picture_fifo_Delete(sys->decoder_fifo);
+    if (sys->pipeline.requeued != NULL)
+        picture_fifo_Delete(sys->pipeline.requeued);
     return VLC_EGENERIC;
 }
 
 static void ThreadStop(vout_thread_t *vout)
 {
+    vout_thread_sys_t *sys = vout->p;
+
+    if (sys->pipeline.depth > 0) {
+        vlc_mutex_lock(&sys->pipeline.lock);
+        sys->pipeline.dead = true;
+        vlc_cond_signal(&sys->pipeline.wait);
+        vlc_mutex_unlock(&sys->pipeline.lock);
+        vlc_join(sys->pipeline.thread, NULL);
+
+        /* Release the pictures of the private pool */
+        vlc_mutex_lock(&sys->filter.lock);
+        ThreadPipelineFlush(vout);
+        vlc_mutex_unlock(&sys->filter.lock);
+    }
+
     if (vout->p->spu_blend)
         filter_DeleteBlend(vout->p->spu_blend);
 
@@ -1464,6 +1881,8 @@ static void ThreadStop(vout_thread_t *vout)
 
     if (vout->p->decoder_fifo)
         picture_fifo_Delete(vout->p->decoder_fifo);
+    if (sys->pipeline.requeued)
+        picture_fifo_Delete(sys->pipeline.requeued);
     assert(!vout->p->decoder_pool);
 
     if (vout->p->mouse_event)
@@ -1629,6 +2048,9 @@ static void VoutDestructor(vlc_object_t *object)
     vlc_mutex_destroy(&vout->p->window_lock);
     vlc_mutex_destroy(&vout->p->spu_lock);
     vlc_mutex_destroy(&vout->p->filter.lock);
+    vlc_cond_destroy(&vout->p->pipeline.wait_ready);
+    vlc_cond_destroy(&vout->p->pipeline.wait);
+    vlc_mutex_destroy(&vout->p->pipeline.lock);
     vout_control_Clean(&vout->p->control);
 
     /* */
@@ -1695,6 +2117,13 @@ static vout_thread_t *VoutCreate(vlc_object_t *object,
 
     vlc_mutex_init(&sys->filter.lock);
 
+    sys->pipeline.ahead = VLC_CLIP(var_InheritInteger(vout, "video-filter-ahead"),
+                                   0, VOUT_MAX_FILTER_AHEAD);
+    sys->pipeline.depth = sys->pipeline.ahead;
+    vlc_mutex_init(&sys->pipeline.lock);
+    vlc_cond_init(&sys->pipeline.wait);
+    vlc_cond_init(&sys->pipeline.wait_ready);
+
     /* Window */
     sys->display_cfg.window = vout_display_window_New(vout);
     if (sys->splitter_name != NULL)
@@ -39,6 +39,9 @@
  */
 #define VOUT_MAX_PICTURES (20)
 
+/* Maximum number of pictures filtered ahead of the display */
+#define VOUT_MAX_FILTER_AHEAD (8)
+
 /**
  * Vout configuration
  */
@@ -120,6 +123,9 @@ struct vout_thread_sys_t
         picture_t   *decoded;
         picture_t   *current;
         picture_t   *next;
+        /* chain_interactive output of current and next, if filtered ahead */
+        picture_t   *current_filtered;
+        picture_t   *next_filtered;
     } displayed;
 
     struct {
@@ -157,6 +163,25 @@ struct vout_thread_sys_t
         bool            has_deint;
     } filter;
 
+    /* Filtering ahead of the display, in its own thread (0 if disabled) */
+    struct {
+        unsigned        ahead;      /* configured depth */
+        unsigned        depth;      /* depth of the current start */
+        vlc_thread_t    thread;
+        vlc_mutex_t     lock;
+        vlc_cond_t      wait;       /* worker: input or room available */
+        vlc_cond_t      wait_ready; /* vout thread: a picture is ready */
+        struct vout_prepared *first;
+        struct vout_prepared **last_ptr;
+        unsigned        count;
+        picture_fifo_t  *requeued;  /* flushed, but not yet displayed */
+        picture_t       *reformat;  /* needs new filters from the vout */
+        bool            busy;
+        bool            held;
+        bool            dead;
+        bool            dropping;   /* vout thread only */
+    } pipeline;
+
     /* */
     vlc_mouse_t     mouse;
     vlc_mouse_event mouse_event;
@@ -94,7 +94,10 @@ int vout_OpenWrapper(vout_thread_t *vout,
 
     const bool use_dr = !vout_IsDisplayFiltered(vd);
     const bool allow_dr = !vd->info.has_pictures_invalid && !vd->info.is_slow && use_dr;
-    const unsigned private_picture  = 4; /* XXX 3 for filter, 1 for SPU */
+    /* XXX 3 for filter, 1 for SPU, and when filtering ahead, the queued
+     * pictures, an extra output of chain_static, the current and next ones */
+    const unsigned private_picture  = 4 + (sys->pipeline.depth > 0 ?
+                                           sys->pipeline.depth + 3 : 0);
     const unsigned decoder_picture  = 1 + sys->dpb_size;
     const unsigned kept_picture     = 1; /* last displayed picture */
     const unsigned reserved_picture = DISPLAY_PICTURE_COUNT +
@@ -0,0 +1,319 @@
+/*****************************************************************************
+ * equalizer.c: equalizers consistency and benchmark
+ *****************************************************************************
+ * Copyright (C) 2024 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+/*
+ * Usage: test_modules_audio_filter_equalizer [seconds]
+ *
+ * Plays the same signal on every channel through the "equalizer", in one and
+ * two pass modes, and the "param_eq" filters, and prints how many times faster
+ * than real time each one runs. The channels are filtered in groups, one per
+ * vector lane: all of them must come out identical, whatever their number and
+ * however the signal is split into blocks, and match a scalar reference
+ * written from the filter definitions.
+ */
+
+#include "filter_helper.h"
+
+static const struct
+{
+    const char *name;
+    uint16_t    channels;
+} layouts[] = {
+    { "mono",   AOUT_CHAN_CENTER },
+    { "stereo", AOUT_CHANS_STEREO },
+    { "3.0",    AOUT_CHANS_3_0 },
+    { "5.1",    AOUT_CHANS_5_1 },
+    { "7.1",    AOUT_CHANS_7_1 },
+    { "8.1",    AOUT_CHANS_8_1 },
+};
+
+static const struct
+{
+    const char *name;
+    const char *module;
+    bool        two_pass;
+} filters[] = {
+    { "equalizer",        "equalizer", false },
+    { "equalizer 2 pass", "equalizer", true },
+    { "param_eq",         "param_eq",  false },
+};
+
+/* The settings of the filters, shared with the references */
+static const float eqz_bands[10] = { 8, 6, -4, 2, 0, -2, 4, -6, 3, -8 };
+#define EQZ_PREAMP (-6.f)
+#define PARAM_EQ_LOWGAIN (6.f)
+#define PARAM_EQ_GAIN2 (-9.f)
+#define PARAM_EQ_HIGHGAIN (3.f)
+
+static filter_t *Create( libvlc_int_t *vlc, unsigned f, unsigned l )
+{
+    char bands[10 * 8], *p = bands;
+    for( unsigned i = 0; i < ARRAY_SIZE(eqz_bands); i++ )
+        p += sprintf( p, "%s%g", i ? " " : "", eqz_bands[i] );
+
+    /* The equalizer settings belong to the audio output, the parent */
+    var_SetString( vlc, "equalizer-bands", bands );
+    var_SetBool( vlc, "equalizer-2pass", filters[f].two_pass );
+    var_SetFloat( vlc, "equalizer-preamp", EQZ_PREAMP );
+
+    filter_t *filter = FilterCreate( vlc, layouts[l].channels );
+
+    var_Create( filter, "param-eq-lowgain", VLC_VAR_FLOAT );
+    var_SetFloat( filter, "param-eq-lowgain", PARAM_EQ_LOWGAIN );
+    var_Create( filter, "param-eq-gain2", VLC_VAR_FLOAT );
+    var_SetFloat( filter, "param-eq-gain2", PARAM_EQ_GAIN2 );
+    var_Create( filter, "param-eq-highgain", VLC_VAR_FLOAT );
+    var_SetFloat( filter, "param-eq-highgain", PARAM_EQ_HIGHGAIN );
+
+    FilterStart( filter, filters[f].module );
+    return filter;
+}
+
+/* The 10 bands equalizer, on the VLC frequency bands of one octave: each band
+ * is a 2nd order IIR on the input, and the output is the input plus the bands
+ * weighted by their gains; the second pass filters that output again */
+static void EqzReference( float *buf, size_t length, bool two_pass )
+{
+    static const float freqs[10] = {
+        60, 170, 310, 600, 1000, 3000, 6000, 12000, 14000, 16000,
+    };
+    const float octave = sqrtf( 2.f );
+    float alpha[10], beta[10], gamma[10], amp[10];
+
+    for( unsigned j = 0; j < 10; j++ )
+    {
+        float theta_1 = 2.f * (float)M_PI * freqs[j] / RATE;
+        float theta_2 = theta_1 / octave;
+        float sin_prd = sinf( theta_2 * .5f * ( octave + 1.f ) )
+                      * sinf( theta_2 * .5f * ( octave - 1.f ) );
+        float sin_hlf = sinf( theta_2 ) * .5f;
+        float den = sin_hlf + sin_prd;
+
+        alpha[j] = sin_prd / den;
+        beta[j] = ( sin_hlf - sin_prd ) / den;
+        gamma[j] = 2.f * sin_hlf * cosf( theta_1 ) / den;
+        amp[j] = .25f * ( powf( 10.f, eqz_bands[j] / 20.f ) - 1.f );
+    }
+
+    const unsigned passes = two_pass ? 2 : 1;
+    float gain = powf( 10.f, EQZ_PREAMP / 20.f );
+    if( two_pass )
+        gain *= gain;
+
+    float x[2][2] = { { 0.f } }, y[2][10][2] = { { { 0.f } } };
+    for( size_t i = 0; i < length; i++ )
+    {
+        float in = buf[i], o = 0.f;
+
+        for( unsigned p = 0; p < passes; p++ )
+        {
+            if( p > 0 )
+                in = .25f * in + o;
+            o = 0.f;
+            for( unsigned j = 0; j < 10; j++ )
+            {
+                float v = alpha[j] * ( in - x[p][1] ) + gamma[j] * y[p][j][0]
+                        - beta[j] * y[p][j][1];
+                y[p][j][1] = y[p][j][0];
+                y[p][j][0] = v;
+                o += v * amp[j];
+            }
+            x[p][1] = x[p][0];
+            x[p][0] = in;
+        }
+        buf[i] = gain * ( .25f * in + o );
+    }
+}
+
+/* RBJ audio EQ cookbook biquads, normalized by a0 */
+static void Biquad( float *c, float b0, float b1, float b2,
+                    float a0, float a1, float a2 )
+{
+    c[0] = b0 / a0;
+    c[1] = b1 / a0;
+    c[2] = b2 / a0;
+    c[3] = a1 / a0;
+    c[4] = a2 / a0;
+}
+
+static void PeakCoeffs( float *c, float f0, float q, float gain )
+{
+    float a = powf( 10.f, gain / 40.f );
+    float w0 = 2.f * (float)M_PI * f0 / RATE;
+    float alpha = sinf( w0 ) / ( 2.f * q );
+
+    Biquad( c, 1.f + alpha * a, -2.f * cosf( w0 ), 1.f - alpha * a,
+               1.f + alpha / a, -2.f * cosf( w0 ), 1.f - alpha / a );
+}
+
+static void LowShelfCoeffs( float *c, float f0, float gain )
+{
+    /* With a slope of 1 */
+    float a = powf( 10.f, gain / 40.f );
+    float w0 = 2.f * (float)M_PI * f0 / RATE;
+    float alpha2 = 2.f * sqrtf( a ) * sinf( w0 ) / 2.f * sqrtf( 2.f );
+    float cw = cosf( w0 );
+
+    Biquad( c, a * ( ( a + 1.f ) - ( a - 1.f ) * cw + alpha2 ),
+               2.f * a * ( ( a - 1.f ) - ( a + 1.f ) * cw ),
+               a * ( ( a + 1.f ) - ( a - 1.f ) * cw - alpha2 ),
+               ( a + 1.f ) + ( a - 1.f ) * cw + alpha2,
+               -2.f * ( ( a - 1.f ) + ( a + 1.f ) * cw ),
+               ( a + 1.f ) + ( a - 1.f ) * cw - alpha2 );
+}
+
+/* The parametric equalizer, with its default frequencies and Q: 3 peaks and
+ * 2 shelves, cascaded. The filter sets up its high shelf as a low shelf. */
+static void ParamEqReference( float *buf, size_t length )
+{
+    float c[5][5], state[5][4] = { { 0.f } };
+
+    PeakCoeffs( c[0], 300.f, 3.f, 0.f );
+    PeakCoeffs( c[1], 1000.f, 3.f, PARAM_EQ_GAIN2 );
+    PeakCoeffs( c[2], 3000.f, 3.f, 0.f );
+    LowShelfCoeffs( c[3], 100.f, PARAM_EQ_LOWGAIN );
+    LowShelfCoeffs( c[4], 10000.f, PARAM_EQ_HIGHGAIN );
+
+    for( size_t i = 0; i < length; i++ )
+    {
+        float x = buf[i];
+
+        for( unsigned eq = 0; eq < 5; eq++ )
+        {
+            float y = x * c[eq][0] + state[eq][0] * c[eq][1]
+                    + state[eq][1] * c[eq][2] - state[eq][2] * c[eq][3]
+                    - state[eq][3] * c[eq][4];
+            state[eq][1] = state[eq][0];
+            state[eq][0] = x;
+            state[eq][3] = state[eq][2];
+            state[eq][2] = y;
+            x = y;
+        }
+        buf[i] = x;
+    }
+}
+
+/* Filters the signal, duplicated on every channel, in blocks of a given
+ * number of frames, or of varying sizes if 0 */
+static float *Run( filter_t *filter, const float *signal, size_t length,
+                   unsigned frames, vlc_tick_t *duration )
+{
+    const unsigned channels = aout_FormatNbChannels( &filter->fmt_in.audio );
+    float *out = malloc( length * channels * sizeof (float) );
+    assert( out != NULL );
+
+    vlc_tick_t total = 0;
+    for( size_t i = 0; i < length; )
+    {
+        size_t count = frames ? frames : 1 + (i * 7919) % 1500;
+        if( count > length - i )
+            count = length - i;
+
+        block_t *block = FilterBlockAlloc( filter, count, i );
+        float *p = (float *)block->p_buffer;
+        for( size_t j = 0; j < count; j++ )
+            for( unsigned c = 0; c < channels; c++ )
+                *(p++) = signal[i + j];
+
+        vlc_tick_t start = vlc_tick_now();
+        block = filter->pf_audio_filter( filter, block );
+        total += vlc_tick_now() - start;
+
+        assert( block != NULL );
+        assert( block->i_nb_samples == count );
+        memcpy( out + i * channels, block->p_buffer,
+                count * channels * sizeof (float) );
+        block_Release( block );
+        i += count;
+    }
+    *duration = total;
+    return out;
+}
+
+int main( int argc, char *argv[] )
+{
+    size_t length = (size_t)FilterTestSeconds( argc, argv ) * RATE;
+
+    test_init();
+
+    libvlc_instance_t *vlc = libvlc_new( test_defaults_nargs,
+                                         test_defaults_args );
+    assert( vlc != NULL );
+
+    libvlc_int_t *obj = vlc->p_libvlc_int;
+    var_Create( obj, "equalizer-bands", VLC_VAR_STRING );
+    var_Create( obj, "equalizer-2pass", VLC_VAR_BOOL );
+    var_Create( obj, "equalizer-preamp", VLC_VAR_FLOAT );
+
+    /* Tones across the bands, and some noise */
+    float *signal = malloc( length * sizeof (float) );
+    assert( signal != NULL );
+    for( size_t i = 0; i < length; i++ )
+        signal[i] = .2f * sinf( i * .0071f ) + .2f * sinf( i * .13f )
+                  + .1f * sinf( i * 1.3f )
+                  + .05f * ( rand() / (float)RAND_MAX - .5f );
+
+    float *expected = malloc( length * sizeof (float) );
+    assert( expected != NULL );
+
+    for( unsigned f = 0; f < ARRAY_SIZE(filters); f++ )
+    {
+        memcpy( expected, signal, length * sizeof (float) );
+        if( !strcmp( filters[f].module, "equalizer" ) )
+            EqzReference( expected, length, filters[f].two_pass );
+        else
+            ParamEqReference( expected, length );
+
+        printf( "%-16s", filters[f].name );
+        for( unsigned l = 0; l < ARRAY_SIZE(layouts); l++ )
+        {
+            filter_t *filter = Create( obj, f, l );
+            const unsigned channels =
+                aout_FormatNbChannels( &filter->fmt_in.audio );
+            vlc_tick_t duration, unused;
+            float *out = Run( filter, signal, length, FRAMES, &duration );
+            FilterDelete( filter );
+
+            filter = Create( obj, f, l );
+            float *ref = Run( filter, signal, length, 0, &unused );
+            FilterDelete( filter );
+
+            assert( !memcmp( out, ref, length * channels * sizeof (float) ) );
+            for( size_t i = 0; i < length; i++ )
+            {
+                assert( isfinite( out[i * channels] ) );
+                assert( fabsf( out[i * channels] - expected[i] ) < 1e-4f );
+                for( unsigned c = 1; c < channels; c++ )
+                    assert( out[i * channels + c] == out[i * channels] );
+            }
+            free( ref );
+            free( out );
+
+            printf( "  %s %6.1f", layouts[l].name,
+                    FilterSpeed( length, duration ) );
+        }
+        printf( " x real time\n" );
+    }
+
+    free( expected );
+    free( signal );
+    libvlc_release( vlc );
+    return 0;
+}
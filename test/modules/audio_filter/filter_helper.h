@@ -0,0 +1,97 @@
+/*****************************************************************************
+ * filter_helper.h: shared setup of the audio filter tests
+ *****************************************************************************
+ * Copyright (C) 2024 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+/*
+ * The tests run a filter on 32-bits float audio at RATE, and take the
+ * duration of the signal in seconds as their only argument, 1 by default to
+ * keep "make check" short.
+ */
+
+#ifndef FILTER_HELPER_H
+#define FILTER_HELPER_H
+
+#include "../../libvlc/test.h"
+#include "../../../lib/libvlc_internal.h"
+
+#include <math.h>
+#include <string.h>
+
+#include <vlc_common.h>
+#include <vlc_modules.h>
+#include <vlc_aout.h>
+#include <vlc_block.h>
+#include <vlc_filter.h>
+#include <vlc_tick.h>
+
+#define RATE  48000
+#define FRAMES 1024 /* per block */
+
+static inline unsigned FilterTestSeconds( int argc, char *argv[] )
+{
+    return (argc > 1) ? strtoul( argv[1], NULL, 0 ) : 1;
+}
+
+/* Creates a filter object; its variables can be set before FilterStart() */
+static inline filter_t *FilterCreate( libvlc_int_t *vlc, uint16_t channels )
+{
+    filter_t *filter = vlc_object_create( vlc, sizeof (*filter) );
+    assert( filter != NULL );
+
+    es_format_Init( &filter->fmt_in, AUDIO_ES, VLC_CODEC_FL32 );
+    filter->fmt_in.audio.i_format = VLC_CODEC_FL32;
+    filter->fmt_in.audio.i_rate = RATE;
+    filter->fmt_in.audio.i_physical_channels = channels;
+    aout_FormatPrepare( &filter->fmt_in.audio );
+    filter->fmt_out = filter->fmt_in;
+    return filter;
+}
+
+static inline void FilterStart( filter_t *filter, const char *module )
+{
+    filter->p_module = module_need( filter, "audio filter", module, true );
+    assert( filter->p_module != NULL );
+}
+
+static inline void FilterDelete( filter_t *filter )
+{
+    module_unneed( filter, filter->p_module );
+    vlc_object_release( filter );
+}
+
+/* Allocates a block of frames, starting at a given frame of the signal */
+static inline block_t *FilterBlockAlloc( const filter_t *filter, size_t count,
+                                         size_t start )
+{
+    const unsigned channels = aout_FormatNbChannels( &filter->fmt_in.audio );
+    block_t *block = block_Alloc( count * channels * sizeof (float) );
+    assert( block != NULL );
+
+    block->i_nb_samples = count;
+    block->i_pts = block->i_dts = VLC_TICK_0 + vlc_tick_from_samples( start, RATE );
+    return block;
+}
+
+/* How many times faster than real time a number of frames was filtered */
+static inline double FilterSpeed( size_t frames, vlc_tick_t duration )
+{
+    return (double)frames / RATE / secf_from_vlc_tick( duration );
+}
+
+#endif /* FILTER_HELPER_H */
@@ -0,0 +1,196 @@
+/*****************************************************************************
+ * scaletempo.c: tempo scaler overlap search benchmark
+ *****************************************************************************
+ * Copyright (C) 2024 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+/*
+ * Usage: test_modules_audio_filter_scaletempo [seconds]
+ *
+ * Plays audio through the "scaletempo" filter at several speeds, with the
+ * direct and the FFT correlation methods, and prints how many times faster
+ * than real time each one runs, i.e. how many streams a core can serve.
+ *
+ * On a signal where the best overlap offset is known to be unique, both
+ * methods must also choose the same offsets, hence output the same samples.
+ */
+
+#include "filter_helper.h"
+
+static const struct
+{
+    const char *name;
+    uint16_t    channels;
+    int         stride;
+    float       overlap;
+    int         search;
+} configs[] = {
+    { "default stereo", AOUT_CHANS_STEREO, 30, .20f, 14 },
+    { "default 5.1",    AOUT_CHANS_5_1,    30, .20f, 14 },
+    { "long stereo",    AOUT_CHANS_STEREO, 60, .50f, 30 },
+};
+
+static const char *const methods[] = { "auto", "direct", "fft" };
+static const float speeds[] = { 1.5f, 2.f, 3.f };
+
+static filter_t *Create( libvlc_int_t *vlc, unsigned c, int method )
+{
+    filter_t *filter = FilterCreate( vlc, configs[c].channels );
+
+    var_Create( filter, "scaletempo-stride", VLC_VAR_INTEGER );
+    var_SetInteger( filter, "scaletempo-stride", configs[c].stride );
+    var_Create( filter, "scaletempo-overlap", VLC_VAR_FLOAT );
+    var_SetFloat( filter, "scaletempo-overlap", configs[c].overlap );
+    var_Create( filter, "scaletempo-search", VLC_VAR_INTEGER );
+    var_SetInteger( filter, "scaletempo-search", configs[c].search );
+    var_Create( filter, "scaletempo-correlation", VLC_VAR_INTEGER );
+    var_SetInteger( filter, "scaletempo-correlation", method );
+
+    FilterStart( filter, "scaletempo" );
+    return filter;
+}
+
+/* Returns the number of output frames, stored to out if not NULL */
+static size_t Run( filter_t *filter, float speed, const float *samples,
+                   unsigned blocks, vlc_tick_t *duration, float *out )
+{
+    const unsigned channels = aout_FormatNbChannels( &filter->fmt_in.audio );
+    const size_t size = FRAMES * channels * sizeof (float);
+    size_t frames = 0;
+
+    /* As the audio output does on rate changes */
+    filter->fmt_in.audio.i_rate = lroundf( RATE * speed );
+
+    vlc_tick_t start = vlc_tick_now();
+    for( unsigned i = 0; i < blocks; i++ )
+    {
+        block_t *block = FilterBlockAlloc( filter, FRAMES, i * FRAMES );
+        memcpy( block->p_buffer, samples + i * FRAMES * channels, size );
+
+        block = filter->pf_audio_filter( filter, block );
+        assert( block != NULL );
+        assert( block->i_nb_samples * channels * sizeof (float) == block->i_buffer );
+        for( size_t j = 0; j < block->i_buffer / sizeof (float); j++ )
+            assert( isfinite( ((float *)block->p_buffer)[j] ) );
+        if( out != NULL )
+        {
+            /* The output is shorter than the input when speeding up */
+            assert( frames + block->i_nb_samples <= (size_t)blocks * FRAMES );
+            memcpy( out + frames * channels, block->p_buffer, block->i_buffer );
+        }
+        frames += block->i_nb_samples;
+        block_Release( block );
+    }
+    *duration = vlc_tick_now() - start;
+    return frames;
+}
+
+/*
+ * White noise repeating with the period of the search window: at each
+ * stride, exactly one offset of the window continues the overlap, and its
+ * correlation is far above the others (the full energy of the overlap,
+ * against uncorrelated noise). The direct and the FFT searches must both
+ * find it, so that they output exactly the same samples.
+ */
+static void CheckOffsets( libvlc_int_t *vlc, unsigned c, unsigned blocks )
+{
+    const unsigned channels = vlc_popcount( configs[c].channels );
+    const unsigned period = configs[c].search * RATE / 1000;
+    const size_t count = (size_t)blocks * FRAMES * channels;
+    float *samples = malloc( count * sizeof (float) );
+    float *out_direct = malloc( count * sizeof (float) );
+    float *out_fft = malloc( count * sizeof (float) );
+    assert( samples != NULL && out_direct != NULL && out_fft != NULL );
+
+    for( size_t i = 0; i < period * channels; i++ )
+        samples[i] = rand() / (float)RAND_MAX - .5f;
+    for( size_t i = period * channels; i < count; i++ )
+        samples[i] = samples[i - period * channels];
+
+    for( unsigned s = 0; s < ARRAY_SIZE(speeds); s++ )
+    {
+        vlc_tick_t duration;
+
+        filter_t *filter = Create( vlc, c, 1 /* direct */ );
+        size_t frames = Run( filter, speeds[s], samples, blocks, &duration,
+                             out_direct );
+        FilterDelete( filter );
+
+        filter = Create( vlc, c, 2 /* fft */ );
+        assert( Run( filter, speeds[s], samples, blocks, &duration,
+                     out_fft ) == frames );
+        FilterDelete( filter );
+
+        assert( frames > 0 );
+        assert( !memcmp( out_direct, out_fft,
+                         frames * channels * sizeof (float) ) );
+    }
+
+    free( out_fft );
+    free( out_direct );
+    free( samples );
+}
+
+int main( int argc, char *argv[] )
+{
+    unsigned blocks = FilterTestSeconds( argc, argv ) * RATE / FRAMES;
+
+    test_init();
+
+    libvlc_instance_t *vlc = libvlc_new( test_defaults_nargs,
+                                         test_defaults_args );
+    assert( vlc != NULL );
+
+    /* Tones and some noise, so that the correlation has a clear peak */
+    float *samples = malloc( blocks * FRAMES * AOUT_CHAN_MAX * sizeof (float) );
+    assert( samples != NULL );
+    for( size_t i = 0; i < blocks * FRAMES * AOUT_CHAN_MAX; i++ )
+        samples[i] = .3f * sinf( i * .013f ) + .2f * sinf( i * .0071f )
+                   + .05f * ( rand() / (float)RAND_MAX - .5f );
+
+    for( unsigned c = 0; c < ARRAY_SIZE(configs); c++ )
+        for( unsigned s = 0; s < ARRAY_SIZE(speeds); s++ )
+        {
+            size_t ref_frames = 0;
+
+            printf( "%-14s x%.1f", configs[c].name, speeds[s] );
+            for( unsigned m = 0; m < ARRAY_SIZE(methods); m++ )
+            {
+                filter_t *filter = Create( vlc->p_libvlc_int, c, m );
+                vlc_tick_t duration;
+                size_t frames = Run( filter, speeds[s], samples, blocks,
+                                     &duration, NULL );
+
+                /* The methods may pick different offsets among equally
+                 * good ones, but always output the same amount */
+                if( m == 0 )
+                    ref_frames = frames;
+                assert( frames == ref_frames );
+                printf( "  %s %7.1f", methods[m],
+                        FilterSpeed( (size_t)blocks * FRAMES, duration ) );
+                FilterDelete( filter );
+            }
+            printf( " x real time\n" );
+        }
+
+    for( unsigned c = 0; c < ARRAY_SIZE(configs); c++ )
+        CheckOffsets( vlc->p_libvlc_int, c, blocks );
+
+    free( samples );
+    libvlc_release( vlc );
+    return 0;
+}
@@ -0,0 +1,302 @@
+/*****************************************************************************
+ * throughput.c: PCM conversion, volume and interleaving benchmark
+ *****************************************************************************
+ * Copyright (C) 2024 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+/*
+ * Usage: test_modules_audio_filter_throughput [iterations]
+ *
+ * Runs every format pair through the "format" converter and, when it handles
+ * the pair on this CPU, through the vectorized "audio_simd" one, checking that
+ * both produce the same samples. The volume modules and the (de)interleaving
+ * are measured the same way.
+ */
+
+#include "../../libvlc/test.h"
+#include "../../../lib/libvlc_internal.h"
+
+#include <string.h>
+
+#include <vlc_common.h>
+#include <vlc_modules.h>
+#include <vlc_aout.h>
+#include <vlc_aout_volume.h>
+#include <vlc_block.h>
+#include <vlc_filter.h>
+#include <vlc_tick.h>
+
+/* One second of 7.1 at 96 kHz */
+#define CHANNELS 8
+#define SAMPLES  (96000 * CHANNELS)
+
+static const vlc_fourcc_t formats[] = {
+    VLC_CODEC_U8, VLC_CODEC_S16N, VLC_CODEC_S32N, VLC_CODEC_FL32,
+    VLC_CODEC_FL64,
+};
+
+static uint32_t seed = 0x1234;
+
+static uint32_t Random( void )
+{
+    seed = seed * 1664525 + 1013904223;
+    return seed;
+}
+
+/* Samples covering the clipping range of the float formats */
+static block_t *Generate( vlc_fourcc_t format )
+{
+    block_t *block = block_Alloc( SAMPLES * aout_BitsPerSample( format ) / 8 );
+    assert( block != NULL );
+
+    for( size_t i = 0; i < SAMPLES; i++ )
+    {
+        const double f = ((int32_t)Random() / 2147483648.) * 1.1;
+
+        switch( format )
+        {
+            case VLC_CODEC_FL32: ((float *)block->p_buffer)[i] = f; break;
+            case VLC_CODEC_FL64: ((double *)block->p_buffer)[i] = f; break;
+            case VLC_CODEC_S32N: ((uint32_t *)block->p_buffer)[i] = Random(); break;
+            case VLC_CODEC_S16N: ((uint16_t *)block->p_buffer)[i] = Random(); break;
+            default:             block->p_buffer[i] = Random(); break;
+        }
+    }
+    return block;
+}
+
+static double Rate( vlc_tick_t duration, unsigned n )
+{
+    return n * (double)SAMPLES / 1e6 / secf_from_vlc_tick( duration );
+}
+
+static void FormatInit( es_format_t *fmt, vlc_fourcc_t format )
+{
+    es_format_Init( fmt, AUDIO_ES, format );
+    fmt->audio.i_format = format;
+    fmt->audio.i_rate = 96000;
+    fmt->audio.i_physical_channels = AOUT_CHANS_7_1;
+    aout_FormatPrepare( &fmt->audio );
+}
+
+/* Converts the samples n times, the last output is returned. The in place
+ * converters consume their input, so that it is copied each time. */
+static block_t *Convert( libvlc_int_t *vlc, const char *name,
+                         vlc_fourcc_t src, vlc_fourcc_t dst,
+                         const block_t *in, unsigned n, vlc_tick_t *duration )
+{
+    filter_t *filter = vlc_object_create( vlc, sizeof (*filter) );
+    block_t *out = NULL;
+
+    assert( filter != NULL );
+    FormatInit( &filter->fmt_in, src );
+    FormatInit( &filter->fmt_out, dst );
+
+    module_t *module = module_need( filter, "audio converter", name, true );
+    if( module == NULL )
+    {
+        vlc_object_release( filter );
+        return NULL;
+    }
+
+    vlc_tick_t start = vlc_tick_now();
+    for( unsigned i = 0; i < n; i++ )
+    {
+        block_t *block = block_Alloc( in->i_buffer );
+        assert( block != NULL );
+        memcpy( block->p_buffer, in->p_buffer, in->i_buffer );
+
+        if( out != NULL )
+            block_Release( out );
+        out = filter->pf_audio_filter( filter, block );
+        assert( out != NULL );
+    }
+    *duration = vlc_tick_now() - start;
+
+    module_unneed( filter, module );
+    vlc_object_release( filter );
+    return out;
+}
+
+static void test_converters( libvlc_int_t *vlc, unsigned n )
+{
+    for( size_t i = 0; i < ARRAY_SIZE(formats); i++ )
+    {
+        block_t *in = Generate( formats[i] );
+
+        for( size_t j = 0; j < ARRAY_SIZE(formats); j++ )
+        {
+            if( i == j )
+                continue;
+
+            vlc_tick_t ref_time, simd_time;
+            block_t *ref = Convert( vlc, "format", formats[i], formats[j],
+                                    in, n, &ref_time );
+            block_t *simd = Convert( vlc, "audio_simd", formats[i], formats[j],
+                                     in, n, &simd_time );
+            assert( ref != NULL );
+
+            printf( "%4.4s->%4.4s  format %8.1f", (const char *)&formats[i],
+                    (const char *)&formats[j], Rate( ref_time, n ) );
+            if( simd != NULL )
+            {
+                assert( simd->i_buffer == ref->i_buffer );
+                assert( !memcmp( simd->p_buffer, ref->p_buffer, ref->i_buffer ) );
+                printf( "  simd %8.1f", Rate( simd_time, n ) );
+                block_Release( simd );
+            }
+            printf( " Msamples/s\n" );
+            block_Release( ref );
+        }
+        block_Release( in );
+    }
+}
+
+static block_t *Amplify( libvlc_int_t *vlc, const char *name,
+                         vlc_fourcc_t format, float amp,
+                         const block_t *in, unsigned n, vlc_tick_t *duration )
+{
+    audio_volume_t *volume = vlc_object_create( vlc, sizeof (*volume) );
+    assert( volume != NULL );
+    volume->format = format;
+
+    module_t *module = module_need( volume, "audio volume", name, true );
+    if( module == NULL )
+    {
+        vlc_object_release( volume );
+        return NULL;
+    }
+
+    block_t *out = block_Alloc( in->i_buffer );
+    assert( out != NULL );
+
+    vlc_tick_t start = vlc_tick_now();
+    for( unsigned i = 0; i < n; i++ )
+    {
+        memcpy( out->p_buffer, in->p_buffer, in->i_buffer );
+        volume->amplify( volume, out, amp );
+    }
+    *duration = vlc_tick_now() - start;
+
+    module_unneed( volume, module );
+    vlc_object_release( volume );
+    return out;
+}
+
+static void test_volume( libvlc_int_t *vlc, unsigned n )
+{
+    static const char *const modules[] = { "float", "integer", "audio_simd" };
+
+    for( size_t i = 0; i < ARRAY_SIZE(formats); i++ )
+    {
+        block_t *in = Generate( formats[i] );
+        block_t *ref = NULL;
+
+        printf( "volume %4.4s", (const char *)&formats[i] );
+        for( size_t j = 0; j < ARRAY_SIZE(modules); j++ )
+        {
+            vlc_tick_t duration;
+            /* Above unity to exercise the clipping */
+            block_t *out = Amplify( vlc, modules[j], formats[i], 1.7f, in, n,
+                                    &duration );
+            if( out == NULL )
+                continue;
+
+            printf( "  %s %8.1f", modules[j], Rate( duration, n ) );
+            if( ref == NULL )
+                ref = out;
+            else
+            {
+                assert( !memcmp( out->p_buffer, ref->p_buffer, ref->i_buffer ) );
+                block_Release( out );
+            }
+        }
+        printf( " Msamples/s\n" );
+        if( ref != NULL )
+            block_Release( ref );
+        block_Release( in );
+    }
+}
+
+static void test_interleave( unsigned n )
+{
+    static const unsigned channels[] = { 2, 6, 8 };
+
+    for( size_t i = 0; i < ARRAY_SIZE(formats); i++ )
+    {
+        const unsigned size = aout_BitsPerSample( formats[i] ) / 8;
+        block_t *in = Generate( formats[i] );
+        uint8_t *planar = malloc( in->i_buffer );
+        uint8_t *out = malloc( in->i_buffer );
+        assert( planar != NULL && out != NULL );
+
+        for( size_t c = 0; c < ARRAY_SIZE(channels); c++ )
+        {
+            const unsigned chans = channels[c];
+            const unsigned samples = SAMPLES / CHANNELS;
+            const void *planes[CHANNELS];
+
+            for( unsigned k = 0; k < chans; k++ )
+                planes[k] = planar + k * samples * size;
+
+            vlc_tick_t start = vlc_tick_now();
+            for( unsigned k = 0; k < n; k++ )
+                aout_Deinterleave( planar, in->p_buffer, samples, chans,
+                                   formats[i] );
+            vlc_tick_t deinterleave = vlc_tick_now() - start;
+
+            start = vlc_tick_now();
+            for( unsigned k = 0; k < n; k++ )
+                aout_Interleave( out, planes, samples, chans, formats[i] );
+            vlc_tick_t interleave = vlc_tick_now() - start;
+
+            for( unsigned k = 0; k < samples * chans; k += 97 )
+                assert( !memcmp( &planar[((k % chans) * samples + k / chans) * size],
+                                 &in->p_buffer[k * size], size ) );
+            assert( !memcmp( out, in->p_buffer, samples * chans * size ) );
+
+            /* Rates are per interleaved sample, as the conversions */
+            const double scale = (double)(samples * chans) / SAMPLES;
+            printf( "%4.4s %u channels  deinterleave %8.1f  interleave %8.1f"
+                    " Msamples/s\n", (const char *)&formats[i], chans,
+                    Rate( deinterleave, n ) * scale,
+                    Rate( interleave, n ) * scale );
+        }
+        free( out );
+        free( planar );
+        block_Release( in );
+    }
+}
+
+int main( int argc, char *argv[] )
+{
+    /* Keep "make check" short; pass a larger count for benchmarking */
+    unsigned n = (argc > 1) ? strtoul( argv[1], NULL, 0 ) : 2;
+
+    test_init();
+
+    libvlc_instance_t *vlc = libvlc_new( test_defaults_nargs,
+                                         test_defaults_args );
+    assert( vlc != NULL );
+
+    test_converters( vlc->p_libvlc_int, n );
+    test_volume( vlc->p_libvlc_int, n );
+    test_interleave( n );
+
+    libvlc_release( vlc );
+    return 0;
+}
@@ -0,0 +1,321 @@
+/*****************************************************************************
+ * ts.c: TS muxer output groups regression test
+ *****************************************************************************
+ * Copyright (C) 2024 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+/*
+ * Muxes a scrambled video and audio program with the "ts" muxer, with PAT and
+ * PMT before each key frame, and checks the blocks written to the access
+ * output. The TS packets are sent by groups sharing the buffer they are muxed
+ * into:
+ *  - each group must fit in the datagrams of the access output MTU, and
+ *    the groups must fill them as single packets would,
+ *  - a group must start at each PAT/PMT flagged as header,
+ *  - the PCRs must be patched in place, consistently with the dates of their
+ *    groups,
+ *  - the payloads must be scrambled in place: they must descramble to the
+ *    muxed PES.
+ */
+
+#include "../../libvlc/test.h"
+#include "../../../lib/libvlc_internal.h"
+#include "../../../modules/mux/mpeg/csa.h"
+
+#include <string.h>
+
+#include <vlc_common.h>
+#include <vlc_sout.h>
+#include <vlc_block.h>
+
+#define MTU 1000 /* 5 packets per group */
+#define PACKETS (MTU / 188)
+#define CK "1234567890abcdef"
+
+struct group
+{
+    size_t     first; /* index of the first packet */
+    unsigned   count;
+    uint32_t   flags;
+    vlc_tick_t dts;
+    vlc_tick_t length;
+};
+
+static struct
+{
+    uint8_t      *packets;
+    size_t        packet_count;
+    struct group *groups;
+    size_t        group_count;
+} out;
+
+static ssize_t Write( sout_access_out_t *access, block_t *block )
+{
+    ssize_t total = 0;
+
+    (void) access;
+    while( block != NULL )
+    {
+        block_t *next = block->p_next;
+        const unsigned count = block->i_buffer / 188;
+
+        assert( count > 0 && block->i_buffer == count * 188 );
+
+        out.packets = realloc( out.packets,
+                               (out.packet_count + count) * 188 );
+        out.groups = realloc( out.groups,
+                              (out.group_count + 1) * sizeof (*out.groups) );
+        assert( out.packets != NULL && out.groups != NULL );
+
+        memcpy( out.packets + out.packet_count * 188, block->p_buffer,
+                block->i_buffer );
+        out.groups[out.group_count++] = (struct group) {
+            .first = out.packet_count,
+            .count = count,
+            .flags = block->i_flags,
+            .dts = block->i_dts,
+            .length = block->i_length,
+        };
+        out.packet_count += count;
+        total += block->i_buffer;
+
+        block_Release( block );
+        block = next;
+    }
+    return total;
+}
+
+static unsigned PID( const uint8_t *p )
+{
+    return ((p[1] & 0x1f) << 8) | p[2];
+}
+
+static const uint8_t *Payload( const uint8_t *p )
+{
+    return (p[3] & 0x20) ? p + 5 + p[4] : p + 4;
+}
+
+static void Mux( libvlc_int_t *vlc, unsigned seconds )
+{
+    /* The objects are zeroed: the access output only writes */
+    sout_instance_t *sout = vlc_object_create( vlc, sizeof (*sout) );
+    assert( sout != NULL );
+    vlc_mutex_init( &sout->lock );
+    var_Create( sout, "sout-mux-caching", VLC_VAR_INTEGER | VLC_VAR_DOINHERIT );
+
+    sout_access_out_t *access = vlc_object_create( sout, sizeof (*access) );
+    assert( access != NULL );
+    access->pf_write = Write;
+    var_Create( access, "mtu", VLC_VAR_INTEGER );
+    var_SetInteger( access, "mtu", MTU );
+
+    sout_mux_t *mux = sout_MuxNew( sout, "ts{use-key-frames,csa-ck=" CK "}",
+                                   access );
+    if( mux == NULL )
+    {
+        vlc_object_release( access );
+        vlc_mutex_destroy( &sout->lock );
+        vlc_object_release( sout );
+        return; /* the muxer is not built */
+    }
+
+    es_format_t fmt;
+    es_format_Init( &fmt, VIDEO_ES, VLC_CODEC_H264 );
+    sout_input_t *video = sout_MuxAddStream( mux, &fmt );
+    es_format_Clean( &fmt );
+    es_format_Init( &fmt, AUDIO_ES, VLC_CODEC_A52 );
+    fmt.audio.i_rate = 48000;
+    fmt.audio.i_channels = 2;
+    sout_input_t *audio = sout_MuxAddStream( mux, &fmt );
+    es_format_Clean( &fmt );
+    assert( video != NULL && audio != NULL );
+
+    vlc_tick_t v = VLC_TICK_FROM_SEC(10), a = v;
+    for( unsigned f = 0; f < seconds * 25; f++ )
+    {
+        size_t size = (f % 12 == 0) ? 30000 : 6000 + (f * 7919) % 2000;
+        block_t *block = block_Alloc( size );
+        assert( block != NULL );
+        for( size_t i = 0; i < size; i++ )
+            block->p_buffer[i] = i * 7 + f;
+        block->i_dts = v;
+        block->i_pts = v + VLC_TICK_FROM_MS(80);
+        block->i_length = VLC_TICK_FROM_MS(40);
+        if( f % 12 == 0 )
+            block->i_flags |= BLOCK_FLAG_TYPE_I;
+        sout_MuxSendBuffer( mux, video, block );
+        v += VLC_TICK_FROM_MS(40);
+
+        for( ; a < v; a += VLC_TICK_FROM_MS(32) )
+        {
+            block = block_Alloc( 768 );
+            assert( block != NULL );
+            memset( block->p_buffer, a / 1000, 768 );
+            block->i_dts = block->i_pts = a;
+            block->i_length = VLC_TICK_FROM_MS(32);
+            sout_MuxSendBuffer( mux, audio, block );
+        }
+    }
+
+    sout_MuxDeleteStream( mux, audio );
+    sout_MuxDeleteStream( mux, video );
+    sout_MuxDelete( mux );
+    vlc_object_release( access );
+    vlc_mutex_destroy( &sout->lock );
+    vlc_object_release( sout );
+}
+
+/* The groups fill the datagrams of the MTU, and a header starts a group */
+static void CheckGroups( void )
+{
+    unsigned fill = 0, headers = 0;
+
+    for( size_t i = 0; i < out.group_count; i++ )
+    {
+        const struct group *g = &out.groups[i];
+
+        if( fill >= PACKETS )
+            fill = 0;
+        assert( fill + g->count <= PACKETS );
+        fill += g->count;
+
+        for( unsigned j = 0; j < g->count; j++ )
+            assert( out.packets[(g->first + j) * 188] == 0x47 );
+
+        if( g->flags & BLOCK_FLAG_HEADER )
+        {
+            assert( PID( out.packets + g->first * 188 ) == 0 );
+            headers++;
+        }
+    }
+    assert( headers > 0 );
+    test_log( "%zu groups, %zu packets, %u headers\n", out.group_count,
+              out.packet_count, headers );
+}
+
+/* Each PCR, in the 90 kHz base, is the date of its packet, which is within
+ * its group, minus a constant offset */
+static void CheckPCR( void )
+{
+    vlc_tick_t lo = INT64_MIN, hi = INT64_MAX, last = -1;
+    unsigned count = 0;
+
+    for( size_t i = 0; i < out.group_count; i++ )
+    {
+        const struct group *g = &out.groups[i];
+
+        for( unsigned j = 0; j < g->count; j++ )
+        {
+            const uint8_t *p = out.packets + (g->first + j) * 188;
+
+            if( !(p[3] & 0x20) || p[4] < 7 || !(p[5] & 0x10) )
+                continue;
+
+            int64_t base = ((int64_t)p[6] << 25) | (p[7] << 17) | (p[8] << 9)
+                         | (p[9] << 1) | (p[10] >> 7);
+            vlc_tick_t pcr = base * 100 / 9;
+
+            assert( pcr > last );
+            last = pcr;
+            lo = __MAX( lo, g->dts - pcr );
+            hi = __MIN( hi, g->dts + g->length - pcr );
+            count++;
+        }
+    }
+    assert( count > 0 );
+    /* The 90 kHz and per packet length roundings */
+    assert( lo <= hi + VLC_TICK_FROM_MS(1) );
+}
+
+static unsigned PMTPID( void )
+{
+    for( size_t i = 0; i < out.packet_count; i++ )
+    {
+        const uint8_t *p = out.packets + i * 188;
+
+        if( PID( p ) == 0 && (p[1] & 0x40) )
+        {
+            const uint8_t *section = Payload( p ) + 1 + Payload( p )[0];
+
+            return ((section[10] & 0x1f) << 8) | section[11];
+        }
+    }
+    abort();
+}
+
+/* The payloads are scrambled, and descramble to the PES */
+static void CheckCSA( vlc_object_t *obj )
+{
+    const unsigned pmt = PMTPID();
+    unsigned pes = 0;
+
+    csa_t *csa = csa_New();
+    assert( csa != NULL );
+    char ck[] = CK;
+    assert( !csa_SetCW( obj, csa, ck, true ) );
+    assert( !csa_SetCW( obj, csa, ck, false ) );
+
+    for( size_t i = 0; i < out.packet_count; i++ )
+    {
+        uint8_t *p = out.packets + i * 188;
+        const unsigned pid = PID( p );
+
+        if( pid == 0 || pid == pmt || pid == 0x1fff || !(p[3] & 0x10) )
+            continue;
+        if( Payload( p ) + 8 > p + 188 )
+            continue; /* too short to be scrambled */
+
+        assert( p[3] & 0x80 );
+        csa_Decrypt( csa, p, 188 );
+        assert( !(p[3] & 0xc0) );
+
+        if( p[1] & 0x40 )
+        {
+            const uint8_t *payload = Payload( p );
+
+            assert( payload[0] == 0 && payload[1] == 0 && payload[2] == 1 );
+            pes++;
+        }
+    }
+    csa_Delete( csa );
+    assert( pes > 0 );
+}
+
+int main( void )
+{
+    test_init();
+
+    libvlc_instance_t *vlc = libvlc_new( test_defaults_nargs,
+                                         test_defaults_args );
+    assert( vlc != NULL );
+
+    Mux( vlc->p_libvlc_int, 4 );
+    if( out.group_count == 0 )
+    {
+        libvlc_release( vlc );
+        return 77;
+    }
+
+    CheckGroups();
+    CheckPCR();
+    CheckCSA( VLC_OBJECT(vlc->p_libvlc_int) );
+
+    free( out.groups );
+    free( out.packets );
+    libvlc_release( vlc );
+    return 0;
+}
@@ -30,6 +30,7 @@
 #include <vlc_block_helper.h>
 
 #include "../modules/packetizer/startcode_helper.h"
+#include "../modules/packetizer/hxxx_ep3b.h"
 
 struct results_s
 {
@@ -77,16 +78,126 @@ static int run_annexb_sets( const uint8_t *p_set, const uint8_t *p_end,
         return i_ret;
 
     /* Perform same tests on simd optimized code */
-    if( startcode_FindAnnexB_Bits != startcode_FindAnnexB )
+#if defined(CAN_COMPILE_SSE2) || defined(HAVE_SSE2_INTRINSICS)
+    if( vlc_CPU_SSE2() )
     {
-        printf("checking asm:\n");
+        printf("checking sse2 code:\n");
         i_ret = check_set( p_set, p_end, p_results, i_results, i_results_offset,
-                           startcode_FindAnnexB );
+                           startcode_FindAnnexB_SSE2 );
         if( i_ret != 0 )
             return i_ret;
     }
-    else printf("asm not built in, skipping test:\n");
+#endif
+#ifdef STARTCODE_AVX2
+    if( vlc_CPU_AVX2() )
+    {
+        printf("checking avx2 code:\n");
+        i_ret = check_set( p_set, p_end, p_results, i_results, i_results_offset,
+                           startcode_FindAnnexB_AVX2 );
+        if( i_ret != 0 )
+            return i_ret;
+    }
+#endif
+#ifdef STARTCODE_NEON
+    if( vlc_CPU_ARM_NEON() )
+    {
+        printf("checking neon code:\n");
+        i_ret = check_set( p_set, p_end, p_results, i_results, i_results_offset,
+                           startcode_FindAnnexB_NEON );
+        if( i_ret != 0 )
+            return i_ret;
+    }
+#endif
+
+    return 0;
+}
 
+static int check_prefix( const uint8_t *p_set, const uint8_t *p_end,
+                         const uint8_t *(*pf_find)(const uint8_t *, const uint8_t *) )
+{
+    /* Reference: first 00 00 pair, or p_end */
+    for( const uint8_t *p = p_set; p < p_end; p++ )
+    {
+        const uint8_t *p_ref = p;
+        while( p_ref + 1 < p_end && (p_ref[0] || p_ref[1]) )
+            p_ref++;
+        if( p_ref + 1 >= p_end )
+            p_ref = p_end;
+        if( pf_find( p, p_end ) != p_ref )
+        {
+            printf("- mismatch at offset %ld\n", p - p_set);
+            return 1;
+        }
+    }
+    return 0;
+}
+
+static int run_prefix_sets( void )
+{
+    uint8_t set[200];
+    int i_ret;
+
+    /* Sparse zeroes, pairs crossing every vector boundary */
+    for( size_t i = 0; i < sizeof(set); i++ )
+        set[i] = (i % 7 == 0 || i % 31 == 1 || i % 33 == 0) ? 0 : 0x42;
+
+    i_ret = check_prefix( set, set + sizeof(set), startcode_FindPrefix_Bits );
+#ifdef STARTCODE_AVX2
+    if( i_ret == 0 && vlc_CPU_AVX2() )
+        i_ret = check_prefix( set, set + sizeof(set), startcode_FindPrefix_AVX2 );
+#endif
+#ifdef HAVE_SSE2_INTRINSICS
+    if( i_ret == 0 && vlc_CPU_SSE2() )
+        i_ret = check_prefix( set, set + sizeof(set), startcode_FindPrefix_SSE2 );
+#endif
+#ifdef STARTCODE_NEON
+    if( i_ret == 0 && vlc_CPU_ARM_NEON() )
+        i_ret = check_prefix( set, set + sizeof(set), startcode_FindPrefix_NEON );
+#endif
+    return i_ret;
+}
+
+static int check_ep3b( const uint8_t *p_set, size_t i_set,
+                       const uint8_t *p_rbsp, size_t i_rbsp )
+{
+    uint8_t out[64];
+
+    assert( i_set <= sizeof(out) );
+    if( hxxx_ep3b_total_size( p_set, p_set + i_set ) != i_rbsp ||
+        hxxx_ep3b_unescape( out, p_set, p_set + i_set ) != i_rbsp ||
+        memcmp( out, p_rbsp, i_rbsp ) )
+        return 1;
+
+    /* Same bits when read through the bitstream callbacks */
+    struct hxxx_bsfw_ep3b_ctx_s ctx;
+    bs_t bs;
+    hxxx_bsfw_ep3b_ctx_init( &ctx );
+    bs_init_custom( &bs, p_set, i_set, &hxxx_bsfw_ep3b_callbacks, &ctx );
+    if( bs_remain( &bs ) != i_rbsp * 8 )
+        return 1;
+    for( size_t i = 0; i < i_rbsp; i++ )
+        if( bs_read( &bs, 8 ) != p_rbsp[i] )
+            return 1;
+    return 0;
+}
+
+static int run_ep3b_sets( void )
+{
+    const uint8_t test1[] = { 0x25, 0, 0, 3, 1, 0x88, 0, 0, 3, 0, 0, 3 };
+    /* the last byte is never escaped */
+    const uint8_t test1_rbsp[] = { 0x25, 0, 0, 1, 0x88, 0, 0, 0, 0, 3 };
+    /* first byte is never part of a sequence */
+    const uint8_t test2[] = { 0, 0, 3, 0, 0, 0x03, 0x03, 0x55 };
+    const uint8_t test2_rbsp[] = { 0, 0, 3, 0, 0, 0x03, 0x55 };
+    /* nothing to remove, long enough for the vector prefix search */
+    uint8_t test3[48];
+    for( size_t i = 0; i < sizeof(test3); i++ )
+        test3[i] = (i % 17) ? 0x42 : 0;
+
+    if( check_ep3b( test1, sizeof(test1), test1_rbsp, sizeof(test1_rbsp) ) ||
+        check_ep3b( test2, sizeof(test2), test2_rbsp, sizeof(test2_rbsp) ) ||
+        check_ep3b( test3, sizeof(test3), test3, sizeof(test3) ) )
+        return 1;
     return 0;
 }
 
@@ -134,5 +245,11 @@ int main( void )
             return i_ret;
     }
 
-    return 0;
+    printf("* Running prefix tests:\n");
+    i_ret = run_prefix_sets();
+    if( i_ret != 0 )
+        return i_ret;
+
+    printf("* Running ep3b tests:\n");
+    return run_ep3b_sets();
 }
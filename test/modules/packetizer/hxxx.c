@@ -117,6 +117,20 @@ static void testannexbin( const uint8_t *p_data, size_t i_data,
             printf("** No output **\n");
             assert(0);
         }
+
+        /* A shared payload must be left untouched */
+        block_t *p_orig = block_Alloc( i_data );
+        memcpy( p_orig->p_buffer, p_data, i_data );
+        p_orig->i_pts = VLC_TICK_0 + i;
+
+        p_block = hxxx_AnnexB_to_xVC( block_Share( p_orig ), 1 << i );
+        assert( p_block );
+        assert( p_block->i_pts == VLC_TICK_0 + i );
+        assert( p_block->i_buffer == pi_res[i] );
+        assert( memcmp( p_block->p_buffer, pp_res[i], pi_res[i] ) == 0 );
+        assert( memcmp( p_orig->p_buffer, p_data, i_data ) == 0 );
+        block_Release( p_block );
+        block_Release( p_orig );
     }
 }
 #define runtest(number, name, testfunction) \
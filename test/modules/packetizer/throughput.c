@@ -0,0 +1,195 @@
+/*****************************************************************************
+ * throughput.c: AnnexB startcode scanning and unescaping benchmark
+ *****************************************************************************
+ * Copyright (C) 2024 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+/*
+ * Usage: test_modules_packetizer_throughput [iterations]
+ */
+
+#ifdef HAVE_CONFIG_H
+# include "config.h"
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+#undef NDEBUG
+#include <assert.h>
+
+#include <vlc_common.h>
+#include <vlc_tick.h>
+
+#include "../modules/packetizer/hxxx_nal.h"
+#include "../modules/packetizer/hxxx_ep3b.h"
+
+#define STREAM_SIZE (4 << 20) /* a few high bitrate intra frames */
+
+struct stream
+{
+    uint8_t *p_data;
+    size_t   i_data;
+    size_t   i_nals;
+};
+
+/* Generates escaped NAL units with zero runs, as found in intra slices */
+static void stream_Generate( struct stream *s )
+{
+    uint8_t *p = s->p_data = malloc( STREAM_SIZE );
+    const uint8_t *end = p + STREAM_SIZE - 16;
+    unsigned seed = 0x1234;
+
+    assert( p != NULL );
+    s->i_nals = 0;
+
+    while( p < end )
+    {
+        size_t i_nal = 1000 + (seed % 60000);
+        if( i_nal > (size_t)(end - p) - 8 )
+            i_nal = (end - p) - 8;
+
+        memcpy( p, annexb_startcode4, 4 );
+        p += 4;
+        *p++ = 0x65; /* non-zero NAL header */
+
+        unsigned i_zeros = 0;
+        for( size_t i = 1; i < i_nal; i++ )
+        {
+            seed = seed * 1103515245 + 12345;
+            uint8_t b = (seed >> 16) % 16 ? (seed >> 8) : 0;
+            if( i_zeros >= 2 && b <= 3 )
+            {
+                *p++ = 0x03;
+                i_zeros = 0;
+            }
+            *p++ = b;
+            i_zeros = b ? 0 : i_zeros + 1;
+        }
+        /* Never end a NAL with zero */
+        if( i_zeros )
+            *p++ = 0x80;
+        s->i_nals++;
+    }
+    s->i_data = p - s->p_data;
+}
+
+static vlc_tick_t bench_scan( const struct stream *s, unsigned n,
+                              const uint8_t *(*pf_find)(const uint8_t *, const uint8_t *) )
+{
+    const uint8_t *end = s->p_data + s->i_data;
+    vlc_tick_t start = vlc_tick_now();
+
+    for( unsigned i = 0; i < n; i++ )
+    {
+        size_t i_found = 0;
+        for( const uint8_t *p = s->p_data; (p = pf_find( p, end )) != NULL; p += 3 )
+            i_found++;
+        assert( i_found == s->i_nals );
+    }
+    return vlc_tick_now() - start;
+}
+
+/* Reference unescaping, one byte at a time */
+static size_t unescape_Bytes( uint8_t *p_dst, const uint8_t *p, const uint8_t *end )
+{
+    unsigned i_prev = 0;
+    size_t i_dst = 0;
+
+    p_dst[i_dst++] = *p;
+    while( (p = hxxx_ep3b_to_rbsp( (uint8_t *) p, (uint8_t *) end, &i_prev, 1 )) < end )
+        p_dst[i_dst++] = *p;
+    return i_dst;
+}
+
+static vlc_tick_t bench_nals( const struct stream *s, unsigned n, uint8_t *p_dst,
+                              size_t (*pf_unescape)(uint8_t *, const uint8_t *,
+                                                    const uint8_t *),
+                              size_t *pi_rbsp )
+{
+    vlc_tick_t start = vlc_tick_now();
+
+    for( unsigned i = 0; i < n; i++ )
+    {
+        hxxx_iterator_ctx_t it;
+        const uint8_t *p_nal;
+        size_t i_nal, i_nals = 0, i_rbsp = 0;
+
+        hxxx_iterator_init( &it, s->p_data, s->i_data, 0 );
+        while( hxxx_annexb_iterate_next( &it, &p_nal, &i_nal ) )
+        {
+            i_rbsp += pf_unescape( &p_dst[i_rbsp], p_nal, p_nal + i_nal );
+            i_nals++;
+        }
+        assert( i_nals == s->i_nals );
+        *pi_rbsp = i_rbsp;
+    }
+    return vlc_tick_now() - start;
+}
+
+static void report( const char *name, const struct stream *s, unsigned n,
+                    vlc_tick_t duration )
+{
+    double secs = secf_from_vlc_tick( duration );
+
+    printf( "%-16s %u x %zu bytes in %.3f s: %.1f MB/s\n", name, n, s->i_data,
+            secs, (n * (double) s->i_data / 1e6) / secs );
+}
+
+int main( int argc, char *argv[] )
+{
+    /* Keep "make check" short; pass a larger count for benchmarking */
+    unsigned n = (argc > 1) ? strtoul( argv[1], NULL, 0 ) : 4;
+    struct stream s;
+
+    stream_Generate( &s );
+
+    uint8_t *p_ref = malloc( s.i_data );
+    uint8_t *p_dst = malloc( s.i_data );
+    assert( p_ref != NULL && p_dst != NULL );
+
+    /* The vectorized unescaping must match the byte per byte one */
+    size_t i_ref, i_rbsp;
+    bench_nals( &s, 1, p_ref, unescape_Bytes, &i_ref );
+    bench_nals( &s, 1, p_dst, hxxx_ep3b_unescape, &i_rbsp );
+    assert( i_rbsp == i_ref && !memcmp( p_ref, p_dst, i_ref ) );
+
+    printf( "%zu NALs, %zu bytes, %zu unescaped\n", s.i_nals, s.i_data, i_ref );
+
+    report( "scan bits", &s, n, bench_scan( &s, n, startcode_FindAnnexB_Bits ) );
+#if defined(CAN_COMPILE_SSE2) || defined(HAVE_SSE2_INTRINSICS)
+    if( vlc_CPU_SSE2() )
+        report( "scan sse2", &s, n, bench_scan( &s, n, startcode_FindAnnexB_SSE2 ) );
+#endif
+#ifdef STARTCODE_AVX2
+    if( vlc_CPU_AVX2() )
+        report( "scan avx2", &s, n, bench_scan( &s, n, startcode_FindAnnexB_AVX2 ) );
+#endif
+#ifdef STARTCODE_NEON
+    if( vlc_CPU_ARM_NEON() )
+        report( "scan neon", &s, n, bench_scan( &s, n, startcode_FindAnnexB_NEON ) );
+#endif
+
+    report( "nals bytewise", &s, n,
+            bench_nals( &s, n, p_dst, unescape_Bytes, &i_rbsp ) );
+    report( "nals unescape", &s, n,
+            bench_nals( &s, n, p_dst, hxxx_ep3b_unescape, &i_rbsp ) );
+
+    free( p_dst );
+    free( p_ref );
+    free( s.p_data );
+    return 0;
+}
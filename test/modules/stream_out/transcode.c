@@ -0,0 +1,145 @@
+/*****************************************************************************
+ * transcode.c: transcode stream output test
+ *****************************************************************************
+ * Copyright (C) 2024 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+/*
+ * Transcodes the audio of a mock input to raw samples, received through the
+ * smem stream output, with and without the per-ES threads. Both must output
+ * the same samples, in order: nothing may be lost when the ES is drained.
+ */
+
+#include "../../libvlc/test.h"
+
+#include <inttypes.h>
+#include <string.h>
+
+#include <vlc_common.h>
+#include <vlc_threads.h>
+
+struct output
+{
+    uint8_t   buffer[1 << 20];
+    uint64_t  samples;
+    uint64_t  bytes;
+    uint32_t  checksum;
+    vlc_tick_t last_pts;
+    bool      b_ordered;
+};
+
+static void AudioPrerender( void *data, uint8_t **pp_buffer, size_t size )
+{
+    struct output *out = data;
+
+    assert( size <= sizeof (out->buffer) );
+    *pp_buffer = out->buffer;
+}
+
+static void AudioPostrender( void *data, uint8_t *p_buffer,
+                             unsigned channels, unsigned rate,
+                             unsigned samples, unsigned bits,
+                             size_t size, vlc_tick_t pts )
+{
+    struct output *out = data;
+
+    assert( channels > 0 && rate > 0 && bits == 16 );
+
+    if( out->last_pts != VLC_TICK_INVALID && pts <= out->last_pts )
+        out->b_ordered = false;
+    out->last_pts = pts;
+    out->samples += samples;
+    out->bytes += size;
+    for( size_t i = 0; i < size; i++ )
+        out->checksum = out->checksum * 31 + p_buffer[i];
+}
+
+static void OnEnd( const libvlc_event_t *event, void *data )
+{
+    (void) event;
+    vlc_sem_post( data );
+}
+
+static void Transcode( libvlc_instance_t *vlc, bool b_threads,
+                       struct output *out )
+{
+    memset( out, 0, sizeof (*out) );
+    out->last_pts = VLC_TICK_INVALID;
+    out->b_ordered = true;
+
+    char *sout;
+    int ret = asprintf( &sout, ":sout=#transcode{acodec=s16l%s}"
+        ":smem{audio-prerender-callback=%"PRIdPTR","
+        "audio-postrender-callback=%"PRIdPTR",audio-data=%"PRIdPTR"}",
+        b_threads ? ",es-threads" : "",
+        (intptr_t)AudioPrerender, (intptr_t)AudioPostrender, (intptr_t)out );
+    assert( ret >= 0 );
+
+    libvlc_media_t *media = libvlc_media_new_location( vlc,
+        "mock://video_track_count=0;audio_track_count=1;"
+        "length=1000000" );
+    assert( media != NULL );
+    libvlc_media_add_option( media, sout );
+    free( sout );
+
+    libvlc_media_player_t *mp = libvlc_media_player_new_from_media( media );
+    assert( mp != NULL );
+    libvlc_media_release( media );
+
+    vlc_sem_t done;
+    vlc_sem_init( &done, 0 );
+
+    libvlc_event_manager_t *em = libvlc_media_player_event_manager( mp );
+    ret = libvlc_event_attach( em, libvlc_MediaPlayerEndReached, OnEnd, &done );
+    assert( ret == 0 );
+
+    ret = libvlc_media_player_play( mp );
+    assert( ret == 0 );
+    vlc_sem_wait( &done );
+
+    /* Stopping deletes the ES, which drains the transcoders */
+    libvlc_media_player_stop( mp );
+    libvlc_event_detach( em, libvlc_MediaPlayerEndReached, OnEnd, &done );
+    libvlc_media_player_release( mp );
+    vlc_sem_destroy( &done );
+
+    test_log( "%s: %"PRIu64" samples, %"PRIu64" bytes\n",
+              b_threads ? "threaded" : "synchronous", out->samples, out->bytes );
+}
+
+int main( void )
+{
+    test_init();
+
+    libvlc_instance_t *vlc = libvlc_new( test_defaults_nargs,
+                                         test_defaults_args );
+    assert( vlc != NULL );
+
+    static struct output sync_out, thread_out;
+
+    Transcode( vlc, false, &sync_out );
+    Transcode( vlc, true, &thread_out );
+
+    assert( sync_out.samples > 0 && sync_out.b_ordered );
+    assert( thread_out.b_ordered );
+    assert( thread_out.samples == sync_out.samples );
+    assert( thread_out.bytes == sync_out.bytes );
+    assert( thread_out.checksum == sync_out.checksum );
+
+    libvlc_release( vlc );
+    return 0;
+}
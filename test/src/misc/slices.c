@@ -0,0 +1,97 @@
+/*****************************************************************************
+ * slices.c: test for the slice-parallel execution of video filters
+ *****************************************************************************
+ * Copyright (C) 2024 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+#include "../../libvlc/test.h"
+#include "../lib/libvlc_internal.h"
+
+#include <vlc_common.h>
+#include <vlc_atomic.h>
+#include <vlc_filter.h>
+
+#define LINES 1081
+#define RUNS  16
+
+struct slices_test
+{
+    unsigned   lines;
+    atomic_uint covered[LINES];
+};
+
+static void SliceCb( filter_t *filter, void *opaque,
+                     unsigned slice, unsigned slices )
+{
+    struct slices_test *t = opaque;
+    unsigned start, end;
+
+    assert( filter != NULL );
+    assert( slice < slices );
+    filter_GetSliceLines( t->lines, slice, slices, &start, &end );
+    assert( start <= end && end <= t->lines );
+
+    for( unsigned i = start; i < end; i++ )
+        atomic_fetch_add( &t->covered[i], 1 );
+}
+
+static void test_slices( filter_t *filter, unsigned lines )
+{
+    struct slices_test t = { .lines = lines };
+
+    unsigned count = filter_GetSliceCount( filter, lines );
+    assert( count >= 1 && count <= 4 );
+    if( lines < 64 )
+        assert( count == 1 );
+
+    for( unsigned i = 0; i < LINES; i++ )
+        atomic_init( &t.covered[i], 0 );
+
+    /* Run up to more slices than threads, every line once per run */
+    for( unsigned n = 0; n < RUNS; n++ )
+        filter_RunSlices( filter, count + n, SliceCb, &t );
+
+    for( unsigned i = 0; i < lines; i++ )
+        assert( atomic_load( &t.covered[i] ) == RUNS );
+}
+
+int main( void )
+{
+    const char *argv[test_defaults_nargs + 1];
+
+    for( int i = 0; i < test_defaults_nargs; i++ )
+        argv[i] = test_defaults_args[i];
+    argv[test_defaults_nargs] = "--video-filter-threads=4";
+
+    test_init();
+
+    libvlc_instance_t *vlc = libvlc_new( test_defaults_nargs + 1, argv );
+    assert( vlc != NULL );
+
+    filter_t *filter = vlc_object_create( vlc->p_libvlc_int, sizeof(*filter) );
+    assert( filter != NULL );
+
+    test_log( "Testing slices\n" );
+    test_slices( filter, 1 );
+    test_slices( filter, 63 );
+    test_slices( filter, 576 );
+    test_slices( filter, LINES );
+
+    vlc_object_release( filter );
+    libvlc_release( vlc );
+    return 0;
+}
@@ -0,0 +1,117 @@
+/*****************************************************************************
+ * startup.c: plugins bank start-up benchmark
+ *****************************************************************************
+ * Copyright (C) 2024 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+/*
+ * Measures the time from libvlc_new() to the first module being resolved,
+ * with and without --plugins-lazy. The plugins cache must be up to date
+ * (see vlc-cache-gen) for the lazy mode to be effective.
+ *
+ * Usage: test_src_modules_startup [iterations] [capability]
+ */
+
+#include <stdarg.h>
+#include <string.h>
+
+#include "../../libvlc/test.h"
+#include "../lib/libvlc_internal.h"
+
+#include <vlc_common.h>
+#include <vlc_modules.h>
+
+static int probe(void *func, va_list ap)
+{
+    /* Resolve the module without activating it */
+    (void) func; (void) ap;
+    return VLC_SUCCESS;
+}
+
+struct stats
+{
+    vlc_tick_t init_min, init_sum;
+    vlc_tick_t first_min, first_sum;
+};
+
+static void run(const char *cap, bool lazy, struct stats *st)
+{
+    const char *argv[] = {
+        "--ignore-config", "--quiet",
+        lazy ? "--plugins-lazy" : "--no-plugins-lazy",
+    };
+
+    vlc_tick_t start = vlc_tick_now();
+    libvlc_instance_t *vlc = libvlc_new(ARRAY_SIZE(argv), argv);
+    assert(vlc != NULL);
+    vlc_tick_t init = vlc_tick_now();
+
+    module_t *module = vlc_module_load(vlc->p_libvlc_int, cap, NULL, false,
+                                       probe);
+    vlc_tick_t first = vlc_tick_now();
+    if (module == NULL)
+        fprintf(stderr, "no \"%s\" module found\n", cap);
+
+    libvlc_release(vlc);
+
+    init -= start;
+    first -= start;
+    st->init_sum += init;
+    st->first_sum += first;
+    if (init < st->init_min)
+        st->init_min = init;
+    if (first < st->first_min)
+        st->first_min = first;
+}
+
+static void report(const char *name, const struct stats *st, unsigned n)
+{
+    printf("%-8s libvlc_new: min %8.3f ms, mean %8.3f ms | "
+           "first module: min %8.3f ms, mean %8.3f ms\n", name,
+           MS_FROM_VLC_TICK((double)st->init_min),
+           MS_FROM_VLC_TICK((double)st->init_sum / n),
+           MS_FROM_VLC_TICK((double)st->first_min),
+           MS_FROM_VLC_TICK((double)st->first_sum / n));
+}
+
+int main(int argc, char *argv[])
+{
+    unsigned n = (argc > 1) ? strtoul(argv[1], NULL, 0) : 10;
+    const char *cap = (argc > 2) ? argv[2] : "audio filter";
+
+    if (n == 0)
+        n = 1;
+
+    setenv("VLC_PLUGIN_PATH", "../modules", 1);
+
+    struct stats eager = { INT64_MAX, 0, INT64_MAX, 0 };
+    struct stats lazy = eager;
+
+    /* Warm up the page cache and the plugins cache file */
+    run(cap, false, &(struct stats){ INT64_MAX, 0, INT64_MAX, 0 });
+
+    for (unsigned i = 0; i < n; i++)
+    {
+        run(cap, false, &eager);
+        run(cap, true, &lazy);
+    }
+
+    printf("%u iterations, capability \"%s\"\n", n, cap);
+    report("eager", &eager, n);
+    report("lazy", &lazy, n);
+    return 0;
+}